@@ -32,6 +32,8 @@ SOFTWARE.
 /******************************************************************************
                     Includes section
 ******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
 
 /******************************************************************************
                    Define(s) section
@@ -52,5 +54,27 @@ void HAL_Console_Init( void );
  ******************************************************************************/
 void HAL_Console_Tx_Byte( uint8_t byte );
 
+/***************************************************************************//**
+ * Start sending a buffer on Debug Uart using DMA, returns immediately
+ * Buffer must remain unchanged until Console_TxDone() is called
+ * returns false if a transfer is already in progress
+ ******************************************************************************/
+bool HAL_Console_Tx_Dma( uint8_t const * buffer, uint16_t size );
+
+/***************************************************************************//**
+ * Return true while a DMA transfer is in progress
+ ******************************************************************************/
+bool HAL_Console_Tx_Busy( void );
+
+/***************************************************************************//**
+ * Wait until all bytes were shifted out of Debug Uart
+ ******************************************************************************/
+void HAL_Console_Flush( void );
+
+/***************************************************************************//**
+ * Change Debug Uart baudrate
+ ******************************************************************************/
+void HAL_Console_SetBaudrate( uint32_t baudrate );
+
 
 #endif //_HAL_CONSOLE_H
\ No newline at end of file
@@ -0,0 +1,76 @@
+/****************************************************************************//**
+  \file Hal_Flash.h
+
+  \brief Hardware abstraction layer for internal flash programming
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#ifndef _HAL_FLASH_
+#define _HAL_FLASH_
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    HAL_FLASH_SUCCESS,
+    HAL_FLASH_INVALID_ADDRESS,          //outside flash log region or not aligned
+    HAL_FLASH_LOCKED,                   //page is write protected
+    HAL_FLASH_ERROR,                    //controller reported a failure
+}HAL_Flash_Result_t;
+
+/***************************************************************************//**
+ * Return flash page size in bytes, smallest erasable unit
+ ******************************************************************************/
+uint32_t HAL_Flash_GetPageSize( void );
+
+/***************************************************************************//**
+ * Retreive flash region reserved for data logging by the linker script
+ * Region starts and ends on a page boundary
+ ******************************************************************************/
+void HAL_Flash_GetLogRegion( uint32_t * address, uint32_t * size );
+
+/***************************************************************************//**
+ * Erase a page of the log region, blocks until done (tens of ms)
+ *
+ * \param[in]   address     page start address
+ ******************************************************************************/
+HAL_Flash_Result_t HAL_Flash_ErasePage( uint32_t address );
+
+/***************************************************************************//**
+ * Write words to erased flash of the log region, blocks until done
+ *
+ * \param[in]   address     word aligned destination
+ * \param[in]   data        word aligned source, must be in RAM
+ * \param[in]   words       number of 32 bits words, must not cross a page
+ ******************************************************************************/
+HAL_Flash_Result_t HAL_Flash_Write( uint32_t address, uint32_t const * data, uint32_t words );
+
+#endif      //_HAL_FLASH_
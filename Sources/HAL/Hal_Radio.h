@@ -35,6 +35,12 @@ SOFTWARE.
 ******************************************************************************/
 #include "phy.h"
 
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Returned by HAL_Radio_GetRssi when no valid measurement is available
+#define HAL_RADIO_RSSI_INVALID          (-128 * 4)
+
 /******************************************************************************
                    Types section
 ******************************************************************************/
@@ -44,6 +50,19 @@ typedef enum {
     HAL_RADIO_GET_RX_PACKET_INVALID_PARAMETER,
 }HAL_Radio_GetRxPacket_Result_t;
 
+typedef enum {
+    HAL_RADIO_TRANSMIT_SUCCESS,
+    HAL_RADIO_TRANSMIT_INVALID_PARAMETER,
+    HAL_RADIO_TRANSMIT_BUSY,                //previous transmit not completed
+}HAL_Radio_Transmit_Result_t;
+
+//Outcome of a transmit, reported by HAL_Radio_TxCallback
+typedef enum {
+    HAL_RADIO_TX_SENT,
+    HAL_RADIO_TX_CHANNEL_BUSY,              //CSMA found channel busy on every try
+    HAL_RADIO_TX_ERROR,                     //aborted, blocked or underflow
+}HAL_Radio_Tx_Result_t;
+
 /***************************************************************************//**
  * Init radio ready for command
  ******************************************************************************/
@@ -59,6 +78,44 @@ void HAL_Radio_InitPromiscuousMode( void );
  ******************************************************************************/
 HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx );
 
+/***************************************************************************//**
+ * Discard oldest received packet without retreiving it
+ ******************************************************************************/
+void HAL_Radio_DropRxPacket( void );
+
+/***************************************************************************//**
+ * Return true if a received packet is waiting for HAL_Radio_GetRxPacket
+ ******************************************************************************/
+bool HAL_Radio_RxPending( void );
+
+/***************************************************************************//**
+ * Callback raised from interrupt context when a packet is received
+ ******************************************************************************/
+void HAL_Radio_RxCallback( void );
+
+/***************************************************************************//**
+ * Transmit a frame on current channel, radio returns to RX once done
+ *
+ * \param[in]   frame     PSDU without FCS, radio appends it
+ * \param[in]   length    frame length, FCS excluded
+ * \param[in]   csma      true to transmit after CSMA-CA, false transmits now
+ ******************************************************************************/
+HAL_Radio_Transmit_Result_t HAL_Radio_Transmit( uint8_t const * frame, uint8_t length, bool csma );
+
+/***************************************************************************//**
+ * Transmit a frame on current channel so that it ends at end_time
+ * A time already passed transmits now
+ *
+ * \param[in]   end_time  radio time in us, same time base as HAL_Radio_GetTime
+ ******************************************************************************/
+HAL_Radio_Transmit_Result_t HAL_Radio_TransmitAt( uint8_t const * frame, uint8_t length, uint32_t end_time );
+
+/***************************************************************************//**
+ * Callback raised from interrupt context when a transmit completes
+ * timestamp is radio time in us at end of frame when sent, else time of failure
+ ******************************************************************************/
+void HAL_Radio_TxCallback( HAL_Radio_Tx_Result_t result, uint32_t timestamp );
+
 /***************************************************************************//**
  * Select channel to use
  *
@@ -66,5 +123,22 @@ HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx );
  ******************************************************************************/
 void HAL_SetRadioChannel( uint8_t channel );
 
+/***************************************************************************//**
+ * Return radio channel
+ ******************************************************************************/
+uint8_t HAL_GetRadioChannel( void );
+
+/***************************************************************************//**
+ * Return radio time base in microseconds
+ * Same time base as PhyRx_t timestamp
+ ******************************************************************************/
+uint32_t HAL_Radio_GetTime( void );
+
+/***************************************************************************//**
+ * Return instantaneous RSSI of current channel in quarter dBm
+ * Does not wait nor leave RX, HAL_RADIO_RSSI_INVALID while not receiving
+ ******************************************************************************/
+int16_t HAL_Radio_GetRssi( void );
+
 
 #endif //_HAL_RADIO_
\ No newline at end of file
@@ -0,0 +1,68 @@
+/****************************************************************************//**
+  \file Hal_System.h
+
+  \brief Hardware abstraction layer for core system services
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#ifndef _HAL_SYSTEM_
+#define _HAL_SYSTEM_
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+
+/***************************************************************************//**
+ * Enter a critical section (interrupts masked)
+ * Returns the previous interrupt state, to be given back to
+ * HAL_System_ExitCritical. Calls can be nested.
+ ******************************************************************************/
+uint32_t HAL_System_EnterCritical( void );
+
+/***************************************************************************//**
+ * Leave a critical section and restore previous interrupt state
+ ******************************************************************************/
+void HAL_System_ExitCritical( uint32_t state );
+
+/***************************************************************************//**
+ * Sleep until next interrupt
+ * Call with interrupts masked by HAL_System_EnterCritical() so an interrupt
+ * occuring after the decision to sleep still wakes the core up
+ ******************************************************************************/
+void HAL_System_Sleep( void );
+
+/***************************************************************************//**
+ * Start core clock cycles counter read by HAL_CYCLE_COUNT()
+ ******************************************************************************/
+void HAL_System_CycleCounterInit( void );
+
+/***************************************************************************//**
+ * Reset the microcontroller, does not return
+ ******************************************************************************/
+void HAL_System_Reset( void );
+
+
+#endif //_HAL_SYSTEM_
@@ -0,0 +1,76 @@
+/****************************************************************************//**
+  \file Hal_Timer.h
+
+  \brief Hardware abstraction layer for software timers
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#ifndef _HAL_TIMER_
+#define _HAL_TIMER_
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Number of independent timers
+#define HAL_TIMER_COUNT         24
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+//Called from interrupt context upon timer expiration
+typedef void (*HAL_Timer_Callback_t)( uint8_t timer );
+
+/***************************************************************************//**
+ * Init timers, radio must be initialized first
+ ******************************************************************************/
+void HAL_Timer_Init( void );
+
+/***************************************************************************//**
+ * Start a timer, restart it if already running
+ * A periodic timer is rearmed relative to its expected expiration so it
+ * does not drift
+ *
+ * \param[in]   timer       0 to HAL_TIMER_COUNT - 1
+ * \param[in]   delay_us    delay or period in microseconds
+ ******************************************************************************/
+bool HAL_Timer_Start( uint8_t timer, uint32_t delay_us, bool periodic, HAL_Timer_Callback_t callback );
+
+/***************************************************************************//**
+ * Stop a timer
+ ******************************************************************************/
+void HAL_Timer_Stop( uint8_t timer );
+
+/***************************************************************************//**
+ * Return true if timer is running
+ ******************************************************************************/
+bool HAL_Timer_IsRunning( uint8_t timer );
+
+#endif      //_HAL_TIMER_
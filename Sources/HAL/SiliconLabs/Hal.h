@@ -34,6 +34,18 @@ SOFTWARE.
 #include "Hal_Clocks.h"
 #include "Hal_Console.h"
 #include "Hal_Radio.h"
+#include "Hal_System.h"
+#include "Hal_Timer.h"
+#include "Hal_Flash.h"
+#include "em_device.h"
+
+//Core clock cycles counter, see HAL_System_CycleCounterInit
+#define HAL_CYCLE_COUNT()       (DWT->CYCCNT)
+
+//Function executed from RAM, avoids flash wait states on the hot path
+//Copied at startup with initialized data, see .ramfunc in linker script
+//Calls between flash and RAM go through linker generated veneers
+#define HAL_RAMFUNC             __attribute__((section(".ramfunc"), noinline))
 
 
 
@@ -30,6 +30,7 @@ SOFTWARE.
 #include "Hal.h"
 #include "em_usart.h"
 #include "em_cmu.h"
+#include "em_ldma.h"
 #include "console.h"
 
 /***************************************************************************//**
@@ -60,6 +61,8 @@ SOFTWARE.
 /***************************************************************************//**
  * Local variables
  ******************************************************************************/
+static LDMA_Descriptor_t consoleTxDescriptor;
+static volatile bool consoleTxDmaBusy = false;
 
 /***************************************************************************//**
  * Local functions
@@ -170,6 +173,11 @@ void HAL_Console_Init( void )
     console_usart->IF_CLR = USART_IF_RXDATAV;
     //try to enable interrupt
     console_usart->IEN_SET = USART_IEN_RXDATAV;
+
+    // TX DMA //
+    const LDMA_Init_t ldma_init = LDMA_INIT_DEFAULT;
+    LDMA_Init(&ldma_init);
+    consoleTxDmaBusy = false;
 }
 
 /***************************************************************************//**
@@ -179,14 +187,75 @@ void HAL_Console_Init( void )
 void HAL_Console_Tx_Byte( uint8_t byte )
 {
     USART_TypeDef * console_usart = HAL_CONSOLE_USART;
+    //do not interleave with a DMA transfer
+    while( consoleTxDmaBusy ){};
     while( (console_usart->STATUS & USART_STATUS_TXBL) != USART_STATUS_TXBL){};
     console_usart->TXDATA = byte;
 }
 
 
-//using dma - todo
-//DMADRV_MemoryPeripheral
-//StartTransmitDma
+/***************************************************************************//**
+ * Wait until all bytes were shifted out of debug uart
+ ******************************************************************************/
+void HAL_Console_Flush( void )
+{
+    USART_TypeDef * console_usart = HAL_CONSOLE_USART;
+    while( consoleTxDmaBusy ){};
+    while( (console_usart->STATUS & USART_STATUS_TXC) != USART_STATUS_TXC){};
+}
+
+/***************************************************************************//**
+ * Change debug uart baudrate
+ * Pending bytes are sent at previous baudrate
+ ******************************************************************************/
+void HAL_Console_SetBaudrate( uint32_t baudrate )
+{
+    HAL_Console_Flush();
+    USART_BaudrateAsyncSet( HAL_CONSOLE_USART, 0, baudrate, usartOVS16 );
+}
+
+/***************************************************************************//**
+ * Start sending a buffer on debug uart using DMA
+ * Completion is reported by Console_TxDone() from interrupt context
+ ******************************************************************************/
+bool HAL_Console_Tx_Dma( uint8_t const * buffer, uint16_t size )
+{
+    const LDMA_TransferCfg_t transfer = LDMA_TRANSFER_CFG_PERIPHERAL( HAL_CONSOLE_TX_DMA_SIGNAL );
+
+    //a single descriptor moves up to 2048 bytes
+    if( consoleTxDmaBusy || size == 0 || size > (_LDMA_CH_CTRL_XFERCNT_MASK >> _LDMA_CH_CTRL_XFERCNT_SHIFT) + 1 )
+    {
+        return false;
+    }
+
+    consoleTxDescriptor = (LDMA_Descriptor_t) LDMA_DESCRIPTOR_SINGLE_M2P_BYTE( buffer, &(HAL_CONSOLE_USART->TXDATA), size );
+    consoleTxDmaBusy = true;
+    LDMA_StartTransfer( HAL_CONSOLE_TX_DMA_CHANNEL, &transfer, &consoleTxDescriptor );
+    return true;
+}
+
+/***************************************************************************//**
+ * Return true while a DMA transfer is in progress
+ ******************************************************************************/
+bool HAL_Console_Tx_Busy( void )
+{
+    return consoleTxDmaBusy;
+}
+
+/***************************************************************************//**
+ * DMA interrupt handler, console is the only DMA user
+ ******************************************************************************/
+void LDMA_IRQHandler( void )
+{
+    uint32_t pending = LDMA_IntGetEnabled();
+
+    LDMA_IntClear( pending );
+    if( pending & (1 << HAL_CONSOLE_TX_DMA_CHANNEL) )
+    {
+        consoleTxDmaBusy = false;
+        Console_TxDone();
+    }
+}
 
 /***************************************************************************//**
  * UART interrupt handler
@@ -0,0 +1,170 @@
+/****************************************************************************//**
+  \file Hal_Flash.c
+
+  \brief Hardware abstraction layer for internal flash, MSC write controller
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Local defines
+ ******************************************************************************/
+//Any value other than the unlock key locks MSC registers
+#define HAL_FLASH_MSC_LOCK          0
+
+//Flash log region boundaries, from linker script
+extern uint32_t __flashlog_start__;
+extern uint32_t __flashlog_end__;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static bool hal_flash_in_log_region( uint32_t address, uint32_t size );
+static HAL_Flash_Result_t hal_flash_status( void );
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/***************************************************************************//**
+ * Return true if range is inside flash log region, application code is
+ * never erased or written through this HAL
+ ******************************************************************************/
+static bool hal_flash_in_log_region( uint32_t address, uint32_t size )
+{
+    uint32_t start = (uint32_t)(uintptr_t)&__flashlog_start__;
+    uint32_t end = (uint32_t)(uintptr_t)&__flashlog_end__;
+
+    return ( address >= start ) && ( address < end ) && ( size <= end - address );
+}
+
+/***************************************************************************//**
+ * Translate MSC status of last operation, runs from RAM
+ ******************************************************************************/
+HAL_RAMFUNC static HAL_Flash_Result_t hal_flash_status( void )
+{
+    uint32_t status = MSC->STATUS;
+
+    if( status & MSC_STATUS_LOCKED )
+    {
+        return HAL_FLASH_LOCKED;
+    }
+    if( status & (MSC_STATUS_INVADDR | MSC_STATUS_TIMEOUT) )
+    {
+        return HAL_FLASH_ERROR;
+    }
+    return HAL_FLASH_SUCCESS;
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/***************************************************************************//**
+ * Return flash page size in bytes
+ ******************************************************************************/
+uint32_t HAL_Flash_GetPageSize( void )
+{
+    return FLASH_PAGE_SIZE;
+}
+
+/***************************************************************************//**
+ * Retreive flash region reserved for data logging by the linker script
+ ******************************************************************************/
+void HAL_Flash_GetLogRegion( uint32_t * address, uint32_t * size )
+{
+    *address = (uint32_t)(uintptr_t)&__flashlog_start__;
+    *size = (uint32_t)(uintptr_t)&__flashlog_end__ - (uint32_t)(uintptr_t)&__flashlog_start__;
+}
+
+/***************************************************************************//**
+ * Erase a page of the log region
+ * Runs from RAM, flash can't be read while it is erased. Interrupt handlers
+ * located in flash are stalled until erase completes
+ ******************************************************************************/
+HAL_RAMFUNC HAL_Flash_Result_t HAL_Flash_ErasePage( uint32_t address )
+{
+    HAL_Flash_Result_t result;
+
+    if( (address % FLASH_PAGE_SIZE) || !hal_flash_in_log_region( address, FLASH_PAGE_SIZE ) )
+    {
+        return HAL_FLASH_INVALID_ADDRESS;
+    }
+
+    MSC->LOCK = MSC_LOCK_LOCKKEY_UNLOCK;
+    MSC->WRITECTRL_SET = MSC_WRITECTRL_WREN;
+
+    MSC->ADDRB = address;
+    result = hal_flash_status();
+    if( result == HAL_FLASH_SUCCESS )
+    {
+        MSC->WRITECMD = MSC_WRITECMD_ERASEPAGE;
+        while( MSC->STATUS & MSC_STATUS_BUSY );
+        result = hal_flash_status();
+    }
+
+    MSC->WRITECTRL_CLR = MSC_WRITECTRL_WREN;
+    MSC->LOCK = HAL_FLASH_MSC_LOCK;
+    return result;
+}
+
+/***************************************************************************//**
+ * Write words to erased flash of the log region
+ * Runs from RAM, see HAL_Flash_ErasePage
+ ******************************************************************************/
+HAL_RAMFUNC HAL_Flash_Result_t HAL_Flash_Write( uint32_t address, uint32_t const * data, uint32_t words )
+{
+    HAL_Flash_Result_t result;
+
+    //address auto increment does not cross a page boundary
+    if( (address % sizeof(uint32_t)) ||
+        ((address % FLASH_PAGE_SIZE) + words * sizeof(uint32_t) > FLASH_PAGE_SIZE) ||
+        !hal_flash_in_log_region( address, words * sizeof(uint32_t) ) )
+    {
+        return HAL_FLASH_INVALID_ADDRESS;
+    }
+
+    MSC->LOCK = MSC_LOCK_LOCKKEY_UNLOCK;
+    MSC->WRITECTRL_SET = MSC_WRITECTRL_WREN;
+
+    MSC->ADDRB = address;
+    result = hal_flash_status();
+    for( uint32_t i = 0; i < words && result == HAL_FLASH_SUCCESS; i++ )
+    {
+        //controller auto increments address within a page
+        while( (MSC->STATUS & MSC_STATUS_WDATAREADY) == 0 );
+        MSC->WDATA = data[i];
+        result = hal_flash_status();
+    }
+    MSC->WRITECMD = MSC_WRITECMD_WRITEEND;
+    while( MSC->STATUS & MSC_STATUS_BUSY );
+    if( result == HAL_FLASH_SUCCESS )
+    {
+        result = hal_flash_status();
+    }
+
+    MSC->WRITECTRL_CLR = MSC_WRITECTRL_WREN;
+    MSC->LOCK = HAL_FLASH_MSC_LOCK;
+    return result;
+}
@@ -31,16 +31,22 @@ SOFTWARE.
 #include "rail.h"
 #include "rail_ieee802154.h"
 #include "printf.h"
+#include "profiler.h"
 
 /***************************************************************************//**
  * Private defines
  ******************************************************************************/
+//2.4 GHz O-QPSK, 32 us per byte, SHR is preamble (4) and SFD
+#define RADIO_US_PER_BYTE           32
+#define RADIO_SHR_SIZE              5
 
 /***************************************************************************//**
  * Local prototypes
  ******************************************************************************/
 static void radioEventHandler(RAIL_Handle_t railHandle,
                               RAIL_Events_t events);
+static void radio_tx_completed( RAIL_Handle_t railHandle, RAIL_Events_t events );
+static bool radio_load_tx_fifo( uint8_t const * frame, uint8_t length );
 
 
 /***************************************************************************//**
@@ -91,15 +97,50 @@ static uint8_t RadioTxFifo[RADIO_TX_FIFO_SIZE];
 
 static uint8_t MainChannel = 11;        //default channel 11
 
+//CSMA-CA as used by ZigBee, channel is sensed before each transmit
+static const RAIL_CsmaConfig_t radioCsmaConfig = RAIL_CSMA_CONFIG_802_15_4_2003_2p4_GHz_OQPSK_CSMA;
+
+static uint8_t radioTxPacketBytes;      //PHR and PSDU of transmit in progress
+
 
 
 /***************************************************************************//**
  * Private functions
  ******************************************************************************/
-static void radioEventHandler(RAIL_Handle_t railHandle,
+/***************************************************************************//**
+ * Report transmit outcome, interrupt context
+ * Sent frames are timestamped at end of frame, same as received ones
+ ******************************************************************************/
+HAL_RAMFUNC static void radio_tx_completed( RAIL_Handle_t railHandle, RAIL_Events_t events )
+{
+    RAIL_TxPacketDetails_t details;
+
+    if( (events & RAIL_EVENT_TX_PACKET_SENT) != 0 )
+    {
+        details.isAck = false;
+        details.timeSent.timePosition = RAIL_PACKET_TIME_AT_PACKET_END;
+        details.timeSent.totalPacketBytes = radioTxPacketBytes;
+        if( RAIL_GetTxPacketDetailsAlt2( railHandle, &details ) != RAIL_STATUS_NO_ERROR )
+        {
+            details.timeSent.packetTime = RAIL_GetTime();
+        }
+        HAL_Radio_TxCallback( HAL_RADIO_TX_SENT, details.timeSent.packetTime );
+    }
+    else if( (events & RAIL_EVENT_TX_CHANNEL_BUSY) != 0 )
+    {
+        HAL_Radio_TxCallback( HAL_RADIO_TX_CHANNEL_BUSY, RAIL_GetTime() );
+    }
+    else
+    {
+        HAL_Radio_TxCallback( HAL_RADIO_TX_ERROR, RAIL_GetTime() );
+    }
+}
+
+HAL_RAMFUNC static void radioEventHandler(RAIL_Handle_t railHandle,
                               RAIL_Events_t events)
 {
     RAIL_RxPacketHandle_t handle;
+    PROF_START( PROFILER_PROBE_RADIO_EVENT );
 
     if( (events & RAIL_EVENT_RX_PACKET_RECEIVED) == RAIL_EVENT_RX_PACKET_RECEIVED )
     {
@@ -113,6 +154,7 @@ static void radioEventHandler(RAIL_Handle_t railHandle,
             // sl_led_turn_off (&sl_led_led0);
             mainPacketHandle = handle;
         }
+        HAL_Radio_RxCallback();
     }
 
     if( (events & ( RAIL_EVENT_RX_SYNC1_DETECT | RAIL_EVENT_RX_SYNC2_DETECT)) != 0 )
@@ -125,9 +167,34 @@ static void radioEventHandler(RAIL_Handle_t railHandle,
     {
         BSP_ClrLed();
     }
+
+    if( (events & RAIL_EVENTS_TX_COMPLETION) != 0 )
+    {
+        radio_tx_completed( railHandle, events );
+    }
+    PROF_STOP( PROFILER_PROBE_RADIO_EVENT );
 }
 
 
+/***************************************************************************//**
+ * Write PHR and frame to TX FIFO, PHR counts the FCS appended by the radio
+ ******************************************************************************/
+static bool radio_load_tx_fifo( uint8_t const * frame, uint8_t length )
+{
+    uint8_t phr;
+
+    if( (frame == NULL) || (length == 0) || (length > PHY_TX_FRAME_MAX) )
+    {
+        return false;
+    }
+
+    phr = length + PHY_FCS_SIZE;
+    RAIL_WriteTxFifo( gRailHandle, &phr, 1, true );
+    RAIL_WriteTxFifo( gRailHandle, frame, length, false );
+    radioTxPacketBytes = phr + 1;
+    return true;
+}
+
 /***************************************************************************//**
  * Global functions
  ******************************************************************************/
@@ -171,7 +238,7 @@ void HAL_Radio_InitPromiscuousMode( void )
     // Configures the most useful callbacks and catches a few errors.
     RAIL_ConfigEvents(gRailHandle,
                     RAIL_EVENTS_ALL,
-                    RAIL_EVENT_TX_PACKET_SENT
+                    RAIL_EVENTS_TX_COMPLETION
                     | RAIL_EVENTS_RX_COMPLETION
                     | RAIL_EVENT_RX_SYNC1_DETECT
                     | RAIL_EVENT_RX_SYNC2_DETECT);      //Detect begin of a messages
@@ -198,7 +265,7 @@ void HAL_Radio_InitPromiscuousMode( void )
 /***************************************************************************//**
  * Process radio incoming messages
  ******************************************************************************/
-HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx )
+HAL_RAMFUNC HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx )
 {
     RAIL_RxPacketInfo_t packetInfo;
     RAIL_RxPacketDetails_t packetDetails;
@@ -209,10 +276,16 @@ HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx )
         return HAL_RADIO_GET_RX_PACKET_INVALID_PARAMETER;
     }
     phy_rx->len = 0;
+    phy_rx->repeats = 0;
+    phy_rx->weight = 1;
+    PROF_START( PROFILER_PROBE_RADIO_GET_RX );
 
     if( mainPacketHandle != RAIL_RX_PACKET_HANDLE_INVALID )
     {
         RAIL_GetRxPacketInfo(gRailHandle, mainPacketHandle, &packetInfo);
+        //timestamp end of frame, all bytes after sync word (PHR + PSDU)
+        packetDetails.timeReceived.timePosition = RAIL_PACKET_TIME_AT_PACKET_END;
+        packetDetails.timeReceived.totalPacketBytes = packetInfo.packetBytes;
         RAIL_GetRxPacketDetails(gRailHandle, mainPacketHandle, &packetDetails);
 
         if( (packetInfo.packetBytes < PHY_PAYLOAD_MAX + 1) && (packetInfo.packetBytes != 0) )
@@ -228,6 +301,7 @@ HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx )
             phy_rx->rssi = packetDetails.rssi;
             phy_rx->lqi = packetDetails.lqi;
             phy_rx->channel = MainChannel;
+            phy_rx->timestamp = packetDetails.timeReceived.packetTime;
             packet_received = true;
             // //RAIL_GetChannel() //to retreive channel
             // MAC_ProcessPhyRx( &phy_rx );
@@ -235,6 +309,7 @@ HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx )
         RAIL_ReleaseRxPacket(gRailHandle, mainPacketHandle);
         mainPacketHandle = RAIL_GetRxPacketInfo(gRailHandle, RAIL_RX_PACKET_HANDLE_OLDEST_COMPLETE, &packetInfo);
     }
+    PROF_STOP( PROFILER_PROBE_RADIO_GET_RX );
 
     if( packet_received )
     {
@@ -244,6 +319,103 @@ HAL_Radio_GetRxPacket_Result_t  HAL_Radio_GetRxPacket( PhyRx_t * phy_rx )
     }
 }
 
+/***************************************************************************//**
+ * Discard oldest received packet without retreiving it
+ ******************************************************************************/
+void HAL_Radio_DropRxPacket( void )
+{
+    RAIL_RxPacketInfo_t packetInfo;
+
+    if( mainPacketHandle != RAIL_RX_PACKET_HANDLE_INVALID )
+    {
+        RAIL_ReleaseRxPacket(gRailHandle, mainPacketHandle);
+        mainPacketHandle = RAIL_GetRxPacketInfo(gRailHandle, RAIL_RX_PACKET_HANDLE_OLDEST_COMPLETE, &packetInfo);
+    }
+}
+
+/***************************************************************************//**
+ * Return true if a received packet is waiting for HAL_Radio_GetRxPacket
+ ******************************************************************************/
+bool HAL_Radio_RxPending( void )
+{
+    return ( mainPacketHandle != RAIL_RX_PACKET_HANDLE_INVALID );
+}
+
+/***************************************************************************//**
+ * Callback raised from interrupt context when a packet is received
+ ******************************************************************************/
+void __attribute__((weak)) HAL_Radio_RxCallback( void )
+{
+}
+
+/***************************************************************************//**
+ * Transmit a frame on current channel, radio returns to RX once done
+ ******************************************************************************/
+HAL_Radio_Transmit_Result_t HAL_Radio_Transmit( uint8_t const * frame, uint8_t length, bool csma )
+{
+    RAIL_Status_t status;
+
+    if( !radio_load_tx_fifo( frame, length ) )
+    {
+        return HAL_RADIO_TRANSMIT_INVALID_PARAMETER;
+    }
+
+    if( csma )
+    {
+        status = RAIL_StartCcaCsmaTx( gRailHandle, MainChannel, RAIL_TX_OPTIONS_DEFAULT, &radioCsmaConfig, NULL );
+    }else{
+        status = RAIL_StartTx( gRailHandle, MainChannel, RAIL_TX_OPTIONS_DEFAULT, NULL );
+    }
+
+    if( status != RAIL_STATUS_NO_ERROR )
+    {
+        return HAL_RADIO_TRANSMIT_BUSY;
+    }
+    return HAL_RADIO_TRANSMIT_SUCCESS;
+}
+
+/***************************************************************************//**
+ * Transmit a frame on current channel so that it ends at end_time
+ * RAIL schedules the start of the frame, air time is removed from end_time.
+ * RAIL refuses a time already passed, the frame is then sent now and the
+ * completion timestamp shows the lateness. A frame being received at start
+ * time postpones the transmit.
+ ******************************************************************************/
+HAL_Radio_Transmit_Result_t HAL_Radio_TransmitAt( uint8_t const * frame, uint8_t length, uint32_t end_time )
+{
+    RAIL_ScheduleTxConfig_t schedule;
+    RAIL_Status_t status;
+
+    if( !radio_load_tx_fifo( frame, length ) )
+    {
+        return HAL_RADIO_TRANSMIT_INVALID_PARAMETER;
+    }
+
+    schedule.when = end_time - ((RADIO_SHR_SIZE + radioTxPacketBytes) * RADIO_US_PER_BYTE);
+    schedule.mode = RAIL_TIME_ABSOLUTE;
+    schedule.txDuringRx = RAIL_SCHEDULED_TX_DURING_RX_POSTPONE_TX;
+    status = RAIL_StartScheduledTx( gRailHandle, MainChannel, RAIL_TX_OPTIONS_DEFAULT, &schedule, NULL );
+    if( status != RAIL_STATUS_NO_ERROR )
+    {
+        status = RAIL_StartTx( gRailHandle, MainChannel, RAIL_TX_OPTIONS_DEFAULT, NULL );
+    }
+
+    if( status != RAIL_STATUS_NO_ERROR )
+    {
+        return HAL_RADIO_TRANSMIT_BUSY;
+    }
+    return HAL_RADIO_TRANSMIT_SUCCESS;
+}
+
+/***************************************************************************//**
+ * Callback raised from interrupt context when a transmit completes
+ ******************************************************************************/
+void __attribute__((weak)) HAL_Radio_TxCallback( HAL_Radio_Tx_Result_t result, uint32_t timestamp )
+{
+    (void) result;
+    (void) timestamp;
+}
+
 /***************************************************************************//**
  * Select channel to use
  *
@@ -260,5 +432,32 @@ void HAL_SetRadioChannel( uint8_t channel )
 }
 
 
+/***************************************************************************//**
+ * Return radio channel
+ ******************************************************************************/
+uint8_t HAL_GetRadioChannel( void )
+{
+    return MainChannel;
+}
+
+/***************************************************************************//**
+ * Return radio time base in microseconds
+ ******************************************************************************/
+uint32_t HAL_Radio_GetTime( void )
+{
+    return RAIL_GetTime();
+}
+
+/***************************************************************************//**
+ * Return instantaneous RSSI of current channel in quarter dBm
+ * RAIL_StartAverageRssi needs an idle radio, reception would be lost
+ ******************************************************************************/
+int16_t HAL_Radio_GetRssi( void )
+{
+    int16_t rssi = RAIL_GetRssi( gRailHandle, false );
+
+    return ( rssi == RAIL_RSSI_INVALID ) ? HAL_RADIO_RSSI_INVALID : rssi;
+}
+
 /***************************************************************************//**
  ******************************************************************************/
@@ -0,0 +1,77 @@
+/****************************************************************************//**
+  \file Hal_System.c
+
+  \brief Hardware abstraction layer for core system services
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#include "Hal.h"
+#include "em_core.h"
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * Enter a critical section (interrupts masked)
+ ******************************************************************************/
+uint32_t HAL_System_EnterCritical( void )
+{
+    return CORE_EnterCritical();
+}
+
+/***************************************************************************//**
+ * Leave a critical section and restore previous interrupt state
+ ******************************************************************************/
+void HAL_System_ExitCritical( uint32_t state )
+{
+    CORE_ExitCritical( state );
+}
+
+/***************************************************************************//**
+ * Sleep until next interrupt (EM1, radio keeps running)
+ ******************************************************************************/
+void HAL_System_Sleep( void )
+{
+    __WFI();
+}
+
+/***************************************************************************//**
+ * Start DWT cycle counter, counts at core clock and wraps every 53s at 80MHz
+ ******************************************************************************/
+void HAL_System_CycleCounterInit( void )
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/***************************************************************************//**
+ * Reset the microcontroller, does not return
+ ******************************************************************************/
+void HAL_System_Reset( void )
+{
+    NVIC_SystemReset();
+}
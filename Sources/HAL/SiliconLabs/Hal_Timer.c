@@ -0,0 +1,114 @@
+/****************************************************************************//**
+  \file Hal_Timer.c
+
+  \brief Hardware abstraction layer for software timers, built on RAIL multitimer
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+
+#include "Hal.h"
+#include "rail.h"
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void hal_timer_expired( RAIL_MultiTimer_t * tmr, RAIL_Time_t expectedTimeOfEvent, void * cbArg );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static RAIL_MultiTimer_t halTimers[HAL_TIMER_COUNT];
+static HAL_Timer_Callback_t halTimerCallbacks[HAL_TIMER_COUNT];
+static uint32_t halTimerPeriods[HAL_TIMER_COUNT];       //0 for one shot timer
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/***************************************************************************//**
+ * RAIL multitimer expiration, interrupt context
+ ******************************************************************************/
+static void hal_timer_expired( RAIL_MultiTimer_t * tmr, RAIL_Time_t expectedTimeOfEvent, void * cbArg )
+{
+    uint8_t timer = (uint8_t)(uintptr_t)cbArg;
+
+    if( halTimerPeriods[timer] )
+    {
+        RAIL_SetMultiTimer( tmr, expectedTimeOfEvent + halTimerPeriods[timer], RAIL_TIME_ABSOLUTE, hal_timer_expired, cbArg );
+    }
+
+    if( halTimerCallbacks[timer] != NULL )
+    {
+        halTimerCallbacks[timer]( timer );
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/***************************************************************************//**
+ * Init timers, radio must be initialized first
+ ******************************************************************************/
+void HAL_Timer_Init( void )
+{
+    RAIL_ConfigMultiTimer( true );
+}
+
+/***************************************************************************//**
+ * Start a timer, restart it if already running
+ ******************************************************************************/
+bool HAL_Timer_Start( uint8_t timer, uint32_t delay_us, bool periodic, HAL_Timer_Callback_t callback )
+{
+    if( timer >= HAL_TIMER_COUNT || (periodic && delay_us == 0) )
+    {
+        return false;
+    }
+
+    halTimerCallbacks[timer] = callback;
+    halTimerPeriods[timer] = periodic ? delay_us : 0;
+    return ( RAIL_SetMultiTimer( &halTimers[timer], delay_us, RAIL_TIME_DELAY, hal_timer_expired, (void *)(uintptr_t)timer ) == RAIL_STATUS_NO_ERROR );
+}
+
+/***************************************************************************//**
+ * Stop a timer
+ ******************************************************************************/
+void HAL_Timer_Stop( uint8_t timer )
+{
+    if( timer < HAL_TIMER_COUNT )
+    {
+        halTimerPeriods[timer] = 0;
+        RAIL_CancelMultiTimer( &halTimers[timer] );
+    }
+}
+
+/***************************************************************************//**
+ * Return true if timer is running
+ ******************************************************************************/
+bool HAL_Timer_IsRunning( uint8_t timer )
+{
+    if( timer >= HAL_TIMER_COUNT )
+    {
+        return false;
+    }
+    return RAIL_IsMultiTimerRunning( &halTimers[timer] );
+}
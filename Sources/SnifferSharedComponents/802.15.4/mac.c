@@ -32,6 +32,7 @@ SOFTWARE.
 #include "mac.h"
 #include "mac_unpack.h"
 #include "console.h"
+#include "log.h"
 #include "phy.h"
 #include "string.h"
 
@@ -74,23 +75,8 @@ void MAC_ProcessPhyRx( PhyRx_t * phy_rx)
         return;
     }
 
-    // Console_Print("RX msg\n\r");
-    // // uint8_t len;
-    // // uint8_t payload[PHY_PAYLOAD_MAX];
-    // // uint8_t lqi;
-    // // uint8_t rssi;
-
-    // Console_Print("len: %d\n\r", phy_rx->len);
-    // Console_Print("lqi: %d\n\r", phy_rx->lqi);
-    // Console_Print("rssi: %d\n\r", phy_rx->rssi);
-
-    // for( uint8_t i = 0; i < phy_rx->len; i++ ){
-    //     if( (i % 16) == 0 && i != 0 ){
-    //         Console_Print("\n\r");
-    //     }
-    //     Console_Print("%02x ", phy_rx->payload[i]);
-    // }
-    // Console_Print("\n\r");
+    //Formatting is done by host, frame content is already sent on capture channel
+    LOG_DEBUG( "RX msg len: %d lqi: %d rssi: %d channel: %d", phy_rx->len, phy_rx->lqi, phy_rx->rssi, phy_rx->channel );
 
 
     //Callback used to process any incoming frame
@@ -212,6 +198,7 @@ int MAC_TxAssociationRequest( uint16_t dest_pan, uint16_t dest_shortID )
 
     frame.frame_control.source_addressing_mode          = MAC_ADDRESSING_MODE_EXTENDED_ADDRESS;
     frame.source_addr.long_addr                         = 0xCAFEBABEDEADBEEF;
+    frame.source_pan_id                                 = MAC_BROADCAST_ALL;
     // frame.source_addr.long_addr                         = GetOwnExtendedAddress();
 
     frame.payload_size = 1;
@@ -71,6 +71,8 @@ void MAC_Init( void );
 
 /**************************************************************************//**
 \brief MAC reception function
+phy_rx is a pool buffer borrowed for the duration of the call,
+a stage keeping it afterward must take a reference with Pool_Retain
 ******************************************************************************/
 void MAC_ProcessPhyRx( PhyRx_t * phy_rx);
 
@@ -79,6 +81,18 @@ void MAC_ProcessPhyRx( PhyRx_t * phy_rx);
 ******************************************************************************/
 uint8_t MAC_GetNextSequenceNumber( void );
 
+/**************************************************************************//**
+\brief Send Beacon Request, broadcast on current channel after CSMA-CA
+returns 0 when queued for transmission, -1 otherwise
+******************************************************************************/
+int MAC_Tx_BeaconRequest( void );
+
+/**************************************************************************//**
+\brief Send Association Request
+returns 0 when queued for transmission, -1 otherwise
+******************************************************************************/
+int MAC_TxAssociationRequest( uint16_t dest_pan, uint16_t dest_shortID );
+
 /**************************************************************************//**
 \brief callback for MAC pre message process
 This callback is raised upon reception of any frame from phy before any
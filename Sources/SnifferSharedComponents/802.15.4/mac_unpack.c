@@ -32,6 +32,7 @@ SOFTWARE.
 #include "mac_unpack.h"
 #include "string.h"
 #include "crc.h"
+#include "profiler.h"
 
 /******************************************************************************
                    Implementations section
@@ -88,21 +89,153 @@ static const PANID_Compression_Presence_t TABLE7_2_PANID_Compression[] =
 
 #define NB_OF_ELEMENT_PANID_COMPRESSION_0b10    (sizeof(TABLE7_2_PANID_Compression)/sizeof(TABLE7_2_PANID_Compression[0]))
 
+//Frame control and MAC header layout, by frame type
+typedef enum {
+    MAC_FORMAT_UNSUPPORTED,
+    MAC_FORMAT_GENERAL,                 //2 octets frame control, 7.2.1
+    MAC_FORMAT_MULTIPURPOSE,            //1 or 2 octets frame control, 7.3.5
+    MAC_FORMAT_SHORT,                   //1 octet frame control, no MAC header field
+}MAC_Frame_Format_t;
+
+static const MAC_Frame_Format_t MAC_Frame_Type_Format[] =
+{
+    MAC_FORMAT_GENERAL,                 //beacon
+    MAC_FORMAT_GENERAL,                 //data
+    MAC_FORMAT_GENERAL,                 //ack
+    MAC_FORMAT_GENERAL,                 //command
+    MAC_FORMAT_UNSUPPORTED,             //reserved
+    MAC_FORMAT_MULTIPURPOSE,            //multipurpose
+    MAC_FORMAT_SHORT,                   //fragment or Frak
+    MAC_FORMAT_SHORT,                   //extended
+};
+
+//See 802.15.4 table 9.6, MIC size per security level
+static const uint8_t MAC_Security_MIC_Size[] = { 0, 4, 8, 16, 0, 4, 8, 16 };
+
+//See 802.15.4 table 9.7, key source size per key identifier mode
+static const uint8_t MAC_Security_Key_Source_Size[] = { 0, 0, 4, 8 };
+
 
 /******************************************************************************
                    Local function section
 ******************************************************************************/
+/**************************************************************************//**
+\brief Decode a general frame control, see 802.15.4-2015 7.2.1
+******************************************************************************/
+static void mac_unpack_frame_control( uint16_t frame_control, MAC_Frame_Control_t * out )
+{
+    out->security_enabled             = ((frame_control & MHR_FRAMECONTROL_SECURITY_ENABLED_MSK) == MHR_FRAMECONTROL_SECURITY_ENABLED) ? MAC_SECURITY_ENABLED : MAC_SECURITY_DISABLED;
+    out->frame_pending                = ((frame_control & MHR_FRAMECONTROL_FRAME_PENDING_MSK) == MHR_FRAMECONTROL_FRAME_PENDING) ? MAC_FRAME_PENDING_DATA_PENDING : MAC_FRAME_PENDING_NONE;
+    out->acknowledge_request          = ((frame_control & MHR_FRAMECONTROL_AR_MSK) == MHR_FRAMECONTROL_AR) ? MAC_ACKNOWLEDGE_REQUEST_REQUIRED : MAC_ACKNOWLEDGE_REQUEST_NONE;
+    out->panid_compression            = ((frame_control & MHR_FRAMECONTROL_PANID_COMPRESSION_MSK) == MHR_FRAMECONTROL_PANID_COMPRESSION) ? MAC_PANID_COMPRESSION_ENABLED : MAC_PANID_COMPRESSION_DISABLED;
+    out->sequence_number_suppressed   = ((frame_control & MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION_MSK) == MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION) ? MAC_SEQUENCE_NUMBER_SUPPRESSION_ENABLED : MAC_SEQUENCE_NUMBER_SUPPRESSION_DISABLED;
+    out->ie_present                   = ((frame_control & MHR_FRAMECONTROL_IE_PRESENT_MSK) == MHR_FRAMECONTROL_IE_PRESENT) ? MAC_IE_PRESENT_PRESENT : MAC_IE_PRESENT_NOT_PRESENT;
+    out->destination_addressing_mode  = ((frame_control & MHR_FRAMECONTROL_DST_ADDR_MODE_MSK) >> MHR_FRAMECONTROL_DST_ADDR_MODE_SHFT);
+    out->source_addressing_mode       = ((frame_control & MHR_FRAMECONTROL_SRC_ADDR_MODE_MSK) >> MHR_FRAMECONTROL_SRC_ADDR_MODE_SHFT);
+    out->frame_version                = ((frame_control & MHR_FRAMECONTROL_FRAME_VERSION_MSK) >> MHR_FRAMECONTROL_FRAME_VERSION_SHFT);
+}
 
-/******************************************************************************
-                   Global function section
+/**************************************************************************//**
+\brief Decode a multipurpose frame control, see 802.15.4-2015 7.3.5.1
+Second octet is 0 for the one octet variant
 ******************************************************************************/
+static void mac_unpack_multipurpose_control( uint16_t frame_control, MAC_Frame_Control_t * out )
+{
+    out->long_frame_control           = (frame_control & MHR_MP_FRAMECONTROL_LONG) ? MAC_LONG_FRAME_CONTROL_ENABLED : MAC_LONG_FRAME_CONTROL_DISABLED;
+    out->destination_addressing_mode  = ((frame_control & MHR_MP_FRAMECONTROL_DST_ADDR_MODE_MSK) >> MHR_MP_FRAMECONTROL_DST_ADDR_MODE_SHFT);
+    out->source_addressing_mode       = ((frame_control & MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_MSK) >> MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_SHFT);
+    out->panid_present                = (frame_control & MHR_MP_FRAMECONTROL_PANID_PRESENT) ? MAC_PANID_PRESENT_PRESENT : MAC_PANID_PRESENT_NOT_PRESENT;
+    out->security_enabled             = (frame_control & MHR_MP_FRAMECONTROL_SECURITY_ENABLED) ? MAC_SECURITY_ENABLED : MAC_SECURITY_DISABLED;
+    out->sequence_number_suppressed   = (frame_control & MHR_MP_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION) ? MAC_SEQUENCE_NUMBER_SUPPRESSION_ENABLED : MAC_SEQUENCE_NUMBER_SUPPRESSION_DISABLED;
+    out->frame_pending                = (frame_control & MHR_MP_FRAMECONTROL_FRAME_PENDING) ? MAC_FRAME_PENDING_DATA_PENDING : MAC_FRAME_PENDING_NONE;
+    out->frame_version                = ((frame_control & MHR_MP_FRAMECONTROL_FRAME_VERSION_MSK) >> MHR_MP_FRAMECONTROL_FRAME_VERSION_SHFT);
+    out->acknowledge_request          = (frame_control & MHR_MP_FRAMECONTROL_AR) ? MAC_ACKNOWLEDGE_REQUEST_REQUIRED : MAC_ACKNOWLEDGE_REQUEST_NONE;
+    out->ie_present                   = (frame_control & MHR_MP_FRAMECONTROL_IE_PRESENT) ? MAC_IE_PRESENT_PRESENT : MAC_IE_PRESENT_NOT_PRESENT;
+}
+
 /**************************************************************************//**
-\brief Unpack a MAC frame
+\brief Parse auxiliary security header at index, see 802.15.4-2015 9.4
+index is moved after the header, MIC size is returned in the header
 ******************************************************************************/
-MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t * out)
+static MAC_Unpack_Result_t mac_unpack_security( uint8_t const * buffer, uint8_t * index, uint8_t end, MAC_Security_Header_t * header )
+{
+    uint8_t const * field = &buffer[*index];
+    uint8_t control;
+    uint8_t size;
+
+    if( end < (*index + MAC_SECURITY_CONTROL_SIZE) )
+    {
+        return MAC_UNPACK_FRAME_SIZE_ERROR;
+    }
+    control = field[0];
+    header->security_level = control & MAC_SECURITY_LEVEL_MSK;
+    header->key_id_mode = (control & MAC_SECURITY_KEY_ID_MODE_MSK) >> MAC_SECURITY_KEY_ID_MODE_SHFT;
+    header->frame_counter_suppressed = (control & MAC_SECURITY_FRAME_COUNTER_SUPPRESSION) != 0;
+    header->asn_in_nonce = (control & MAC_SECURITY_ASN_IN_NONCE) != 0;
+    header->key_source_size = MAC_Security_Key_Source_Size[header->key_id_mode];
+    header->mic_size = MAC_Security_MIC_Size[header->security_level];
+
+    //Whole header size known from control, checked once
+    size = MAC_SECURITY_CONTROL_SIZE + header->key_source_size;
+    size += header->frame_counter_suppressed ? 0 : MAC_SECURITY_FRAME_COUNTER_SIZE;
+    size += ( header->key_id_mode == MAC_KEY_ID_MODE_IMPLICIT ) ? 0 : MAC_SECURITY_KEY_INDEX_SIZE;
+    if( end < (*index + size) )
+    {
+        return MAC_UNPACK_FRAME_SIZE_ERROR;
+    }
+    header->size = size;
+    field += MAC_SECURITY_CONTROL_SIZE;
+
+    if( !header->frame_counter_suppressed )
+    {
+        header->frame_counter = field[0] | ((uint32_t)field[1] << 8) | ((uint32_t)field[2] << 16) | ((uint32_t)field[3] << 24);
+        field += MAC_SECURITY_FRAME_COUNTER_SIZE;
+    }
+    if( header->key_id_mode != MAC_KEY_ID_MODE_IMPLICIT )
+    {
+        memcpy( header->key_source, field, header->key_source_size );
+        header->key_index = field[header->key_source_size];
+    }
+
+    *index += size;
+    return MAC_UNPACK_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Delimit header and payload IEs starting at start, see 802.15.4-2015 7.4
+IEs are left in place, they are copied to payload with the MAC payload
+Only header IEs are delimited when payload is encrypted
+******************************************************************************/
+static MAC_Unpack_Result_t mac_unpack_ie( uint8_t const * buffer, uint8_t start, uint8_t end, bool encrypted, MAC_Frame_Unpacked_t * out )
 {
+    MAC_IE_Iterator_t iterator;
+    MAC_IE_t ie;
+
+    MAC_IE_IteratorInit( &iterator, &buffer[start], end - start );
+    iterator.header_only = encrypted;
+    while( MAC_IE_Next( &iterator, &ie ) )
+    {}      //intentionally blank, walk validates the lists
+
+    if( iterator.error )
+    {
+        return MAC_UNPACK_INVALID_IE;
+    }
+    out->header_ie_size = iterator.header_size;
+    out->ie_size = iterator.index;
+
+    return MAC_UNPACK_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Unpack a MAC frame, see MAC_Unpack
+******************************************************************************/
+static MAC_Unpack_Result_t mac_unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t * out)
+{
+    MAC_Unpack_Result_t result;
     uint16_t frame_control;
+    MAC_Frame_Format_t format;
     uint8_t index = 0;
+    uint8_t mic_size = 0;
     bool destination_panid_present = false;
     bool source_panid_present = false;
 
@@ -113,46 +246,49 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
         return MAC_UNPACK_PARAMETER_ERROR;
     }
 
-    //Minimum frame size is frame control
-    if( in->lenght < MHR_FRAME_CONTROL_SIZE )
+    //Minimum frame size is one octet frame control
+    if( in->lenght < MHR_SHORT_FRAMECONTROL_SIZE )
     {
         return MAC_UNPACK_FRAME_SIZE_ERROR;
     }
 
     memset( out, 0, sizeof(MAC_Frame_Unpacked_t));
 
+    //Frame type selects frame control layout
+    out->frame_control.frame_Type = ((in->payload[0] & MHR_FRAMECONTROL_FRAME_TYPE_MSK) >> MHR_FRAMECONTROL_FRAME_TYPE_SHFT);
+    format = MAC_Frame_Type_Format[out->frame_control.frame_Type];
+
     //Extract frame control and adjust endianness to host
-    frame_control = in->payload[index++];
-    frame_control |= (((uint16_t) in->payload[index++]) << 8);
-
-    //Parse frame control
-    out->frame_control.frame_Type                   = ((frame_control & MHR_FRAMECONTROL_FRAME_TYPE_MSK) >> MHR_FRAMECONTROL_FRAME_TYPE_SHFT);
-    out->frame_control.security_enabled             = ((frame_control & MHR_FRAMECONTROL_SECURITY_ENABLED_MSK) == MHR_FRAMECONTROL_SECURITY_ENABLED) ? MAC_SECURITY_ENABLED : MAC_SECURITY_DISABLED;
-    out->frame_control.frame_pending                = ((frame_control & MHR_FRAMECONTROL_FRAME_PENDING_MSK) == MHR_FRAMECONTROL_FRAME_PENDING) ? MAC_FRAME_PENDING_DATA_PENDING : MAC_FRAME_PENDING_NONE;
-    out->frame_control.acknowledge_request          = ((frame_control & MHR_FRAMECONTROL_AR_MSK) == MHR_FRAMECONTROL_AR) ? MAC_ACKNOWLEDGE_REQUEST_REQUIRED : MAC_ACKNOWLEDGE_REQUEST_NONE;
-    out->frame_control.panid_compression            = ((frame_control & MHR_FRAMECONTROL_PANID_COMPRESSION_MSK) == MHR_FRAMECONTROL_PANID_COMPRESSION) ? MAC_PANID_COMPRESSION_ENABLED : MAC_PANID_COMPRESSION_DISABLED;
-    out->frame_control.sequence_number_suppressed   = ((frame_control & MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION_MSK) == MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION) ? MAC_SEQUENCE_NUMBER_SUPPRESSION_ENABLED : MAC_SEQUENCE_NUMBER_SUPPRESSION_DISABLED;
-    out->frame_control.ie_present                   = ((frame_control & MHR_FRAMECONTROL_IE_PRESENT_MSK) == MHR_FRAMECONTROL_IE_PRESENT) ? MAC_IE_PRESENT_PRESENT : MAC_IE_PRESENT_NOT_PRESENT;
-    out->frame_control.destination_addressing_mode  = ((frame_control & MHR_FRAMECONTROL_DST_ADDR_MODE_MSK) >> MHR_FRAMECONTROL_DST_ADDR_MODE_SHFT);
-    out->frame_control.source_addressing_mode       = ((frame_control & MHR_FRAMECONTROL_SRC_ADDR_MODE_MSK) >> MHR_FRAMECONTROL_SRC_ADDR_MODE_SHFT);
-    out->frame_control.frame_version                = ((frame_control & MHR_FRAMECONTROL_FRAME_VERSION_MSK) >> MHR_FRAMECONTROL_FRAME_VERSION_SHFT);
-
-    //Frame version 0b11 is unsupported
-    if( out->frame_control.frame_version == MAC_FRAME_VERSION_11 )
-    {
-        return MAC_UNPACK_INVALID_FRAME_VERSION;
-    }
-
-    //Reserved, multipurpose, fragment, extended currently not supported
-    switch( out->frame_control.frame_Type )
-    {
-        case MAC_FRAME_TYPE_RESERVED:
-        case MAC_FRAME_TYPE_MULTIPURPOSE:
-        case MAC_FRAME_TYPE_FRAGMENT:
-        case MAC_FRAME_TYPE_EXTENDED:
-            return MAC_UNPACK_UNSUPPORTED_FRAME_TYPE;
-        default:
+    switch( format )
+    {
+        case MAC_FORMAT_GENERAL:
+            if( in->lenght < MHR_FRAME_CONTROL_SIZE )
+            {
+                return MAC_UNPACK_FRAME_SIZE_ERROR;
+            }
+            frame_control = in->payload[index++];
+            frame_control |= (((uint16_t) in->payload[index++]) << 8);
+            mac_unpack_frame_control( frame_control, &out->frame_control );
+            break;
+        case MAC_FORMAT_MULTIPURPOSE:
+            frame_control = in->payload[index++];
+            if( frame_control & MHR_MP_FRAMECONTROL_LONG )
+            {
+                if( in->lenght < MHR_FRAME_CONTROL_SIZE )
+                {
+                    return MAC_UNPACK_FRAME_SIZE_ERROR;
+                }
+                frame_control |= (((uint16_t) in->payload[index++]) << 8);
+            }
+            mac_unpack_multipurpose_control( frame_control, &out->frame_control );
+            break;
+        case MAC_FORMAT_SHORT:
+            //no sequence number nor addressing, MAC header ends here
+            out->frame_control.extension = ((in->payload[index++] & MHR_FRAMECONTROL_EXTENSION_MSK) >> MHR_FRAMECONTROL_EXTENSION_SHFT);
+            out->frame_control.sequence_number_suppressed = MAC_SEQUENCE_NUMBER_SUPPRESSION_ENABLED;
             break;
+        default:
+            return MAC_UNPACK_UNSUPPORTED_FRAME_TYPE;
     }
 
     if( out->frame_control.destination_addressing_mode == MAC_ADDRESSING_MODE_RESERVED )
@@ -165,12 +301,10 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
         return MAC_UNPACK_INVALID_ADDRESSING_MODE;
     }
 
-    if( out->frame_control.security_enabled )
-    {
-        return MAC_UNPACK_UNSUPPORTED_FEATURE;
-    }
-
-    if( out->frame_control.ie_present )
+    //802.15.4-2003 security has no auxiliary security header
+    if( out->frame_control.security_enabled &&
+        (format == MAC_FORMAT_GENERAL) &&
+        (out->frame_control.frame_version == MAC_FRAME_VERSION_00) )
     {
         return MAC_UNPACK_UNSUPPORTED_FEATURE;
     }
@@ -186,10 +320,15 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
         out->sequence_number = in->payload[index++];
     }
 
+    //Multipurpose - destination PAN ID only, when flagged present
+    if( format == MAC_FORMAT_MULTIPURPOSE )
+    {
+        destination_panid_present = out->frame_control.panid_present;
+    }
     //PAN ID compression
     //Frame version 0b00 or 0b01
-    if( (out->frame_control.frame_version == MAC_FRAME_VERSION_00) ||
-        (out->frame_control.frame_version == MAC_FRAME_VERSION_01) )
+    else if( (out->frame_control.frame_version == MAC_FRAME_VERSION_00) ||
+             (out->frame_control.frame_version == MAC_FRAME_VERSION_01) )
     {
         //if destination address present
         if((out->frame_control.destination_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS) ||
@@ -210,12 +349,10 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
             source_panid_present = false;
         }
     }
-
-    //frame version 0b10
-    if( (out->frame_control.frame_version == MAC_FRAME_VERSION_10))
+    //frame version 0b10, reserved 0b11 follows the same rules
+    else
     {
         //applies to Beacon, Data frame, MAC Command, Ack frame
-        //consider verifying if frame is one of the above
         for( uint8_t i = 0; i < NB_OF_ELEMENT_PANID_COMPRESSION_0b10; i++ )
         {
             if( ( out->frame_control.destination_addressing_mode    == TABLE7_2_PANID_Compression[i].destination_address ) &&
@@ -326,16 +463,55 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
 
     }
 
-    //Auxiliary Security - header - Not supported rejected above
-    //if( out->frame_control.security_enabled )
+    //Elided PAN ID - frame belongs to the PAN ID carried, both fields hold it
+    if( destination_panid_present && !source_panid_present )
+    {
+        out->source_pan_id = out->destination_pan_id;
+    }
+    else if( source_panid_present && !destination_panid_present )
+    {
+        out->destination_pan_id = out->source_pan_id;
+    }
 
-    //IE - not supported for now
-    //if( out->frame_control.ie_present )
+    //Auxiliary Security - header, MIC is removed from payload end
+    if( out->frame_control.security_enabled )
+    {
+        if( in->lenght < MAC_FCS_SIZE )
+        {
+            return MAC_UNPACK_FRAME_SIZE_ERROR;
+        }
+        result = mac_unpack_security( in->payload, &index, in->lenght - MAC_FCS_SIZE, &out->auxiliary_security_header );
+        if( result != MAC_UNPACK_SUCCESS )
+        {
+            return result;
+        }
+        mic_size = out->auxiliary_security_header.mic_size;
+        if( in->lenght < (index + mic_size + MAC_FCS_SIZE) )
+        {
+            return MAC_UNPACK_FRAME_SIZE_ERROR;
+        }
+        memcpy( out->auxiliary_security_header.mic, &in->payload[in->lenght - MAC_FCS_SIZE - mic_size], mic_size );
+    }
+
+    //IE - kept at start of payload, delimited by header_ie_size and ie_size
+    if( out->frame_control.ie_present )
+    {
+        if( in->lenght < (index + mic_size + MAC_FCS_SIZE) )
+        {
+            return MAC_UNPACK_FRAME_SIZE_ERROR;
+        }
+        result = mac_unpack_ie( in->payload, index, in->lenght - MAC_FCS_SIZE - mic_size,
+                                ( out->auxiliary_security_header.security_level & MAC_SECURITY_LEVEL_ENCRYPTION ) != 0, out );
+        if( result != MAC_UNPACK_SUCCESS )
+        {
+            return result;
+        }
+    }
 
     //copy payload content
-    if( in->lenght > (index + MAC_FCS_SIZE) )
+    if( in->lenght > (index + mic_size + MAC_FCS_SIZE) )
     {
-        out->payload_size = in->lenght - (index + MAC_FCS_SIZE);
+        out->payload_size = in->lenght - (index + mic_size + MAC_FCS_SIZE);
         if( out->payload_size > MAC_MAX_PAYLOAD )
         {
             return MAC_UNPACK_FRAME_SIZE_ERROR;
@@ -344,11 +520,16 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
         memcpy(out->payload, &in->payload[index], out->payload_size);
         index += out->payload_size;
     }
+    index += mic_size;
 
-    //FCS - 16 bit
+    //FCS - 16 bit, header may end the frame with no room left for it
     uint16_t crc_calc;
     uint16_t crc_rcv;
 
+    if( in->lenght < (index + MAC_FCS_SIZE) )
+    {
+        return MAC_UNPACK_FRAME_SIZE_ERROR;
+    }
     crc_calc = crcFast( in->payload, (in->lenght - MAC_FCS_SIZE) );
     crc_rcv = in->payload[index++];
     crc_rcv |= (((uint16_t) in->payload[index++]) << 8);
@@ -361,12 +542,31 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
     return MAC_UNPACK_SUCCESS;
 }
 
+/******************************************************************************
+                   Global function section
+******************************************************************************/
+/**************************************************************************//**
+\brief Unpack a MAC frame
+******************************************************************************/
+MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t * out)
+{
+    MAC_Unpack_Result_t result;
+    PROF_START( PROFILER_PROBE_MAC_UNPACK );
+
+    //profiled through a wrapper so every return path is measured
+    result = mac_unpack( in, out );
+
+    PROF_STOP( PROFILER_PROBE_MAC_UNPACK );
+    return result;
+}
+
 
 /**************************************************************************//**
 \brief Pack a MAC frame
 ******************************************************************************/
 MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out)
 {
+    MAC_Frame_Format_t format;
     uint16_t frame_control;
     uint8_t index = 0;
     bool destination_panid_present = false;
@@ -380,22 +580,10 @@ MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out)
     //Clear output frame
     memset( out, 0, sizeof(MAC_Frame_packed_t));
 
-    //Frame version 0b11 is unsupported
-    if( in->frame_control.frame_version == MAC_FRAME_VERSION_11 )
-    {
-        return MAC_PACK_INVALID_FRAME_VERSION;
-    }
-
-    //Reserved, multipurpose, fragment, extended currently not supported
-    switch( in->frame_control.frame_Type )
+    format = MAC_Frame_Type_Format[in->frame_control.frame_Type & MHR_FRAMECONTROL_FRAME_TYPE_MSK];
+    if( format == MAC_FORMAT_UNSUPPORTED )
     {
-        case MAC_FRAME_TYPE_RESERVED:
-        case MAC_FRAME_TYPE_MULTIPURPOSE:
-        case MAC_FRAME_TYPE_FRAGMENT:
-        case MAC_FRAME_TYPE_EXTENDED:
-            return MAC_PACK_UNSUPPORTED_FRAME_TYPE;
-        default:
-            break;
+        return MAC_PACK_UNSUPPORTED_FRAME_TYPE;
     }
 
     if( in->frame_control.destination_addressing_mode == MAC_ADDRESSING_MODE_RESERVED )
@@ -419,19 +607,60 @@ MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out)
     }
 
     //Fill frame control
-    frame_control  = ((in->frame_control.frame_Type << MHR_FRAMECONTROL_FRAME_TYPE_SHFT) & MHR_FRAMECONTROL_FRAME_TYPE_MSK);
-    frame_control |= ((in->frame_control.security_enabled == MAC_SECURITY_DISABLED) ? 0 : MHR_FRAMECONTROL_SECURITY_ENABLED);
-    frame_control |= ((in->frame_control.frame_pending == MAC_FRAME_PENDING_NONE) ? 0 : MHR_FRAMECONTROL_FRAME_PENDING);
-    frame_control |= ((in->frame_control.acknowledge_request == MAC_ACKNOWLEDGE_REQUEST_NONE) ? 0 : MHR_FRAMECONTROL_AR);
-    frame_control |= ((in->frame_control.panid_compression == MAC_PANID_COMPRESSION_DISABLED) ? 0 : MHR_FRAMECONTROL_PANID_COMPRESSION);
-    frame_control |= ((in->frame_control.sequence_number_suppressed == MAC_SEQUENCE_NUMBER_SUPPRESSION_DISABLED) ? 0 : MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION);
-    frame_control |= ((in->frame_control.ie_present == MAC_IE_PRESENT_NOT_PRESENT) ? 0 : MHR_FRAMECONTROL_IE_PRESENT);
-    frame_control |= ((in->frame_control.destination_addressing_mode << MHR_FRAMECONTROL_DST_ADDR_MODE_SHFT) & MHR_FRAMECONTROL_DST_ADDR_MODE_MSK);
-    frame_control |= (((uint16_t) in->frame_control.source_addressing_mode << MHR_FRAMECONTROL_SRC_ADDR_MODE_SHFT) & MHR_FRAMECONTROL_SRC_ADDR_MODE_MSK);
-    frame_control |= (((uint16_t) in->frame_control.frame_version << MHR_FRAMECONTROL_FRAME_VERSION_SHFT) & MHR_FRAMECONTROL_FRAME_VERSION_MSK);
+    switch( format )
+    {
+        case MAC_FORMAT_GENERAL:
+            frame_control  = ((in->frame_control.frame_Type << MHR_FRAMECONTROL_FRAME_TYPE_SHFT) & MHR_FRAMECONTROL_FRAME_TYPE_MSK);
+            frame_control |= ((in->frame_control.security_enabled == MAC_SECURITY_DISABLED) ? 0 : MHR_FRAMECONTROL_SECURITY_ENABLED);
+            frame_control |= ((in->frame_control.frame_pending == MAC_FRAME_PENDING_NONE) ? 0 : MHR_FRAMECONTROL_FRAME_PENDING);
+            frame_control |= ((in->frame_control.acknowledge_request == MAC_ACKNOWLEDGE_REQUEST_NONE) ? 0 : MHR_FRAMECONTROL_AR);
+            frame_control |= ((in->frame_control.panid_compression == MAC_PANID_COMPRESSION_DISABLED) ? 0 : MHR_FRAMECONTROL_PANID_COMPRESSION);
+            frame_control |= ((in->frame_control.sequence_number_suppressed == MAC_SEQUENCE_NUMBER_SUPPRESSION_DISABLED) ? 0 : MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION);
+            frame_control |= ((in->frame_control.ie_present == MAC_IE_PRESENT_NOT_PRESENT) ? 0 : MHR_FRAMECONTROL_IE_PRESENT);
+            frame_control |= ((in->frame_control.destination_addressing_mode << MHR_FRAMECONTROL_DST_ADDR_MODE_SHFT) & MHR_FRAMECONTROL_DST_ADDR_MODE_MSK);
+            frame_control |= (((uint16_t) in->frame_control.source_addressing_mode << MHR_FRAMECONTROL_SRC_ADDR_MODE_SHFT) & MHR_FRAMECONTROL_SRC_ADDR_MODE_MSK);
+            frame_control |= (((uint16_t) in->frame_control.frame_version << MHR_FRAMECONTROL_FRAME_VERSION_SHFT) & MHR_FRAMECONTROL_FRAME_VERSION_MSK);
+
+            out->payload[index++] = (uint8_t) (frame_control & 0xFF);
+            out->payload[index++] = (uint8_t) ((uint16_t) (frame_control & 0xFF00) >> 8);
+            break;
+
+        case MAC_FORMAT_MULTIPURPOSE:
+            frame_control  = ((in->frame_control.frame_Type << MHR_FRAMECONTROL_FRAME_TYPE_SHFT) & MHR_FRAMECONTROL_FRAME_TYPE_MSK);
+            frame_control |= ((in->frame_control.destination_addressing_mode << MHR_MP_FRAMECONTROL_DST_ADDR_MODE_SHFT) & MHR_MP_FRAMECONTROL_DST_ADDR_MODE_MSK);
+            frame_control |= ((in->frame_control.source_addressing_mode << MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_SHFT) & MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_MSK);
+            frame_control |= ((in->frame_control.panid_present == MAC_PANID_PRESENT_NOT_PRESENT) ? 0 : MHR_MP_FRAMECONTROL_PANID_PRESENT);
+            frame_control |= ((in->frame_control.sequence_number_suppressed == MAC_SEQUENCE_NUMBER_SUPPRESSION_DISABLED) ? 0 : MHR_MP_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION);
+            frame_control |= ((in->frame_control.frame_pending == MAC_FRAME_PENDING_NONE) ? 0 : MHR_MP_FRAMECONTROL_FRAME_PENDING);
+            frame_control |= (((uint16_t) in->frame_control.frame_version << MHR_MP_FRAMECONTROL_FRAME_VERSION_SHFT) & MHR_MP_FRAMECONTROL_FRAME_VERSION_MSK);
+            frame_control |= ((in->frame_control.acknowledge_request == MAC_ACKNOWLEDGE_REQUEST_NONE) ? 0 : MHR_MP_FRAMECONTROL_AR);
+
+            out->payload[index++] = (uint8_t) (frame_control & 0xFF);
+            if( in->frame_control.long_frame_control == MAC_LONG_FRAME_CONTROL_ENABLED )
+            {
+                out->payload[index - 1] |= MHR_MP_FRAMECONTROL_LONG;
+                out->payload[index++] = (uint8_t) ((uint16_t) (frame_control & 0xFF00) >> 8);
+            }
+            else if( frame_control & 0xFF00 )
+            {
+                //one octet frame control can't carry second octet fields
+                return MAC_PACK_PARAMETER_ERROR;
+            }
+            destination_panid_present = in->frame_control.panid_present;
+            break;
 
-    out->payload[index++] = (uint8_t) (frame_control & 0xFF);
-    out->payload[index++] = (uint8_t) ((uint16_t) (frame_control & 0xFF00) >> 8);
+        default:
+            //one octet frame control only, sequence number and addresses absent
+            if( !in->frame_control.sequence_number_suppressed ||
+                in->frame_control.destination_addressing_mode != MAC_ADDRESSING_MODE_NONE ||
+                in->frame_control.source_addressing_mode != MAC_ADDRESSING_MODE_NONE )
+            {
+                return MAC_PACK_PARAMETER_ERROR;
+            }
+            out->payload[index++] = (uint8_t) ( ((in->frame_control.frame_Type << MHR_FRAMECONTROL_FRAME_TYPE_SHFT) & MHR_FRAMECONTROL_FRAME_TYPE_MSK) |
+                                                ((in->frame_control.extension << MHR_FRAMECONTROL_EXTENSION_SHFT) & MHR_FRAMECONTROL_EXTENSION_MSK) );
+            break;
+    }
 
 
     //sequence number present
@@ -440,9 +669,10 @@ MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out)
         out->payload[index++] = in->sequence_number;
     }
 
-    //Addressing fields - depends on frame version
-    if( (in->frame_control.frame_version == MAC_FRAME_VERSION_00) ||
-        (in->frame_control.frame_version == MAC_FRAME_VERSION_01) )
+    //Addressing fields - depends on frame version, multipurpose set above
+    if( (format == MAC_FORMAT_GENERAL) &&
+        ( (in->frame_control.frame_version == MAC_FRAME_VERSION_00) ||
+          (in->frame_control.frame_version == MAC_FRAME_VERSION_01) ) )
     {
         //destination address
         if( ( in->frame_control.destination_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS ) ||
@@ -451,36 +681,29 @@ MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out)
             destination_panid_present = true;
         }
 
-        //source address
+        //source address, PAN ID elided when compressed against destination one
         if( ( in->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS ) ||
             ( in->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS ))
         {
             source_panid_present = true;
-            if( in->frame_control.panid_compression != MAC_PANID_COMPRESSION_ENABLED )  //consider evaluate this before and setting interrnally the panid compression field
+            if( destination_panid_present && in->frame_control.panid_compression == MAC_PANID_COMPRESSION_ENABLED )
             {
                 source_panid_present = false;
             }
         }
     }
-
-    //frame version 0b10
-    if( (in->frame_control.frame_version == MAC_FRAME_VERSION_10))
+    //frame version 0b10, reserved 0b11 follows the same rules
+    else if( format == MAC_FORMAT_GENERAL )
     {
         //applies to Beacon, Data frame, MAC Command, Ack frame
-        if( (in->frame_control.frame_Type == MAC_FRAME_TYPE_BEACON) ||
-            (in->frame_control.frame_Type == MAC_FRAME_TYPE_DATA) ||
-            (in->frame_control.frame_Type == MAC_FRAME_TYPE_ACK) ||
-            (in->frame_control.frame_Type == MAC_FRAME_TYPE_COMMAND) )
+        for( uint8_t i = 0; i < NB_OF_ELEMENT_PANID_COMPRESSION_0b10; i++ )
         {
-            for( uint8_t i = 0; i < NB_OF_ELEMENT_PANID_COMPRESSION_0b10; i++ )
+            if( ( in->frame_control.destination_addressing_mode    == TABLE7_2_PANID_Compression[i].destination_address ) &&
+                ( in->frame_control.source_addressing_mode         == TABLE7_2_PANID_Compression[i].source_address ) &&
+                ( in->frame_control.panid_compression              == TABLE7_2_PANID_Compression[i].PanID_compression ) )
             {
-                if( ( in->frame_control.destination_addressing_mode    == TABLE7_2_PANID_Compression[i].destination_address ) &&
-                    ( in->frame_control.source_addressing_mode         == TABLE7_2_PANID_Compression[i].source_address ) &&
-                    ( in->frame_control.panid_compression              == TABLE7_2_PANID_Compression[i].PanID_compression ) )
-                {
-                    destination_panid_present = TABLE7_2_PANID_Compression[i].dest_panid_present;
-                    source_panid_present = TABLE7_2_PANID_Compression[i].source_panid_present;
-                }
+                destination_panid_present = TABLE7_2_PANID_Compression[i].dest_panid_present;
+                source_panid_present = TABLE7_2_PANID_Compression[i].source_panid_present;
             }
         }
     }
@@ -588,6 +811,266 @@ MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out)
 
 
 
+/**************************************************************************//**
+\brief Start iterating a header IE list
+******************************************************************************/
+void MAC_IE_IteratorInit( MAC_IE_Iterator_t * iterator, uint8_t const * buffer, uint16_t size )
+{
+    memset( iterator, 0, sizeof(MAC_IE_Iterator_t) );
+    iterator->buffer = buffer;
+    iterator->size = size;
+    iterator->kind = MAC_IE_KIND_HEADER;
+}
+
+/**************************************************************************//**
+\brief Start iterating IEs of an unpacked frame
+******************************************************************************/
+void MAC_IE_IteratorInitFrame( MAC_IE_Iterator_t * iterator, MAC_Frame_Unpacked_t const * frame )
+{
+    MAC_IE_IteratorInit( iterator, frame->payload, frame->ie_size );
+}
+
+/**************************************************************************//**
+\brief Start iterating sub-IEs nested in a MLME payload IE
+******************************************************************************/
+void MAC_IE_IteratorInitNested( MAC_IE_Iterator_t * iterator, MAC_IE_t const * ie )
+{
+    MAC_IE_IteratorInit( iterator, ie->content, ie->length );
+    iterator->kind = MAC_IE_KIND_SUB_SHORT;
+    iterator->done = ( ie->kind != MAC_IE_KIND_PAYLOAD || ie->id != MAC_PAYLOAD_IE_GROUP_MLME );
+}
+
+/**************************************************************************//**
+\brief Get next IE
+A header list without termination runs to the end of buffer, header
+termination 1 switches to payload IEs, header termination 2 and payload
+termination end the walk
+******************************************************************************/
+bool MAC_IE_Next( MAC_IE_Iterator_t * iterator, MAC_IE_t * ie )
+{
+    uint16_t descriptor;
+    uint16_t length;
+    uint8_t id;
+    MAC_IE_Kind_t kind;
+
+    while( !iterator->done )
+    {
+        if( iterator->index >= iterator->size )
+        {
+            if( iterator->kind == MAC_IE_KIND_HEADER )
+            {
+                iterator->header_size = iterator->index;
+            }
+            iterator->done = true;
+            break;
+        }
+
+        if( (iterator->size - iterator->index) < MAC_IE_DESCRIPTOR_SIZE )
+        {
+            iterator->error = true;
+            iterator->done = true;
+            break;
+        }
+        descriptor = iterator->buffer[iterator->index];
+        descriptor |= (((uint16_t) iterator->buffer[iterator->index + 1]) << 8);
+
+        kind = iterator->kind;
+        switch( kind )
+        {
+        case MAC_IE_KIND_HEADER:
+            length = descriptor & MAC_HEADER_IE_LENGTH_MSK;
+            id = (descriptor & MAC_HEADER_IE_ID_MSK) >> MAC_HEADER_IE_ID_SHFT;
+            iterator->error = ( descriptor & MAC_IE_TYPE_MSK ) != 0;
+            break;
+        case MAC_IE_KIND_PAYLOAD:
+            length = descriptor & MAC_PAYLOAD_IE_LENGTH_MSK;
+            id = (descriptor & MAC_PAYLOAD_IE_GROUP_MSK) >> MAC_PAYLOAD_IE_GROUP_SHFT;
+            iterator->error = ( descriptor & MAC_IE_TYPE_MSK ) == 0;
+            break;
+        default:
+            //nested list, both forms
+            if( descriptor & MAC_IE_TYPE_MSK )
+            {
+                kind = MAC_IE_KIND_SUB_LONG;
+                length = descriptor & MAC_SUB_IE_LONG_LENGTH_MSK;
+                id = (descriptor & MAC_SUB_IE_LONG_ID_MSK) >> MAC_SUB_IE_LONG_ID_SHFT;
+            }
+            else
+            {
+                kind = MAC_IE_KIND_SUB_SHORT;
+                length = descriptor & MAC_SUB_IE_SHORT_LENGTH_MSK;
+                id = (descriptor & MAC_SUB_IE_SHORT_ID_MSK) >> MAC_SUB_IE_SHORT_ID_SHFT;
+            }
+            break;
+        }
+
+        if( iterator->error ||
+            (iterator->size - iterator->index - MAC_IE_DESCRIPTOR_SIZE) < length )
+        {
+            iterator->error = true;
+            iterator->done = true;
+            break;
+        }
+
+        ie->content = &iterator->buffer[iterator->index + MAC_IE_DESCRIPTOR_SIZE];
+        ie->length = length;
+        ie->id = id;
+        ie->kind = kind;
+        iterator->index += MAC_IE_DESCRIPTOR_SIZE + length;
+
+        //Terminations
+        if( kind == MAC_IE_KIND_HEADER &&
+            (id == MAC_HEADER_IE_ID_HT1 || id == MAC_HEADER_IE_ID_HT2) )
+        {
+            iterator->header_size = iterator->index;
+            iterator->kind = MAC_IE_KIND_PAYLOAD;
+            iterator->done = ( id == MAC_HEADER_IE_ID_HT2 ) || iterator->header_only;
+            continue;
+        }
+        if( kind == MAC_IE_KIND_PAYLOAD && id == MAC_PAYLOAD_IE_GROUP_TERMINATION )
+        {
+            iterator->done = true;
+            continue;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/**************************************************************************//**
+\brief Get CSL IE
+******************************************************************************/
+bool MAC_IE_GetCsl( MAC_IE_t const * ie, MAC_IE_Csl_t * csl )
+{
+    if( ie->kind != MAC_IE_KIND_HEADER || ie->id != MAC_HEADER_IE_ID_CSL ||
+        (ie->length != MAC_IE_CSL_SIZE && ie->length != MAC_IE_CSL_RENDEZVOUS_SIZE) )
+    {
+        return false;
+    }
+    csl->phase = ie->content[0] | ((uint16_t)ie->content[1] << 8);
+    csl->period = ie->content[2] | ((uint16_t)ie->content[3] << 8);
+    csl->rendezvous = 0;
+    if( ie->length == MAC_IE_CSL_RENDEZVOUS_SIZE )
+    {
+        csl->rendezvous = ie->content[4] | ((uint16_t)ie->content[5] << 8);
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Get ACK/NACK time correction IE
+******************************************************************************/
+bool MAC_IE_GetTimeCorrection( MAC_IE_t const * ie, MAC_IE_Time_Correction_t * correction )
+{
+    uint16_t value;
+
+    if( ie->kind != MAC_IE_KIND_HEADER || ie->id != MAC_HEADER_IE_ID_TIME_CORRECTION ||
+        ie->length != MAC_IE_TIME_CORRECTION_SIZE )
+    {
+        return false;
+    }
+    value = ie->content[0] | ((uint16_t)ie->content[1] << 8);
+    correction->nack = ( value & MAC_IE_TIME_CORRECTION_NACK ) != 0;
+    correction->correction_us = value & MAC_IE_TIME_CORRECTION_MSK;
+    if( value & MAC_IE_TIME_CORRECTION_SIGN )
+    {
+        correction->correction_us -= (MAC_IE_TIME_CORRECTION_MSK + 1);
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Get ASN of TSCH synchronization IE
+******************************************************************************/
+bool MAC_IE_GetAsn( MAC_IE_t const * ie, uint64_t * asn )
+{
+    if( ie->kind != MAC_IE_KIND_SUB_SHORT || ie->id != MAC_SUB_IE_SHORT_ID_TSCH_SYNC ||
+        ie->length < MAC_IE_ASN_SIZE )
+    {
+        return false;
+    }
+    *asn = 0;
+    for( uint8_t i = MAC_IE_ASN_SIZE; i > 0; i-- )
+    {
+        *asn = (*asn << 8) | ie->content[i - 1];
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Get TSCH timeslot IE
+******************************************************************************/
+bool MAC_IE_GetTimeslot( MAC_IE_t const * ie, MAC_IE_Timeslot_t * timeslot )
+{
+    uint8_t const * content = ie->content;
+
+    if( ie->kind != MAC_IE_KIND_SUB_SHORT || ie->id != MAC_SUB_IE_SHORT_ID_TSCH_TIMESLOT ||
+        (ie->length != MAC_IE_TIMESLOT_ID_SIZE && ie->length != MAC_IE_TIMESLOT_SIZE &&
+         ie->length != MAC_IE_TIMESLOT_LONG_SIZE) )
+    {
+        return false;
+    }
+    memset( timeslot, 0, sizeof(MAC_IE_Timeslot_t) );
+    timeslot->template_id = content[0];
+    if( ie->length == MAC_IE_TIMESLOT_ID_SIZE )
+    {
+        return true;
+    }
+
+    //ID, CCA offset, CCA, TX offset ... max TX, timeslot length last
+    timeslot->tx_offset_us = content[5] | ((uint16_t)content[6] << 8);
+    if( ie->length == MAC_IE_TIMESLOT_SIZE )
+    {
+        timeslot->timeslot_us = content[23] | ((uint32_t)content[24] << 8);
+    }
+    else
+    {
+        timeslot->timeslot_us = content[24] | ((uint32_t)content[25] << 8) | ((uint32_t)content[26] << 16);
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Get channel hopping IE
+******************************************************************************/
+bool MAC_IE_GetChannelHopping( MAC_IE_t const * ie, MAC_IE_Channel_Hopping_t * hopping )
+{
+    uint8_t const * content = ie->content;
+    uint16_t count;
+
+    if( ie->kind != MAC_IE_KIND_SUB_LONG || ie->id != MAC_SUB_IE_LONG_ID_CHANNEL_HOPPING ||
+        ie->length < MAC_IE_CHANNEL_HOPPING_ID_SIZE )
+    {
+        return false;
+    }
+    memset( hopping, 0, sizeof(MAC_IE_Channel_Hopping_t) );
+    hopping->sequence_id = content[0];
+    if( ie->length == MAC_IE_CHANNEL_HOPPING_ID_SIZE )
+    {
+        return true;
+    }
+
+    //ID, channel page, number of channels, PHY configuration, sequence
+    //length, sequence, current hop
+    if( ie->length < MAC_IE_CHANNEL_HOPPING_FIXED_SIZE )
+    {
+        return false;
+    }
+    count = content[8] | ((uint16_t)content[9] << 8);
+    if( ie->length != MAC_IE_CHANNEL_HOPPING_FIXED_SIZE + count * MAC_IE_CHANNEL_HOPPING_ENTRY_SIZE )
+    {
+        return false;
+    }
+    hopping->count = count;
+    hopping->list = &content[10];
+    hopping->current_hop = content[10 + count * MAC_IE_CHANNEL_HOPPING_ENTRY_SIZE] |
+                           ((uint16_t)content[11 + count * MAC_IE_CHANNEL_HOPPING_ENTRY_SIZE] << 8);
+    return true;
+}
+
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Unit test for MAC
 ///////////////////////////////////////////////////////////////////////////////
@@ -620,6 +1103,342 @@ uint8_t MAC_Unpack_UnitTest1( void )
 
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Unit test for IE iterator, frames without FCS, it is appended by test
+///////////////////////////////////////////////////////////////////////////////
+//Enhanced ACK, time correction -100 us NACK, CSL phase 16 period 1000
+//rendezvous 32, header termination 2, 2 payload bytes
+static const uint8_t MAC_Unpack_EnhancedAck[] = {   0x02, 0x2a, 0x55, 0x34, 0x12, 0x01, 0x00,
+                                                    0x02, 0x0f, 0x9c, 0x8f,
+                                                    0x06, 0x0d, 0x10, 0x00, 0xe8, 0x03, 0x20, 0x00,
+                                                    0x80, 0x3f,
+                                                    0xaa, 0xbb };
+
+//Enhanced beacon, header termination 1, MLME IE with ASN 0x0102030405,
+//full timeslot template (TX offset 2120, timeslot 15000) and 4 channels
+//hopping sequence, payload termination
+static const uint8_t MAC_Unpack_EnhancedBeacon[] = {    0x40, 0xea, 0x01, 0x62, 0x1a, 0xff, 0xff,
+                                                        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+                                                        0x00, 0x3f,
+                                                        0x39, 0x88,
+                                                        0x06, 0x1a, 0x05, 0x04, 0x03, 0x02, 0x01, 0x00,
+                                                        0x19, 0x1c, 0x01, 0x08, 0x07, 0x80, 0x00, 0x48, 0x08, 0xfc, 0x03, 0x20, 0x03,
+                                                        0xe8, 0x03, 0x98, 0x08, 0x90, 0x01, 0xc0, 0x00, 0x60, 0x09, 0xa0, 0x10, 0x98, 0x3a,
+                                                        0x14, 0xc8, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00,
+                                                        0x0f, 0x00, 0x14, 0x00, 0x19, 0x00, 0x1a, 0x00, 0x02, 0x00,
+                                                        0x00, 0xf8 };
+
+static void mac_unit_test_load( MAC_Frame_packed_t * in, uint8_t const * frame, uint8_t size )
+{
+    uint16_t crc;
+
+    memcpy( in->payload, frame, size );
+    crc = crcFast( in->payload, size );
+    in->payload[size] = crc & 0xFF;
+    in->payload[size + 1] = (crc & 0xFF00) >> 8;
+    in->lenght = size + MAC_FCS_SIZE;
+}
+
+uint8_t MAC_Unpack_UnitTest2( void )
+{
+    MAC_Frame_packed_t in;
+    MAC_Frame_Unpacked_t out;
+    MAC_IE_Iterator_t iterator;
+    MAC_IE_Iterator_t nested;
+    MAC_IE_t ie;
+    MAC_IE_t sub_ie;
+    MAC_IE_Time_Correction_t correction;
+    MAC_IE_Csl_t csl;
+    MAC_IE_Timeslot_t timeslot;
+    MAC_IE_Channel_Hopping_t hopping;
+    uint64_t asn;
+    uint8_t overrun[sizeof(MAC_Unpack_EnhancedAck)];
+    uint8_t found = 0;
+
+    //Header IEs, terminated, MAC payload follows
+    mac_unit_test_load( &in, MAC_Unpack_EnhancedAck, sizeof(MAC_Unpack_EnhancedAck) );
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_SUCCESS ||
+        out.header_ie_size != 14 || out.ie_size != 14 || out.payload_size != 16 ||
+        out.payload[out.ie_size] != 0xaa || out.source_pan_id != 0x1234 )
+    {
+        return false;
+    }
+    MAC_IE_IteratorInitFrame( &iterator, &out );
+    if( !MAC_IE_Next( &iterator, &ie ) || !MAC_IE_GetTimeCorrection( &ie, &correction ) ||
+        correction.correction_us != -100 || !correction.nack )
+    {
+        return false;
+    }
+    if( !MAC_IE_Next( &iterator, &ie ) || !MAC_IE_GetCsl( &ie, &csl ) ||
+        csl.phase != 16 || csl.period != 1000 || csl.rendezvous != 32 )
+    {
+        return false;
+    }
+    if( MAC_IE_Next( &iterator, &ie ) || iterator.error )
+    {
+        return false;
+    }
+
+    //Payload IEs with nested sub-IEs
+    mac_unit_test_load( &in, MAC_Unpack_EnhancedBeacon, sizeof(MAC_Unpack_EnhancedBeacon) );
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_SUCCESS ||
+        out.header_ie_size != 2 || out.ie_size != 63 || out.payload_size != 63 ||
+        out.source_pan_id != 0x1a62 )
+    {
+        return false;
+    }
+    MAC_IE_IteratorInitFrame( &iterator, &out );
+    while( MAC_IE_Next( &iterator, &ie ) )
+    {
+        MAC_IE_IteratorInitNested( &nested, &ie );
+        while( MAC_IE_Next( &nested, &sub_ie ) )
+        {
+            if( MAC_IE_GetAsn( &sub_ie, &asn ) && asn == 0x0102030405ULL )
+            {
+                found |= 0x01;
+            }
+            if( MAC_IE_GetTimeslot( &sub_ie, &timeslot ) && timeslot.template_id == 1 &&
+                timeslot.tx_offset_us == 2120 && timeslot.timeslot_us == 15000 )
+            {
+                found |= 0x02;
+            }
+            if( MAC_IE_GetChannelHopping( &sub_ie, &hopping ) && hopping.count == 4 &&
+                hopping.list[0] == 15 && hopping.list[6] == 26 && hopping.current_hop == 2 )
+            {
+                found |= 0x04;
+            }
+        }
+    }
+    if( found != 0x07 || iterator.error )
+    {
+        return false;
+    }
+
+    //IE overrunning frame
+    memcpy( overrun, MAC_Unpack_EnhancedAck, sizeof(overrun) );
+    overrun[7] = 0x7f;
+    mac_unit_test_load( &in, overrun, sizeof(overrun) );
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_INVALID_IE )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark of IE parsing against frame parsing, mean cycles of each step
+///////////////////////////////////////////////////////////////////////////////
+#define MAC_UNIT_TEST_BENCHMARK_RUNS        256
+
+void MAC_Unpack_BenchmarkIE( MAC_Unpack_Benchmark_t * result )
+{
+    MAC_Frame_packed_t plain;
+    MAC_Frame_packed_t beacon;
+    MAC_Frame_Unpacked_t out;
+    MAC_IE_Iterator_t iterator;
+    MAC_IE_Iterator_t nested;
+    MAC_IE_t ie;
+    MAC_IE_t sub_ie;
+    MAC_IE_Timeslot_t timeslot;
+    MAC_IE_Channel_Hopping_t hopping;
+    uint64_t asn;
+    uint32_t start;
+    volatile uint32_t sink = 0;
+
+    plain.lenght = sizeof(MAC_Unpack_MTO);
+    memcpy( plain.payload, MAC_Unpack_MTO, plain.lenght );
+    mac_unit_test_load( &beacon, MAC_Unpack_EnhancedBeacon, sizeof(MAC_Unpack_EnhancedBeacon) );
+
+    start = HAL_CYCLE_COUNT();
+    for( uint16_t i = 0; i < MAC_UNIT_TEST_BENCHMARK_RUNS; i++ )
+    {
+        sink += MAC_Unpack( &plain, &out );
+    }
+    result->unpack_plain = (HAL_CYCLE_COUNT() - start) / MAC_UNIT_TEST_BENCHMARK_RUNS;
+
+    start = HAL_CYCLE_COUNT();
+    for( uint16_t i = 0; i < MAC_UNIT_TEST_BENCHMARK_RUNS; i++ )
+    {
+        sink += MAC_Unpack( &beacon, &out );
+    }
+    result->unpack_ie = (HAL_CYCLE_COUNT() - start) / MAC_UNIT_TEST_BENCHMARK_RUNS;
+
+    start = HAL_CYCLE_COUNT();
+    for( uint16_t i = 0; i < MAC_UNIT_TEST_BENCHMARK_RUNS; i++ )
+    {
+        MAC_IE_IteratorInitFrame( &iterator, &out );
+        while( MAC_IE_Next( &iterator, &ie ) )
+        {
+            MAC_IE_IteratorInitNested( &nested, &ie );
+            while( MAC_IE_Next( &nested, &sub_ie ) )
+            {
+                sink += MAC_IE_GetAsn( &sub_ie, &asn ) +
+                        MAC_IE_GetTimeslot( &sub_ie, &timeslot ) +
+                        MAC_IE_GetChannelHopping( &sub_ie, &hopping );
+            }
+        }
+    }
+    result->iterate_ie = (HAL_CYCLE_COUNT() - start) / MAC_UNIT_TEST_BENCHMARK_RUNS;
+    (void)sink;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Unit test for frame formats, frames without FCS, it is appended by test
+///////////////////////////////////////////////////////////////////////////////
+//2006 data, PAN ID compression, short addresses
+static const uint8_t MAC_Unpack_Data2006[] = { 0x61, 0x98, 0x22, 0x62, 0x1a, 0x34, 0x12, 0x78, 0x56, 0x01, 0x02, 0x03 };
+
+//Reserved version 0b11 data, PAN ID compression, short addresses
+static const uint8_t MAC_Unpack_DataVersion11[] = { 0x41, 0xb8, 0x23, 0x62, 0x1a, 0x34, 0x12, 0x78, 0x56, 0x04 };
+
+//Multipurpose, one octet frame control, short destination, extended source
+static const uint8_t MAC_Unpack_MultipurposeShort[] = { 0xe5, 0x24, 0x34, 0x12, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x05, 0x06 };
+
+//Multipurpose, long frame control, PAN ID present, AR, short addresses
+static const uint8_t MAC_Unpack_MultipurposeLong[] = { 0xad, 0x41, 0x25, 0x62, 0x1a, 0x34, 0x12, 0x78, 0x56, 0x07 };
+
+//Fragment, extension 0x05
+static const uint8_t MAC_Unpack_Fragment[] = { 0x2e, 0x10, 0x11, 0x12, 0x13 };
+
+//Extended, extension 0x01
+static const uint8_t MAC_Unpack_Extended[] = { 0x0f, 0x20, 0x21 };
+
+//Fragment, frame control only, no room for FCS
+static const uint8_t MAC_Unpack_FragmentNoFcs[] = { 0x0e };
+
+//Fragment, frame control and one FCS octet
+static const uint8_t MAC_Unpack_FragmentShortFcs[] = { 0x0e, 0x01 };
+
+typedef struct {
+    uint8_t const * frame;
+    uint8_t size;
+}MAC_Unit_Test_Frame_t;
+
+static const MAC_Unit_Test_Frame_t MAC_Unpack_Formats[] =
+{
+    { MAC_Unpack_Data2006,          sizeof(MAC_Unpack_Data2006) },
+    { MAC_Unpack_DataVersion11,     sizeof(MAC_Unpack_DataVersion11) },
+    { MAC_Unpack_MultipurposeShort, sizeof(MAC_Unpack_MultipurposeShort) },
+    { MAC_Unpack_MultipurposeLong,  sizeof(MAC_Unpack_MultipurposeLong) },
+    { MAC_Unpack_Fragment,          sizeof(MAC_Unpack_Fragment) },
+    { MAC_Unpack_Extended,          sizeof(MAC_Unpack_Extended) },
+};
+
+#define MAC_UNIT_TEST_FORMAT_COUNT  (sizeof(MAC_Unpack_Formats)/sizeof(MAC_Unpack_Formats[0]))
+
+uint8_t MAC_Unpack_UnitTest3( void )
+{
+    MAC_Frame_packed_t in;
+    MAC_Frame_packed_t packed;
+    MAC_Frame_Unpacked_t out;
+
+    //Round trip, packing the unpacked frame gives it back
+    for( uint8_t i = 0; i < MAC_UNIT_TEST_FORMAT_COUNT; i++ )
+    {
+        mac_unit_test_load( &in, MAC_Unpack_Formats[i].frame, MAC_Unpack_Formats[i].size );
+        if( MAC_Unpack( &in, &out ) != MAC_UNPACK_SUCCESS ||
+            MAC_Pack( &out, &packed ) != MAC_PACK_SUCCESS ||
+            packed.lenght != in.lenght ||
+            memcmp( packed.payload, in.payload, in.lenght ) != 0 )
+        {
+            return false;
+        }
+    }
+
+    //Multipurpose fields
+    mac_unit_test_load( &in, MAC_Unpack_MultipurposeShort, sizeof(MAC_Unpack_MultipurposeShort) );
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_SUCCESS ||
+        out.frame_control.long_frame_control != MAC_LONG_FRAME_CONTROL_DISABLED ||
+        out.frame_control.source_addressing_mode != MAC_ADDRESSING_MODE_EXTENDED_ADDRESS ||
+        out.sequence_number != 0x24 || out.destination_addr.short_addr != 0x1234 ||
+        out.source_addr.ext_addr[7] != 0x08 || out.payload_size != 2 )
+    {
+        return false;
+    }
+    mac_unit_test_load( &in, MAC_Unpack_MultipurposeLong, sizeof(MAC_Unpack_MultipurposeLong) );
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_SUCCESS ||
+        out.frame_control.long_frame_control != MAC_LONG_FRAME_CONTROL_ENABLED ||
+        out.frame_control.acknowledge_request != MAC_ACKNOWLEDGE_REQUEST_REQUIRED ||
+        out.destination_pan_id != 0x1a62 || out.source_pan_id != 0x1a62 ||
+        out.source_addr.short_addr != 0x5678 || out.payload_size != 1 )
+    {
+        return false;
+    }
+
+    //Fragment fields, header is the frame control only
+    mac_unit_test_load( &in, MAC_Unpack_Fragment, sizeof(MAC_Unpack_Fragment) );
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_SUCCESS ||
+        out.frame_control.frame_Type != MAC_FRAME_TYPE_FRAGMENT ||
+        out.frame_control.extension != 0x05 || out.payload_size != 4 || out.payload[0] != 0x10 )
+    {
+        return false;
+    }
+
+    //Long frame control truncated
+    mac_unit_test_load( &in, MAC_Unpack_MultipurposeLong, 1 );
+    in.lenght = 1;
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_FRAME_SIZE_ERROR )
+    {
+        return false;
+    }
+
+    //Short frame control frames shorter than header and FCS
+    mac_unit_test_load( &in, MAC_Unpack_FragmentNoFcs, sizeof(MAC_Unpack_FragmentNoFcs) );
+    in.lenght = sizeof(MAC_Unpack_FragmentNoFcs);
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_FRAME_SIZE_ERROR )
+    {
+        return false;
+    }
+    mac_unit_test_load( &in, MAC_Unpack_FragmentShortFcs, sizeof(MAC_Unpack_FragmentShortFcs) );
+    in.lenght = sizeof(MAC_Unpack_FragmentShortFcs);
+    if( MAC_Unpack( &in, &out ) != MAC_UNPACK_FRAME_SIZE_ERROR )
+    {
+        return false;
+    }
+
+    //One octet multipurpose frame control can't carry second octet fields
+    mac_unit_test_load( &in, MAC_Unpack_MultipurposeLong, sizeof(MAC_Unpack_MultipurposeLong) );
+    MAC_Unpack( &in, &out );
+    out.frame_control.long_frame_control = MAC_LONG_FRAME_CONTROL_DISABLED;
+    if( MAC_Pack( &out, &packed ) != MAC_PACK_PARAMETER_ERROR )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmark of frame formats, mean cycles of MAC_Unpack
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t mac_unit_test_cycles( MAC_Unit_Test_Frame_t const * frame )
+{
+    MAC_Frame_packed_t in;
+    MAC_Frame_Unpacked_t out;
+    uint32_t start;
+    volatile uint32_t sink = 0;
+
+    mac_unit_test_load( &in, frame->frame, frame->size );
+    start = HAL_CYCLE_COUNT();
+    for( uint16_t i = 0; i < MAC_UNIT_TEST_BENCHMARK_RUNS; i++ )
+    {
+        sink += MAC_Unpack( &in, &out );
+    }
+    (void)sink;
+    return (HAL_CYCLE_COUNT() - start) / MAC_UNIT_TEST_BENCHMARK_RUNS;
+}
+
+void MAC_Unpack_BenchmarkTypes( MAC_Unpack_Benchmark_Types_t * result )
+{
+    result->data_2006           = mac_unit_test_cycles( &MAC_Unpack_Formats[0] );
+    result->data_version_11     = mac_unit_test_cycles( &MAC_Unpack_Formats[1] );
+    result->multipurpose_short  = mac_unit_test_cycles( &MAC_Unpack_Formats[2] );
+    result->multipurpose_long   = mac_unit_test_cycles( &MAC_Unpack_Formats[3] );
+    result->fragment            = mac_unit_test_cycles( &MAC_Unpack_Formats[4] );
+    result->extended            = mac_unit_test_cycles( &MAC_Unpack_Formats[5] );
+}
+
 #endif //UNIT_TEST_MAC_UNPACK
 
 
@@ -130,6 +130,105 @@ typedef union {
 #define MHR_FRAMECONTROL_SRC_ADDR_MODE_SHORT_ADDR       ((MHR_FRAMECONTROL_ADDR_MODE_SHORT_ADDR_Val)  << MHR_FRAMECONTROL_SRC_ADDR_MODE_SHFT)
 #define MHR_FRAMECONTROL_SRC_ADDR_MODE_EXT_ADDR         ((MHR_FRAMECONTROL_ADDR_MODE_EXT_ADDR_Val)    << MHR_FRAMECONTROL_SRC_ADDR_MODE_SHFT)
 
+//MAC - Multipurpose Frame Control - 802.15.4-2015 7.3.5.1
+//One octet unless Long Frame Control is set, second octet fields are then 0
+#define MHR_MP_FRAMECONTROL_SHORT_SIZE                  (1)
+#define MHR_MP_FRAMECONTROL_LONG                        (0x0008)
+#define MHR_MP_FRAMECONTROL_DST_ADDR_MODE_SHFT          (4)
+#define MHR_MP_FRAMECONTROL_DST_ADDR_MODE_MSK           ((0x03) << MHR_MP_FRAMECONTROL_DST_ADDR_MODE_SHFT)
+#define MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_SHFT          (6)
+#define MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_MSK           ((0x03) << MHR_MP_FRAMECONTROL_SRC_ADDR_MODE_SHFT)
+#define MHR_MP_FRAMECONTROL_PANID_PRESENT               (0x0100)    //destination PAN ID, there is no source PAN ID
+#define MHR_MP_FRAMECONTROL_SECURITY_ENABLED            (0x0200)
+#define MHR_MP_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION (0x0400)
+#define MHR_MP_FRAMECONTROL_FRAME_PENDING               (0x0800)
+#define MHR_MP_FRAMECONTROL_FRAME_VERSION_SHFT          (12)
+#define MHR_MP_FRAMECONTROL_FRAME_VERSION_MSK           ((0x03) << MHR_MP_FRAMECONTROL_FRAME_VERSION_SHFT)
+#define MHR_MP_FRAMECONTROL_AR                          (0x4000)
+#define MHR_MP_FRAMECONTROL_IE_PRESENT                  (0x8000)
+
+//MAC - Fragment (or Frak) and extended frames - one octet frame control
+//bits 3-7 are defined by the amendment using the frame, kept as sent
+//there is no sequence number nor addressing fields
+#define MHR_SHORT_FRAMECONTROL_SIZE                     (1)
+#define MHR_FRAMECONTROL_EXTENSION_SHFT                 (3)
+#define MHR_FRAMECONTROL_EXTENSION_MSK                  ((0x1F) << MHR_FRAMECONTROL_EXTENSION_SHFT)
+
+//MAC - Information Elements - 802.15.4-2015 7.4
+//Descriptors are 2 octets, type bit 15 is 0 for header IEs, 1 for payload IEs
+#define MAC_IE_DESCRIPTOR_SIZE                          (2)
+#define MAC_IE_TYPE_MSK                                 (0x8000)
+
+//MAC - Header IE descriptor - length bit 0-6, element ID bit 7-14
+#define MAC_HEADER_IE_LENGTH_MSK                        (0x007F)
+#define MAC_HEADER_IE_ID_SHFT                           (7)
+#define MAC_HEADER_IE_ID_MSK                            ((0xFF) << MAC_HEADER_IE_ID_SHFT)
+#define MAC_HEADER_IE_ID_CSL                            (0x1A)
+#define MAC_HEADER_IE_ID_TIME_CORRECTION                (0x1E)      //ACK/NACK time correction
+#define MAC_HEADER_IE_ID_HT1                            (0x7E)      //header termination, payload IEs follow
+#define MAC_HEADER_IE_ID_HT2                            (0x7F)      //header termination, payload follows
+
+//MAC - CSL IE, phase and period then optional rendezvous time, in 10 symbols
+#define MAC_IE_CSL_SIZE                                 (4)
+#define MAC_IE_CSL_RENDEZVOUS_SIZE                      (6)
+
+//MAC - Time correction IE, signed 12 bits time correction in us, NACK bit 15
+#define MAC_IE_TIME_CORRECTION_SIZE                     (2)
+#define MAC_IE_TIME_CORRECTION_MSK                      (0x0FFF)
+#define MAC_IE_TIME_CORRECTION_SIGN                     (0x0800)
+#define MAC_IE_TIME_CORRECTION_NACK                     (0x8000)
+
+//MAC - Payload IE descriptor - length bit 0-10, group ID bit 11-14
+#define MAC_PAYLOAD_IE_LENGTH_MSK                       (0x07FF)
+#define MAC_PAYLOAD_IE_GROUP_SHFT                       (11)
+#define MAC_PAYLOAD_IE_GROUP_MSK                        ((0x0F) << MAC_PAYLOAD_IE_GROUP_SHFT)
+#define MAC_PAYLOAD_IE_GROUP_MLME                       (0x01)      //content is nested sub-IEs
+#define MAC_PAYLOAD_IE_GROUP_TERMINATION                (0x0F)
+
+//MAC - MLME sub-IE descriptor, type bit 15 is 0 for short, 1 for long
+//short: length bit 0-7, sub-ID bit 8-14
+//long: length bit 0-10, sub-ID bit 11-14
+#define MAC_SUB_IE_SHORT_LENGTH_MSK                     (0x00FF)
+#define MAC_SUB_IE_SHORT_ID_SHFT                        (8)
+#define MAC_SUB_IE_SHORT_ID_MSK                         ((0x7F) << MAC_SUB_IE_SHORT_ID_SHFT)
+#define MAC_SUB_IE_LONG_LENGTH_MSK                      (0x07FF)
+#define MAC_SUB_IE_LONG_ID_SHFT                         (11)
+#define MAC_SUB_IE_LONG_ID_MSK                          ((0x0F) << MAC_SUB_IE_LONG_ID_SHFT)
+#define MAC_SUB_IE_SHORT_ID_TSCH_SYNC                   (0x1A)      //ASN and join metric
+#define MAC_SUB_IE_SHORT_ID_TSCH_SLOTFRAME              (0x1B)
+#define MAC_SUB_IE_SHORT_ID_TSCH_TIMESLOT               (0x1C)
+#define MAC_SUB_IE_LONG_ID_CHANNEL_HOPPING              (0x09)
+
+//MAC - TSCH synchronization IE, 5 octets ASN then join metric
+#define MAC_IE_ASN_SIZE                                 (5)
+
+//MAC - TSCH timeslot IE, template ID only or full template with max TX
+//and timeslot length on 2 or 3 octets
+#define MAC_IE_TIMESLOT_ID_SIZE                         (1)
+#define MAC_IE_TIMESLOT_SIZE                            (25)
+#define MAC_IE_TIMESLOT_LONG_SIZE                       (27)
+
+//MAC - Channel hopping IE, sequence ID only or full sequence without
+//extended bitmap, channels are 2 octets each
+#define MAC_IE_CHANNEL_HOPPING_ID_SIZE                  (1)
+#define MAC_IE_CHANNEL_HOPPING_FIXED_SIZE               (12)
+#define MAC_IE_CHANNEL_HOPPING_ENTRY_SIZE               (2)
+
+//MAC - Auxiliary security header - 802.15.4-2015 9.4
+//security control | frame counter (4) | key source (0, 4 or 8) | key index
+//Follows addressing fields, header IEs are sent in clear after it
+#define MAC_SECURITY_CONTROL_SIZE                       (1)
+#define MAC_SECURITY_LEVEL_MSK                          (0x07)
+#define MAC_SECURITY_LEVEL_ENCRYPTION                   (0x04)      //payload IEs and payload encrypted
+#define MAC_SECURITY_KEY_ID_MODE_SHFT                   (3)
+#define MAC_SECURITY_KEY_ID_MODE_MSK                    ((0x03) << MAC_SECURITY_KEY_ID_MODE_SHFT)
+#define MAC_SECURITY_FRAME_COUNTER_SUPPRESSION          (0x20)
+#define MAC_SECURITY_ASN_IN_NONCE                       (0x40)
+#define MAC_SECURITY_FRAME_COUNTER_SIZE                 (4)
+#define MAC_SECURITY_KEY_SOURCE_MAX_SIZE                (8)
+#define MAC_SECURITY_KEY_INDEX_SIZE                     (1)
+#define MAC_SECURITY_MIC_MAX_SIZE                       (16)
+
 
 typedef enum {
     MAC_FRAME_TYPE_BEACON,
@@ -186,6 +285,34 @@ typedef enum {
     MAC_FRAME_VERSION_11
 }MAC_Frame_Version_t;
 
+typedef enum {
+    MAC_LONG_FRAME_CONTROL_DISABLED,    //one octet multipurpose frame control
+    MAC_LONG_FRAME_CONTROL_ENABLED
+}MAC_Long_Frame_Control_t;
+
+typedef enum {
+    MAC_PANID_PRESENT_NOT_PRESENT,
+    MAC_PANID_PRESENT_PRESENT
+}MAC_PANID_Present_t;
+
+typedef enum {
+    MAC_SECURITY_LEVEL_NONE,
+    MAC_SECURITY_LEVEL_MIC_32,
+    MAC_SECURITY_LEVEL_MIC_64,
+    MAC_SECURITY_LEVEL_MIC_128,
+    MAC_SECURITY_LEVEL_ENC,
+    MAC_SECURITY_LEVEL_ENC_MIC_32,
+    MAC_SECURITY_LEVEL_ENC_MIC_64,
+    MAC_SECURITY_LEVEL_ENC_MIC_128
+}MAC_Security_Level_t;
+
+typedef enum {
+    MAC_KEY_ID_MODE_IMPLICIT,           //key from addresses, no key identifier
+    MAC_KEY_ID_MODE_INDEX,              //key index only
+    MAC_KEY_ID_MODE_SOURCE_4,           //4 octets key source and key index
+    MAC_KEY_ID_MODE_SOURCE_8            //8 octets key source and key index
+}MAC_Key_Id_Mode_t;
+
 //Frame control - Unpack
 typedef struct {
     MAC_Frame_Type_t            frame_Type;
@@ -198,8 +325,26 @@ typedef struct {
     MAC_Addressing_Mode_t       destination_addressing_mode;
     MAC_Frame_Version_t         frame_version;
     MAC_Addressing_Mode_t       source_addressing_mode;
+    MAC_Long_Frame_Control_t    long_frame_control;         //multipurpose only
+    MAC_PANID_Present_t         panid_present;              //multipurpose only, replaces panid_compression
+    uint8_t                     extension;                  //fragment and extended only, bits 3-7
 }MAC_Frame_Control_t;
 
+//Auxiliary security header - Unpack, fields are left as sent, nothing is decrypted
+typedef struct {
+    MAC_Security_Level_t    security_level;
+    MAC_Key_Id_Mode_t       key_id_mode;
+    bool                    frame_counter_suppressed;
+    bool                    asn_in_nonce;
+    uint32_t                frame_counter;              //0 when suppressed
+    uint8_t                 key_source[MAC_SECURITY_KEY_SOURCE_MAX_SIZE];   //as sent, LSB first
+    uint8_t                 key_source_size;
+    uint8_t                 key_index;
+    uint8_t                 size;                       //header size in frame
+    uint8_t                 mic[MAC_SECURITY_MIC_MAX_SIZE];
+    uint8_t                 mic_size;                   //MIC is not part of payload
+}MAC_Security_Header_t;
+
 typedef union {
     uint16_t    fcs_2_octets;
     uint32_t    fcs_4_octets;
@@ -210,13 +355,14 @@ typedef union {
 typedef struct {
     MAC_Frame_Control_t     frame_control;
     uint8_t                 sequence_number;
-    uint16_t                destination_pan_id;
+    uint16_t                destination_pan_id;             //holds source PAN ID when elided
     MAC_Addr_t              destination_addr;
-    uint16_t                source_pan_id;
+    uint16_t                source_pan_id;                  //holds destination PAN ID when elided
     MAC_Addr_t              source_addr;
-    // MAC_Security_Header_t   auxiliary_security_header;      //not suppoorted for now
-    // MAC_IE_Header_t         ie_header;                      //not suppoorted for now
-    // uint8_t                 ie_payload[];                   //not suppoorted for now
+    MAC_Security_Header_t   auxiliary_security_header;      //valid when security enabled
+    uint8_t                 header_ie_size;                 //header IEs at start of payload, termination included
+    uint8_t                 ie_size;                        //header and payload IEs at start of payload, MAC payload follows
+                                                            //encrypted payload IEs are left in MAC payload
     uint8_t                 payload[MAC_MAX_PAYLOAD];
     uint8_t                 payload_size;
     MAC_FCS_t               fcs;
@@ -237,9 +383,66 @@ typedef enum {
     MAC_UNPACK_INVALID_FRAME_VERSION,
     MAC_UNPACK_UNSUPPORTED_FRAME_TYPE,
     MAC_UNPACK_FCS_DOES_NOT_MATCH,
+    MAC_UNPACK_INVALID_IE,
 }MAC_Unpack_Result_t;
 
 
+//IE lists, an iterator walks header IEs then payload IEs, or the sub-IEs
+//nested in a MLME payload IE
+typedef enum {
+    MAC_IE_KIND_HEADER,                 //id is element ID
+    MAC_IE_KIND_PAYLOAD,                //id is group ID
+    MAC_IE_KIND_SUB_SHORT,              //id is short sub-ID
+    MAC_IE_KIND_SUB_LONG,               //id is long sub-ID
+}MAC_IE_Kind_t;
+
+//An IE, content points in the iterated buffer, nothing is copied
+typedef struct {
+    uint8_t const *     content;        //descriptor excluded
+    uint16_t            length;
+    uint8_t             id;
+    MAC_IE_Kind_t       kind;
+}MAC_IE_t;
+
+typedef struct {
+    uint8_t const *     buffer;
+    uint16_t            size;
+    uint16_t            index;          //next descriptor, end of IEs once done
+    uint16_t            header_size;    //end of header IEs, termination included
+    MAC_IE_Kind_t       kind;           //list walked, nested lists are MAC_IE_KIND_SUB_SHORT
+    bool                done;
+    bool                error;          //IE overruns buffer or has the wrong type
+    bool                header_only;    //walk ends with header IEs, payload IEs are encrypted
+}MAC_IE_Iterator_t;
+
+//CSL IE, in units of 10 symbols
+typedef struct {
+    uint16_t            phase;
+    uint16_t            period;
+    uint16_t            rendezvous;     //0 when absent
+}MAC_IE_Csl_t;
+
+//ACK/NACK time correction IE
+typedef struct {
+    int16_t             correction_us;
+    bool                nack;
+}MAC_IE_Time_Correction_t;
+
+//TSCH timeslot IE, times are 0 when only template ID is given
+typedef struct {
+    uint8_t             template_id;
+    uint16_t            tx_offset_us;
+    uint32_t            timeslot_us;
+}MAC_IE_Timeslot_t;
+
+//Channel hopping IE, count is 0 when only sequence ID is given
+typedef struct {
+    uint8_t             sequence_id;
+    uint16_t            count;
+    uint8_t const *     list;           //count channels, 2 octets each LSB first
+    uint16_t            current_hop;
+}MAC_IE_Channel_Hopping_t;
+
 typedef enum {
     MAC_PACK_SUCCESS,
     MAC_PACK_PARAMETER_ERROR,
@@ -263,11 +466,66 @@ MAC_Unpack_Result_t MAC_Unpack( MAC_Frame_packed_t * in, MAC_Frame_Unpacked_t *
 
 MAC_Pack_Result_t MAC_Pack( MAC_Frame_Unpacked_t * in, MAC_Frame_packed_t * out);
 
+/**************************************************************************//**
+\brief Start iterating a header IE list, payload IEs follow a header
+termination 1
+******************************************************************************/
+void MAC_IE_IteratorInit( MAC_IE_Iterator_t * iterator, uint8_t const * buffer, uint16_t size );
+
+/**************************************************************************//**
+\brief Start iterating IEs of an unpacked frame
+******************************************************************************/
+void MAC_IE_IteratorInitFrame( MAC_IE_Iterator_t * iterator, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Start iterating sub-IEs nested in a MLME payload IE
+******************************************************************************/
+void MAC_IE_IteratorInitNested( MAC_IE_Iterator_t * iterator, MAC_IE_t const * ie );
+
+/**************************************************************************//**
+\brief Get next IE, returns false at end of list or on malformed IE
+Terminations end their list and are not returned
+******************************************************************************/
+bool MAC_IE_Next( MAC_IE_Iterator_t * iterator, MAC_IE_t * ie );
+
+/**************************************************************************//**
+\brief Typed IE accessors, return false if IE is not of that type or
+its length is invalid
+******************************************************************************/
+bool MAC_IE_GetCsl( MAC_IE_t const * ie, MAC_IE_Csl_t * csl );
+bool MAC_IE_GetTimeCorrection( MAC_IE_t const * ie, MAC_IE_Time_Correction_t * correction );
+bool MAC_IE_GetAsn( MAC_IE_t const * ie, uint64_t * asn );
+bool MAC_IE_GetTimeslot( MAC_IE_t const * ie, MAC_IE_Timeslot_t * timeslot );
+bool MAC_IE_GetChannelHopping( MAC_IE_t const * ie, MAC_IE_Channel_Hopping_t * hopping );
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
 //  Unit tests
 ///////////////////////////////////////////////////////////////////////////////
 uint8_t MAC_Unpack_UnitTest1( void );
+uint8_t MAC_Unpack_UnitTest2( void );
+uint8_t MAC_Unpack_UnitTest3( void );
+
+//Mean core clock cycles per call
+typedef struct {
+    uint32_t unpack_plain;              //MAC_Unpack of a frame without IE
+    uint32_t unpack_ie;                 //MAC_Unpack of an enhanced beacon
+    uint32_t iterate_ie;                //walk of its IEs with typed accessors
+}MAC_Unpack_Benchmark_t;
+
+void MAC_Unpack_BenchmarkIE( MAC_Unpack_Benchmark_t * result );
+
+//Mean core clock cycles per MAC_Unpack call, by frame format
+typedef struct {
+    uint32_t data_2006;
+    uint32_t data_version_11;
+    uint32_t multipurpose_short;
+    uint32_t multipurpose_long;
+    uint32_t fragment;
+    uint32_t extended;
+}MAC_Unpack_Benchmark_Types_t;
+
+void MAC_Unpack_BenchmarkTypes( MAC_Unpack_Benchmark_Types_t * result );
 
 #endif // _MAC_UNPACK_H
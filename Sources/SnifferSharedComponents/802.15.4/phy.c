@@ -35,13 +35,29 @@ SOFTWARE.
 #include "string.h"
 #include "mac.h"
 #include "Hal_Radio.h"
+#include "scheduler.h"
+#include "pool.h"
 
 /******************************************************************************
                    Define section
 ******************************************************************************/
+#define PHY_TX_QUEUE_MASK           (PHY_TX_QUEUE_SIZE - 1)
+
+#if (PHY_TX_QUEUE_SIZE & PHY_TX_QUEUE_MASK) != 0
+#error "PHY_TX_QUEUE_SIZE must be a power of 2"
+#endif
+
 /******************************************************************************
                    Types section
 ******************************************************************************/
+typedef struct {
+    PhyRx_t * frame;                //pool buffer, len excludes FCS
+    uint32_t queued;                //radio time frame was queued
+    uint32_t scheduled;             //requested end of frame, scheduled mode only
+    uint16_t handle;
+    PhyTxMode_t mode;
+}PhyTxEntry_t;
+
 /******************************************************************************
                    Implementations section
 ******************************************************************************/
@@ -51,9 +67,96 @@ SOFTWARE.
 /******************************************************************************
                    Local variables section
 ******************************************************************************/
+//Transmit queue, head is in transmission when phyTxActive is set
+static PhyTxEntry_t phyTxQueue[PHY_TX_QUEUE_SIZE];
+static uint8_t phyTxHead;
+static uint8_t phyTxCount;
+static bool phyTxActive;
+static PhyTxStats_t phyTxStats;
+
+//Outcome of transmit in progress, written from interrupt context
+static volatile bool phyTxDone;
+static volatile PhyTxStatus_t phyTxStatus;
+static volatile uint32_t phyTxTimestamp;
+
 /******************************************************************************
                    Local function section
 ******************************************************************************/
+/**************************************************************************//**
+\brief Report and release frame at queue head
+******************************************************************************/
+static void phy_tx_complete( PhyTxStatus_t status, uint32_t timestamp )
+{
+    PhyTxEntry_t * entry = &phyTxQueue[phyTxHead];
+    PhyTxReport_t report;
+
+    switch( status )
+    {
+        case PHY_TX_STATUS_SENT:        phyTxStats.sent++;      break;
+        case PHY_TX_STATUS_CCA_FAIL:    phyTxStats.cca_fail++;  break;
+        default:                        phyTxStats.errors++;    break;
+    }
+
+    report.queued = entry->queued;
+    report.scheduled = entry->scheduled;
+    report.done = timestamp;
+    report.handle = entry->handle;
+    report.mode = entry->mode;
+    report.status = status;
+    PHY_TxCallback( &report );
+    Pool_Release( entry->frame );
+    entry->frame = NULL;
+    phyTxHead = (phyTxHead + 1) & PHY_TX_QUEUE_MASK;
+    phyTxCount--;
+}
+
+/**************************************************************************//**
+\brief Put a pool buffer at queue tail, queue owns one reference on it
+******************************************************************************/
+static void phy_tx_push( PhyRx_t * buffer, PhyTxMode_t mode, uint32_t scheduled, uint16_t handle )
+{
+    PhyTxEntry_t * entry;
+
+    entry = &phyTxQueue[(phyTxHead + phyTxCount) & PHY_TX_QUEUE_MASK];
+    entry->frame = buffer;
+    entry->queued = HAL_Radio_GetTime();
+    entry->scheduled = scheduled;
+    entry->handle = handle;
+    entry->mode = mode;
+    phyTxCount++;
+    phyTxStats.queued++;
+
+    Scheduler_Post( SCHEDULER_TASK_TX );
+}
+
+/**************************************************************************//**
+\brief Copy a frame to a pool buffer at queue tail, reception reserve is left free
+******************************************************************************/
+static PhyTxQueue_Result_t phy_tx_queue( uint8_t const * frame, uint8_t length, PhyTxMode_t mode, uint32_t scheduled, uint16_t handle )
+{
+    PhyRx_t * buffer;
+
+    if( (frame == NULL) || (length == 0) || (length > PHY_TX_FRAME_MAX) || (mode >= PHY_TX_MODE_COUNT) )
+    {
+        return PHY_TX_QUEUE_INVALID_PARAMETER;
+    }
+
+    buffer = NULL;
+    if( phyTxCount < PHY_TX_QUEUE_SIZE )
+    {
+        buffer = Pool_AllocHold();
+    }
+    if( buffer == NULL )
+    {
+        phyTxStats.rejected++;
+        return PHY_TX_QUEUE_FULL;
+    }
+
+    buffer->len = length;
+    memcpy( buffer->payload, frame, length );
+    phy_tx_push( buffer, mode, scheduled, handle );
+    return PHY_TX_QUEUE_SUCCESS;
+}
 
 /******************************************************************************
                    Global function section
@@ -113,14 +216,136 @@ SOFTWARE.
 // }
 
 
-// /**************************************************************************//**
-// \brief Send a frame over the air
-//     /param[in]     buffer       pointer to buffer to send
-//     /param[in]     size         buffer length
-// ******************************************************************************/
-// int PHY_SendFrame( uint8_t * buffer, uint8_t size )
-// {
-// }
+/**************************************************************************//**
+\brief Send a frame over the air
+    /param[in]     buffer       packed MAC frame, FCS included
+    /param[in]     length       buffer length
+    FCS is dropped, radio computes it again
+******************************************************************************/
+int PHY_SendFrame( uint8_t * buffer, uint16_t length )
+{
+    if( (length <= PHY_FCS_SIZE) || (length > (PHY_TX_FRAME_MAX + PHY_FCS_SIZE)) )
+    {
+        return -1;
+    }
+
+    if( PHY_QueueFrame( buffer, length - PHY_FCS_SIZE, PHY_TX_MODE_CSMA, PHY_TX_HANDLE_NONE ) != PHY_TX_QUEUE_SUCCESS )
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/**************************************************************************//**
+\brief Queue a frame for transmission on current channel
+Frames are sent in queue order, reception resumes between transmits
+******************************************************************************/
+PhyTxQueue_Result_t PHY_QueueFrame( uint8_t const * frame, uint8_t length, PhyTxMode_t mode, uint16_t handle )
+{
+    if( mode >= PHY_TX_MODE_SCHEDULED )
+    {
+        return PHY_TX_QUEUE_INVALID_PARAMETER;
+    }
+    return phy_tx_queue( frame, length, mode, 0, handle );
+}
+
+/**************************************************************************//**
+\brief Queue a frame for transmission at a given time on current channel
+Scheduled frames keep queue order, a frame queued behind one of them waits
+******************************************************************************/
+PhyTxQueue_Result_t PHY_QueueFrameAt( uint8_t const * frame, uint8_t length, uint32_t end_time, uint16_t handle )
+{
+    return phy_tx_queue( frame, length, PHY_TX_MODE_SCHEDULED, end_time, handle );
+}
+
+/**************************************************************************//**
+\brief Queue a frame already held in a pool buffer at a given time, no copy
+******************************************************************************/
+PhyTxQueue_Result_t PHY_QueueBufferAt( PhyRx_t * buffer, uint32_t end_time, uint16_t handle )
+{
+    if( (Pool_GetReferences( buffer ) == 0) || (buffer->len == 0) || (buffer->len > PHY_TX_FRAME_MAX) )
+    {
+        return PHY_TX_QUEUE_INVALID_PARAMETER;
+    }
+
+    if( phyTxCount >= PHY_TX_QUEUE_SIZE )
+    {
+        phyTxStats.rejected++;
+        return PHY_TX_QUEUE_FULL;
+    }
+
+    Pool_Retain( buffer );
+    phy_tx_push( buffer, PHY_TX_MODE_SCHEDULED, end_time, handle );
+    return PHY_TX_QUEUE_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Retreive transmit statistics
+******************************************************************************/
+void PHY_GetTxStats( PhyTxStats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = phyTxStats;
+        stats->pending = phyTxCount;
+    }
+}
+
+/**************************************************************************//**
+\brief Clear transmit counters
+******************************************************************************/
+void PHY_ClearTxStats( void )
+{
+    memset( &phyTxStats, 0, sizeof(phyTxStats) );
+}
+
+/**************************************************************************//**
+\brief Phy transmit task
+    Start next queued frame once previous one completed, report outcomes
+    A single transmit is in progress at a time, the radio goes back to
+    RX between frames so capture continues while the queue drains
+******************************************************************************/
+void PHY_TxTask( void )
+{
+    PhyTxEntry_t * entry;
+    HAL_Radio_Transmit_Result_t result;
+
+    if( phyTxActive )
+    {
+        if( !phyTxDone )
+        {
+            return;
+        }
+        phyTxActive = false;
+        phy_tx_complete( phyTxStatus, phyTxTimestamp );
+    }
+
+    while( (phyTxCount != 0) && !phyTxActive )
+    {
+        entry = &phyTxQueue[phyTxHead];
+        phyTxDone = false;
+        phyTxActive = true;
+        if( entry->mode == PHY_TX_MODE_SCHEDULED )
+        {
+            result = HAL_Radio_TransmitAt( entry->frame->payload, entry->frame->len, entry->scheduled );
+        }else{
+            result = HAL_Radio_Transmit( entry->frame->payload, entry->frame->len, (entry->mode == PHY_TX_MODE_CSMA) );
+        }
+        if( result != HAL_RADIO_TRANSMIT_SUCCESS )
+        {
+            phyTxActive = false;
+            phy_tx_complete( PHY_TX_STATUS_ERROR, HAL_Radio_GetTime() );
+        }
+    }
+}
+
+/**************************************************************************//**
+\brief callback raised once per queued frame when its transmit is done
+******************************************************************************/
+void __attribute__((weak)) PHY_TxCallback( PhyTxReport_t const * report )
+{
+    (void) report;
+}
 
 
 /**************************************************************************//**
@@ -129,15 +354,53 @@ SOFTWARE.
 ******************************************************************************/
 void PHY_Task( void )
 {
-    PhyRx_t phy_rx;
+    PhyRx_t * phy_rx;
+
+    //Frame buffer is owned by this task, stages keeping it retain a reference
+    phy_rx = Pool_Alloc();
+    if( phy_rx == NULL )
+    {
+        //every buffer is held downstream, drop frame (counted as pool exhaustion)
+        HAL_Radio_DropRxPacket();
+    }else{
+        //Retreive and process radio packets
+        if( HAL_Radio_GetRxPacket( phy_rx ) == HAL_RADIO_GET_RX_PACKET_SUCCESS )
+        {
+            MAC_ProcessPhyRx( phy_rx );
+        }
+        Pool_Release( phy_rx );
+    }
+
+    //One packet per run, let other tasks run in between
+    if( HAL_Radio_RxPending() )
+    {
+        Scheduler_Post( SCHEDULER_TASK_PHY );
+    }
+}
+
+/**************************************************************************//**
+\brief Radio received a packet, interrupt context
+******************************************************************************/
+void HAL_Radio_RxCallback( void )
+{
+    Scheduler_Post( SCHEDULER_TASK_PHY );
+}
 
-    //Retreive and process radio packets
-    if( HAL_Radio_GetRxPacket( &phy_rx ) == HAL_RADIO_GET_RX_PACKET_SUCCESS )
+/**************************************************************************//**
+\brief Radio transmit completed, interrupt context
+******************************************************************************/
+void HAL_Radio_TxCallback( HAL_Radio_Tx_Result_t result, uint32_t timestamp )
+{
+    switch( result )
     {
-        MAC_ProcessPhyRx( &phy_rx );
+        case HAL_RADIO_TX_SENT:         phyTxStatus = PHY_TX_STATUS_SENT;       break;
+        case HAL_RADIO_TX_CHANNEL_BUSY: phyTxStatus = PHY_TX_STATUS_CCA_FAIL;   break;
+        default:                        phyTxStatus = PHY_TX_STATUS_ERROR;      break;
     }
+    phyTxTimestamp = timestamp;
+    phyTxDone = true;
+    Scheduler_Post( SCHEDULER_TASK_TX );
 }
 
 
 // eof phy.c
-
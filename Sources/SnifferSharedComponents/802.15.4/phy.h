@@ -33,11 +33,22 @@ SOFTWARE.
                     Includes section
 ******************************************************************************/
 #include "stdint.h"
+#include "stdbool.h"
 
 /******************************************************************************
                    Define(s) section
 ******************************************************************************/
 #define PHY_PAYLOAD_MAX         128
+#define PHY_FCS_SIZE            2
+
+//Largest frame accepted for transmission, PSDU of 127 bytes without FCS
+#define PHY_TX_FRAME_MAX        (PHY_PAYLOAD_MAX - 1 - PHY_FCS_SIZE)
+
+//Frames waiting for transmission, must be a power of 2
+#define PHY_TX_QUEUE_SIZE       16
+
+//Handle reported for frames queued by PHY_SendFrame
+#define PHY_TX_HANDLE_NONE      0xFFFF
 
 /******************************************************************************
                    Types section
@@ -73,8 +84,50 @@ typedef struct {
     uint8_t lqi;
     int8_t  rssi;
     uint8_t channel;
+    uint32_t timestamp;             //radio time in us at end of frame
+    uint8_t repeats;                //identical copies received after this one, see Dedup_Hold
+    uint16_t weight;                //frames this one stands for, see Sample_Keep
 }PhyRx_t;
 
+typedef enum {
+    PHY_TX_MODE_CSMA,               //CSMA-CA then transmit
+    PHY_TX_MODE_IMMEDIATE,          //transmit without sensing the channel
+    PHY_TX_MODE_SCHEDULED,          //transmit at a given radio time, see PHY_QueueFrameAt
+    PHY_TX_MODE_COUNT
+}PhyTxMode_t;
+
+typedef enum {
+    PHY_TX_QUEUE_SUCCESS,
+    PHY_TX_QUEUE_INVALID_PARAMETER,
+    PHY_TX_QUEUE_FULL,              //queue full or pool down to its reception reserve
+}PhyTxQueue_Result_t;
+
+//Outcome of a queued frame, see PHY_TxCallback
+typedef enum {
+    PHY_TX_STATUS_SENT,
+    PHY_TX_STATUS_CCA_FAIL,         //channel busy on every CSMA try
+    PHY_TX_STATUS_ERROR,            //radio refused or aborted the transmit
+}PhyTxStatus_t;
+
+//Outcome of a queued frame, radio times in us
+typedef struct {
+    uint32_t queued;                //time frame was queued
+    uint32_t scheduled;             //requested end of frame, scheduled mode only
+    uint32_t done;                  //end of frame when sent, else time of failure
+    uint16_t handle;
+    PhyTxMode_t mode;
+    PhyTxStatus_t status;
+}PhyTxReport_t;
+
+typedef struct {
+    uint32_t queued;                //frames accepted
+    uint32_t sent;
+    uint32_t cca_fail;
+    uint32_t errors;
+    uint32_t rejected;              //frames refused, queue full
+    uint8_t  pending;               //frames queued or in transmission
+}PhyTxStats_t;
+
 /******************************************************************************
                    Global variables section
 ******************************************************************************/
@@ -91,9 +144,56 @@ void PHY_SetChannel( uint8_t channel );
 
 /**************************************************************************//**
 \brief Phy Send frame
+Queue a packed MAC frame, FCS included, for transmission after CSMA-CA
+returns 0 when queued, -1 otherwise
 ******************************************************************************/
 int PHY_SendFrame( uint8_t * buffer, uint16_t length );
 
+/**************************************************************************//**
+\brief Queue a frame for transmission on current channel
+    /param[in]     frame        PSDU without FCS, radio appends it
+    /param[in]     length       1 - PHY_TX_FRAME_MAX
+    /param[in]     mode         CSMA-CA or immediate
+    /param[in]     handle       reported back by PHY_TxCallback
+******************************************************************************/
+PhyTxQueue_Result_t PHY_QueueFrame( uint8_t const * frame, uint8_t length, PhyTxMode_t mode, uint16_t handle );
+
+/**************************************************************************//**
+\brief Queue a frame for transmission at a given time on current channel
+    /param[in]     end_time     radio time in us of end of frame, same time
+                                base as received frames timestamps
+    A time already passed transmits as soon as possible
+******************************************************************************/
+PhyTxQueue_Result_t PHY_QueueFrameAt( uint8_t const * frame, uint8_t length, uint32_t end_time, uint16_t handle );
+
+/**************************************************************************//**
+\brief Queue a frame at a given time, as PHY_QueueFrameAt, from a pool buffer
+    /param[in]     buffer       pool buffer, len and payload hold the PSDU
+                                without FCS, queue retains it until sent
+******************************************************************************/
+PhyTxQueue_Result_t PHY_QueueBufferAt( PhyRx_t * buffer, uint32_t end_time, uint16_t handle );
+
+/**************************************************************************//**
+\brief Retreive transmit statistics
+******************************************************************************/
+void PHY_GetTxStats( PhyTxStats_t * stats );
+
+/**************************************************************************//**
+\brief Clear transmit counters
+******************************************************************************/
+void PHY_ClearTxStats( void );
+
+/**************************************************************************//**
+\brief Phy transmit task
+    Start next queued frame once previous one completed, report outcomes
+******************************************************************************/
+void PHY_TxTask( void );
+
+/**************************************************************************//**
+\brief callback raised once per queued frame when its transmit is done
+******************************************************************************/
+void PHY_TxCallback( PhyTxReport_t const * report );
+
 /**************************************************************************//**
 \brief Phy task
     Retreive received messages and pass to MAC layer
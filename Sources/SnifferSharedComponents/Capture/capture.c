@@ -0,0 +1,432 @@
+/***************************************************************************//**
+ @file capture.c
+  @brief   Capture configuration and processing of received frames
+           Frames are filtered, truncated to snaplen and encoded to the
+           capture channel, radio channel follows an optional hop plan
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture.h"
+#include "capture_burst.h"
+#include "capture_flashlog.h"
+#include "capture_summary.h"
+#include "capture_dedup.h"
+#include "capture_ack.h"
+#include "capture_sample.h"
+#include "capture_discover.h"
+#include "capture_turnaround.h"
+#include "capture_visit.h"
+#include "capture_tsch.h"
+#include "console.h"
+#include "console_mux.h"
+#include "mac_unpack.h"
+#include "scheduler.h"
+#include "Hal.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define CAPTURE_US_PER_MS               1000
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+typedef struct {
+    uint8_t  channels[CAPTURE_HOP_MAX_CHANNELS];
+    uint8_t  count;                     //0 when hopping is disabled
+    uint8_t  index;                     //current entry of channels
+}Capture_Hop_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static bool capture_filter_match( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Capture_Hop_t captureHop;
+static Capture_Filter_t captureFilter;
+static uint8_t captureSnaplen = CAPTURE_SNAPLEN_FULL;
+static Capture_Encoding_t captureEncoding = CAPTURE_ENCODING_JSON;
+static Capture_Stats_t captureStats;
+
+//Unpack buffers shared by every frame consumer, too large for stack
+static MAC_Frame_packed_t captureFramePacked;
+static MAC_Frame_Unpacked_t captureFrameUnpacked;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return true if frame is accepted by capture filter
+Frames the MAC layer can't unpack, frame being NULL, never match an address filter
+******************************************************************************/
+static bool capture_filter_match( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    uint8_t frame_type;
+
+    if( phy_rx->len < MHR_FRAME_CONTROL_SIZE )
+    {
+        return false;
+    }
+
+    //Frame type is the first 3 bits, no need to unpack
+    frame_type = (phy_rx->payload[0] & MHR_FRAMECONTROL_FRAME_TYPE_MSK) >> MHR_FRAMECONTROL_FRAME_TYPE_SHFT;
+    if( (captureFilter.type_mask & (1 << frame_type)) == 0 )
+    {
+        return false;
+    }
+
+    if( (captureFilter.pan_id == CAPTURE_FILTER_ANY) &&
+        (captureFilter.src_addr == CAPTURE_FILTER_ANY) &&
+        (captureFilter.dst_addr == CAPTURE_FILTER_ANY) )
+    {
+        return true;
+    }
+
+    if( frame == NULL )
+    {
+        return false;
+    }
+
+    if( (captureFilter.pan_id != CAPTURE_FILTER_ANY) &&
+        (frame->destination_pan_id != captureFilter.pan_id) &&
+        (frame->source_pan_id != captureFilter.pan_id) )
+    {
+        return false;
+    }
+
+    if( (captureFilter.src_addr != CAPTURE_FILTER_ANY) &&
+        ( (frame->frame_control.source_addressing_mode != MAC_ADDRESSING_MODE_SHORT_ADDRESS) ||
+          (frame->source_addr.short_addr != captureFilter.src_addr) ) )
+    {
+        return false;
+    }
+
+    if( (captureFilter.dst_addr != CAPTURE_FILTER_ANY) &&
+        ( (frame->frame_control.destination_addressing_mode != MAC_ADDRESSING_MODE_SHORT_ADDRESS) ||
+          (frame->destination_addr.short_addr != captureFilter.dst_addr) ) )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init capture, full frames on current channel, no filter, JSON encoding
+******************************************************************************/
+void Capture_Init( void )
+{
+    memset( &captureHop, 0, sizeof(captureHop) );
+    memset( &captureStats, 0, sizeof(captureStats) );
+    captureFilter.pan_id = CAPTURE_FILTER_ANY;
+    captureFilter.src_addr = CAPTURE_FILTER_ANY;
+    captureFilter.dst_addr = CAPTURE_FILTER_ANY;
+    captureFilter.type_mask = CAPTURE_FILTER_TYPE_ALL;
+    captureSnaplen = CAPTURE_SNAPLEN_FULL;
+    captureEncoding = CAPTURE_ENCODING_JSON;
+}
+
+/**************************************************************************//**
+\brief Select a fixed capture channel, stops hopping
+******************************************************************************/
+Capture_Result_t Capture_SetChannel( uint8_t channel )
+{
+    if( channel < PHY_CHANNEL_11 || channel > PHY_CHANNEL_26 )
+    {
+        return CAPTURE_INVALID_PARAMETER;
+    }
+    Visit_Stop();
+    Tsch_Stop();
+    captureHop.count = 0;
+    Scheduler_Cancel( SCHEDULER_TASK_CAPTURE );
+    HAL_SetRadioChannel( channel );
+    return CAPTURE_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Return current capture channel
+******************************************************************************/
+uint8_t Capture_GetChannel( void )
+{
+    return HAL_GetRadioChannel();
+}
+
+/**************************************************************************//**
+\brief Set a hop plan
+******************************************************************************/
+Capture_Result_t Capture_SetHopPlan( uint8_t const * channels, uint8_t count, uint16_t dwell_ms )
+{
+    if( count > CAPTURE_HOP_MAX_CHANNELS || (count && channels == NULL) )
+    {
+        return CAPTURE_INVALID_PARAMETER;
+    }
+
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        if( channels[i] < PHY_CHANNEL_11 || channels[i] > PHY_CHANNEL_26 )
+        {
+            return CAPTURE_INVALID_PARAMETER;
+        }
+    }
+
+    Visit_Stop();
+    Tsch_Stop();
+    if( count == 0 || dwell_ms == 0 )
+    {
+        captureHop.count = 0;
+        Scheduler_Cancel( SCHEDULER_TASK_CAPTURE );
+        return CAPTURE_SUCCESS;
+    }
+
+    memcpy( captureHop.channels, channels, count );
+    captureHop.count = count;
+    captureHop.index = 0;
+    HAL_SetRadioChannel( captureHop.channels[0] );
+    Scheduler_PostPeriodic( SCHEDULER_TASK_CAPTURE, (uint32_t)dwell_ms * CAPTURE_US_PER_MS );
+    return CAPTURE_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set capture filter
+******************************************************************************/
+void Capture_SetFilter( Capture_Filter_t const * filter )
+{
+    if( filter != NULL )
+    {
+        captureFilter = *filter;
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive capture filter
+******************************************************************************/
+void Capture_GetFilter( Capture_Filter_t * filter )
+{
+    if( filter != NULL )
+    {
+        *filter = captureFilter;
+    }
+}
+
+/**************************************************************************//**
+\brief Set maximum number of bytes of each frame sent to host
+******************************************************************************/
+void Capture_SetSnaplen( uint8_t snaplen )
+{
+    captureSnaplen = snaplen;
+}
+
+/**************************************************************************//**
+\brief Set capture encoding
+******************************************************************************/
+Capture_Result_t Capture_SetEncoding( Capture_Encoding_t encoding )
+{
+    if( encoding >= CAPTURE_ENCODING_COUNT )
+    {
+        return CAPTURE_INVALID_PARAMETER;
+    }
+    captureEncoding = encoding;
+    return CAPTURE_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Return encoding in use
+Binary encoding falls back to JSON with timestamp without mux framing
+******************************************************************************/
+Capture_Encoding_t Capture_GetEncoding( void )
+{
+    if( captureEncoding == CAPTURE_ENCODING_BINARY && !Mux_IsEnabled() )
+    {
+        return CAPTURE_ENCODING_JSON_TIMESTAMP;
+    }
+    return captureEncoding;
+}
+
+/**************************************************************************//**
+\brief Retreive capture statistics
+******************************************************************************/
+void Capture_GetStats( Capture_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = captureStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Clear capture statistics
+******************************************************************************/
+void Capture_ClearStats( void )
+{
+    memset( &captureStats, 0, sizeof(captureStats) );
+}
+
+/**************************************************************************//**
+\brief Encode a frame to host with current encoding and snaplen
+Binary records can't be told apart from JSON on a raw console,
+JSON with timestamp is used instead until host enables mux framing
+******************************************************************************/
+Mux_Write_Result_t Capture_SendFrame( PhyRx_t * phy_rx, bool timestamp )
+{
+    switch( captureEncoding )
+    {
+    case CAPTURE_ENCODING_BINARY:
+        if( Mux_IsEnabled() )
+        {
+            return Console_PhyToBinary( phy_rx, captureSnaplen );
+        }
+        return Console_PhyToJSON( phy_rx, captureSnaplen, true );
+    case CAPTURE_ENCODING_JSON_TIMESTAMP:
+        return Console_PhyToJSON( phy_rx, captureSnaplen, true );
+    case CAPTURE_ENCODING_JSON:
+    default:
+        return Console_PhyToJSON( phy_rx, captureSnaplen, timestamp );
+    }
+}
+
+/**************************************************************************//**
+\brief Filter and encode a received frame to host
+Accepted frames are also appended to flash log while it records,
+they go to burst capture instead of host while a burst is active.
+MAC header is unpacked once here for every consumer, they get NULL when
+the MAC layer can't unpack it
+******************************************************************************/
+void Capture_ProcessFrame( PhyRx_t * phy_rx )
+{
+    MAC_Frame_Unpacked_t const * frame = NULL;
+
+    if( phy_rx == NULL )
+    {
+        return;
+    }
+
+    captureStats.received++;
+
+    captureFramePacked.lenght = phy_rx->len;
+    memcpy( captureFramePacked.payload, phy_rx->payload, ( phy_rx->len < PHY_PAYLOAD_MAX ) ? phy_rx->len : PHY_PAYLOAD_MAX );
+    if( MAC_Unpack( &captureFramePacked, &captureFrameUnpacked ) == MAC_UNPACK_SUCCESS )
+    {
+        frame = &captureFrameUnpacked;
+    }
+
+    //only beacons matter while sweeping, they are reported as a table
+    if( Discover_Record( phy_rx, frame ) )
+    {
+        return;
+    }
+
+    //acknowledgments carry no address, timing is measured before filtering
+    Turnaround_Record( phy_rx, frame );
+    Visit_Record( phy_rx, frame );
+    Tsch_Record( phy_rx, frame );
+
+    if( !capture_filter_match( phy_rx, frame ) )
+    {
+        captureStats.filtered++;
+        return;
+    }
+
+    //host link is used by flash log dump
+    if( FlashLog_Record( phy_rx ) )
+    {
+        return;
+    }
+
+    if( Burst_Record( phy_rx, frame ) )
+    {
+        return;
+    }
+
+    if( Summary_Record( phy_rx, frame ) )
+    {
+        return;
+    }
+
+    //folded acknowledgments are cheap enough to be all kept
+    if( Ack_Fold( phy_rx ) )
+    {
+        return;
+    }
+
+    if( !Sample_Keep( phy_rx, frame ) )
+    {
+        captureStats.sampled++;
+        return;
+    }
+
+    if( Dedup_Hold( phy_rx ) )
+    {
+        return;
+    }
+
+    Capture_SendLiveFrame( phy_rx );
+}
+
+/**************************************************************************//**
+\brief Encode an accepted frame to host and account it
+******************************************************************************/
+void Capture_SendLiveFrame( PhyRx_t * phy_rx )
+{
+    Mux_Write_Result_t result;
+
+    result = Capture_SendFrame( phy_rx, false );
+    if( result == MUX_WRITE_SUCCESS )
+    {
+        captureStats.sent++;
+    }
+    else
+    {
+        captureStats.dropped++;
+    }
+}
+
+/**************************************************************************//**
+\brief Capture task
+Posted every dwell time while a hop plan is active, move to next channel
+******************************************************************************/
+void Capture_Task( void )
+{
+    if( captureHop.count == 0 )
+    {
+        return;
+    }
+
+    captureHop.index++;
+    if( captureHop.index >= captureHop.count )
+    {
+        captureHop.index = 0;
+    }
+    HAL_SetRadioChannel( captureHop.channels[captureHop.index] );
+    captureStats.hops++;
+}
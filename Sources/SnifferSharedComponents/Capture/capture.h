@@ -0,0 +1,169 @@
+/****************************************************************************//**
+  \file capture.h
+
+  \brief Capture configuration: channel hopping, filters, snaplen and encoding
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "console_mux.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Maximum number of channels in a hop plan
+#define CAPTURE_HOP_MAX_CHANNELS        16
+
+//Filter disabled value for PAN ID and short address filters
+#define CAPTURE_FILTER_ANY              0xFFFFFFFF
+
+//Frame type mask, bit n set to accept MAC frame type n
+#define CAPTURE_FILTER_TYPE_ALL         0xFF
+
+//Snaplen value capturing the whole frame
+#define CAPTURE_SNAPLEN_FULL            0
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    CAPTURE_ENCODING_JSON,              //legacy JSON, {"L":..,"Q":..,"R":..,"C":..,"S":".."}
+    CAPTURE_ENCODING_JSON_TIMESTAMP,    //legacy JSON with "T" radio timestamp in us
+    CAPTURE_ENCODING_BINARY,            //binary record, requires mux framing
+    CAPTURE_ENCODING_COUNT
+}Capture_Encoding_t;
+
+typedef enum {
+    CAPTURE_SUCCESS,
+    CAPTURE_INVALID_PARAMETER,
+}Capture_Result_t;
+
+typedef struct {
+    uint32_t pan_id;                    //destination or source PAN ID, CAPTURE_FILTER_ANY to disable
+    uint32_t src_addr;                  //source short address, CAPTURE_FILTER_ANY to disable
+    uint32_t dst_addr;                  //destination short address, CAPTURE_FILTER_ANY to disable
+    uint8_t  type_mask;                 //accepted MAC frame types, bit n for frame type n
+}Capture_Filter_t;
+
+typedef struct {
+    uint32_t received;                  //frames received from phy
+    uint32_t filtered;                  //frames rejected by filters
+    uint32_t sampled;                   //frames not sent by flow sampling
+    uint32_t sent;                      //frames queued to host
+    uint32_t dropped;                   //frames lost because host link is busy
+    uint32_t hops;                      //channel changes done by hop plan
+}Capture_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init capture, full frames on current channel, no filter, JSON encoding
+******************************************************************************/
+void Capture_Init( void );
+
+/**************************************************************************//**
+\brief Select a fixed capture channel, stops hopping, channel visits and TSCH follow
+******************************************************************************/
+Capture_Result_t Capture_SetChannel( uint8_t channel );
+
+/**************************************************************************//**
+\brief Return current capture channel
+******************************************************************************/
+uint8_t Capture_GetChannel( void );
+
+/**************************************************************************//**
+\brief Set a hop plan
+Radio cycles through channels, staying dwell_ms on each one
+A plan of 0 channel or a dwell of 0 stops hopping, channel visits and TSCH follow are stopped
+******************************************************************************/
+Capture_Result_t Capture_SetHopPlan( uint8_t const * channels, uint8_t count, uint16_t dwell_ms );
+
+/**************************************************************************//**
+\brief Set capture filter, frames must match every enabled field
+******************************************************************************/
+void Capture_SetFilter( Capture_Filter_t const * filter );
+
+/**************************************************************************//**
+\brief Retreive capture filter
+******************************************************************************/
+void Capture_GetFilter( Capture_Filter_t * filter );
+
+/**************************************************************************//**
+\brief Set maximum number of bytes of each frame sent to host
+CAPTURE_SNAPLEN_FULL sends whole frames, length field keeps original length
+******************************************************************************/
+void Capture_SetSnaplen( uint8_t snaplen );
+
+/**************************************************************************//**
+\brief Set capture encoding
+******************************************************************************/
+Capture_Result_t Capture_SetEncoding( Capture_Encoding_t encoding );
+
+/**************************************************************************//**
+\brief Return encoding in use, binary requires mux framing
+******************************************************************************/
+Capture_Encoding_t Capture_GetEncoding( void );
+
+/**************************************************************************//**
+\brief Retreive capture statistics
+******************************************************************************/
+void Capture_GetStats( Capture_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Clear capture statistics
+******************************************************************************/
+void Capture_ClearStats( void );
+
+/**************************************************************************//**
+\brief Encode a frame to host with current encoding and snaplen
+timestamp forces "T" when encoding is plain JSON
+******************************************************************************/
+Mux_Write_Result_t Capture_SendFrame( PhyRx_t * phy_rx, bool timestamp );
+
+/**************************************************************************//**
+\brief Filter and encode a received frame to host
+******************************************************************************/
+void Capture_ProcessFrame( PhyRx_t * phy_rx );
+
+/**************************************************************************//**
+\brief Encode an accepted frame to host and account it in capture statistics
+******************************************************************************/
+void Capture_SendLiveFrame( PhyRx_t * phy_rx );
+
+/**************************************************************************//**
+\brief Capture task
+Posted every dwell time while a hop plan is active, move to next channel
+******************************************************************************/
+void Capture_Task( void );
+
+#endif // _CAPTURE_H
@@ -0,0 +1,251 @@
+/***************************************************************************//**
+ @file capture_ack.c
+  @brief   Coalescing of acknowledgments into compact records
+           Immediate acknowledgments are 5 bytes frames fully defined by their sequence
+           number and frame pending bit, they are sent as 4 bytes tuples instead
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_ack.h"
+#include "capture.h"
+#include "console_mux.h"
+#include "mac_unpack.h"
+#include "crc.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define ACK_US_PER_MS                   1000
+
+//Immediate acknowledgment: frame control | sequence number | FCS
+#define ACK_FRAME_SIZE                  (MHR_FRAME_CONTROL_SIZE + 1 + MAC_FCS_SIZE)
+
+//Frame control bits of an immediate acknowledgment, frame pending excluded
+#define ACK_FRAME_CONTROL_MSK           (0xFFFF & ~MHR_FRAMECONTROL_FRAME_PENDING_MSK)
+#define ACK_FRAME_CONTROL               MHR_FRAMECONTROL_FRAME_TYPE_ACK
+
+//Binary record header: marker | channel | count | timestamp (4, LSB first)
+#define ACK_BINARY_HEADER_SIZE          7
+
+//JSON record: {"K":"<tuples>","C":11,"T":4294967295}
+#define ACK_RECORD_SIZE                 (ACK_RECORD_MAX_ACKS * ACK_TUPLE_SIZE * 2 + 48)
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void ack_send_record( void );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static uint8_t ackTuples[ACK_RECORD_MAX_ACKS * ACK_TUPLE_SIZE];
+static uint8_t ackCount;                //acknowledgments in current record
+static uint8_t ackChannel;              //channel of current record
+static uint32_t ackTimestamp;           //timestamp of first acknowledgment of current record
+static uint32_t ackIntervalUs = ACK_DISABLED;
+static Ack_Stats_t ackStats;
+
+static char const HexDigits[] = "0123456789abcdef";
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Send current record with capture encoding and start a new one
+Binary: marker | channel | count | timestamp (4, LSB first) | tuples
+JSON: {"K":"<tuples in hexadecimal>","C":11,"T":12345678}
+******************************************************************************/
+static void ack_send_record( void )
+{
+    uint8_t record[ACK_RECORD_SIZE];
+    uint16_t length = 0;
+    uint16_t size = ackCount * ACK_TUPLE_SIZE;
+
+    if( ackCount == 0 )
+    {
+        return;
+    }
+
+    if( Capture_GetEncoding() == CAPTURE_ENCODING_BINARY )
+    {
+        record[length++] = ACK_BINARY_RECORD_MARKER;
+        record[length++] = ackChannel;
+        record[length++] = ackCount;
+        record[length++] = (uint8_t)(ackTimestamp);
+        record[length++] = (uint8_t)(ackTimestamp >> 8);
+        record[length++] = (uint8_t)(ackTimestamp >> 16);
+        record[length++] = (uint8_t)(ackTimestamp >> 24);
+        memcpy( &record[length], ackTuples, size );
+        length += size;
+    }
+    else
+    {
+        memcpy( record, "{\"K\":\"", 6 );
+        length = 6;
+        for( uint16_t i = 0; i < size; i++ )
+        {
+            record[length++] = HexDigits[ackTuples[i] >> 4];
+            record[length++] = HexDigits[ackTuples[i] & 0x0F];
+        }
+        length += snprintf( (char *)&record[length], ACK_RECORD_SIZE - length, "\",\"C\":%u,\"T\":%u}\n\r",
+                            ackChannel, (unsigned int)ackTimestamp );
+    }
+
+    if( Mux_Write( MUX_CHANNEL_CAPTURE, record, length ) == MUX_WRITE_SUCCESS )
+    {
+        ackStats.records++;
+    }
+    else
+    {
+        ackStats.dropped++;
+    }
+    ackCount = 0;
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init acknowledgment coalescing, disabled
+******************************************************************************/
+void Ack_Init( void )
+{
+    ackCount = 0;
+    ackIntervalUs = ACK_DISABLED;
+    memset( &ackStats, 0, sizeof(ackStats) );
+}
+
+/**************************************************************************//**
+\brief Set record interval, current record is sent when disabled
+******************************************************************************/
+void Ack_SetInterval( uint32_t interval_ms )
+{
+    //a record can't span more than the tuple time range
+    if( interval_ms * ACK_US_PER_MS > (uint32_t)ACK_TIME_MAX * ACK_TIME_UNIT_US )
+    {
+        interval_ms = ((uint32_t)ACK_TIME_MAX * ACK_TIME_UNIT_US) / ACK_US_PER_MS;
+    }
+    ackStats.interval = interval_ms;
+    ackIntervalUs = interval_ms * ACK_US_PER_MS;
+
+    if( ackIntervalUs == ACK_DISABLED )
+    {
+        Scheduler_Cancel( SCHEDULER_TASK_ACK );
+        ack_send_record();
+    }
+}
+
+/**************************************************************************//**
+\brief Offer a live frame to acknowledgment coalescing
+Only frames host can rebuild byte for byte are folded: immediate
+acknowledgments with frame control 0x0002 (0x0012 with frame pending) and a
+valid FCS. Other frame versions and enhanced acknowledgments are sent as is.
+******************************************************************************/
+bool Ack_Fold( PhyRx_t const * phy_rx )
+{
+    uint16_t frame_control;
+    uint16_t fcs;
+    uint32_t delay;
+    uint8_t * tuple;
+
+    if( ackIntervalUs == ACK_DISABLED || phy_rx->len != ACK_FRAME_SIZE )
+    {
+        return false;
+    }
+
+    frame_control = (uint16_t)phy_rx->payload[0] | ((uint16_t)phy_rx->payload[1] << 8);
+    if( (frame_control & ACK_FRAME_CONTROL_MSK) != ACK_FRAME_CONTROL )
+    {
+        return false;
+    }
+
+    fcs = (uint16_t)phy_rx->payload[3] | ((uint16_t)phy_rx->payload[4] << 8);
+    if( fcs != crcFast( phy_rx->payload, ACK_FRAME_SIZE - MAC_FCS_SIZE ) )
+    {
+        return false;
+    }
+
+    //record is sent early when its channel or time range is exceeded
+    if( ackCount && ( (phy_rx->channel != ackChannel) ||
+                      ((phy_rx->timestamp - ackTimestamp) / ACK_TIME_UNIT_US > ACK_TIME_MAX) ) )
+    {
+        Scheduler_Cancel( SCHEDULER_TASK_ACK );
+        ack_send_record();
+    }
+
+    if( ackCount == 0 )
+    {
+        ackChannel = phy_rx->channel;
+        ackTimestamp = phy_rx->timestamp;
+        Scheduler_PostDelayed( SCHEDULER_TASK_ACK, ackIntervalUs );
+    }
+
+    delay = (phy_rx->timestamp - ackTimestamp) / ACK_TIME_UNIT_US;
+    if( frame_control & MHR_FRAMECONTROL_FRAME_PENDING_MSK )
+    {
+        delay |= ACK_TIME_PENDING;
+    }
+
+    tuple = &ackTuples[ackCount * ACK_TUPLE_SIZE];
+    tuple[0] = phy_rx->payload[2];
+    tuple[1] = (uint8_t)phy_rx->rssi;
+    tuple[2] = (uint8_t)delay;
+    tuple[3] = (uint8_t)(delay >> 8);
+    ackCount++;
+    ackStats.folded++;
+
+    if( ackCount == ACK_RECORD_MAX_ACKS )
+    {
+        Scheduler_Cancel( SCHEDULER_TASK_ACK );
+        ack_send_record();
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive coalescing state and counters
+******************************************************************************/
+void Ack_GetStats( Ack_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = ackStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Ack task
+Only posted by record interval
+******************************************************************************/
+void Ack_Task( void )
+{
+    ack_send_record();
+}
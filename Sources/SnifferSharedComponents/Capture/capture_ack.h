@@ -0,0 +1,99 @@
+/****************************************************************************//**
+  \file capture_ack.h
+
+  \brief Coalescing of acknowledgments into compact records
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_ACK_H
+#define _CAPTURE_ACK_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Acknowledgments folded in a record
+#define ACK_RECORD_MAX_ACKS         16
+
+//A folded acknowledgment is: sequence number | RSSI | time (2, LSB first)
+//time is bit 15 frame pending, bits 0-14 delay since record timestamp in ACK_TIME_UNIT_US
+#define ACK_TUPLE_SIZE              4
+#define ACK_TIME_UNIT_US            4
+#define ACK_TIME_MAX                0x7FFF
+#define ACK_TIME_PENDING            0x8000
+
+//First byte of a binary acknowledgment record, a frame record never has a length of 0
+#define ACK_BINARY_RECORD_MARKER    0x00
+
+//Interval value disabling coalescing
+#define ACK_DISABLED                0
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t interval;                  //longest record interval in ms, ACK_DISABLED when not folded
+    uint32_t folded;                    //acknowledgments folded in records
+    uint32_t records;                   //records sent to host
+    uint32_t dropped;                   //records lost because host link is busy
+}Ack_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init acknowledgment coalescing, disabled
+******************************************************************************/
+void Ack_Init( void );
+
+/**************************************************************************//**
+\brief Fold acknowledgments in records spanning up to interval_ms,
+ACK_DISABLED sends them as other frames
+******************************************************************************/
+void Ack_SetInterval( uint32_t interval_ms );
+
+/**************************************************************************//**
+\brief Offer a live frame to acknowledgment coalescing
+returns true if frame is an immediate acknowledgment folded in current record
+******************************************************************************/
+bool Ack_Fold( PhyRx_t const * phy_rx );
+
+/**************************************************************************//**
+\brief Retreive coalescing state and counters
+******************************************************************************/
+void Ack_GetStats( Ack_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Ack task
+Sends current record once its interval ended
+******************************************************************************/
+void Ack_Task( void );
+
+#endif // _CAPTURE_ACK_H
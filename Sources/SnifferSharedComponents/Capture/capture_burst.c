@@ -0,0 +1,428 @@
+/***************************************************************************//**
+ @file capture_burst.c
+  @brief   Store and forward burst capture
+           Frames are kept in their pool buffers at air rate then drained
+           to host no faster than the serial link allows
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_burst.h"
+#include "capture.h"
+#include "capture_trigger.h"
+#include "console_mux.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "Hal.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define BURST_QUEUE_MASK                (BURST_QUEUE_SIZE - 1)
+#define BURST_US_PER_MS                 1000
+
+//Largest encoded record, JSON with timestamp of a 127 bytes frame
+#define BURST_ENCODED_RECORD_MAX        320
+
+//Frames sent per task run, keeps other tasks responsive while draining
+#define BURST_DRAIN_FRAMES_PER_RUN      8
+
+//Retry delay when capture channel queue is full
+#define BURST_DRAIN_POLL_US             2000
+
+//A progress report is sent every BURST_PROGRESS_FRAMES drained frames
+#define BURST_PROGRESS_FRAMES           16
+#define BURST_PROGRESS_SIZE             96
+
+#if (BURST_QUEUE_SIZE & BURST_QUEUE_MASK) != 0
+#error "BURST_QUEUE_SIZE must be a power of 2"
+#endif
+
+#if BURST_QUEUE_SIZE < (POOL_BUFFER_COUNT - POOL_RX_RESERVE)
+#error "BURST_QUEUE_SIZE must reference every buffer burst can hold"
+#endif
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static bool burst_store( PhyRx_t * phy_rx );
+static void burst_evict_oldest( void );
+static void burst_release_all( void );
+static void burst_arm( void );
+static void burst_fire( void );
+static void burst_stop( Burst_Stop_Reason_t reason );
+static void burst_report_progress( void );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static PhyRx_t * burstQueue[BURST_QUEUE_SIZE];
+static uint8_t burstHead;               //oldest held frame
+static uint8_t burstCount;              //frames held
+static uint32_t burstMaxFrames;
+static uint32_t burstFirstTimestamp;
+static uint32_t burstLastTimestamp;
+
+//Armed window settings, see Burst_Arm
+static uint32_t burstPreTriggerUs;
+static uint32_t burstPostFrames;
+static uint32_t burstPostMs;
+static bool burstRearm;
+
+static Burst_Stats_t burstStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Hold a frame at queue tail
+returns false when queue is full or pool is down to its reception reserve
+******************************************************************************/
+static bool burst_store( PhyRx_t * phy_rx )
+{
+    if( burstCount == BURST_QUEUE_SIZE || !Pool_Hold( phy_rx ) )
+    {
+        return false;
+    }
+    burstQueue[(burstHead + burstCount) & BURST_QUEUE_MASK] = phy_rx;
+    burstCount++;
+
+    if( burstStats.recorded == 0 )
+    {
+        burstFirstTimestamp = phy_rx->timestamp;
+    }
+    burstLastTimestamp = phy_rx->timestamp;
+    burstStats.recorded++;
+    burstStats.bytes += phy_rx->len;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Release oldest frame of pre-trigger lead-up
+******************************************************************************/
+static void burst_evict_oldest( void )
+{
+    PhyRx_t * oldest = burstQueue[burstHead];
+
+    burstQueue[burstHead] = NULL;
+    burstHead = (burstHead + 1) & BURST_QUEUE_MASK;
+    burstCount--;
+    burstStats.recorded--;
+    burstStats.bytes -= oldest->len;
+    Pool_Release( oldest );
+    if( burstCount )
+    {
+        burstFirstTimestamp = burstQueue[burstHead]->timestamp;
+    }
+}
+
+/**************************************************************************//**
+\brief Release every held frame
+******************************************************************************/
+static void burst_release_all( void )
+{
+    while( burstCount )
+    {
+        Pool_Release( burstQueue[burstHead] );
+        burstQueue[burstHead] = NULL;
+        burstHead = (burstHead + 1) & BURST_QUEUE_MASK;
+        burstCount--;
+    }
+    burstHead = 0;
+}
+
+/**************************************************************************//**
+\brief Empty queue and wait for a trigger
+******************************************************************************/
+static void burst_arm( void )
+{
+    burst_release_all();
+    burstStats.state = BURST_STATE_ARMED;
+    burstStats.reason = BURST_STOP_NONE;
+    burstStats.recorded = 0;
+    burstStats.pre_trigger = 0;
+    burstStats.bytes = 0;
+    burstStats.drained = 0;
+    burstStats.duration = 0;
+}
+
+/**************************************************************************//**
+\brief Trigger fired, lead-up is kept and post-trigger budget starts
+******************************************************************************/
+static void burst_fire( void )
+{
+    burstStats.state = BURST_STATE_RECORDING;
+    burstStats.pre_trigger = burstStats.recorded;
+    burstStats.windows++;
+    burstMaxFrames = ( burstPostFrames == BURST_NO_LIMIT ) ? BURST_NO_LIMIT : burstStats.recorded + burstPostFrames;
+    if( burstPostMs != BURST_NO_LIMIT )
+    {
+        Scheduler_PostDelayed( SCHEDULER_TASK_BURST, burstPostMs * BURST_US_PER_MS );
+    }
+}
+
+/**************************************************************************//**
+\brief End recording window and start draining
+******************************************************************************/
+static void burst_stop( Burst_Stop_Reason_t reason )
+{
+    burstStats.state = BURST_STATE_DRAINING;
+    burstStats.reason = reason;
+    burstStats.duration = burstStats.recorded ? burstLastTimestamp - burstFirstTimestamp : 0;
+    Scheduler_Cancel( SCHEDULER_TASK_BURST );
+    Scheduler_Post( SCHEDULER_TASK_BURST );
+}
+
+/**************************************************************************//**
+\brief Send drain progress on stats channel
+{"burst":"drain","done":64,"total":1500}
+******************************************************************************/
+static void burst_report_progress( void )
+{
+    char report[BURST_PROGRESS_SIZE];
+    int length;
+
+    length = snprintf( report, BURST_PROGRESS_SIZE, "{\"burst\":\"%s\",\"done\":%u,\"total\":%u}\n\r",
+                       (burstStats.state == BURST_STATE_DRAINING) ? "drain" : "done",
+                       (unsigned int)burstStats.drained, (unsigned int)burstStats.recorded );
+    if( length > 0 && length < BURST_PROGRESS_SIZE )
+    {
+        Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)report, length );
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init burst capture, idle and empty
+******************************************************************************/
+void Burst_Init( void )
+{
+    burst_release_all();
+    memset( &burstStats, 0, sizeof(burstStats) );
+}
+
+/**************************************************************************//**
+\brief Start recording a burst
+******************************************************************************/
+Burst_Result_t Burst_Start( uint32_t max_frames, uint32_t duration_ms )
+{
+    if( burstStats.state != BURST_STATE_IDLE )
+    {
+        return BURST_BUSY;
+    }
+
+    Burst_Init();
+    burstRearm = false;
+    burstMaxFrames = max_frames;
+    burstStats.state = BURST_STATE_RECORDING;
+    if( duration_ms != BURST_NO_LIMIT )
+    {
+        Scheduler_PostDelayed( SCHEDULER_TASK_BURST, duration_ms * BURST_US_PER_MS );
+    }
+    return BURST_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Arm an event triggered window
+******************************************************************************/
+Burst_Result_t Burst_Arm( uint32_t pre_ms, uint32_t post_frames, uint32_t post_ms, bool rearm )
+{
+    if( burstStats.state != BURST_STATE_IDLE )
+    {
+        return BURST_BUSY;
+    }
+
+    Burst_Init();
+    burstPreTriggerUs = pre_ms * BURST_US_PER_MS;
+    burstPostFrames = post_frames;
+    burstPostMs = post_ms;
+    burstRearm = rearm;
+    burst_arm();
+    return BURST_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Stop recording and start draining stored frames to host
+When armed, trigger now and start recording post-trigger frames
+******************************************************************************/
+Burst_Result_t Burst_Trigger( void )
+{
+    if( burstStats.state == BURST_STATE_ARMED )
+    {
+        burst_fire();
+        return BURST_SUCCESS;
+    }
+
+    if( burstStats.state != BURST_STATE_RECORDING )
+    {
+        return BURST_INVALID_STATE;
+    }
+    burst_stop( BURST_STOP_TRIGGER );
+    return BURST_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Abort recording or draining, stored frames are discarded
+******************************************************************************/
+void Burst_Abort( void )
+{
+    Scheduler_Cancel( SCHEDULER_TASK_BURST );
+    burst_release_all();
+    burstRearm = false;
+    burstStats.state = BURST_STATE_IDLE;
+}
+
+/**************************************************************************//**
+\brief Offer a captured frame to burst
+While armed, every frame is stored and checked against trigger expressions
+******************************************************************************/
+bool Burst_Record( PhyRx_t * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    if( burstStats.state == BURST_STATE_IDLE )
+    {
+        return false;
+    }
+
+    if( burstStats.state == BURST_STATE_ARMED )
+    {
+        //release lead-up beyond pre-trigger count or time
+        while( burstCount &&
+               ( (burstCount >= BURST_PRE_TRIGGER_FRAMES) ||
+                 (burstPreTriggerUs != BURST_NO_LIMIT && (phy_rx->timestamp - burstFirstTimestamp) > burstPreTriggerUs) ) )
+        {
+            burst_evict_oldest();
+        }
+        //pool down to its reception reserve, give up older lead-up first
+        while( !burst_store( phy_rx ) && burstCount )
+        {
+            burst_evict_oldest();
+        }
+
+        if( Trigger_Match( phy_rx, frame ) )
+        {
+            burst_fire();
+        }
+        return true;
+    }
+
+    if( burstStats.state != BURST_STATE_RECORDING )
+    {
+        burstStats.missed++;
+        return true;
+    }
+
+    //window ends at first frame not held, no loss inside window
+    if( !burst_store( phy_rx ) )
+    {
+        burstStats.missed++;
+        burst_stop( BURST_STOP_FULL );
+        return true;
+    }
+
+    if( burstMaxFrames != BURST_NO_LIMIT && burstStats.recorded >= burstMaxFrames )
+    {
+        burst_stop( BURST_STOP_FRAMES );
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive burst state and counters
+******************************************************************************/
+void Burst_GetStats( Burst_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = burstStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Burst task
+Held frames are encoded as live frames then released, timestamp is always
+sent since frames are no longer received in real time
+******************************************************************************/
+void Burst_Task( void )
+{
+    PhyRx_t * phy_rx;
+
+    if( burstStats.state == BURST_STATE_RECORDING )
+    {
+        //only posted by duration limit while recording
+        burst_stop( BURST_STOP_TIME );
+        return;
+    }
+
+    if( burstStats.state != BURST_STATE_DRAINING )
+    {
+        return;
+    }
+
+    for( uint8_t n = 0; n < BURST_DRAIN_FRAMES_PER_RUN && burstCount; n++ )
+    {
+        //wait for host link rather than lose a held frame
+        if( Mux_GetFreeSpace( MUX_CHANNEL_CAPTURE ) < BURST_ENCODED_RECORD_MAX )
+        {
+            Scheduler_PostDelayed( SCHEDULER_TASK_BURST, BURST_DRAIN_POLL_US );
+            return;
+        }
+
+        phy_rx = burstQueue[burstHead];
+        burstQueue[burstHead] = NULL;
+        burstHead = (burstHead + 1) & BURST_QUEUE_MASK;
+        burstCount--;
+
+        phy_rx->repeats = 0;
+        phy_rx->weight = 1;
+        Capture_SendFrame( phy_rx, true );
+        Pool_Release( phy_rx );
+        burstStats.drained++;
+
+        if( (burstStats.drained % BURST_PROGRESS_FRAMES) == 0 )
+        {
+            burst_report_progress();
+        }
+    }
+
+    if( burstCount )
+    {
+        Scheduler_Post( SCHEDULER_TASK_BURST );
+        return;
+    }
+
+    //window drained, back to live capture or wait for next trigger
+    burstStats.state = BURST_STATE_IDLE;
+    burst_report_progress();
+    if( burstRearm )
+    {
+        burst_arm();
+    }
+}
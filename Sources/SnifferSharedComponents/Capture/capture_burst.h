@@ -0,0 +1,152 @@
+/****************************************************************************//**
+  \file capture_burst.h
+
+  \brief Store and forward burst capture
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_BURST_H
+#define _CAPTURE_BURST_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+#include "pool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Recorded frames are kept in their pool buffers, referenced from a queue
+//of this many entries, must be a power of 2 and hold every buffer the pool
+//lets a stage keep. Window ends when pool is down to its reception reserve
+#define BURST_QUEUE_SIZE            64
+
+//Limit value disabling frame count or duration limit
+#define BURST_NO_LIMIT              0
+
+//Longest duration or lead-up in ms, timers count in us
+#define BURST_MS_MAX                (UINT32_MAX / 1000)
+
+//While armed, oldest frames are released to keep lead-up under this count,
+//the other buffers a stage can keep are left for the post-trigger part
+#define BURST_PRE_TRIGGER_FRAMES    ((POOL_BUFFER_COUNT - POOL_RX_RESERVE) / 2)
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    BURST_STATE_IDLE,                   //live capture
+    BURST_STATE_RECORDING,              //frames kept in pool buffers at air rate
+    BURST_STATE_DRAINING,               //stored frames sent to host
+    BURST_STATE_ARMED,                  //lead-up kept in pool buffers until a trigger matches
+}Burst_State_t;
+
+typedef enum {
+    BURST_STOP_NONE,
+    BURST_STOP_FULL,                    //next frame could not be held, queue or pool full
+    BURST_STOP_FRAMES,                  //frame count limit reached
+    BURST_STOP_TIME,                    //duration limit reached
+    BURST_STOP_TRIGGER,                 //Burst_Trigger called (host or trigger)
+}Burst_Stop_Reason_t;
+
+typedef enum {
+    BURST_SUCCESS,
+    BURST_BUSY,                         //a burst is recording or draining
+    BURST_INVALID_STATE,
+}Burst_Result_t;
+
+typedef struct {
+    Burst_State_t state;
+    Burst_Stop_Reason_t reason;         //why last recording stopped
+    uint32_t recorded;                  //frames stored in window
+    uint32_t pre_trigger;               //frames of window stored before trigger
+    uint32_t windows;                   //triggered windows since armed
+    uint32_t bytes;                     //frame bytes held by window
+    uint32_t drained;                   //frames of window sent to host
+    uint32_t missed;                    //frames received outside window while not idle
+    uint32_t duration;                  //window length in us, radio time
+}Burst_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init burst capture, idle and empty
+******************************************************************************/
+void Burst_Init( void );
+
+/**************************************************************************//**
+\brief Start recording a burst, live capture is suspended until drained
+max_frames: stop after this many frames, BURST_NO_LIMIT for none
+duration_ms: stop after this time, BURST_NO_LIMIT for none, up to BURST_MS_MAX
+Recording always stops when no more frame can be held
+******************************************************************************/
+Burst_Result_t Burst_Start( uint32_t max_frames, uint32_t duration_ms );
+
+/**************************************************************************//**
+\brief Arm an event triggered window, live capture is suspended until disarmed
+Frames are stored continuously, keeping the last pre_ms of lead-up
+(BURST_NO_LIMIT for as much as BURST_PRE_TRIGGER_FRAMES allows).
+A frame matching a trigger expression, or Burst_Trigger, starts recording of
+post_frames more frames or post_ms more time, the whole window is then drained.
+pre_ms and post_ms are up to BURST_MS_MAX
+rearm: arm again once window is drained
+******************************************************************************/
+Burst_Result_t Burst_Arm( uint32_t pre_ms, uint32_t post_frames, uint32_t post_ms, bool rearm );
+
+/**************************************************************************//**
+\brief Stop recording and start draining stored frames to host
+When armed, trigger now and start recording post-trigger frames
+******************************************************************************/
+Burst_Result_t Burst_Trigger( void );
+
+/**************************************************************************//**
+\brief Abort recording, draining or armed window, stored frames are discarded
+******************************************************************************/
+void Burst_Abort( void );
+
+/**************************************************************************//**
+\brief Offer a captured frame to burst
+returns true if frame is consumed (held or outside of window),
+returns false when idle and frame goes to live capture,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+bool Burst_Record( PhyRx_t * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive burst state and counters
+******************************************************************************/
+void Burst_GetStats( Burst_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Burst task
+Ends recording on duration limit, drains stored frames as host link allows
+******************************************************************************/
+void Burst_Task( void );
+
+#endif // _CAPTURE_BURST_H
@@ -0,0 +1,242 @@
+/***************************************************************************//**
+ @file capture_dedup.c
+  @brief   Retransmission deduplication of live capture
+           MAC retries are identical frames, they are counted on the first copy
+           which is held for a time window instead of being sent again
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_dedup.h"
+#include "capture.h"
+#include "mac_unpack.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "Hal.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define DEDUP_QUEUE_MASK                (DEDUP_QUEUE_SIZE - 1)
+#define DEDUP_US_PER_MS                 1000
+
+//Smallest frame with a sequence number: frame control, sequence number and FCS
+#define DEDUP_MIN_FRAME_SIZE            (MHR_FRAME_CONTROL_SIZE + 1 + MAC_FCS_SIZE)
+
+#if (DEDUP_QUEUE_SIZE & DEDUP_QUEUE_MASK) != 0
+#error "DEDUP_QUEUE_SIZE must be a power of 2"
+#endif
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+typedef struct {
+    PhyRx_t * frame;
+    uint16_t fcs;                       //key, only meaningful when retry is true
+    bool     retry;                     //frame requests an acknowledgment so can be retried
+}Dedup_Entry_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void dedup_send_oldest( void );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Dedup_Entry_t dedupQueue[DEDUP_QUEUE_SIZE];
+static uint8_t dedupHead;               //oldest held frame
+static uint8_t dedupCount;
+static uint32_t dedupWindowUs = DEDUP_DISABLED;
+static Dedup_Stats_t dedupStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Send and release oldest held frame
+******************************************************************************/
+static void dedup_send_oldest( void )
+{
+    PhyRx_t * frame = dedupQueue[dedupHead].frame;
+
+    dedupQueue[dedupHead].frame = NULL;
+    dedupHead = (dedupHead + 1) & DEDUP_QUEUE_MASK;
+    dedupCount--;
+
+    Capture_SendLiveFrame( frame );
+    Pool_Release( frame );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init deduplication, disabled
+******************************************************************************/
+void Dedup_Init( void )
+{
+    memset( dedupQueue, 0, sizeof(dedupQueue) );
+    memset( &dedupStats, 0, sizeof(dedupStats) );
+    dedupHead = 0;
+    dedupCount = 0;
+    dedupWindowUs = DEDUP_DISABLED;
+}
+
+/**************************************************************************//**
+\brief Set deduplication window
+******************************************************************************/
+void Dedup_SetWindow( uint32_t window_ms )
+{
+    dedupStats.window = window_ms;
+    dedupWindowUs = window_ms * DEDUP_US_PER_MS;
+
+    if( dedupWindowUs == DEDUP_DISABLED )
+    {
+        Scheduler_Cancel( SCHEDULER_TASK_DEDUP );
+        while( dedupCount )
+        {
+            dedup_send_oldest();
+        }
+    }
+    else if( dedupCount )
+    {
+        Scheduler_Post( SCHEDULER_TASK_DEDUP );
+    }
+}
+
+/**************************************************************************//**
+\brief Offer a live frame to deduplication
+Only frames requesting an acknowledgment are retried by the MAC layer, a
+repeat has the same FCS, length and content as a held frame, so same source
+and sequence number. Other frames are held too, to keep capture order.
+The queue is short, a linear scan of the FCS keys is faster than hashing.
+******************************************************************************/
+bool Dedup_Hold( PhyRx_t * phy_rx )
+{
+    Dedup_Entry_t * entry;
+    bool retry;
+    uint16_t fcs = 0;
+
+    if( dedupWindowUs == DEDUP_DISABLED )
+    {
+        return false;
+    }
+
+    retry = (phy_rx->len >= DEDUP_MIN_FRAME_SIZE) && (phy_rx->payload[0] & MHR_FRAMECONTROL_AR_MSK);
+    if( retry )
+    {
+        fcs = (uint16_t)phy_rx->payload[phy_rx->len - 2] | ((uint16_t)phy_rx->payload[phy_rx->len - 1] << 8);
+        for( uint8_t i = 0; i < dedupCount; i++ )
+        {
+            entry = &dedupQueue[(dedupHead + i) & DEDUP_QUEUE_MASK];
+            if( entry->retry && entry->fcs == fcs && entry->frame->len == phy_rx->len &&
+                memcmp( entry->frame->payload, phy_rx->payload, phy_rx->len ) == 0 )
+            {
+                if( entry->frame->repeats < UINT8_MAX )
+                {
+                    entry->frame->repeats++;
+                }
+                dedupStats.suppressed++;
+                return true;
+            }
+        }
+    }
+
+    if( dedupCount == DEDUP_QUEUE_SIZE )
+    {
+        dedup_send_oldest();
+        dedupStats.early++;
+    }
+
+    //pool down to its reception reserve, send older frames to keep order
+    while( !Pool_Hold( phy_rx ) )
+    {
+        if( dedupCount == 0 )
+        {
+            return false;
+        }
+        dedup_send_oldest();
+        dedupStats.early++;
+    }
+
+    entry = &dedupQueue[(dedupHead + dedupCount) & DEDUP_QUEUE_MASK];
+    entry->frame = phy_rx;
+    entry->fcs = fcs;
+    entry->retry = retry;
+    dedupCount++;
+
+    //later frames expire after this one, timer only set for the oldest
+    if( dedupCount == 1 )
+    {
+        Scheduler_PostDelayed( SCHEDULER_TASK_DEDUP, dedupWindowUs );
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive deduplication state and counters
+******************************************************************************/
+void Dedup_GetStats( Dedup_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = dedupStats;
+        stats->held = dedupCount;
+    }
+}
+
+/**************************************************************************//**
+\brief Clear deduplication counters
+******************************************************************************/
+void Dedup_ClearStats( void )
+{
+    dedupStats.suppressed = 0;
+    dedupStats.early = 0;
+}
+
+/**************************************************************************//**
+\brief Dedup task
+Window of a frame starts at its reception timestamp
+******************************************************************************/
+void Dedup_Task( void )
+{
+    uint32_t now = HAL_Radio_GetTime();
+    uint32_t elapsed;
+
+    while( dedupCount )
+    {
+        elapsed = now - dedupQueue[dedupHead].frame->timestamp;
+        if( elapsed < dedupWindowUs )
+        {
+            Scheduler_PostDelayed( SCHEDULER_TASK_DEDUP, dedupWindowUs - elapsed );
+            return;
+        }
+        dedup_send_oldest();
+    }
+}
@@ -0,0 +1,97 @@
+/****************************************************************************//**
+  \file capture_dedup.h
+
+  \brief Retransmission deduplication of live capture
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_DEDUP_H
+#define _CAPTURE_DEDUP_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Frames held in window, must be a power of 2, each one keeps a pool buffer
+#define DEDUP_QUEUE_SIZE            16
+
+//Window value disabling deduplication
+#define DEDUP_DISABLED              0
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t window;                    //window in ms, DEDUP_DISABLED when frames are sent at once
+    uint32_t held;                      //frames currently held
+    uint32_t suppressed;                //repeats counted on their first copy instead of sent
+    uint32_t early;                     //frames sent before window end, queue or pool full
+}Dedup_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init deduplication, disabled
+******************************************************************************/
+void Dedup_Init( void );
+
+/**************************************************************************//**
+\brief Set deduplication window in ms, DEDUP_DISABLED sends held frames at once
+******************************************************************************/
+void Dedup_SetWindow( uint32_t window_ms );
+
+/**************************************************************************//**
+\brief Offer a live frame to deduplication
+returns true if frame is held (pool buffer retained) or counted as a repeat,
+returns false when disabled, or no pool buffer can be held, and frame is to
+be sent at once
+Held frames keep their order and are sent with Capture_SendLiveFrame once
+their window ended, repeats in phy_rx->repeats
+******************************************************************************/
+bool Dedup_Hold( PhyRx_t * phy_rx );
+
+/**************************************************************************//**
+\brief Retreive deduplication state and counters
+******************************************************************************/
+void Dedup_GetStats( Dedup_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Clear deduplication counters
+******************************************************************************/
+void Dedup_ClearStats( void );
+
+/**************************************************************************//**
+\brief Dedup task
+Sends held frames whose window ended
+******************************************************************************/
+void Dedup_Task( void );
+
+#endif // _CAPTURE_DEDUP_H
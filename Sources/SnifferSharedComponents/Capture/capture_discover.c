@@ -0,0 +1,406 @@
+/***************************************************************************//**
+ @file capture_discover.c
+  @brief   Active network discovery, beacon request sweep and PAN table
+           Each channel of the sweep gets a beacon request, beacons received in the
+           listening window are folded in a table reported once the sweep is done
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_discover.h"
+#include "capture.h"
+#include "console_mux.h"
+#include "mac.h"
+#include "mac_unpack.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define DISCOVER_US_PER_MS              1000
+
+//{"disc":"pan","ch":26,"pan":"0x1A62","a":"0x0123456789ABCDEF","lqi":255,"rssi":-100,"pj":1,"sp":15,"n":255}
+#define DISCOVER_RECORD_SIZE            128
+
+//Records sent per task run, and wait when stats channel is full
+#define DISCOVER_RECORDS_PER_RUN        8
+#define DISCOVER_REPORT_POLL_US         5000
+
+//Beacon payload: superframe specification (2) | GTS specification | pending address specification
+#define DISCOVER_BEACON_MIN_SIZE        4
+#define DISCOVER_SUPERFRAME_PERMIT_MSK  0x8000
+#define DISCOVER_GTS_COUNT_MSK          0x07
+#define DISCOVER_GTS_DESCRIPTOR_SIZE    3
+#define DISCOVER_PENDING_SHORT_MSK      0x07
+#define DISCOVER_PENDING_EXT_POS        4
+#define DISCOVER_PENDING_EXT_MSK        0x07
+
+//ZigBee beacon payload: protocol ID (0) | stack profile (bits 0-3) and protocol version | ...
+#define DISCOVER_ZIGBEE_PROTOCOL_ID     0x00
+#define DISCOVER_STACK_PROFILE_MSK      0x0F
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static uint8_t discover_stack_profile( uint8_t const * payload, uint8_t size );
+static Discover_Pan_t * discover_lookup( uint8_t channel, uint16_t pan_id, uint8_t mode, uint64_t address );
+static void discover_next_channel( void );
+static bool discover_send_header( void );
+static bool discover_send_entry( Discover_Pan_t const * entry );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Discover_Pan_t discoverTable[DISCOVER_TABLE_SIZE];
+static Discover_Stats_t discoverStats;
+static uint32_t discoverRemaining;      //channels of the sweep not visited yet
+static uint8_t discoverChannels;        //channels of the sweep
+static uint8_t discoverRestore;         //channel in use before the sweep
+static uint32_t discoverWindowUs;
+static uint32_t discoverStart;
+static bool discoverHeaderPending;
+static uint8_t discoverReportIndex;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return ZigBee stack profile of a beacon payload
+GTS and pending address fields are skipped to reach the beacon payload
+******************************************************************************/
+static uint8_t discover_stack_profile( uint8_t const * payload, uint8_t size )
+{
+    uint16_t index = 2;
+    uint8_t count;
+
+    count = payload[index++] & DISCOVER_GTS_COUNT_MSK;
+    if( count != 0 )
+    {
+        //GTS directions then descriptors
+        index += 1 + (count * DISCOVER_GTS_DESCRIPTOR_SIZE);
+    }
+    if( index >= size )
+    {
+        return DISCOVER_STACK_PROFILE_NONE;
+    }
+
+    count = payload[index++];
+    index += ((count & DISCOVER_PENDING_SHORT_MSK) * 2) +
+             (((count >> DISCOVER_PENDING_EXT_POS) & DISCOVER_PENDING_EXT_MSK) * MAC_EXTENDED_ADDR_SIZE);
+    if( (index + 2) > size || payload[index] != DISCOVER_ZIGBEE_PROTOCOL_ID )
+    {
+        return DISCOVER_STACK_PROFILE_NONE;
+    }
+    return payload[index + 1] & DISCOVER_STACK_PROFILE_MSK;
+}
+
+/**************************************************************************//**
+\brief Find or add a beacon sender, NULL when table is full
+The table is short and only filled during a sweep, a linear scan is enough
+******************************************************************************/
+static Discover_Pan_t * discover_lookup( uint8_t channel, uint16_t pan_id, uint8_t mode, uint64_t address )
+{
+    Discover_Pan_t * entry;
+
+    for( uint8_t i = 0; i < discoverStats.pans; i++ )
+    {
+        entry = &discoverTable[i];
+        if( entry->channel == channel && entry->pan_id == pan_id && entry->mode == mode && entry->address == address )
+        {
+            return entry;
+        }
+    }
+
+    if( discoverStats.pans >= DISCOVER_TABLE_SIZE )
+    {
+        return NULL;
+    }
+
+    entry = &discoverTable[discoverStats.pans++];
+    memset( entry, 0, sizeof(Discover_Pan_t) );
+    entry->channel = channel;
+    entry->pan_id = pan_id;
+    entry->mode = mode;
+    entry->address = address;
+    entry->rssi = INT8_MIN;
+    return entry;
+}
+
+/**************************************************************************//**
+\brief Send beacon request on next channel of the sweep, or end the sweep
+******************************************************************************/
+static void discover_next_channel( void )
+{
+    uint8_t channel;
+
+    if( discoverRemaining == 0 )
+    {
+        Capture_SetChannel( discoverRestore );
+        discoverStats.duration = HAL_Radio_GetTime() - discoverStart;
+        discoverStats.sweeps++;
+        discoverStats.state = DISCOVER_STATE_REPORT;
+        discoverHeaderPending = true;
+        discoverReportIndex = 0;
+        Scheduler_Post( SCHEDULER_TASK_DISCOVER );
+        return;
+    }
+
+    channel = PHY_CHANNEL_11;
+    while( (discoverRemaining & (1UL << channel)) == 0 )
+    {
+        channel++;
+    }
+    discoverRemaining &= ~(1UL << channel);
+
+    Capture_SetChannel( channel );
+    if( MAC_Tx_BeaconRequest() != 0 )
+    {
+        discoverStats.failed++;
+    }
+    Scheduler_PostDelayed( SCHEDULER_TASK_DISCOVER, discoverWindowUs );
+}
+
+/**************************************************************************//**
+\brief Send sweep header on stats channel
+{"disc":"done","ch":16,"pans":3,"us":645123,"full":0}
+******************************************************************************/
+static bool discover_send_header( void )
+{
+    char record[DISCOVER_RECORD_SIZE];
+    int length;
+
+    length = snprintf( record, DISCOVER_RECORD_SIZE, "{\"disc\":\"done\",\"ch\":%u,\"pans\":%u,\"us\":%lu,\"full\":%lu}\n\r",
+                       (unsigned int)discoverChannels, (unsigned int)discoverStats.pans,
+                       (unsigned long)discoverStats.duration, (unsigned long)discoverStats.full );
+    if( length <= 0 || length >= DISCOVER_RECORD_SIZE )
+    {
+        return false;
+    }
+    return ( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS );
+}
+
+/**************************************************************************//**
+\brief Send a PAN table entry on stats channel, "sp" only for ZigBee beacons
+{"disc":"pan","ch":11,"pan":"0x1A62","a":"0x0000","lqi":255,"rssi":-40,"pj":1,"sp":2,"n":3}
+******************************************************************************/
+static bool discover_send_entry( Discover_Pan_t const * entry )
+{
+    char record[DISCOVER_RECORD_SIZE];
+    char address[20];
+    char profile[12];
+    int length;
+
+    if( entry->mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        snprintf( address, sizeof(address), "0x%08X%08X", (unsigned int)(entry->address >> 32), (unsigned int)entry->address );
+    }
+    else
+    {
+        snprintf( address, sizeof(address), "0x%04X", (unsigned int)entry->address );
+    }
+
+    profile[0] = '\0';
+    if( entry->stack_profile != DISCOVER_STACK_PROFILE_NONE )
+    {
+        snprintf( profile, sizeof(profile), ",\"sp\":%u", (unsigned int)entry->stack_profile );
+    }
+
+    length = snprintf( record, DISCOVER_RECORD_SIZE,
+                       "{\"disc\":\"pan\",\"ch\":%u,\"pan\":\"0x%04X\",\"a\":\"%s\",\"lqi\":%u,\"rssi\":%d,\"pj\":%u%s,\"n\":%u}\n\r",
+                       (unsigned int)entry->channel, entry->pan_id, address, (unsigned int)entry->lqi, entry->rssi,
+                       (unsigned int)entry->permit_join, profile, (unsigned int)entry->beacons );
+    if( length <= 0 || length >= DISCOVER_RECORD_SIZE )
+    {
+        return false;
+    }
+    return ( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init discovery, idle and table empty
+******************************************************************************/
+void Discover_Init( void )
+{
+    memset( discoverTable, 0, sizeof(discoverTable) );
+    memset( &discoverStats, 0, sizeof(discoverStats) );
+    discoverRemaining = 0;
+}
+
+/**************************************************************************//**
+\brief Start a sweep of channels in channel_mask, listening window_ms on each
+Table of previous sweep is discarded
+******************************************************************************/
+bool Discover_Start( uint32_t channel_mask, uint16_t window_ms )
+{
+    uint32_t mask = channel_mask & DISCOVER_CHANNELS_ALL;
+
+    if( discoverStats.state != DISCOVER_STATE_IDLE || mask == 0 || window_ms == 0 )
+    {
+        return false;
+    }
+
+    discoverStats.pans = 0;
+    discoverStats.full = 0;
+    discoverRemaining = mask;
+    discoverChannels = 0;
+    while( mask )
+    {
+        mask &= mask - 1;
+        discoverChannels++;
+    }
+    discoverWindowUs = (uint32_t)window_ms * DISCOVER_US_PER_MS;
+    discoverStart = HAL_Radio_GetTime();
+    discoverStats.state = DISCOVER_STATE_SWEEP;
+
+    //channels are driven by the sweep, a channel visit returns to primary first
+    Capture_SetHopPlan( NULL, 0, 0 );
+    discoverRestore = Capture_GetChannel();
+    discover_next_channel();
+    return true;
+}
+
+/**************************************************************************//**
+\brief Offer a received frame to discovery
+Beacons are parsed, every other frame is dropped until the sweep ends
+******************************************************************************/
+bool Discover_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    Discover_Pan_t * entry;
+    uint64_t address = 0;
+    uint16_t pan_id;
+
+    if( discoverStats.state != DISCOVER_STATE_SWEEP )
+    {
+        return false;
+    }
+
+    //enhanced beacons carry IEs instead of a superframe specification
+    //an encrypted beacon payload can't be read
+    if( frame == NULL || frame->frame_control.frame_Type != MAC_FRAME_TYPE_BEACON ||
+        frame->ie_size != 0 || frame->payload_size < DISCOVER_BEACON_MIN_SIZE ||
+        (frame->auxiliary_security_header.security_level & MAC_SECURITY_LEVEL_ENCRYPTION) )
+    {
+        return true;
+    }
+
+    if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        address = frame->source_addr.short_addr;
+    }
+    else if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        address = frame->source_addr.long_addr;
+    }
+    //MAC_Unpack fills an elided source PAN ID
+    pan_id = frame->source_pan_id;
+
+    discoverStats.beacons++;
+    entry = discover_lookup( phy_rx->channel, pan_id, frame->frame_control.source_addressing_mode, address );
+    if( entry == NULL )
+    {
+        discoverStats.full++;
+        return true;
+    }
+
+    if( entry->beacons < UINT8_MAX )
+    {
+        entry->beacons++;
+    }
+    if( phy_rx->lqi > entry->lqi )
+    {
+        entry->lqi = phy_rx->lqi;
+    }
+    if( phy_rx->rssi > entry->rssi )
+    {
+        entry->rssi = phy_rx->rssi;
+    }
+    entry->permit_join = ( (frame->payload[0] | ((uint16_t)frame->payload[1] << 8)) & DISCOVER_SUPERFRAME_PERMIT_MSK ) != 0;
+    entry->stack_profile = discover_stack_profile( frame->payload, frame->payload_size );
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive discovery statistics
+******************************************************************************/
+void Discover_GetStats( Discover_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = discoverStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Discovery task
+Records are paced by stats channel free space, as summary records are
+******************************************************************************/
+void Discover_Task( void )
+{
+    uint8_t sent = 0;
+
+    if( discoverStats.state == DISCOVER_STATE_SWEEP )
+    {
+        discover_next_channel();
+        return;
+    }
+
+    while( discoverStats.state == DISCOVER_STATE_REPORT )
+    {
+        if( sent >= DISCOVER_RECORDS_PER_RUN )
+        {
+            Scheduler_Post( SCHEDULER_TASK_DISCOVER );
+            return;
+        }
+
+        if( Mux_GetFreeSpace( MUX_CHANNEL_STATS ) < DISCOVER_RECORD_SIZE )
+        {
+            Scheduler_PostDelayed( SCHEDULER_TASK_DISCOVER, DISCOVER_REPORT_POLL_US );
+            return;
+        }
+
+        if( discoverHeaderPending )
+        {
+            discover_send_header();
+            discoverHeaderPending = false;
+        }
+        else if( discoverReportIndex < discoverStats.pans )
+        {
+            discover_send_entry( &discoverTable[discoverReportIndex++] );
+        }
+        else
+        {
+            discoverStats.state = DISCOVER_STATE_IDLE;
+        }
+        sent++;
+    }
+}
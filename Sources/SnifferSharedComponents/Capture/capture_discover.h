@@ -0,0 +1,120 @@
+/****************************************************************************//**
+  \file capture_discover.h
+
+  \brief Active network discovery, beacon request sweep and PAN table
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_DISCOVER_H
+#define _CAPTURE_DISCOVER_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Beacon senders kept per sweep
+#define DISCOVER_TABLE_SIZE             32
+
+//Channel mask, bit n set to visit channel n
+#define DISCOVER_CHANNELS_ALL           0x07FFF800
+
+//Listening time on each channel after the beacon request
+#define DISCOVER_WINDOW_DEFAULT_MS      40
+
+//Stack profile of a beacon without ZigBee beacon payload
+#define DISCOVER_STACK_PROFILE_NONE     0xFF
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    DISCOVER_STATE_IDLE,
+    DISCOVER_STATE_SWEEP,               //visiting channels, live capture suspended
+    DISCOVER_STATE_REPORT,              //sending PAN table
+}Discover_State_t;
+
+//A beacon sender, best link quality seen during the sweep
+typedef struct {
+    uint64_t address;                   //coordinator or router short or extended address
+    uint16_t pan_id;
+    uint8_t  mode;                      //MAC_Addressing_Mode_t of address
+    uint8_t  channel;
+    uint8_t  lqi;
+    int8_t   rssi;
+    uint8_t  stack_profile;             //ZigBee stack profile, DISCOVER_STACK_PROFILE_NONE if absent
+    uint8_t  beacons;                   //beacons received, saturates at 255
+    bool     permit_join;               //association permit of superframe specification
+}Discover_Pan_t;
+
+typedef struct {
+    Discover_State_t state;
+    uint32_t sweeps;                    //sweeps completed
+    uint32_t beacons;                   //beacons parsed
+    uint32_t full;                      //beacons from new senders lost, table full
+    uint32_t failed;                    //beacon requests not queued
+    uint32_t duration;                  //last sweep duration in us
+    uint8_t  pans;                      //entries in table
+}Discover_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init discovery, idle and table empty
+******************************************************************************/
+void Discover_Init( void );
+
+/**************************************************************************//**
+\brief Start a sweep of channels in channel_mask, listening window_ms on each
+Stops hopping, radio returns to current channel once done
+returns false if a sweep is in progress or parameters are invalid
+******************************************************************************/
+bool Discover_Start( uint32_t channel_mask, uint16_t window_ms );
+
+/**************************************************************************//**
+\brief Offer a received frame to discovery
+returns true while a sweep is running, frame is consumed,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+bool Discover_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive discovery statistics
+******************************************************************************/
+void Discover_GetStats( Discover_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Discovery task
+Move to next channel at window end, then send PAN table on stats channel
+******************************************************************************/
+void Discover_Task( void );
+
+#endif // _CAPTURE_DISCOVER_H
@@ -0,0 +1,655 @@
+/***************************************************************************//**
+ @file capture_flashlog.c
+  @brief   Offline capture to internal flash
+           Pages are used as a ring, the oldest page is erased when log is full
+           so every page wears evenly. Records are written by RAM batches
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_flashlog.h"
+#include "console_mux.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "Hal.h"
+#include "string.h"
+#include "stddef.h"     //for offsetof
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+//Sequence of a page erased by FlashLog_Erase and not yet used,
+//left unprogrammed so the page is taken without a new erase
+#define FLASHLOG_SEQUENCE_FREE          0xFFFFFFFF
+
+#define FLASHLOG_BATCH_COUNT            2
+
+//A partially filled batch is written after this delay
+#define FLASHLOG_FLUSH_US               1000000
+
+//Retry delay when capture channel queue is full while dumping
+#define FLASHLOG_DUMP_POLL_US           2000
+#define FLASHLOG_DUMP_CHUNKS_PER_RUN    4
+
+//A dump progress report is sent every FLASHLOG_PROGRESS_CHUNKS chunks
+#define FLASHLOG_PROGRESS_CHUNKS        16
+#define FLASHLOG_PROGRESS_SIZE          96
+
+#if (FLASHLOG_BATCH_SIZE % 4) != 0
+#error "FLASHLOG_BATCH_SIZE must be a multiple of a flash word"
+#endif
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;                  //increments with each new page
+    uint32_t erases;                    //times page was erased
+    uint32_t reserved;
+}FlashLog_Page_Header_t;
+
+typedef struct {
+    uint32_t data[FLASHLOG_BATCH_SIZE / 4];     //word aligned for flash write
+    uint32_t sequence;                  //not 0 when batch starts a new page
+    uint32_t opened;                    //radio time of first record
+    uint16_t page;                      //destination page
+    uint16_t offset;                    //destination offset in page
+    uint16_t length;                    //bytes in batch
+    bool     sealed;                    //complete, waiting to be written
+}FlashLog_Batch_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static FlashLog_Page_Header_t const * flashlog_header( uint16_t page );
+static uint16_t flashlog_page_used( uint16_t page );
+static void flashlog_batch_open( FlashLog_Batch_t * batch, uint16_t size );
+static void flashlog_batch_seal( FlashLog_Batch_t * batch );
+static void flashlog_batch_write( FlashLog_Batch_t * batch );
+static bool flashlog_batches_pending( void );
+static void flashlog_erase_step( void );
+static void flashlog_dump_step( void );
+static void flashlog_report_progress( void );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static uint32_t flashLogBase;           //region start address
+static uint32_t flashLogPageSize;
+static uint16_t flashLogPages;
+static uint16_t flashLogHead;           //page being appended
+static uint16_t flashLogOldest;         //first page dumped
+static uint16_t flashLogWriteOffset;    //next record offset in head page
+static bool     flashLogEmpty;
+static uint16_t flashLogEraseIndex;
+static FlashLog_Batch_t flashLogBatches[FLASHLOG_BATCH_COUNT];
+static uint8_t  flashLogActive;         //batch receiving records
+static uint8_t  flashLogNextWrite;      //next sealed batch written
+static uint8_t  flashLogDumpChunk[4 + FLASHLOG_DUMP_CHUNK];
+static uint16_t flashLogDumpChunks;
+static FlashLog_Stats_t flashLogStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return page header, flash is memory mapped
+******************************************************************************/
+static FlashLog_Page_Header_t const * flashlog_header( uint16_t page )
+{
+    return (FlashLog_Page_Header_t const *)(flashLogBase + (uint32_t)page * flashLogPageSize);
+}
+
+/**************************************************************************//**
+\brief Return bytes of records and padding in a page, header excluded
+******************************************************************************/
+static uint16_t flashlog_page_used( uint16_t page )
+{
+    uint8_t const * data = (uint8_t const *)flashlog_header( page );
+    uint32_t offset = FLASHLOG_PAGE_HEADER;
+
+    while( offset < flashLogPageSize && data[offset] != FLASHLOG_END )
+    {
+        if( data[offset] == FLASHLOG_PAD )
+        {
+            offset++;
+        }else{
+            offset += FLASHLOG_RECORD_HEADER + data[offset];
+        }
+    }
+    if( offset > flashLogPageSize )
+    {
+        //truncated record, should not happen
+        offset = flashLogPageSize;
+    }
+    return offset - FLASHLOG_PAGE_HEADER;
+}
+
+/**************************************************************************//**
+\brief Start a batch at current write position, moves to next page when
+record does not fit head page, overwriting oldest page when log is full
+******************************************************************************/
+static void flashlog_batch_open( FlashLog_Batch_t * batch, uint16_t size )
+{
+    batch->sequence = 0;
+    if( flashLogEmpty || ( flashLogWriteOffset + size > flashLogPageSize ) )
+    {
+        if( flashLogEmpty )
+        {
+            flashLogHead = flashLogOldest;
+            flashLogEmpty = false;
+            flashLogStats.used_pages = 1;
+        }else{
+            flashLogHead = ( flashLogHead + 1 ) % flashLogPages;
+            if( flashLogHead == flashLogOldest )
+            {
+                flashLogOldest = ( flashLogOldest + 1 ) % flashLogPages;
+            }else{
+                flashLogStats.used_pages++;
+            }
+        }
+        flashLogStats.sequence++;
+        batch->sequence = flashLogStats.sequence;
+        flashLogWriteOffset = FLASHLOG_PAGE_HEADER;
+    }
+    batch->page = flashLogHead;
+    batch->offset = flashLogWriteOffset;
+    batch->length = 0;
+    batch->opened = HAL_Radio_GetTime();
+    Scheduler_PostDelayed( SCHEDULER_TASK_FLASHLOG, FLASHLOG_FLUSH_US );
+}
+
+/**************************************************************************//**
+\brief Close a batch for writing, padded to a flash word
+******************************************************************************/
+static void flashlog_batch_seal( FlashLog_Batch_t * batch )
+{
+    uint8_t * data = (uint8_t *)batch->data;
+
+    while( batch->length % sizeof(uint32_t) )
+    {
+        data[batch->length++] = FLASHLOG_PAD;
+        flashLogWriteOffset++;
+    }
+    batch->sealed = true;
+    flashLogActive = ( flashLogActive + 1 ) % FLASHLOG_BATCH_COUNT;
+    Scheduler_Post( SCHEDULER_TASK_FLASHLOG );
+}
+
+/**************************************************************************//**
+\brief Write a sealed batch, preparing its page first when it starts one
+A page left free by FlashLog_Erase only needs its sequence programmed,
+other pages are erased and their erase count carried over
+******************************************************************************/
+static void flashlog_batch_write( FlashLog_Batch_t * batch )
+{
+    FlashLog_Page_Header_t const * current = flashlog_header( batch->page );
+    FlashLog_Page_Header_t header;
+    uint32_t address = (uint32_t)current;
+
+    if( batch->sequence )
+    {
+        if( (current->magic == FLASHLOG_MAGIC) && (current->sequence == FLASHLOG_SEQUENCE_FREE) )
+        {
+            header.sequence = batch->sequence;
+            if( HAL_Flash_Write( address + offsetof(FlashLog_Page_Header_t, sequence), &header.sequence, 1 ) != HAL_FLASH_SUCCESS )
+            {
+                flashLogStats.errors++;
+            }
+        }else{
+            header.magic = FLASHLOG_MAGIC;
+            header.sequence = batch->sequence;
+            header.erases = ( current->magic == FLASHLOG_MAGIC ) ? current->erases + 1 : 1;
+            header.reserved = 0xFFFFFFFF;
+            if( (HAL_Flash_ErasePage( address ) != HAL_FLASH_SUCCESS) ||
+                (HAL_Flash_Write( address, (uint32_t *)&header, sizeof(header) / sizeof(uint32_t) ) != HAL_FLASH_SUCCESS) )
+            {
+                flashLogStats.errors++;
+            }
+            if( header.erases > flashLogStats.max_erases )
+            {
+                flashLogStats.max_erases = header.erases;
+            }
+        }
+    }
+
+    if( HAL_Flash_Write( address + batch->offset, batch->data, batch->length / sizeof(uint32_t) ) != HAL_FLASH_SUCCESS )
+    {
+        flashLogStats.errors++;
+    }
+
+    batch->length = 0;
+    batch->sequence = 0;
+    batch->sealed = false;
+}
+
+/**************************************************************************//**
+\brief Return true while a sealed batch waits to be written
+******************************************************************************/
+static bool flashlog_batches_pending( void )
+{
+    for( uint8_t i = 0; i < FLASHLOG_BATCH_COUNT; i++ )
+    {
+        if( flashLogBatches[i].sealed )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**************************************************************************//**
+\brief Erase next page of log, a page at a time to keep other tasks running
+******************************************************************************/
+static void flashlog_erase_step( void )
+{
+    FlashLog_Page_Header_t const * current = flashlog_header( flashLogEraseIndex );
+    uint8_t const * data = (uint8_t const *)current;
+    FlashLog_Page_Header_t header;
+
+    //already free and unused pages are kept as is
+    if( (current->magic != FLASHLOG_MAGIC) ||
+        (current->sequence != FLASHLOG_SEQUENCE_FREE) ||
+        (data[FLASHLOG_PAGE_HEADER] != FLASHLOG_END) )
+    {
+        header.magic = FLASHLOG_MAGIC;
+        header.sequence = FLASHLOG_SEQUENCE_FREE;
+        header.erases = ( current->magic == FLASHLOG_MAGIC ) ? current->erases + 1 : 1;
+        header.reserved = 0xFFFFFFFF;
+        if( (HAL_Flash_ErasePage( (uint32_t)current ) != HAL_FLASH_SUCCESS) ||
+            (HAL_Flash_Write( (uint32_t)current, (uint32_t *)&header, sizeof(header) / sizeof(uint32_t) ) != HAL_FLASH_SUCCESS) )
+        {
+            flashLogStats.errors++;
+        }
+        if( header.erases > flashLogStats.max_erases )
+        {
+            flashLogStats.max_erases = header.erases;
+        }
+    }
+
+    flashLogEraseIndex++;
+    if( flashLogEraseIndex < flashLogPages )
+    {
+        Scheduler_Post( SCHEDULER_TASK_FLASHLOG );
+        return;
+    }
+
+    flashLogEmpty = true;
+    flashLogHead = 0;
+    flashLogOldest = 0;
+    flashLogWriteOffset = FLASHLOG_PAGE_HEADER;
+    flashLogStats.used_pages = 0;
+    flashLogStats.end = 0;
+    flashLogStats.state = FLASHLOG_STATE_IDLE;
+}
+
+/**************************************************************************//**
+\brief Send next dump chunks as host link allows
+Chunks never cross a page, empty page tail is skipped
+******************************************************************************/
+static void flashlog_dump_step( void )
+{
+    uint32_t data_size = flashLogPageSize - FLASHLOG_PAGE_HEADER;
+    uint16_t rank;
+    uint16_t page;
+    uint16_t in_page;
+    uint16_t used;
+    uint16_t size;
+
+    for( uint8_t n = 0; n < FLASHLOG_DUMP_CHUNKS_PER_RUN; n++ )
+    {
+        if( flashLogStats.dump_offset >= flashLogStats.end )
+        {
+            flashLogStats.state = FLASHLOG_STATE_IDLE;
+            flashlog_report_progress();
+            return;
+        }
+
+        rank = flashLogStats.dump_offset / data_size;
+        in_page = flashLogStats.dump_offset % data_size;
+        page = ( flashLogOldest + rank ) % flashLogPages;
+        used = ( page == flashLogHead ) ? flashLogWriteOffset - FLASHLOG_PAGE_HEADER : flashlog_page_used( page );
+        if( in_page >= used )
+        {
+            flashLogStats.dump_offset = ( rank + 1 ) * data_size;
+            continue;
+        }
+
+        size = used - in_page;
+        if( size > FLASHLOG_DUMP_CHUNK )
+        {
+            size = FLASHLOG_DUMP_CHUNK;
+        }
+        if( Mux_GetFreeSpace( MUX_CHANNEL_CAPTURE ) < size + 4 )
+        {
+            Scheduler_PostDelayed( SCHEDULER_TASK_FLASHLOG, FLASHLOG_DUMP_POLL_US );
+            return;
+        }
+
+        flashLogDumpChunk[0] = (uint8_t)(flashLogStats.dump_offset);
+        flashLogDumpChunk[1] = (uint8_t)(flashLogStats.dump_offset >> 8);
+        flashLogDumpChunk[2] = (uint8_t)(flashLogStats.dump_offset >> 16);
+        flashLogDumpChunk[3] = (uint8_t)(flashLogStats.dump_offset >> 24);
+        memcpy( &flashLogDumpChunk[4], (uint8_t const *)flashlog_header( page ) + FLASHLOG_PAGE_HEADER + in_page, size );
+        Mux_Write( MUX_CHANNEL_CAPTURE, flashLogDumpChunk, size + 4 );
+        flashLogStats.dump_offset += size;
+
+        flashLogDumpChunks++;
+        if( (flashLogDumpChunks % FLASHLOG_PROGRESS_CHUNKS) == 0 )
+        {
+            flashlog_report_progress();
+        }
+    }
+    Scheduler_Post( SCHEDULER_TASK_FLASHLOG );
+}
+
+/**************************************************************************//**
+\brief Send dump progress on stats channel
+{"flog":"dump","off":7680,"end":120000}
+******************************************************************************/
+static void flashlog_report_progress( void )
+{
+    char report[FLASHLOG_PROGRESS_SIZE];
+    int length;
+
+    length = snprintf( report, FLASHLOG_PROGRESS_SIZE, "{\"flog\":\"%s\",\"off\":%u,\"end\":%u}\n\r",
+                       (flashLogStats.state == FLASHLOG_STATE_DUMPING) ? "dump" : "done",
+                       (unsigned int)flashLogStats.dump_offset, (unsigned int)flashLogStats.end );
+    if( length > 0 && length < FLASHLOG_PROGRESS_SIZE )
+    {
+        Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)report, length );
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init flash log, scan page headers to resume after last record
+******************************************************************************/
+void FlashLog_Init( void )
+{
+    FlashLog_Page_Header_t const * header;
+    uint32_t size;
+    uint32_t oldest_sequence = FLASHLOG_SEQUENCE_FREE;
+
+    memset( &flashLogStats, 0, sizeof(flashLogStats) );
+    memset( flashLogBatches, 0, sizeof(flashLogBatches) );
+    flashLogActive = 0;
+    flashLogNextWrite = 0;
+
+    HAL_Flash_GetLogRegion( &flashLogBase, &size );
+    flashLogPageSize = HAL_Flash_GetPageSize();
+    flashLogPages = size / flashLogPageSize;
+    flashLogStats.pages = flashLogPages;
+    flashLogHead = 0;
+    flashLogOldest = 0;
+    flashLogEmpty = true;
+
+    for( uint16_t page = 0; page < flashLogPages; page++ )
+    {
+        header = flashlog_header( page );
+        if( header->magic != FLASHLOG_MAGIC )
+        {
+            continue;
+        }
+        if( header->erases > flashLogStats.max_erases )
+        {
+            flashLogStats.max_erases = header->erases;
+        }
+        if( header->sequence == FLASHLOG_SEQUENCE_FREE )
+        {
+            continue;
+        }
+
+        flashLogStats.used_pages++;
+        if( flashLogEmpty || header->sequence > flashLogStats.sequence )
+        {
+            flashLogStats.sequence = header->sequence;
+            flashLogHead = page;
+        }
+        if( flashLogEmpty || header->sequence < oldest_sequence )
+        {
+            oldest_sequence = header->sequence;
+            flashLogOldest = page;
+        }
+        flashLogEmpty = false;
+    }
+
+    flashLogWriteOffset = FLASHLOG_PAGE_HEADER;
+    if( !flashLogEmpty )
+    {
+        //resume on a word boundary after last record
+        flashLogWriteOffset += flashlog_page_used( flashLogHead );
+        flashLogWriteOffset = ( flashLogWriteOffset + 3 ) & ~3;
+    }
+}
+
+/**************************************************************************//**
+\brief Start appending accepted frames to flash log
+******************************************************************************/
+FlashLog_Result_t FlashLog_Start( void )
+{
+    if( flashLogPages == 0 )
+    {
+        return FLASHLOG_NO_REGION;
+    }
+    if( flashLogStats.state != FLASHLOG_STATE_IDLE && flashLogStats.state != FLASHLOG_STATE_RECORDING )
+    {
+        return FLASHLOG_BUSY;
+    }
+    if( flashLogStats.state == FLASHLOG_STATE_IDLE )
+    {
+        flashLogStats.recorded = 0;
+        flashLogStats.dropped = 0;
+    }
+    flashLogStats.state = FLASHLOG_STATE_RECORDING;
+    return FLASHLOG_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Stop recording, pending records are written
+******************************************************************************/
+void FlashLog_Stop( void )
+{
+    FlashLog_Batch_t * batch = &flashLogBatches[flashLogActive];
+
+    if( flashLogStats.state != FLASHLOG_STATE_RECORDING )
+    {
+        return;
+    }
+    if( batch->length && !batch->sealed )
+    {
+        flashlog_batch_seal( batch );
+    }
+    flashLogStats.state = FLASHLOG_STATE_IDLE;
+}
+
+/**************************************************************************//**
+\brief Send log to host on capture channel from a dump offset
+******************************************************************************/
+FlashLog_Result_t FlashLog_Dump( uint32_t from )
+{
+    if( flashLogPages == 0 )
+    {
+        return FLASHLOG_NO_REGION;
+    }
+    if( flashLogStats.state != FLASHLOG_STATE_IDLE || flashlog_batches_pending() )
+    {
+        return FLASHLOG_BUSY;
+    }
+    if( !Mux_IsEnabled() )
+    {
+        return FLASHLOG_INVALID_PARAMETER;
+    }
+
+    FlashLog_GetStats( NULL );
+    if( from > flashLogStats.end )
+    {
+        return FLASHLOG_INVALID_PARAMETER;
+    }
+    flashLogStats.dump_offset = from;
+    flashLogDumpChunks = 0;
+    flashLogStats.state = FLASHLOG_STATE_DUMPING;
+    Scheduler_Post( SCHEDULER_TASK_FLASHLOG );
+    return FLASHLOG_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Erase whole log, pages keep their erase count
+******************************************************************************/
+FlashLog_Result_t FlashLog_Erase( void )
+{
+    if( flashLogPages == 0 )
+    {
+        return FLASHLOG_NO_REGION;
+    }
+    if( flashLogStats.state != FLASHLOG_STATE_IDLE || flashlog_batches_pending() )
+    {
+        return FLASHLOG_BUSY;
+    }
+    flashLogEraseIndex = 0;
+    flashLogStats.state = FLASHLOG_STATE_ERASING;
+    Scheduler_Post( SCHEDULER_TASK_FLASHLOG );
+    return FLASHLOG_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Offer a captured frame to flash log
+A record never spans two pages nor two batches
+******************************************************************************/
+bool FlashLog_Record( PhyRx_t const * phy_rx )
+{
+    FlashLog_Batch_t * batch = &flashLogBatches[flashLogActive];
+    uint16_t size = FLASHLOG_RECORD_HEADER + phy_rx->len;
+    uint8_t * data;
+
+    if( flashLogStats.state != FLASHLOG_STATE_RECORDING )
+    {
+        return ( flashLogStats.state == FLASHLOG_STATE_DUMPING );
+    }
+
+    if( batch->length && !batch->sealed &&
+        ( (flashLogWriteOffset + size > flashLogPageSize) ||
+          (batch->length + size > FLASHLOG_BATCH_SIZE) ) )
+    {
+        flashlog_batch_seal( batch );
+        batch = &flashLogBatches[flashLogActive];
+    }
+
+    //flash is slower than air, both batches are waiting for flash
+    if( batch->sealed )
+    {
+        flashLogStats.dropped++;
+        return false;
+    }
+
+    if( batch->length == 0 )
+    {
+        flashlog_batch_open( batch, size );
+    }
+
+    data = (uint8_t *)batch->data + batch->length;
+    data[0] = phy_rx->len;
+    data[1] = phy_rx->lqi;
+    data[2] = (uint8_t)phy_rx->rssi;
+    data[3] = phy_rx->channel;
+    data[4] = (uint8_t)(phy_rx->timestamp);
+    data[5] = (uint8_t)(phy_rx->timestamp >> 8);
+    data[6] = (uint8_t)(phy_rx->timestamp >> 16);
+    data[7] = (uint8_t)(phy_rx->timestamp >> 24);
+    memcpy( &data[FLASHLOG_RECORD_HEADER], phy_rx->payload, phy_rx->len );
+    batch->length += size;
+    flashLogWriteOffset += size;
+    flashLogStats.recorded++;
+    return false;
+}
+
+/**************************************************************************//**
+\brief Retreive flash log state and counters
+NULL only refreshes log end
+******************************************************************************/
+void FlashLog_GetStats( FlashLog_Stats_t * stats )
+{
+    uint32_t data_size = flashLogPageSize - FLASHLOG_PAGE_HEADER;
+    uint16_t rank;
+
+    if( flashLogEmpty )
+    {
+        flashLogStats.end = 0;
+    }else{
+        rank = ( flashLogHead + flashLogPages - flashLogOldest ) % flashLogPages;
+        flashLogStats.end = rank * data_size + ( flashLogWriteOffset - FLASHLOG_PAGE_HEADER );
+    }
+
+    if( stats != NULL )
+    {
+        *stats = flashLogStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Flash log task
+******************************************************************************/
+void FlashLog_Task( void )
+{
+    FlashLog_Batch_t * batch;
+
+    //batches are written in the order they were sealed
+    while( flashLogBatches[flashLogNextWrite].sealed )
+    {
+        flashlog_batch_write( &flashLogBatches[flashLogNextWrite] );
+        flashLogNextWrite = ( flashLogNextWrite + 1 ) % FLASHLOG_BATCH_COUNT;
+    }
+
+    switch( flashLogStats.state )
+    {
+    case FLASHLOG_STATE_RECORDING:
+        //low traffic, don't keep records in RAM too long
+        batch = &flashLogBatches[flashLogActive];
+        if( batch->length )
+        {
+            if( (uint32_t)(HAL_Radio_GetTime() - batch->opened) >= FLASHLOG_FLUSH_US )
+            {
+                flashlog_batch_seal( batch );
+            }else{
+                Scheduler_PostDelayed( SCHEDULER_TASK_FLASHLOG, FLASHLOG_FLUSH_US - (HAL_Radio_GetTime() - batch->opened) );
+            }
+        }
+        break;
+    case FLASHLOG_STATE_ERASING:
+        flashlog_erase_step();
+        break;
+    case FLASHLOG_STATE_DUMPING:
+        flashlog_dump_step();
+        break;
+    case FLASHLOG_STATE_IDLE:
+    default:
+        break;
+    }
+}
@@ -0,0 +1,137 @@
+/****************************************************************************//**
+  \file capture_flashlog.h
+
+  \brief Offline capture to internal flash
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_FLASHLOG_H
+#define _CAPTURE_FLASHLOG_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Log pages start with a header, records follow
+//a page header is: magic | sequence | erase count | reserved (uint32_t each)
+//a record is: length | LQI | RSSI | channel | timestamp (4, LSB first) | frame
+//a length of FLASHLOG_PAD is a single padding byte, FLASHLOG_END ends the page
+#define FLASHLOG_MAGIC              0x474F4C46      //"FLOG"
+#define FLASHLOG_PAGE_HEADER        16
+#define FLASHLOG_RECORD_HEADER      8
+#define FLASHLOG_PAD                0xFE
+#define FLASHLOG_END                0xFF
+
+//Records are batched in RAM and written to flash a batch at a time
+#define FLASHLOG_BATCH_SIZE         1024
+
+//Dump chunk is: log offset (4, LSB first) | log bytes
+#define FLASHLOG_DUMP_CHUNK         480
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    FLASHLOG_STATE_IDLE,
+    FLASHLOG_STATE_RECORDING,           //accepted frames appended to log
+    FLASHLOG_STATE_DUMPING,             //log sent to host, live capture suspended
+    FLASHLOG_STATE_ERASING,             //log cleared a page at a time
+}FlashLog_State_t;
+
+typedef enum {
+    FLASHLOG_SUCCESS,
+    FLASHLOG_BUSY,                      //operation in progress or batches pending
+    FLASHLOG_INVALID_PARAMETER,
+    FLASHLOG_NO_REGION,                 //linker script reserves no flash log
+}FlashLog_Result_t;
+
+typedef struct {
+    FlashLog_State_t state;
+    uint16_t pages;                     //pages in flash log region
+    uint16_t used_pages;                //pages holding records
+    uint32_t sequence;                  //sequence number of newest page
+    uint32_t max_erases;                //highest page erase count, wear indicator
+    uint32_t end;                       //log size as a dump offset
+    uint32_t recorded;                  //frames recorded since start
+    uint32_t dropped;                   //frames lost while both batches were pending
+    uint32_t errors;                    //flash erase or write failures
+    uint32_t dump_offset;               //next offset sent while dumping
+}FlashLog_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init flash log, scan page headers to resume after last record
+******************************************************************************/
+void FlashLog_Init( void );
+
+/**************************************************************************//**
+\brief Start appending accepted frames to flash log, oldest pages are
+overwritten once log is full
+******************************************************************************/
+FlashLog_Result_t FlashLog_Start( void );
+
+/**************************************************************************//**
+\brief Stop recording, pending records are written
+******************************************************************************/
+void FlashLog_Stop( void );
+
+/**************************************************************************//**
+\brief Send log to host on capture channel from a dump offset
+A dump offset is (page rank from oldest) * (page size - FLASHLOG_PAGE_HEADER)
++ offset in page records, so an interrupted dump resumes where it stopped
+Requires mux framing
+******************************************************************************/
+FlashLog_Result_t FlashLog_Dump( uint32_t from );
+
+/**************************************************************************//**
+\brief Erase whole log, pages keep their erase count
+******************************************************************************/
+FlashLog_Result_t FlashLog_Erase( void );
+
+/**************************************************************************//**
+\brief Offer a captured frame to flash log
+returns true if frame must not go to live capture (log is being dumped)
+******************************************************************************/
+bool FlashLog_Record( PhyRx_t const * phy_rx );
+
+/**************************************************************************//**
+\brief Retreive flash log state and counters
+******************************************************************************/
+void FlashLog_GetStats( FlashLog_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Flash log task
+Writes batches, flushes idle batch, erases and dumps log
+******************************************************************************/
+void FlashLog_Task( void );
+
+#endif // _CAPTURE_FLASHLOG_H
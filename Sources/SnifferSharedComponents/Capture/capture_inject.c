@@ -0,0 +1,202 @@
+/***************************************************************************//**
+ @file capture_inject.c
+  @brief   Frame injection, host uploads to the transmit queue
+           Batches of frames uploaded by host are queued for transmission, each
+           frame is reported back with its outcome and timestamps
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_inject.h"
+#include "capture_replay.h"
+#include "console_mux.h"
+#include "printf.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+//{"tx":65535,"st":"full","q":4294967295,"t":4294967295,"s":4294967295,"err":-2147483648}
+#define INJECT_REPORT_SIZE              96
+
+//Scheduled record header: mode | handle (2) | length | time offset (4, LSB first)
+#define INJECT_SCHEDULED_HEADER_SIZE    (INJECT_RECORD_HEADER_SIZE + 4)
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void inject_report( uint16_t handle, char const * status, PhyTxReport_t const * tx );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Inject_Stats_t injectStats;
+
+//Transmit outcomes, in PhyTxStatus_t order
+static char const * const InjectStatusNames[] = {
+    "ok",
+    "cca",
+    "err",
+};
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Send a transmit report on transmit channel
+{"tx":12,"st":"ok","q":1000000,"t":1000950}
+A scheduled frame adds requested end of frame and achieved minus requested:
+{"tx":12,"st":"ok","q":1000000,"t":1020003,"s":1020000,"err":3}
+A frame refused by the queue is reported without timestamps
+******************************************************************************/
+static void inject_report( uint16_t handle, char const * status, PhyTxReport_t const * tx )
+{
+    char report[INJECT_REPORT_SIZE];
+    int length;
+
+    if( tx == NULL )
+    {
+        length = snprintf( report, INJECT_REPORT_SIZE, "{\"tx\":%u,\"st\":\"%s\"}\n\r",
+                           (unsigned int)handle, status );
+    }
+    else if( tx->mode == PHY_TX_MODE_SCHEDULED )
+    {
+        length = snprintf( report, INJECT_REPORT_SIZE, "{\"tx\":%u,\"st\":\"%s\",\"q\":%lu,\"t\":%lu,\"s\":%lu,\"err\":%ld}\n\r",
+                           (unsigned int)handle, status, (unsigned long)tx->queued, (unsigned long)tx->done,
+                           (unsigned long)tx->scheduled, (long)(int32_t)(tx->done - tx->scheduled) );
+    }
+    else
+    {
+        length = snprintf( report, INJECT_REPORT_SIZE, "{\"tx\":%u,\"st\":\"%s\",\"q\":%lu,\"t\":%lu}\n\r",
+                           (unsigned int)handle, status, (unsigned long)tx->queued, (unsigned long)tx->done );
+    }
+
+    if( (length > 0) && (length < INJECT_REPORT_SIZE) &&
+        (Mux_Write( MUX_CHANNEL_TX, (uint8_t *)report, length ) == MUX_WRITE_SUCCESS) )
+    {
+        injectStats.reports++;
+    }else{
+        injectStats.dropped++;
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init frame injection
+******************************************************************************/
+void Inject_Init( void )
+{
+    memset( &injectStats, 0, sizeof(injectStats) );
+}
+
+/**************************************************************************//**
+\brief Queue every record of an upload batch for transmission
+Scheduled records go to the replay buffer, others to the transmit queue.
+A record that cannot be taken is reported "full" and the next ones are
+still offered, so host learns the fate of every handle it uploaded
+******************************************************************************/
+void Inject_Upload( uint8_t const * batch, uint16_t size )
+{
+    PhyTxQueue_Result_t result;
+    Replay_Result_t replay;
+    uint16_t handle;
+    uint16_t header;
+    uint8_t length;
+
+    injectStats.uploads++;
+
+    while( size != 0 )
+    {
+        header = ( batch[0] == PHY_TX_MODE_SCHEDULED ) ? INJECT_SCHEDULED_HEADER_SIZE : INJECT_RECORD_HEADER_SIZE;
+        if( size < header )
+        {
+            injectStats.malformed++;
+            return;
+        }
+
+        handle = batch[1] | (((uint16_t) batch[2]) << 8);
+        length = batch[3];
+        if( (size - header) < length )
+        {
+            injectStats.malformed++;
+            return;
+        }
+
+        if( batch[0] == PHY_TX_MODE_SCHEDULED )
+        {
+            replay = Replay_Load( batch[4] | ((uint32_t)batch[5] << 8) | ((uint32_t)batch[6] << 16) | ((uint32_t)batch[7] << 24),
+                                  handle, &batch[header], length );
+            result = ( replay == REPLAY_SUCCESS ) ? PHY_TX_QUEUE_SUCCESS :
+                     ( replay == REPLAY_INVALID_PARAMETER ) ? PHY_TX_QUEUE_INVALID_PARAMETER : PHY_TX_QUEUE_FULL;
+        }else{
+            result = PHY_QueueFrame( &batch[header], length, (PhyTxMode_t) batch[0], handle );
+        }
+
+        if( result == PHY_TX_QUEUE_INVALID_PARAMETER )
+        {
+            inject_report( handle, "inv", NULL );
+            injectStats.malformed++;
+            return;
+        }
+        if( result == PHY_TX_QUEUE_FULL )
+        {
+            inject_report( handle, "full", NULL );
+        }
+
+        batch += header + length;
+        size -= header + length;
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive injection statistics
+******************************************************************************/
+void Inject_GetStats( Inject_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = injectStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Clear injection counters
+******************************************************************************/
+void Inject_ClearStats( void )
+{
+    memset( &injectStats, 0, sizeof(injectStats) );
+}
+
+/**************************************************************************//**
+\brief Transmit done, report outcome to host
+******************************************************************************/
+void PHY_TxCallback( PhyTxReport_t const * report )
+{
+    inject_report( report->handle, InjectStatusNames[report->status], report );
+}
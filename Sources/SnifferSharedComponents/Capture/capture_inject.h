@@ -0,0 +1,82 @@
+/****************************************************************************//**
+  \file capture_inject.h
+
+  \brief Frame injection, host uploads to the transmit queue
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_INJECT_H
+#define _CAPTURE_INJECT_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//An upload is a batch of records: mode | handle (2, LSB first) | length | frame
+//mode is a PhyTxMode_t, frame excludes the FCS
+//PHY_TX_MODE_SCHEDULED records are loaded in the replay buffer and carry a
+//time offset (4, LSB first) between length and frame, see Replay_Load
+#define INJECT_RECORD_HEADER_SIZE   4
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t uploads;                   //batches received from host
+    uint32_t malformed;                 //batches truncated or holding an invalid record
+    uint32_t reports;                   //transmit reports sent to host
+    uint32_t dropped;                   //reports lost because host link is busy
+}Inject_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init frame injection
+******************************************************************************/
+void Inject_Init( void );
+
+/**************************************************************************//**
+\brief Queue every record of an upload batch for transmission
+Records are queued in order, parsing stops at the first malformed one
+******************************************************************************/
+void Inject_Upload( uint8_t const * batch, uint16_t size );
+
+/**************************************************************************//**
+\brief Retreive injection statistics
+******************************************************************************/
+void Inject_GetStats( Inject_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Clear injection counters
+******************************************************************************/
+void Inject_ClearStats( void );
+
+#endif // _CAPTURE_INJECT_H
@@ -0,0 +1,235 @@
+/***************************************************************************//**
+ @file capture_noise.c
+  @brief   Background noise floor and channel busy ratio
+           RSSI of the capture channel is sampled without leaving reception,
+           samples below busy threshold give the noise floor
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_noise.h"
+#include "console_mux.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define NOISE_US_PER_MS                 1000
+#define NOISE_PER_MILLE                 1000
+
+//RSSI samples are in quarter dBm
+#define NOISE_RSSI_SCALE                4
+
+//Longest record
+#define NOISE_RECORD_SIZE               128
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+//Samples of current record, RSSI in quarter dBm
+typedef struct {
+    uint32_t start;                     //radio time of first sample
+    uint32_t samples;
+    uint32_t busy;                      //samples at or above threshold
+    uint32_t invalid;
+    int32_t  clear_total;               //sum of samples below threshold
+    int16_t  min;
+    int16_t  max;
+    uint8_t  channel;
+}Noise_Window_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void noise_restart( uint32_t now, uint8_t channel );
+static void noise_send_record( uint32_t now );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Noise_Window_t noiseWindow;
+static Noise_Stats_t noiseStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Start a new record
+******************************************************************************/
+static void noise_restart( uint32_t now, uint8_t channel )
+{
+    memset( &noiseWindow, 0, sizeof(noiseWindow) );
+    noiseWindow.start = now;
+    noiseWindow.channel = channel;
+    noiseWindow.min = INT16_MAX;
+    noiseWindow.max = INT16_MIN;
+}
+
+/**************************************************************************//**
+\brief Send current record on stats channel
+nf is absent when every sample was busy
+{"noise":"ch","ch":11,"ms":1000,"n":998,"nf":-97,"min":-101,"max":-42,"busy":31,"bad":2}
+******************************************************************************/
+static void noise_send_record( uint32_t now )
+{
+    char record[NOISE_RECORD_SIZE];
+    uint32_t clear = noiseWindow.samples - noiseWindow.busy;
+    int length;
+
+    if( noiseWindow.samples == 0 )
+    {
+        return;
+    }
+
+    length = snprintf( record, NOISE_RECORD_SIZE, "{\"noise\":\"ch\",\"ch\":%u,\"ms\":%u,\"n\":%u",
+                       noiseWindow.channel, (unsigned int)((now - noiseWindow.start) / NOISE_US_PER_MS),
+                       (unsigned int)noiseWindow.samples );
+    if( clear )
+    {
+        length += snprintf( &record[length], NOISE_RECORD_SIZE - length, ",\"nf\":%d",
+                            (int)(noiseWindow.clear_total / (int32_t)clear / NOISE_RSSI_SCALE) );
+    }
+    length += snprintf( &record[length], NOISE_RECORD_SIZE - length, ",\"min\":%d,\"max\":%d,\"busy\":%u,\"bad\":%u}\n\r",
+                        noiseWindow.min / NOISE_RSSI_SCALE, noiseWindow.max / NOISE_RSSI_SCALE,
+                        (unsigned int)((noiseWindow.busy * NOISE_PER_MILLE) / noiseWindow.samples),
+                        (unsigned int)noiseWindow.invalid );
+
+    if( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS )
+    {
+        noiseStats.records++;
+    }
+    else
+    {
+        noiseStats.dropped++;
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init noise tracking, disabled
+******************************************************************************/
+void Noise_Init( void )
+{
+    memset( &noiseStats, 0, sizeof(noiseStats) );
+    noiseStats.sample_us = NOISE_SAMPLE_DEFAULT_US;
+    noiseStats.threshold = NOISE_BUSY_DEFAULT_DBM;
+}
+
+/**************************************************************************//**
+\brief Enable or disable noise tracking
+Sampling is a periodic task, below reception in priority, it never delays
+a received frame
+******************************************************************************/
+bool Noise_Start( uint32_t period_ms, uint32_t sample_us, int8_t threshold )
+{
+    if( period_ms != NOISE_DISABLED &&
+        ( sample_us < NOISE_SAMPLE_MIN_US || sample_us > period_ms * NOISE_US_PER_MS ) )
+    {
+        return false;
+    }
+
+    Scheduler_Cancel( SCHEDULER_TASK_NOISE );
+    noiseStats.period = period_ms;
+    noiseStats.sample_us = sample_us;
+    noiseStats.threshold = threshold;
+
+    if( period_ms != NOISE_DISABLED )
+    {
+        noise_restart( HAL_Radio_GetTime(), HAL_GetRadioChannel() );
+        Scheduler_PostPeriodic( SCHEDULER_TASK_NOISE, sample_us );
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive noise tracking state and counters
+******************************************************************************/
+void Noise_GetStats( Noise_Stats_t * stats )
+{
+    *stats = noiseStats;
+}
+
+/**************************************************************************//**
+\brief Noise task
+A channel change ends current record early, records never mix channels
+******************************************************************************/
+void Noise_Task( void )
+{
+    uint32_t now = HAL_Radio_GetTime();
+    uint8_t channel = HAL_GetRadioChannel();
+    int16_t rssi;
+
+    if( noiseStats.period == NOISE_DISABLED )
+    {
+        return;
+    }
+
+    if( channel != noiseWindow.channel )
+    {
+        noise_send_record( now );
+        noise_restart( now, channel );
+    }
+
+    rssi = HAL_Radio_GetRssi();
+    if( rssi == HAL_RADIO_RSSI_INVALID )
+    {
+        noiseWindow.invalid++;
+        noiseStats.invalid++;
+    }
+    else
+    {
+        noiseWindow.samples++;
+        noiseStats.samples++;
+        if( rssi >= noiseStats.threshold * NOISE_RSSI_SCALE )
+        {
+            noiseWindow.busy++;
+        }
+        else
+        {
+            noiseWindow.clear_total += rssi;
+        }
+        if( rssi < noiseWindow.min )
+        {
+            noiseWindow.min = rssi;
+        }
+        if( rssi > noiseWindow.max )
+        {
+            noiseWindow.max = rssi;
+        }
+    }
+
+    if( now - noiseWindow.start >= noiseStats.period * NOISE_US_PER_MS )
+    {
+        noise_send_record( now );
+        noise_restart( now, channel );
+    }
+}
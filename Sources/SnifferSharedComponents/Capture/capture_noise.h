@@ -0,0 +1,92 @@
+/****************************************************************************//**
+  \file capture_noise.h
+
+  \brief Background noise floor and channel busy ratio
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_NOISE_H
+#define _CAPTURE_NOISE_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Period value disabling noise records
+#define NOISE_DISABLED                  0
+
+//Default RSSI sample period, shortest accepted
+#define NOISE_SAMPLE_DEFAULT_US         1000
+#define NOISE_SAMPLE_MIN_US             250
+
+//Samples at or above threshold count as busy, default is the CCA threshold
+//used for transmission
+#define NOISE_BUSY_DEFAULT_DBM          (-75)
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t period;                    //record period in ms, NOISE_DISABLED when off
+    uint32_t sample_us;                 //RSSI sample period
+    int8_t   threshold;                 //busy threshold in dBm
+    uint32_t samples;                   //valid RSSI samples
+    uint32_t invalid;                   //samples skipped, radio not receiving
+    uint32_t records;                   //records sent to host
+    uint32_t dropped;                   //records lost, stats channel full
+}Noise_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init noise tracking, disabled
+******************************************************************************/
+void Noise_Init( void );
+
+/**************************************************************************//**
+\brief Enable noise tracking, a record is sent every period_ms,
+NOISE_DISABLED stops it
+    /param[in]     sample_us    RSSI sample period
+    /param[in]     threshold    busy threshold in dBm
+******************************************************************************/
+bool Noise_Start( uint32_t period_ms, uint32_t sample_us, int8_t threshold );
+
+/**************************************************************************//**
+\brief Retreive noise tracking state and counters
+******************************************************************************/
+void Noise_GetStats( Noise_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Noise task
+Takes a RSSI sample, sends record once period ended
+******************************************************************************/
+void Noise_Task( void );
+
+#endif // _CAPTURE_NOISE_H
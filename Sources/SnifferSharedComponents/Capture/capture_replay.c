@@ -0,0 +1,224 @@
+/***************************************************************************//**
+ @file capture_replay.c
+  @brief   Timed replay of a frame sequence
+           Frames loaded with relative timestamps are sent with scheduled transmits
+           so their end of frame times reproduce the loaded sequence
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_replay.h"
+#include "pool.h"
+#include "scheduler.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define REPLAY_US_PER_MS                1000
+
+//Frames handed to the transmit queue ahead of their time, only a few are
+//queued at once to leave the queue to other transmits
+#define REPLAY_AHEAD                    4
+
+//Transmit queue poll period while playing
+#define REPLAY_POLL_US                  500
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+typedef struct {
+    PhyRx_t * frame;                    //pool buffer held until cleared
+    uint32_t offset;                    //end of frame time in us relative to offset 0
+    uint16_t handle;
+}Replay_Frame_t;
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Replay_Frame_t replayFrames[REPLAY_FRAMES_MAX];
+static uint32_t replayLastOffset;       //offset of last loaded frame
+static Replay_Stats_t replayStats;
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init replay, buffer empty
+******************************************************************************/
+void Replay_Init( void )
+{
+    memset( &replayStats, 0, sizeof(replayStats) );
+    memset( replayFrames, 0, sizeof(replayFrames) );
+    replayLastOffset = 0;
+}
+
+/**************************************************************************//**
+\brief Append a frame to the replay buffer
+Frame goes straight to the pool buffer the transmit queue sends it from
+******************************************************************************/
+Replay_Result_t Replay_Load( uint32_t offset, uint16_t handle, uint8_t const * frame, uint8_t length )
+{
+    Replay_Frame_t * entry;
+    PhyRx_t * buffer;
+
+    if( replayStats.state != REPLAY_STATE_IDLE )
+    {
+        return REPLAY_BUSY;
+    }
+
+    if( (frame == NULL) || (length == 0) || (length > PHY_TX_FRAME_MAX) ||
+        (replayStats.frames && (offset < replayLastOffset)) )
+    {
+        return REPLAY_INVALID_PARAMETER;
+    }
+
+    if( replayStats.frames == REPLAY_FRAMES_MAX )
+    {
+        return REPLAY_FULL;
+    }
+    buffer = Pool_AllocHold();
+    if( buffer == NULL )
+    {
+        return REPLAY_FULL;
+    }
+
+    buffer->len = length;
+    memcpy( buffer->payload, frame, length );
+    entry = &replayFrames[replayStats.frames];
+    entry->frame = buffer;
+    entry->offset = offset;
+    entry->handle = handle;
+
+    replayStats.bytes += length;
+    replayStats.frames++;
+    replayLastOffset = offset;
+    return REPLAY_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Replay buffer on current channel, offset 0 is lead_ms from now
+******************************************************************************/
+Replay_Result_t Replay_Start( uint16_t lead_ms )
+{
+    if( replayStats.state != REPLAY_STATE_IDLE )
+    {
+        return REPLAY_BUSY;
+    }
+    if( replayStats.frames == 0 )
+    {
+        return REPLAY_INVALID_PARAMETER;
+    }
+
+    replayStats.played = 0;
+    replayStats.runs++;
+    replayStats.start = HAL_Radio_GetTime() + ((uint32_t)lead_ms * REPLAY_US_PER_MS);
+    replayStats.state = REPLAY_STATE_PLAYING;
+    Scheduler_Post( SCHEDULER_TASK_REPLAY );
+    return REPLAY_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Stop replay, frames already handed to transmit queue are still sent
+******************************************************************************/
+void Replay_Stop( void )
+{
+    replayStats.state = REPLAY_STATE_IDLE;
+    Scheduler_Cancel( SCHEDULER_TASK_REPLAY );
+}
+
+/**************************************************************************//**
+\brief Stop replay and empty buffer
+******************************************************************************/
+void Replay_Clear( void )
+{
+    Replay_Stop();
+    for( uint16_t i = 0; i < replayStats.frames; i++ )
+    {
+        Pool_Release( replayFrames[i].frame );
+        replayFrames[i].frame = NULL;
+    }
+    replayStats.frames = 0;
+    replayStats.bytes = 0;
+    replayStats.played = 0;
+    replayLastOffset = 0;
+}
+
+/**************************************************************************//**
+\brief Retreive replay statistics
+******************************************************************************/
+void Replay_GetStats( Replay_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = replayStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Replay task
+Transmits are scheduled by the radio, the task only keeps the transmit
+queue a few frames ahead, so its own latency does not add timing error
+******************************************************************************/
+void Replay_Task( void )
+{
+    PhyTxStats_t tx;
+    Replay_Frame_t const * entry;
+    uint32_t end_time;
+
+    if( replayStats.state != REPLAY_STATE_PLAYING )
+    {
+        return;
+    }
+
+    PHY_GetTxStats( &tx );
+    while( (replayStats.played < replayStats.frames) && (tx.pending < REPLAY_AHEAD) )
+    {
+        entry = &replayFrames[replayStats.played];
+        end_time = replayStats.start + entry->offset;
+        if( PHY_QueueBufferAt( entry->frame, end_time, entry->handle ) != PHY_TX_QUEUE_SUCCESS )
+        {
+            //transmit queue full, retry at next poll
+            break;
+        }
+
+        if( (int32_t)(end_time - HAL_Radio_GetTime()) < 0 )
+        {
+            replayStats.late++;
+        }
+        replayStats.played++;
+        tx.pending++;
+    }
+
+    if( replayStats.played >= replayStats.frames )
+    {
+        replayStats.state = REPLAY_STATE_IDLE;
+        return;
+    }
+    Scheduler_PostDelayed( SCHEDULER_TASK_REPLAY, REPLAY_POLL_US );
+}
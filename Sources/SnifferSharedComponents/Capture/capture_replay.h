@@ -0,0 +1,117 @@
+/****************************************************************************//**
+  \file capture_replay.h
+
+  \brief Timed replay of a frame sequence
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_REPLAY_H
+#define _CAPTURE_REPLAY_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Frames kept for replay, each one holds a pool buffer until cleared
+#define REPLAY_FRAMES_MAX               32
+
+//Delay between start command and end of first frame
+#define REPLAY_LEAD_DEFAULT_MS          20
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    REPLAY_STATE_IDLE,
+    REPLAY_STATE_PLAYING,
+}Replay_State_t;
+
+typedef enum {
+    REPLAY_SUCCESS,
+    REPLAY_INVALID_PARAMETER,
+    REPLAY_FULL,                        //REPLAY_FRAMES_MAX reached or pool down to its reception reserve
+    REPLAY_BUSY,                        //buffer cannot change while playing
+}Replay_Result_t;
+
+typedef struct {
+    Replay_State_t state;
+    uint32_t start;                     //radio time in us of offset 0 of last run
+    uint32_t runs;                      //replays started
+    uint32_t late;                      //frames handed to transmit queue after their time
+    uint16_t frames;                    //frames in buffer
+    uint16_t bytes;                     //frame bytes in buffer
+    uint16_t played;                    //frames handed to transmit queue in current run
+}Replay_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init replay, buffer empty
+******************************************************************************/
+void Replay_Init( void );
+
+/**************************************************************************//**
+\brief Append a frame to the replay buffer, it is copied to a pool buffer
+    /param[in]     offset       end of frame time in us relative to offset 0,
+                                offsets must not decrease
+    /param[in]     handle       reported back with transmit outcome
+    /param[in]     frame        PSDU without FCS
+******************************************************************************/
+Replay_Result_t Replay_Load( uint32_t offset, uint16_t handle, uint8_t const * frame, uint8_t length );
+
+/**************************************************************************//**
+\brief Replay buffer on current channel, offset 0 is lead_ms from now
+Buffer is kept, it can be replayed again
+******************************************************************************/
+Replay_Result_t Replay_Start( uint16_t lead_ms );
+
+/**************************************************************************//**
+\brief Stop replay, frames already handed to transmit queue are still sent
+******************************************************************************/
+void Replay_Stop( void );
+
+/**************************************************************************//**
+\brief Stop replay and empty buffer
+******************************************************************************/
+void Replay_Clear( void );
+
+/**************************************************************************//**
+\brief Retreive replay statistics
+******************************************************************************/
+void Replay_GetStats( Replay_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Replay task
+Hand next frames to transmit queue while playing
+******************************************************************************/
+void Replay_Task( void );
+
+#endif // _CAPTURE_REPLAY_H
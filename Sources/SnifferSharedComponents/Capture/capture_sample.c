@@ -0,0 +1,199 @@
+/***************************************************************************//**
+ @file capture_sample.c
+  @brief   Deterministic flow sampling of live capture
+           A flow (PAN ID, source, destination) is kept whole or not at all depending
+           on its hash, frames of other flows are sampled 1 in N with a weight of N
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_sample.h"
+#include "mac_unpack.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+//FNV-1a, same hash on every device so flows sampled by several sniffers match
+#define SAMPLE_FNV_OFFSET               0x811C9DC5
+#define SAMPLE_FNV_PRIME                0x01000193
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static uint32_t sample_hash( uint32_t hash, uint8_t const * data, uint8_t size );
+static uint32_t sample_hash_address( uint32_t hash, MAC_Addressing_Mode_t mode, MAC_Addr_t const * address );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Sample_Stats_t sampleStats;
+static uint16_t sampleCountdown;        //other flows frames to drop before next kept one
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Add bytes to FNV-1a hash
+******************************************************************************/
+static uint32_t sample_hash( uint32_t hash, uint8_t const * data, uint8_t size )
+{
+    for( uint8_t i = 0; i < size; i++ )
+    {
+        hash ^= data[i];
+        hash *= SAMPLE_FNV_PRIME;
+    }
+    return hash;
+}
+
+/**************************************************************************//**
+\brief Add an address and its mode to hash, absent address only adds mode
+******************************************************************************/
+static uint32_t sample_hash_address( uint32_t hash, MAC_Addressing_Mode_t mode, MAC_Addr_t const * address )
+{
+    uint8_t bytes[1 + MAC_EXTENDED_ADDR_SIZE];
+    uint8_t size = 0;
+
+    bytes[size++] = (uint8_t)mode;
+    if( mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        bytes[size++] = (uint8_t)address->short_addr;
+        bytes[size++] = (uint8_t)(address->short_addr >> 8);
+    }
+    else if( mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        for( uint8_t i = 0; i < MAC_EXTENDED_ADDR_SIZE; i++ )
+        {
+            bytes[size++] = (uint8_t)(address->long_addr >> (8 * i));
+        }
+    }
+    return sample_hash( hash, bytes, size );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init sampling, every frame kept
+******************************************************************************/
+void Sample_Init( void )
+{
+    memset( &sampleStats, 0, sizeof(sampleStats) );
+    sampleStats.flow_fraction = SAMPLE_FLOW_ALL;
+    sampleStats.one_in = SAMPLE_ONE_IN_ALL;
+    sampleCountdown = 0;
+}
+
+/**************************************************************************//**
+\brief Set sampling
+******************************************************************************/
+bool Sample_Set( uint16_t flow_fraction, uint16_t one_in )
+{
+    if( flow_fraction > SAMPLE_FLOW_ALL )
+    {
+        return false;
+    }
+    sampleStats.flow_fraction = flow_fraction;
+    sampleStats.one_in = one_in;
+    sampleCountdown = 0;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Offer a live frame to sampling
+Frames the MAC layer can't unpack belong to other flows
+******************************************************************************/
+bool Sample_Keep( PhyRx_t * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    uint32_t hash = SAMPLE_FNV_OFFSET;
+    uint16_t pan_id;
+    uint8_t pan[2];
+
+    if( sampleStats.flow_fraction == SAMPLE_FLOW_ALL )
+    {
+        return true;
+    }
+
+    if( sampleStats.flow_fraction )
+    {
+        if( frame != NULL )
+        {
+            //MAC_Unpack fills an elided PAN ID, both fields are zero without any
+            pan_id = frame->destination_pan_id;
+            pan[0] = (uint8_t)pan_id;
+            pan[1] = (uint8_t)(pan_id >> 8);
+            hash = sample_hash( hash, pan, sizeof(pan) );
+            hash = sample_hash_address( hash, frame->frame_control.source_addressing_mode, &frame->source_addr );
+            hash = sample_hash_address( hash, frame->frame_control.destination_addressing_mode, &frame->destination_addr );
+
+            //upper bits of FNV-1a are the best mixed ones
+            if( (((hash >> 16) * SAMPLE_FLOW_ALL) >> 16) < sampleStats.flow_fraction )
+            {
+                sampleStats.flow_kept++;
+                return true;
+            }
+        }
+    }
+
+    //systematic 1 in N of remaining frames
+    if( sampleStats.one_in == SAMPLE_ONE_IN_NONE )
+    {
+        sampleStats.dropped++;
+        return false;
+    }
+    if( sampleCountdown )
+    {
+        sampleCountdown--;
+        sampleStats.dropped++;
+        return false;
+    }
+    sampleCountdown = sampleStats.one_in - 1;
+    phy_rx->weight = sampleStats.one_in;
+    sampleStats.sampled++;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive sampling settings and counters
+******************************************************************************/
+void Sample_GetStats( Sample_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = sampleStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Clear sampling counters
+******************************************************************************/
+void Sample_ClearStats( void )
+{
+    sampleStats.flow_kept = 0;
+    sampleStats.sampled = 0;
+    sampleStats.dropped = 0;
+}
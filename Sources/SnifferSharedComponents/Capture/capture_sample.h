@@ -0,0 +1,96 @@
+/****************************************************************************//**
+  \file capture_sample.h
+
+  \brief Deterministic flow sampling of live capture
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_SAMPLE_H
+#define _CAPTURE_SAMPLE_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Flow fraction unit, a fraction of SAMPLE_FLOW_ALL keeps every flow
+#define SAMPLE_FLOW_ALL             1000
+
+//Other frames rate keeping all of them, sampling disabled with SAMPLE_FLOW_ALL
+#define SAMPLE_ONE_IN_ALL           1
+
+//Other frames rate dropping all of them
+#define SAMPLE_ONE_IN_NONE          0
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint16_t flow_fraction;             //flows fully kept, per SAMPLE_FLOW_ALL
+    uint16_t one_in;                    //1 in one_in frames of other flows kept
+    uint32_t flow_kept;                 //frames kept as part of a sampled flow, weight 1
+    uint32_t sampled;                   //frames of other flows kept, weight one_in
+    uint32_t dropped;                   //frames not sent
+}Sample_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init sampling, every frame kept
+******************************************************************************/
+void Sample_Init( void );
+
+/**************************************************************************//**
+\brief Set sampling
+flow_fraction: flows, by hash of PAN ID, source and destination addresses,
+fully kept per SAMPLE_FLOW_ALL
+one_in: 1 in one_in frames of other flows kept, SAMPLE_ONE_IN_NONE for none
+******************************************************************************/
+bool Sample_Set( uint16_t flow_fraction, uint16_t one_in );
+
+/**************************************************************************//**
+\brief Offer a live frame to sampling
+returns true if frame is kept, phy_rx->weight being the number of frames it stands for,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+bool Sample_Keep( PhyRx_t * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive sampling settings and counters
+******************************************************************************/
+void Sample_GetStats( Sample_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Clear sampling counters
+******************************************************************************/
+void Sample_ClearStats( void );
+
+#endif // _CAPTURE_SAMPLE_H
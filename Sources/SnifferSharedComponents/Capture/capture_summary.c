@@ -0,0 +1,529 @@
+/***************************************************************************//**
+ @file capture_summary.c
+  @brief   Statistics only capture, per source address counters
+           Frames are counted in an open addressed hash table keyed by PAN ID
+           and source address, summary records are sent every period
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_summary.h"
+#include "console_mux.h"
+#include "mac_unpack.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "Hal.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define SUMMARY_TABLE_MASK              (SUMMARY_TABLE_SIZE - 1)
+#define SUMMARY_US_PER_S                1000000
+
+//Largest record, extended address source with security counters
+#define SUMMARY_RECORD_SIZE             224
+
+//Records sent per task run, keeps other tasks responsive while flushing
+#define SUMMARY_RECORDS_PER_RUN         8
+
+//Retry delay when stats channel queue is full
+#define SUMMARY_FLUSH_POLL_US           5000
+
+//Fibonacci hashing multiplier
+#define SUMMARY_HASH_MULTIPLIER         0x9E3779B1
+
+//Key indexes tracked per source, a key rotation keeps the previous one
+#define SUMMARY_KEY_SLOTS               2
+
+#if (SUMMARY_TABLE_SIZE & SUMMARY_TABLE_MASK) != 0
+#error "SUMMARY_TABLE_SIZE must be a power of 2"
+#endif
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+//Frame counter of a key index, slot is free while valid is false
+typedef struct {
+    uint32_t frame_counter;             //highest frame counter
+    uint8_t  key_index;
+    bool     valid;
+}Summary_Counter_t;
+
+//Counters of a source, slot is free while frames is 0
+typedef struct {
+    uint64_t address;                   //short or extended source address
+    uint32_t frames;
+    uint32_t bytes;
+    int32_t  rssi_total;                //divide by frames for mean
+    uint32_t lqi_total;                 //divide by frames for mean
+    uint32_t gaps;                      //sequence numbers skipped
+    uint32_t repeats;                   //sequence numbers received again, retries
+    uint32_t secured;                   //frames with an auxiliary security header
+    uint32_t counter_gaps;              //frame counters skipped
+    uint32_t replays;                   //frame counters not above last one, retries excluded
+    Summary_Counter_t counters[SUMMARY_KEY_SLOTS];
+    uint16_t pan_id;
+    uint8_t  mode;                      //source addressing mode, MAC_Addressing_Mode_t
+    int8_t   rssi_min;
+    int8_t   rssi_max;
+    uint8_t  sequence;                  //last sequence number
+    bool     sequence_valid;
+    uint8_t  counter_next;              //slot taken by next new key index
+}Summary_Entry_t;
+
+typedef struct {
+    Summary_Entry_t entries[SUMMARY_TABLE_SIZE];
+    uint32_t sources;
+    uint32_t overflow;
+    uint32_t unparsed;
+}Summary_Table_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static Summary_Entry_t * summary_lookup( Summary_Table_t * table, uint16_t pan_id, uint8_t mode, uint64_t address, bool allocate );
+static void summary_carry( Summary_Entry_t * entry );
+static void summary_frame_counter( Summary_Entry_t * entry, MAC_Frame_Unpacked_t const * frame );
+static void summary_swap( void );
+static bool summary_send_header( void );
+static bool summary_send_entry( Summary_Entry_t const * entry );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Summary_Table_t summaryTables[2];
+static Summary_Table_t * summaryActive = &summaryTables[0];    //counting
+static Summary_Table_t * summaryFlushed = &summaryTables[1];   //being sent
+static uint32_t summaryPeriodUs = SUMMARY_DISABLED;
+static uint32_t summaryDeadline;        //radio time of next swap
+static bool summaryFlushing;
+static bool summaryHeaderPending;
+static uint16_t summaryFlushIndex;
+static Summary_Stats_t summaryStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return entry of a source, allocated on first frame when allocate is set
+returns NULL when table is full or source is absent
+Linear probing, entries are never removed, only the whole table is cleared
+******************************************************************************/
+static Summary_Entry_t * summary_lookup( Summary_Table_t * table, uint16_t pan_id, uint8_t mode, uint64_t address, bool allocate )
+{
+    Summary_Entry_t * entry;
+    uint32_t hash;
+    uint16_t index;
+
+    hash = (uint32_t)address ^ (uint32_t)(address >> 32) ^ ((uint32_t)pan_id << 16) ^ mode;
+    hash *= SUMMARY_HASH_MULTIPLIER;
+    index = hash >> 16;
+
+    for( uint16_t probe = 0; probe < SUMMARY_TABLE_SIZE; probe++ )
+    {
+        entry = &table->entries[(index + probe) & SUMMARY_TABLE_MASK];
+        if( entry->frames == 0 )
+        {
+            if( !allocate )
+            {
+                return NULL;
+            }
+            entry->address = address;
+            entry->pan_id = pan_id;
+            entry->mode = mode;
+            entry->rssi_min = INT8_MAX;
+            entry->rssi_max = INT8_MIN;
+            table->sources++;
+            return entry;
+        }
+        if( entry->address == address && entry->pan_id == pan_id && entry->mode == mode )
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+\brief Carry sequence and frame counters of a new entry from previous interval
+Tracking continues across consecutive intervals, a source silent for a whole
+interval starts again
+******************************************************************************/
+static void summary_carry( Summary_Entry_t * entry )
+{
+    Summary_Entry_t const * previous;
+
+    previous = summary_lookup( summaryFlushed, entry->pan_id, entry->mode, entry->address, false );
+    if( previous == NULL )
+    {
+        return;
+    }
+    entry->sequence = previous->sequence;
+    entry->sequence_valid = previous->sequence_valid;
+    memcpy( entry->counters, previous->counters, sizeof(entry->counters) );
+    entry->counter_next = previous->counter_next;
+}
+
+/**************************************************************************//**
+\brief Track frame counter of a secured frame
+Frame counters only grow for a given key index, a MAC retry repeats both frame
+counter and sequence number, any other counter not above the highest one
+is a replay. A key index not tracked yet takes the slot of the oldest one.
+******************************************************************************/
+static void summary_frame_counter( Summary_Entry_t * entry, MAC_Frame_Unpacked_t const * frame )
+{
+    MAC_Security_Header_t const * security = &frame->auxiliary_security_header;
+    Summary_Counter_t * slot = NULL;
+    uint32_t counter = security->frame_counter;
+
+    entry->secured++;
+    if( security->frame_counter_suppressed ||
+        frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_NONE )
+    {
+        return;
+    }
+
+    for( uint8_t i = 0; i < SUMMARY_KEY_SLOTS; i++ )
+    {
+        if( entry->counters[i].valid && entry->counters[i].key_index == security->key_index )
+        {
+            slot = &entry->counters[i];
+            break;
+        }
+    }
+
+    if( slot == NULL )
+    {
+        slot = &entry->counters[entry->counter_next];
+        entry->counter_next = (entry->counter_next + 1) % SUMMARY_KEY_SLOTS;
+        slot->key_index = security->key_index;
+        slot->valid = true;
+    }
+    else if( counter > slot->frame_counter )
+    {
+        entry->counter_gaps += counter - slot->frame_counter - 1;
+    }
+    else if( counter != slot->frame_counter ||
+             frame->frame_control.sequence_number_suppressed ||
+             !entry->sequence_valid || frame->sequence_number != entry->sequence )
+    {
+        entry->replays++;
+        return;
+    }
+    slot->frame_counter = counter;
+}
+
+/**************************************************************************//**
+\brief End interval, counting continues in the other table
+******************************************************************************/
+static void summary_swap( void )
+{
+    Summary_Table_t * table = summaryFlushed;
+
+    summaryFlushed = summaryActive;
+    summaryActive = table;
+    memset( summaryActive, 0, sizeof(Summary_Table_t) );
+
+    summaryFlushing = true;
+    summaryHeaderPending = true;
+    summaryFlushIndex = 0;
+}
+
+/**************************************************************************//**
+\brief Send interval header on stats channel
+{"sum":"int","s":10,"n":17,"full":0,"bad":3}
+******************************************************************************/
+static bool summary_send_header( void )
+{
+    char record[SUMMARY_RECORD_SIZE];
+    int length;
+
+    length = snprintf( record, SUMMARY_RECORD_SIZE, "{\"sum\":\"int\",\"s\":%u,\"n\":%u,\"full\":%u,\"bad\":%u}\n\r",
+                       (unsigned int)summaryStats.period, (unsigned int)summaryFlushed->sources,
+                       (unsigned int)summaryFlushed->overflow, (unsigned int)summaryFlushed->unparsed );
+    if( length <= 0 || length >= SUMMARY_RECORD_SIZE )
+    {
+        return false;
+    }
+    return ( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS );
+}
+
+/**************************************************************************//**
+\brief Send a source record on stats channel
+{"sum":"src","pan":"0x1A62","a":"0x1234","n":120,"b":5400,"rssi":[-80,-72,-60],"lqi":200,"gap":2,"rep":1}
+Sources sending secured frames add ,"sec":118,"fcgap":3,"replay":0
+******************************************************************************/
+static bool summary_send_entry( Summary_Entry_t const * entry )
+{
+    char record[SUMMARY_RECORD_SIZE];
+    char address[20];
+    char security[64];
+    int length;
+
+    if( entry->mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        snprintf( address, sizeof(address), "0x%08X%08X", (unsigned int)(entry->address >> 32), (unsigned int)entry->address );
+    }
+    else if( entry->mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        snprintf( address, sizeof(address), "0x%04X", (unsigned int)entry->address );
+    }
+    else
+    {
+        address[0] = '\0';
+    }
+
+    security[0] = '\0';
+    if( entry->secured != 0 )
+    {
+        snprintf( security, sizeof(security), ",\"sec\":%u,\"fcgap\":%u,\"replay\":%u",
+                  (unsigned int)entry->secured, (unsigned int)entry->counter_gaps, (unsigned int)entry->replays );
+    }
+
+    length = snprintf( record, SUMMARY_RECORD_SIZE,
+                       "{\"sum\":\"src\",\"pan\":\"0x%04X\",\"a\":\"%s\",\"n\":%u,\"b\":%u,\"rssi\":[%d,%d,%d],\"lqi\":%u,\"gap\":%u,\"rep\":%u%s}\n\r",
+                       entry->pan_id, address, (unsigned int)entry->frames, (unsigned int)entry->bytes,
+                       entry->rssi_min, (int)(entry->rssi_total / (int32_t)entry->frames), entry->rssi_max,
+                       (unsigned int)(entry->lqi_total / entry->frames), (unsigned int)entry->gaps, (unsigned int)entry->repeats,
+                       security );
+    if( length <= 0 || length >= SUMMARY_RECORD_SIZE )
+    {
+        return false;
+    }
+    return ( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init summary capture, disabled
+******************************************************************************/
+void Summary_Init( void )
+{
+    memset( summaryTables, 0, sizeof(summaryTables) );
+    memset( &summaryStats, 0, sizeof(summaryStats) );
+    summaryPeriodUs = SUMMARY_DISABLED;
+    summaryFlushing = false;
+}
+
+/**************************************************************************//**
+\brief Enable or disable summary mode
+A new period starts a new interval, counters of current one are discarded
+******************************************************************************/
+void Summary_SetPeriod( uint32_t period_s )
+{
+    if( period_s > SUMMARY_PERIOD_MAX_S )
+    {
+        period_s = SUMMARY_PERIOD_MAX_S;
+    }
+    Scheduler_Cancel( SCHEDULER_TASK_SUMMARY );
+    memset( summaryTables, 0, sizeof(summaryTables) );
+    summaryFlushing = false;
+    summaryStats.period = period_s;
+    summaryPeriodUs = period_s * SUMMARY_US_PER_S;
+
+    if( period_s != SUMMARY_DISABLED )
+    {
+        summaryDeadline = HAL_Radio_GetTime() + summaryPeriodUs;
+        Scheduler_PostDelayed( SCHEDULER_TASK_SUMMARY, summaryPeriodUs );
+    }
+}
+
+/**************************************************************************//**
+\brief Offer a captured frame to summary
+Sequence numbers are only tracked for data and command frames, beacons use
+their own sequence and acknowledgments have no source address
+******************************************************************************/
+bool Summary_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    Summary_Entry_t * entry;
+    uint64_t address = 0;
+    uint16_t pan_id;
+    uint8_t delta;
+
+    if( summaryPeriodUs == SUMMARY_DISABLED )
+    {
+        return false;
+    }
+
+    if( frame == NULL )
+    {
+        summaryActive->unparsed++;
+        summaryStats.unparsed++;
+        return true;
+    }
+
+    if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        address = frame->source_addr.short_addr;
+    }
+    else if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        address = frame->source_addr.long_addr;
+    }
+
+    //MAC_Unpack fills an elided source PAN ID
+    pan_id = frame->source_pan_id;
+
+    entry = summary_lookup( summaryActive, pan_id, frame->frame_control.source_addressing_mode, address, true );
+    if( entry == NULL )
+    {
+        summaryActive->overflow++;
+        summaryStats.overflow++;
+        return true;
+    }
+
+    if( entry->frames == 0 )
+    {
+        summary_carry( entry );
+    }
+
+    entry->frames++;
+    entry->bytes += phy_rx->len;
+    entry->rssi_total += phy_rx->rssi;
+    entry->lqi_total += phy_rx->lqi;
+    if( phy_rx->rssi < entry->rssi_min )
+    {
+        entry->rssi_min = phy_rx->rssi;
+    }
+    if( phy_rx->rssi > entry->rssi_max )
+    {
+        entry->rssi_max = phy_rx->rssi;
+    }
+
+    //before sequence update, a retry is recognized by its sequence number
+    if( frame->frame_control.security_enabled )
+    {
+        summary_frame_counter( entry, frame );
+    }
+
+    if( !frame->frame_control.sequence_number_suppressed &&
+        ( frame->frame_control.frame_Type == MAC_FRAME_TYPE_DATA ||
+          frame->frame_control.frame_Type == MAC_FRAME_TYPE_COMMAND ) )
+    {
+        if( entry->sequence_valid )
+        {
+            delta = frame->sequence_number - entry->sequence;
+            if( delta == 0 )
+            {
+                entry->repeats++;
+            }
+            else
+            {
+                entry->gaps += delta - 1;
+            }
+        }
+        entry->sequence = frame->sequence_number;
+        entry->sequence_valid = true;
+    }
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive summary state and counters
+******************************************************************************/
+void Summary_GetStats( Summary_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = summaryStats;
+        stats->sources = summaryActive->sources;
+    }
+}
+
+/**************************************************************************//**
+\brief Summary task
+Interval ends on time even when previous one is still being sent, it is
+then extended until the host link caught up
+******************************************************************************/
+void Summary_Task( void )
+{
+    uint32_t now;
+    uint32_t wait;
+    uint8_t sent = 0;
+
+    if( summaryPeriodUs == SUMMARY_DISABLED )
+    {
+        return;
+    }
+
+    now = HAL_Radio_GetTime();
+    if( !summaryFlushing && (int32_t)(now - summaryDeadline) >= 0 )
+    {
+        summary_swap();
+        summaryDeadline += summaryPeriodUs;
+        if( (int32_t)(now - summaryDeadline) >= 0 )
+        {
+            //late by more than a period, restart from now
+            summaryDeadline = now + summaryPeriodUs;
+        }
+    }
+
+    while( summaryFlushing )
+    {
+        if( sent >= SUMMARY_RECORDS_PER_RUN )
+        {
+            Scheduler_Post( SCHEDULER_TASK_SUMMARY );
+            return;
+        }
+
+        if( Mux_GetFreeSpace( MUX_CHANNEL_STATS ) < SUMMARY_RECORD_SIZE )
+        {
+            wait = summaryDeadline - now;
+            Scheduler_PostDelayed( SCHEDULER_TASK_SUMMARY,
+                                   ( (int32_t)wait > 0 && wait < SUMMARY_FLUSH_POLL_US ) ? wait : SUMMARY_FLUSH_POLL_US );
+            return;
+        }
+
+        if( summaryHeaderPending )
+        {
+            summary_send_header();
+            summaryHeaderPending = false;
+            sent++;
+            continue;
+        }
+
+        while( summaryFlushIndex < SUMMARY_TABLE_SIZE && summaryFlushed->entries[summaryFlushIndex].frames == 0 )
+        {
+            summaryFlushIndex++;
+        }
+        if( summaryFlushIndex >= SUMMARY_TABLE_SIZE )
+        {
+            summaryFlushing = false;
+            summaryStats.intervals++;
+            break;
+        }
+        summary_send_entry( &summaryFlushed->entries[summaryFlushIndex++] );
+        summaryStats.records++;
+        sent++;
+    }
+
+    wait = summaryDeadline - now;
+    Scheduler_PostDelayed( SCHEDULER_TASK_SUMMARY, ( (int32_t)wait > 0 ) ? wait : 0 );
+}
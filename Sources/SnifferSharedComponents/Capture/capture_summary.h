@@ -0,0 +1,98 @@
+/****************************************************************************//**
+  \file capture_summary.h
+
+  \brief Statistics only capture, per source address counters
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_SUMMARY_H
+#define _CAPTURE_SUMMARY_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Sources tracked per interval, must be a power of 2
+//two tables are used, one counting while the other one is sent to host
+#define SUMMARY_TABLE_SIZE          64
+
+//Period value disabling summary mode
+#define SUMMARY_DISABLED            0
+
+//Longest period in seconds, the next swap must stay within half the 32 bits
+//radio time range in us
+#define SUMMARY_PERIOD_MAX_S        (INT32_MAX / 1000000)
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t period;                    //interval in seconds, SUMMARY_DISABLED when live capture
+    uint32_t sources;                   //sources counted in current interval
+    uint32_t intervals;                 //intervals sent to host
+    uint32_t records;                   //source records sent to host
+    uint32_t overflow;                  //frames not counted, table full
+    uint32_t unparsed;                  //frames not counted, MAC header not unpacked
+}Summary_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init summary capture, disabled
+******************************************************************************/
+void Summary_Init( void );
+
+/**************************************************************************//**
+\brief Enable summary mode, counters are sent every period_s seconds instead
+of frames, SUMMARY_DISABLED goes back to live capture, up to SUMMARY_PERIOD_MAX_S
+******************************************************************************/
+void Summary_SetPeriod( uint32_t period_s );
+
+/**************************************************************************//**
+\brief Offer a captured frame to summary
+returns true if frame is counted, false when disabled and frame goes to live capture,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+bool Summary_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive summary state and counters
+******************************************************************************/
+void Summary_GetStats( Summary_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Summary task
+Swaps tables every period and sends counters as host link allows
+******************************************************************************/
+void Summary_Task( void );
+
+#endif // _CAPTURE_SUMMARY_H
@@ -0,0 +1,236 @@
+/***************************************************************************//**
+ @file capture_sync.c
+  @brief   Device clock extension and host clock synchronization
+           Radio time wraps every 71 minutes, it is extended to 64 bits and
+           mapped to host wall clock with an offset and drift set by host
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_sync.h"
+#include "console_mux.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define SYNC_US_PER_S                   1000000
+#define SYNC_PPB_SCALE                  1000000000
+
+//Task period when anchors are disabled, well under the radio time wrap
+#define SYNC_KEEPALIVE_US               (600UL * SYNC_US_PER_S)
+
+//Longest anchor record
+#define SYNC_RECORD_SIZE                128
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void sync_send_anchor( void );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static uint32_t syncHigh;               //upper 32 bits of extended time
+static uint32_t syncLast;               //radio time of last read
+static uint64_t syncReference;          //extended time of wall clock reference
+static int64_t  syncWall;               //wall clock at reference
+static Sync_Stats_t syncStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Send an anchor record
+Host maps 32 bits capture timestamps T to extended time with clk and t,
+wall is only present once host set a correction
+Example:
+{"sync":"anchor","clk":4311744512,"t":16777216,"wall":1700000000123456,"ppb":-1520}
+******************************************************************************/
+static void sync_send_anchor( void )
+{
+    char record[SYNC_RECORD_SIZE];
+    uint64_t now = Sync_Now();
+    int64_t wall;
+    int length;
+
+    length = snprintf( record, SYNC_RECORD_SIZE, "{\"sync\":\"anchor\",\"clk\":%llu,\"t\":%u",
+                       (unsigned long long)now, (unsigned int)(uint32_t)now );
+    if( Sync_ToWall( now, &wall ) )
+    {
+        length += snprintf( &record[length], SYNC_RECORD_SIZE - length, ",\"wall\":%lld,\"ppb\":%d",
+                            (long long)wall, (int)syncStats.ppb );
+    }
+    length += snprintf( &record[length], SYNC_RECORD_SIZE - length, "}\n\r" );
+
+    if( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS )
+    {
+        syncStats.anchors++;
+    }
+    else
+    {
+        syncStats.dropped++;
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init clock extension, no correction, anchors disabled
+******************************************************************************/
+void Sync_Init( void )
+{
+    memset( &syncStats, 0, sizeof(syncStats) );
+    syncHigh = 0;
+    syncLast = HAL_Radio_GetTime();
+    Scheduler_PostPeriodic( SCHEDULER_TASK_SYNC, SYNC_KEEPALIVE_US );
+}
+
+/**************************************************************************//**
+\brief Return radio time extended to 64 bits, in us
+******************************************************************************/
+uint64_t Sync_Now( void )
+{
+    uint32_t now = HAL_Radio_GetTime();
+
+    if( now < syncLast )
+    {
+        syncHigh++;
+    }
+    syncLast = now;
+    return ( ((uint64_t)syncHigh << 32) | now );
+}
+
+/**************************************************************************//**
+\brief Extend a 32 bits radio time to 64 bits
+******************************************************************************/
+uint64_t Sync_Extend( uint32_t time )
+{
+    uint64_t now = Sync_Now();
+
+    return now + (int64_t)(int32_t)(time - (uint32_t)now);
+}
+
+/**************************************************************************//**
+\brief Set wall clock correction computed by host
+******************************************************************************/
+bool Sync_SetCorrection( uint64_t reference, int64_t wall, int32_t ppb )
+{
+    if( ppb > SYNC_PPB_MAX || ppb < -SYNC_PPB_MAX )
+    {
+        return false;
+    }
+
+    syncReference = reference;
+    syncWall = wall;
+    syncStats.ppb = ppb;
+    syncStats.corrected = true;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Remove wall clock correction
+******************************************************************************/
+void Sync_ClearCorrection( void )
+{
+    syncStats.ppb = 0;
+    syncStats.corrected = false;
+}
+
+/**************************************************************************//**
+\brief Convert an extended radio time to host wall clock
+Drift is applied in two steps so elapsed time times ppb never overflows
+******************************************************************************/
+bool Sync_ToWall( uint64_t time, int64_t * wall )
+{
+    int64_t elapsed = (int64_t)(time - syncReference);
+
+    if( !syncStats.corrected )
+    {
+        return false;
+    }
+
+    *wall = syncWall + elapsed
+          + (elapsed / SYNC_PPB_SCALE) * syncStats.ppb
+          + ((elapsed % SYNC_PPB_SCALE) * syncStats.ppb) / SYNC_PPB_SCALE;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Set period of anchor records sent on stats channel
+First anchor is sent right away
+******************************************************************************/
+bool Sync_SetAnchorPeriod( uint32_t period_s )
+{
+    if( period_s > SYNC_ANCHOR_PERIOD_MAX_S )
+    {
+        return false;
+    }
+
+    syncStats.period = period_s;
+    if( period_s == SYNC_ANCHOR_DISABLED )
+    {
+        Scheduler_PostPeriodic( SCHEDULER_TASK_SYNC, SYNC_KEEPALIVE_US );
+        return true;
+    }
+    Scheduler_PostPeriodic( SCHEDULER_TASK_SYNC, period_s * SYNC_US_PER_S );
+    Scheduler_Post( SCHEDULER_TASK_SYNC );
+    return true;
+}
+
+/**************************************************************************//**
+\brief Count a sync request answered
+******************************************************************************/
+void Sync_CountExchange( void )
+{
+    syncStats.exchanges++;
+}
+
+/**************************************************************************//**
+\brief Retreive synchronization statistics
+******************************************************************************/
+void Sync_GetStats( Sync_Stats_t * stats )
+{
+    *stats = syncStats;
+}
+
+/**************************************************************************//**
+\brief Sync task
+******************************************************************************/
+void Sync_Task( void )
+{
+    Sync_Now();
+
+    if( syncStats.period != SYNC_ANCHOR_DISABLED )
+    {
+        sync_send_anchor();
+    }
+}
@@ -0,0 +1,123 @@
+/****************************************************************************//**
+  \file capture_sync.h
+
+  \brief Device clock extension and host clock synchronization
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_SYNC_H
+#define _CAPTURE_SYNC_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Anchor period value disabling anchor records
+#define SYNC_ANCHOR_DISABLED            0
+
+//Longest anchor period, clock extension needs a read at least every 71 minutes
+#define SYNC_ANCHOR_PERIOD_MAX_S        3600
+
+//Largest drift correction accepted, in parts per billion
+#define SYNC_PPB_MAX                    1000000
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t exchanges;                 //sync requests answered
+    uint32_t anchors;                   //anchor records sent to host
+    uint32_t dropped;                   //anchor records lost, stats channel full
+    uint32_t period;                    //anchor period in seconds, SYNC_ANCHOR_DISABLED when off
+    int32_t  ppb;                       //drift correction in parts per billion
+    bool     corrected;                 //host set a wall clock correction
+}Sync_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init clock extension, no correction, anchors disabled
+******************************************************************************/
+void Sync_Init( void );
+
+/**************************************************************************//**
+\brief Return radio time extended to 64 bits, in us
+Task context only
+******************************************************************************/
+uint64_t Sync_Now( void );
+
+/**************************************************************************//**
+\brief Extend a 32 bits radio time to 64 bits
+Time must be within 35 minutes of now, before or after
+******************************************************************************/
+uint64_t Sync_Extend( uint32_t time );
+
+/**************************************************************************//**
+\brief Set wall clock correction computed by host
+    /param[in]     reference    extended radio time in us
+    /param[in]     wall         host wall clock in us at reference
+    /param[in]     ppb          device clock rate error, positive when
+                                device clock is slow
+******************************************************************************/
+bool Sync_SetCorrection( uint64_t reference, int64_t wall, int32_t ppb );
+
+/**************************************************************************//**
+\brief Remove wall clock correction
+******************************************************************************/
+void Sync_ClearCorrection( void );
+
+/**************************************************************************//**
+\brief Convert an extended radio time to host wall clock
+returns false when host did not set a correction
+******************************************************************************/
+bool Sync_ToWall( uint64_t time, int64_t * wall );
+
+/**************************************************************************//**
+\brief Set period of anchor records sent on stats channel
+******************************************************************************/
+bool Sync_SetAnchorPeriod( uint32_t period_s );
+
+/**************************************************************************//**
+\brief Count a sync request answered
+******************************************************************************/
+void Sync_CountExchange( void );
+
+/**************************************************************************//**
+\brief Retreive synchronization statistics
+******************************************************************************/
+void Sync_GetStats( Sync_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Sync task
+Keep clock extension alive and send anchor records
+******************************************************************************/
+void Sync_Task( void );
+
+#endif // _CAPTURE_SYNC_H
@@ -0,0 +1,228 @@
+/***************************************************************************//**
+ @file capture_trigger.c
+  @brief   Capture trigger expressions
+           Frames are matched against MAC header fields and payload bytes,
+           the MAC header is only unpacked when an expression needs it
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_trigger.h"
+#include "mac_unpack.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static bool trigger_needs_unpack( Trigger_Expression_t const * expression );
+static bool trigger_match_unpacked( Trigger_Expression_t const * expression, MAC_Frame_Unpacked_t const * frame );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Trigger_Expression_t triggerExpressions[TRIGGER_MAX_EXPRESSIONS];
+static Trigger_Stats_t triggerStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return true if expression compares more than frame type
+******************************************************************************/
+static bool trigger_needs_unpack( Trigger_Expression_t const * expression )
+{
+    if( (expression->pan_id != TRIGGER_ANY) ||
+        (expression->src_addr != TRIGGER_ANY) ||
+        (expression->dst_addr != TRIGGER_ANY) )
+    {
+        return true;
+    }
+    for( uint8_t i = 0; i < TRIGGER_MAX_BYTE_MATCHES; i++ )
+    {
+        if( expression->bytes[i].mask )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**************************************************************************//**
+\brief Match an expression against an unpacked frame
+******************************************************************************/
+static bool trigger_match_unpacked( Trigger_Expression_t const * expression, MAC_Frame_Unpacked_t const * frame )
+{
+    Trigger_Byte_Match_t const * byte;
+
+    if( (expression->pan_id != TRIGGER_ANY) &&
+        (frame->destination_pan_id != expression->pan_id) &&
+        (frame->source_pan_id != expression->pan_id) )
+    {
+        return false;
+    }
+
+    if( (expression->src_addr != TRIGGER_ANY) &&
+        ( (frame->frame_control.source_addressing_mode != MAC_ADDRESSING_MODE_SHORT_ADDRESS) ||
+          (frame->source_addr.short_addr != expression->src_addr) ) )
+    {
+        return false;
+    }
+
+    if( (expression->dst_addr != TRIGGER_ANY) &&
+        ( (frame->frame_control.destination_addressing_mode != MAC_ADDRESSING_MODE_SHORT_ADDRESS) ||
+          (frame->destination_addr.short_addr != expression->dst_addr) ) )
+    {
+        return false;
+    }
+
+    for( uint8_t i = 0; i < TRIGGER_MAX_BYTE_MATCHES; i++ )
+    {
+        byte = &expression->bytes[i];
+        if( byte->mask == 0 )
+        {
+            continue;
+        }
+        //offset is past IEs, if any
+        if( (byte->offset >= frame->payload_size - frame->ie_size) ||
+            ((frame->payload[frame->ie_size + byte->offset] & byte->mask) != (byte->value & byte->mask)) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init triggers, all expressions disabled
+******************************************************************************/
+void Trigger_Init( void )
+{
+    memset( triggerExpressions, 0, sizeof(triggerExpressions) );
+    memset( &triggerStats, 0, sizeof(triggerStats) );
+}
+
+/**************************************************************************//**
+\brief Set or disable an expression
+******************************************************************************/
+Trigger_Result_t Trigger_Set( uint8_t index, Trigger_Expression_t const * expression )
+{
+    if( index >= TRIGGER_MAX_EXPRESSIONS || expression == NULL )
+    {
+        return TRIGGER_INVALID_PARAMETER;
+    }
+    triggerExpressions[index] = *expression;
+    return TRIGGER_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Retreive an expression
+******************************************************************************/
+Trigger_Result_t Trigger_Get( uint8_t index, Trigger_Expression_t * expression )
+{
+    if( index >= TRIGGER_MAX_EXPRESSIONS || expression == NULL )
+    {
+        return TRIGGER_INVALID_PARAMETER;
+    }
+    *expression = triggerExpressions[index];
+    return TRIGGER_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Return true if at least one expression is enabled
+******************************************************************************/
+bool Trigger_IsEnabled( void )
+{
+    for( uint8_t i = 0; i < TRIGGER_MAX_EXPRESSIONS; i++ )
+    {
+        if( triggerExpressions[i].enabled )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**************************************************************************//**
+\brief Return true if frame matches an enabled expression
+frame is NULL when the MAC layer can't unpack it, only frame type
+expressions can match it then
+******************************************************************************/
+bool Trigger_Match( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    Trigger_Expression_t const * expression;
+    uint8_t frame_type;
+
+    if( phy_rx->len < MHR_FRAME_CONTROL_SIZE )
+    {
+        return false;
+    }
+    triggerStats.evaluated++;
+
+    //Frame type is the first 3 bits, no need to unpack
+    frame_type = (phy_rx->payload[0] & MHR_FRAMECONTROL_FRAME_TYPE_MSK) >> MHR_FRAMECONTROL_FRAME_TYPE_SHFT;
+
+    for( uint8_t i = 0; i < TRIGGER_MAX_EXPRESSIONS; i++ )
+    {
+        expression = &triggerExpressions[i];
+        if( !expression->enabled || (expression->type_mask & (1 << frame_type)) == 0 )
+        {
+            continue;
+        }
+
+        if( trigger_needs_unpack( expression ) &&
+            ( frame == NULL || !trigger_match_unpacked( expression, frame ) ) )
+        {
+            continue;
+        }
+
+        triggerStats.hits[i]++;
+        return true;
+    }
+    return false;
+}
+
+/**************************************************************************//**
+\brief Retreive trigger statistics
+******************************************************************************/
+void Trigger_GetStats( Trigger_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = triggerStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Clear trigger statistics
+******************************************************************************/
+void Trigger_ClearStats( void )
+{
+    memset( &triggerStats, 0, sizeof(triggerStats) );
+}
@@ -0,0 +1,123 @@
+/****************************************************************************//**
+  \file capture_trigger.h
+
+  \brief Capture trigger expressions
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_TRIGGER_H
+#define _CAPTURE_TRIGGER_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//A frame triggers when it matches any enabled expression
+#define TRIGGER_MAX_EXPRESSIONS     4
+
+//Byte comparisons of an expression, on MAC payload
+#define TRIGGER_MAX_BYTE_MATCHES    2
+
+//Field disabled value for PAN ID and short address comparisons
+#define TRIGGER_ANY                 0xFFFFFFFF
+
+//Frame type mask, bit n set to accept MAC frame type n
+#define TRIGGER_TYPE_ALL            0xFF
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+//MAC payload byte at offset, once masked, must equal value
+//a mask of 0 disables the comparison
+typedef struct {
+    uint8_t offset;
+    uint8_t value;
+    uint8_t mask;
+}Trigger_Byte_Match_t;
+
+//Every enabled field must match
+//Examples, on MAC command frames (type_mask 0x08), payload byte 0 is the
+//command identifier: 0x01 association request, 0x05 PAN ID conflict notification
+typedef struct {
+    bool     enabled;
+    uint8_t  type_mask;                 //accepted MAC frame types
+    uint32_t pan_id;                    //destination or source PAN ID, TRIGGER_ANY to disable
+    uint32_t src_addr;                  //source short address, TRIGGER_ANY to disable
+    uint32_t dst_addr;                  //destination short address, TRIGGER_ANY to disable
+    Trigger_Byte_Match_t bytes[TRIGGER_MAX_BYTE_MATCHES];
+}Trigger_Expression_t;
+
+typedef enum {
+    TRIGGER_SUCCESS,
+    TRIGGER_INVALID_PARAMETER,
+}Trigger_Result_t;
+
+typedef struct {
+    uint32_t evaluated;                 //frames evaluated
+    uint32_t hits[TRIGGER_MAX_EXPRESSIONS];
+}Trigger_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init triggers, all expressions disabled
+******************************************************************************/
+void Trigger_Init( void );
+
+/**************************************************************************//**
+\brief Set or disable (enabled false) an expression
+******************************************************************************/
+Trigger_Result_t Trigger_Set( uint8_t index, Trigger_Expression_t const * expression );
+
+/**************************************************************************//**
+\brief Retreive an expression
+******************************************************************************/
+Trigger_Result_t Trigger_Get( uint8_t index, Trigger_Expression_t * expression );
+
+/**************************************************************************//**
+\brief Return true if at least one expression is enabled
+******************************************************************************/
+bool Trigger_IsEnabled( void );
+
+/**************************************************************************//**
+\brief Return true if frame matches an enabled expression
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+bool Trigger_Match( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive and clear trigger statistics
+******************************************************************************/
+void Trigger_GetStats( Trigger_Stats_t * stats );
+void Trigger_ClearStats( void );
+
+#endif // _CAPTURE_TRIGGER_H
@@ -0,0 +1,471 @@
+/***************************************************************************//**
+ @file capture_tsch.c
+  @brief   Follow a TSCH network channel schedule
+           Enhanced beacons give the ASN, timeslot template and hopping sequence,
+           the radio is retuned at each timeslot start to the channel of the
+           followed channel offset
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_tsch.h"
+#include "capture.h"
+#include "console_mux.h"
+#include "mac.h"
+#include "mac_unpack.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define TSCH_US_PER_MS                  1000
+#define TSCH_US_PER_S                   1000000UL
+
+//Frame air time, preamble, SFD and PHR then PSDU at 32 us per byte
+#define TSCH_US_PER_BYTE                32
+#define TSCH_PHY_HEADER_SIZE            6
+
+//Radio is retuned this early, channel change and task latency
+#define TSCH_SWITCH_US                  200
+
+//Frames starting this close to their timeslot offset are in sync, half
+//of the default receive wait
+#define TSCH_GUARD_US                   1100
+
+//Template and sequence ID of the defaults
+#define TSCH_DEFAULT_ID                 0
+
+//Longest record
+#define TSCH_RECORD_SIZE                160
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+//Schedule carried by an enhanced beacon
+typedef struct {
+    uint64_t asn;
+    uint32_t timeslot_us;
+    uint32_t tx_offset_us;
+    uint8_t  sequence[TSCH_SEQUENCE_MAX];
+    uint8_t  sequence_length;
+    bool     sync;                      //TSCH synchronization IE found
+}Tsch_Beacon_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void tsch_parse_sub_ie( Tsch_Beacon_t * beacon, MAC_IE_t const * ie );
+static bool tsch_parse_beacon( Tsch_Beacon_t * beacon, MAC_Frame_Unpacked_t const * frame );
+static uint8_t tsch_channel( uint64_t asn );
+static void tsch_send_record( char const * record, int length );
+static void tsch_sync( Tsch_Beacon_t const * beacon, uint16_t pan_id, uint32_t slot_start, uint32_t now );
+static void tsch_lose( uint32_t now );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+//Default hopping sequence of 16 channels, sequence ID 0
+static const uint8_t TschDefaultSequence[TSCH_SEQUENCE_MAX] =
+{
+    16, 17, 23, 18, 26, 15, 25, 22, 19, 11, 12, 13, 24, 14, 20, 21
+};
+
+static uint8_t tschSequence[TSCH_SEQUENCE_MAX];
+static uint64_t tschAnchorAsn;          //ASN of anchor timeslot
+static uint32_t tschAnchorTime;         //radio time anchor timeslot started
+static uint32_t tschLastHeard;          //radio time of last frame in sync
+static uint32_t tschLostTime;           //radio time sync was lost
+static bool tschLost;                   //sync lost since start
+static Tsch_Stats_t tschStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Parse a MLME sub-IE, keeps TSCH synchronization, timeslot and
+channel hopping ones
+Templates and sequences given by ID only are the defaults when ID is 0,
+others are unknown and leave beacon unchanged
+******************************************************************************/
+static void tsch_parse_sub_ie( Tsch_Beacon_t * beacon, MAC_IE_t const * ie )
+{
+    MAC_IE_Timeslot_t timeslot;
+    MAC_IE_Channel_Hopping_t hopping;
+
+    if( MAC_IE_GetAsn( ie, &beacon->asn ) )
+    {
+        beacon->sync = true;
+    }
+    else if( MAC_IE_GetTimeslot( ie, &timeslot ) )
+    {
+        if( timeslot.timeslot_us )
+        {
+            beacon->timeslot_us = timeslot.timeslot_us;
+            beacon->tx_offset_us = timeslot.tx_offset_us;
+        }
+        else if( timeslot.template_id == TSCH_DEFAULT_ID )
+        {
+            beacon->timeslot_us = TSCH_TIMESLOT_DEFAULT_US;
+            beacon->tx_offset_us = TSCH_TX_OFFSET_DEFAULT_US;
+        }
+    }
+    else if( MAC_IE_GetChannelHopping( ie, &hopping ) )
+    {
+        if( hopping.count == 0 && hopping.sequence_id == TSCH_DEFAULT_ID )
+        {
+            memcpy( beacon->sequence, TschDefaultSequence, TSCH_SEQUENCE_MAX );
+            beacon->sequence_length = TSCH_SEQUENCE_MAX;
+        }
+        if( hopping.count == 0 || hopping.count > TSCH_SEQUENCE_MAX )
+        {
+            return;
+        }
+        for( uint8_t i = 0; i < hopping.count; i++ )
+        {
+            //channels are 2 octets, page 0 ones fit in first
+            beacon->sequence[i] = hopping.list[i * MAC_IE_CHANNEL_HOPPING_ENTRY_SIZE];
+            if( beacon->sequence[i] < PHY_CHANNEL_11 || beacon->sequence[i] > PHY_CHANNEL_26 )
+            {
+                beacon->sequence_length = 0;
+                return;
+            }
+        }
+        beacon->sequence_length = hopping.count;
+    }
+}
+
+/**************************************************************************//**
+\brief Parse payload IEs of an enhanced beacon
+Schedule not carried by the beacon is the current one, returns false
+without TSCH synchronization IE
+******************************************************************************/
+static bool tsch_parse_beacon( Tsch_Beacon_t * beacon, MAC_Frame_Unpacked_t const * frame )
+{
+    MAC_IE_Iterator_t iterator;
+    MAC_IE_Iterator_t nested;
+    MAC_IE_t ie;
+    MAC_IE_t sub_ie;
+
+    beacon->sync = false;
+    beacon->timeslot_us = tschStats.timeslot_us;
+    beacon->tx_offset_us = tschStats.tx_offset_us;
+    memcpy( beacon->sequence, tschSequence, TSCH_SEQUENCE_MAX );
+    beacon->sequence_length = tschStats.sequence_length;
+
+    MAC_IE_IteratorInitFrame( &iterator, frame );
+    while( MAC_IE_Next( &iterator, &ie ) )
+    {
+        //nested iterator skips other groups
+        MAC_IE_IteratorInitNested( &nested, &ie );
+        while( MAC_IE_Next( &nested, &sub_ie ) )
+        {
+            tsch_parse_sub_ie( beacon, &sub_ie );
+        }
+    }
+
+    return beacon->sync && beacon->sequence_length && beacon->timeslot_us > beacon->tx_offset_us;
+}
+
+/**************************************************************************//**
+\brief Channel of a timeslot on followed channel offset
+******************************************************************************/
+static uint8_t tsch_channel( uint64_t asn )
+{
+    return tschSequence[(asn + tschStats.channel_offset) % tschStats.sequence_length];
+}
+
+/**************************************************************************//**
+\brief Send a record on stats channel
+******************************************************************************/
+static void tsch_send_record( char const * record, int length )
+{
+    if( Mux_Write( MUX_CHANNEL_STATS, (uint8_t const *)record, length ) == MUX_WRITE_SUCCESS )
+    {
+        tschStats.records++;
+    }
+    else
+    {
+        tschStats.dropped++;
+    }
+}
+
+/**************************************************************************//**
+\brief Anchor schedule on an enhanced beacon
+A record is sent when sync is acquired, resync is the time since last
+loss in ms
+{"tsch":"sync","pan":"0x1A62","asn":1234567,"ch":20,"ts":10000,"tx":2120,"seq":16,"resync":4210}
+******************************************************************************/
+static void tsch_sync( Tsch_Beacon_t const * beacon, uint16_t pan_id, uint32_t slot_start, uint32_t now )
+{
+    char record[TSCH_RECORD_SIZE];
+    int length;
+
+    tschAnchorAsn = beacon->asn;
+    tschAnchorTime = slot_start;
+    tschLastHeard = now;
+    tschStats.timeslot_us = beacon->timeslot_us;
+    tschStats.tx_offset_us = beacon->tx_offset_us;
+    memcpy( tschSequence, beacon->sequence, TSCH_SEQUENCE_MAX );
+    tschStats.sequence_length = beacon->sequence_length;
+
+    if( tschStats.state == TSCH_STATE_FOLLOW )
+    {
+        return;
+    }
+
+    tschStats.state = TSCH_STATE_FOLLOW;
+    tschStats.pan_id = pan_id;
+    tschStats.asn = beacon->asn;
+    tschStats.syncs++;
+
+    length = snprintf( record, TSCH_RECORD_SIZE, "{\"tsch\":\"sync\",\"pan\":\"0x%04X\",\"asn\":%llu,\"ch\":%u,\"ts\":%u,\"tx\":%u,\"seq\":%u",
+                       pan_id, (unsigned long long)beacon->asn, HAL_GetRadioChannel(), (unsigned int)beacon->timeslot_us,
+                       (unsigned int)beacon->tx_offset_us, beacon->sequence_length );
+    if( tschLost )
+    {
+        tschStats.resync_ms = (now - tschLostTime) / TSCH_US_PER_MS;
+        length += snprintf( &record[length], TSCH_RECORD_SIZE - length, ",\"resync\":%u", (unsigned int)tschStats.resync_ms );
+    }
+    length += snprintf( &record[length], TSCH_RECORD_SIZE - length, "}\n\r" );
+    tsch_send_record( record, length );
+
+    Scheduler_Post( SCHEDULER_TASK_TSCH );
+}
+
+/**************************************************************************//**
+\brief Declare sync lost, back to search channel
+ms is the time since last frame in sync
+{"tsch":"lost","asn":1239999,"ms":30004}
+******************************************************************************/
+static void tsch_lose( uint32_t now )
+{
+    char record[TSCH_RECORD_SIZE];
+    int length;
+
+    tschStats.state = TSCH_STATE_SEARCH;
+    tschStats.losses++;
+    tschLost = true;
+    tschLostTime = now;
+    HAL_SetRadioChannel( tschStats.search_channel );
+
+    length = snprintf( record, TSCH_RECORD_SIZE, "{\"tsch\":\"lost\",\"asn\":%llu,\"ms\":%u}\n\r",
+                       (unsigned long long)tschStats.asn, (unsigned int)((now - tschLastHeard) / TSCH_US_PER_MS) );
+    tsch_send_record( record, length );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init TSCH follow, stopped
+******************************************************************************/
+void Tsch_Init( void )
+{
+    memset( &tschStats, 0, sizeof(tschStats) );
+    tschStats.pan_id = TSCH_PAN_ANY;
+    tschStats.timeout = TSCH_TIMEOUT_DEFAULT_S;
+}
+
+/**************************************************************************//**
+\brief Start TSCH follow, current channel becomes search channel and
+hopping stops
+Schedule starts as the default one, enhanced beacons replace it
+******************************************************************************/
+bool Tsch_Start( uint16_t pan_id, uint8_t channel_offset, uint16_t timeout_s )
+{
+    uint8_t channel = Capture_GetChannel();
+
+    if( channel_offset >= TSCH_SEQUENCE_MAX || timeout_s == 0 || timeout_s > TSCH_TIMEOUT_MAX_S )
+    {
+        return false;
+    }
+
+    //stops hopping, visits and any previous follow
+    Capture_SetChannel( channel );
+
+    memset( &tschStats, 0, sizeof(tschStats) );
+    memcpy( tschSequence, TschDefaultSequence, TSCH_SEQUENCE_MAX );
+    tschStats.sequence_length = TSCH_SEQUENCE_MAX;
+    tschStats.timeslot_us = TSCH_TIMESLOT_DEFAULT_US;
+    tschStats.tx_offset_us = TSCH_TX_OFFSET_DEFAULT_US;
+    tschStats.pan_id = pan_id;
+    tschStats.search_channel = channel;
+    tschStats.channel_offset = channel_offset;
+    tschStats.timeout = timeout_s;
+    tschStats.state = TSCH_STATE_SEARCH;
+    tschLost = false;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Stop TSCH follow and return to search channel
+******************************************************************************/
+void Tsch_Stop( void )
+{
+    if( tschStats.state == TSCH_STATE_IDLE )
+    {
+        return;
+    }
+
+    Scheduler_Cancel( SCHEDULER_TASK_TSCH );
+    HAL_SetRadioChannel( tschStats.search_channel );
+    tschStats.state = TSCH_STATE_IDLE;
+}
+
+/**************************************************************************//**
+\brief Offer a received frame to TSCH follow
+Only enhanced beacons are parsed, other frames are timed against the
+schedule: starting at their timeslot offset on the expected channel they
+keep sync and correct drift
+******************************************************************************/
+void Tsch_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    Tsch_Beacon_t beacon;
+    uint32_t start;
+    uint32_t elapsed;
+    uint32_t slots;
+    int32_t error;
+    uint16_t pan_id;
+
+    if( tschStats.state == TSCH_STATE_IDLE || phy_rx->len < MHR_FRAME_CONTROL_SIZE )
+    {
+        return;
+    }
+
+    start = phy_rx->timestamp - ((uint32_t)(phy_rx->len + TSCH_PHY_HEADER_SIZE) * TSCH_US_PER_BYTE);
+
+    if( (phy_rx->payload[0] & MHR_FRAMECONTROL_FRAME_TYPE_MSK) == MHR_FRAMECONTROL_FRAME_TYPE_BEACON &&
+        (phy_rx->payload[1] & (MHR_FRAMECONTROL_IE_PRESENT >> 8)) )
+    {
+        if( frame == NULL || !tsch_parse_beacon( &beacon, frame ) )
+        {
+            return;
+        }
+
+        //MAC_Unpack fills an elided source PAN ID
+        pan_id = frame->source_pan_id;
+        if( tschStats.pan_id != TSCH_PAN_ANY && pan_id != tschStats.pan_id )
+        {
+            return;
+        }
+
+        tschStats.beacons++;
+        tsch_sync( &beacon, pan_id, start - beacon.tx_offset_us, phy_rx->timestamp );
+        return;
+    }
+
+    if( tschStats.state != TSCH_STATE_FOLLOW || (int32_t)(start - tschAnchorTime) < 0 )
+    {
+        return;
+    }
+
+    elapsed = start - tschAnchorTime;
+    slots = elapsed / tschStats.timeslot_us;
+    error = (int32_t)(elapsed - slots * tschStats.timeslot_us - tschStats.tx_offset_us);
+    if( error > TSCH_GUARD_US || error < -TSCH_GUARD_US ||
+        phy_rx->channel != tsch_channel( tschAnchorAsn + slots ) )
+    {
+        return;
+    }
+
+    //frame timeslot becomes anchor, half of the error is taken as drift
+    tschStats.in_slot++;
+    tschLastHeard = phy_rx->timestamp;
+    tschAnchorAsn += slots;
+    tschAnchorTime += slots * tschStats.timeslot_us + error / 2;
+}
+
+/**************************************************************************//**
+\brief Retreive TSCH follow state and counters
+******************************************************************************/
+void Tsch_GetStats( Tsch_Stats_t * stats )
+{
+    *stats = tschStats;
+}
+
+/**************************************************************************//**
+\brief Retreive hopping sequence, returns its length
+******************************************************************************/
+uint8_t Tsch_GetSequence( uint8_t * channels )
+{
+    memcpy( channels, tschSequence, tschStats.sequence_length );
+    return tschStats.sequence_length;
+}
+
+/**************************************************************************//**
+\brief TSCH task
+Runs just before each timeslot, timeslots are computed from the anchor so
+a late run does not shift the schedule. A frame still waiting for
+reception keeps the channel it was received on.
+******************************************************************************/
+void Tsch_Task( void )
+{
+    uint32_t now = HAL_Radio_GetTime();
+    uint32_t elapsed;
+    uint32_t slots;
+    uint32_t position;
+
+    if( tschStats.state != TSCH_STATE_FOLLOW )
+    {
+        return;
+    }
+
+    if( now - tschLastHeard > (uint32_t)tschStats.timeout * TSCH_US_PER_S )
+    {
+        tsch_lose( now );
+        return;
+    }
+
+    if( HAL_Radio_RxPending() )
+    {
+        Scheduler_Post( SCHEDULER_TASK_TSCH );
+        return;
+    }
+
+    elapsed = now - tschAnchorTime;
+    slots = elapsed / tschStats.timeslot_us;
+    position = elapsed - slots * tschStats.timeslot_us;
+    if( tschStats.timeslot_us - position <= TSCH_SWITCH_US + TSCH_GUARD_US )
+    {
+        //early for next timeslot, drift correction may have moved it since
+        //this run was scheduled
+        slots++;
+    }
+    else if( position > tschStats.tx_offset_us )
+    {
+        tschStats.late++;
+    }
+
+    tschStats.asn = tschAnchorAsn + slots;
+    tschStats.slots++;
+    HAL_SetRadioChannel( tsch_channel( tschStats.asn ) );
+
+    Scheduler_PostDelayed( SCHEDULER_TASK_TSCH, tschAnchorTime + (slots + 1) * tschStats.timeslot_us - TSCH_SWITCH_US - now );
+}
@@ -0,0 +1,132 @@
+/****************************************************************************//**
+  \file capture_tsch.h
+
+  \brief Follow a TSCH network channel schedule
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_TSCH_H
+#define _CAPTURE_TSCH_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//PAN value following the first network heard
+#define TSCH_PAN_ANY                0xFFFF
+
+//Hopping sequence entries kept, one per 2.4 GHz channel
+#define TSCH_SEQUENCE_MAX           16
+
+//Default timeslot template, 802.15.4-2015 table 8-99
+#define TSCH_TIMESLOT_DEFAULT_US    10000
+#define TSCH_TX_OFFSET_DEFAULT_US   2120
+
+//Time without a frame in its timeslot before sync is declared lost
+#define TSCH_TIMEOUT_DEFAULT_S      30
+#define TSCH_TIMEOUT_MAX_S          3600
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    TSCH_STATE_IDLE,
+    TSCH_STATE_SEARCH,                  //parked on search channel, waiting for an enhanced beacon
+    TSCH_STATE_FOLLOW,                  //channel follows the network schedule each timeslot
+}Tsch_State_t;
+
+typedef struct {
+    Tsch_State_t state;
+    uint16_t pan_id;                    //followed PAN, TSCH_PAN_ANY until first beacon
+    uint8_t  search_channel;            //channel waiting for enhanced beacons
+    uint8_t  channel_offset;            //followed channel offset, 0 is the minimal cell
+    uint8_t  sequence_length;
+    uint16_t timeout;                   //sync loss timeout in s
+    uint32_t timeslot_us;
+    uint32_t tx_offset_us;              //frame start in timeslot
+    uint64_t asn;                       //absolute slot number of last timeslot followed
+    uint32_t beacons;                   //enhanced beacons with TSCH synchronization
+    uint32_t syncs;                     //sync acquired
+    uint32_t losses;                    //sync lost
+    uint32_t resync_ms;                 //time from last loss to next sync
+    uint32_t slots;                     //timeslots followed
+    uint32_t late;                      //timeslots retuned after their frame start
+    uint32_t in_slot;                   //frames received at their timeslot offset
+    uint32_t records;                   //records sent to host
+    uint32_t dropped;                   //records lost, stats channel full
+}Tsch_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init TSCH follow, stopped
+******************************************************************************/
+void Tsch_Init( void );
+
+/**************************************************************************//**
+\brief Start TSCH follow, current channel becomes search channel and
+hopping stops
+    /param[in]     pan_id           PAN to follow, TSCH_PAN_ANY for first heard
+    /param[in]     channel_offset   channel offset followed
+    /param[in]     timeout_s        sync loss timeout
+******************************************************************************/
+bool Tsch_Start( uint16_t pan_id, uint8_t channel_offset, uint16_t timeout_s );
+
+/**************************************************************************//**
+\brief Stop TSCH follow and return to search channel
+******************************************************************************/
+void Tsch_Stop( void );
+
+/**************************************************************************//**
+\brief Offer a received frame to TSCH follow
+Frame is never consumed, it continues to capture,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+void Tsch_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive TSCH follow state and counters
+******************************************************************************/
+void Tsch_GetStats( Tsch_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Retreive hopping sequence, returns its length
+******************************************************************************/
+uint8_t Tsch_GetSequence( uint8_t * channels );
+
+/**************************************************************************//**
+\brief TSCH task
+Retunes radio at each timeslot start, declares sync loss
+******************************************************************************/
+void Tsch_Task( void );
+
+#endif // _CAPTURE_TSCH_H
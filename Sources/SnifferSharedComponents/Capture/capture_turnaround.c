@@ -0,0 +1,527 @@
+/***************************************************************************//**
+ @file capture_turnaround.c
+  @brief   Acknowledgment turnaround and retry timing metrics
+           Frames requesting an acknowledgment are matched to the immediate
+           acknowledgment following them, per source counters are sent periodically
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_turnaround.h"
+#include "console_mux.h"
+#include "mac_unpack.h"
+#include "scheduler.h"
+#include "printf.h"
+#include "Hal.h"
+#include "string.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define TURNAROUND_TABLE_MASK           (TURNAROUND_TABLE_SIZE - 1)
+#define TURNAROUND_US_PER_S             1000000
+
+//Largest record, extended address source
+#define TURNAROUND_RECORD_SIZE          192
+
+//Records sent per task run, keeps other tasks responsive while flushing
+#define TURNAROUND_RECORDS_PER_RUN      8
+
+//Retry delay when stats channel queue is full
+#define TURNAROUND_FLUSH_POLL_US        5000
+
+//Fibonacci hashing multiplier
+#define TURNAROUND_HASH_MULTIPLIER      0x9E3779B1
+
+//Immediate acknowledgment: frame control | sequence number | FCS
+#define TURNAROUND_ACK_SIZE             (MHR_FRAME_CONTROL_SIZE + 1 + MAC_FCS_SIZE)
+
+//Acknowledgment air time, preamble, SFD and PHR then PSDU at 32 us per byte
+#define TURNAROUND_US_PER_BYTE          32
+#define TURNAROUND_ACK_AIR_TIME_US      ((6 + TURNAROUND_ACK_SIZE) * TURNAROUND_US_PER_BYTE)
+
+//Timestamps are end of frame, an acknowledgment ends at most macAckWaitDuration
+//(54 symbols) plus its own air time after the end of the request
+#define TURNAROUND_ACK_WAIT_US          (54 * 16)
+#define TURNAROUND_WINDOW_US            (TURNAROUND_ACK_WAIT_US + TURNAROUND_ACK_AIR_TIME_US)
+
+#if (TURNAROUND_TABLE_SIZE & TURNAROUND_TABLE_MASK) != 0
+#error "TURNAROUND_TABLE_SIZE must be a power of 2"
+#endif
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+//Timing of a source, slot is free while requests is 0, times are in us
+typedef struct {
+    uint64_t address;                   //short or extended source address
+    uint32_t requests;                  //frames requesting an acknowledgment
+    uint32_t acked;
+    uint32_t missing;
+    uint32_t turn_total;                //divide by acked for mean
+    uint32_t retries;                   //requests repeating previous sequence number
+    uint32_t retry_total;               //divide by retries for mean
+    uint32_t retry_min;
+    uint32_t retry_max;
+    uint32_t last_time;                 //end of last request
+    uint16_t turn_min;
+    uint16_t turn_max;
+    uint16_t pan_id;
+    uint8_t  mode;                      //source addressing mode, MAC_Addressing_Mode_t
+    uint8_t  sequence;                  //sequence number of last request
+}Turnaround_Entry_t;
+
+typedef struct {
+    Turnaround_Entry_t entries[TURNAROUND_TABLE_SIZE];
+    uint32_t sources;
+    uint32_t overflow;
+    uint32_t unparsed;
+}Turnaround_Table_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static Turnaround_Entry_t * turnaround_lookup( Turnaround_Table_t * table, uint16_t pan_id, uint8_t mode, uint64_t address );
+static void turnaround_request( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+static void turnaround_resolve( uint32_t elapsed, bool acked );
+static void turnaround_swap( uint32_t now );
+static bool turnaround_send_header( void );
+static bool turnaround_send_entry( Turnaround_Entry_t const * entry );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Turnaround_Table_t turnaroundTables[2];
+static Turnaround_Table_t * turnaroundActive = &turnaroundTables[0];     //counting
+static Turnaround_Table_t * turnaroundFlushed = &turnaroundTables[1];    //being sent
+static uint32_t turnaroundPeriodUs = TURNAROUND_DISABLED;
+static uint32_t turnaroundDeadline;     //radio time of next swap
+static bool turnaroundFlushing;
+static bool turnaroundHeaderPending;
+static uint16_t turnaroundFlushIndex;
+static Turnaround_Stats_t turnaroundStats;
+
+//Last request waiting for its acknowledgment, NULL when none
+static Turnaround_Entry_t * turnaroundPending;
+static uint32_t turnaroundPendingTime;
+static uint8_t turnaroundPendingSequence;
+static uint8_t turnaroundPendingChannel;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return entry of a source, allocated on first request
+returns NULL when table is full
+Linear probing, entries are never removed, only the whole table is cleared
+******************************************************************************/
+static Turnaround_Entry_t * turnaround_lookup( Turnaround_Table_t * table, uint16_t pan_id, uint8_t mode, uint64_t address )
+{
+    Turnaround_Entry_t * entry;
+    uint32_t hash;
+    uint16_t index;
+
+    hash = (uint32_t)address ^ (uint32_t)(address >> 32) ^ ((uint32_t)pan_id << 16) ^ mode;
+    hash *= TURNAROUND_HASH_MULTIPLIER;
+    index = hash >> 16;
+
+    for( uint16_t probe = 0; probe < TURNAROUND_TABLE_SIZE; probe++ )
+    {
+        entry = &table->entries[(index + probe) & TURNAROUND_TABLE_MASK];
+        if( entry->requests == 0 )
+        {
+            entry->address = address;
+            entry->pan_id = pan_id;
+            entry->mode = mode;
+            entry->turn_min = UINT16_MAX;
+            entry->retry_min = UINT32_MAX;
+            table->sources++;
+            return entry;
+        }
+        if( entry->address == address && entry->pan_id == pan_id && entry->mode == mode )
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+\brief Count a request and wait for its acknowledgment
+A request repeating the previous sequence number of its source is a retry
+******************************************************************************/
+static void turnaround_request( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    Turnaround_Entry_t * entry;
+    uint64_t address = 0;
+    uint32_t interval;
+    uint16_t pan_id;
+
+    if( frame == NULL )
+    {
+        turnaroundActive->unparsed++;
+        turnaroundStats.unparsed++;
+        return;
+    }
+
+    if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        address = frame->source_addr.short_addr;
+    }
+    else if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        address = frame->source_addr.long_addr;
+    }
+
+    //MAC_Unpack fills an elided source PAN ID
+    pan_id = frame->source_pan_id;
+
+    entry = turnaround_lookup( turnaroundActive, pan_id, frame->frame_control.source_addressing_mode, address );
+    if( entry == NULL )
+    {
+        turnaroundActive->overflow++;
+        turnaroundStats.overflow++;
+        return;
+    }
+
+    if( entry->requests && entry->sequence == frame->sequence_number )
+    {
+        interval = phy_rx->timestamp - entry->last_time;
+        entry->retries++;
+        entry->retry_total += interval;
+        if( interval < entry->retry_min )
+        {
+            entry->retry_min = interval;
+        }
+        if( interval > entry->retry_max )
+        {
+            entry->retry_max = interval;
+        }
+    }
+    entry->requests++;
+    entry->sequence = frame->sequence_number;
+    entry->last_time = phy_rx->timestamp;
+
+    turnaroundPending = entry;
+    turnaroundPendingTime = phy_rx->timestamp;
+    turnaroundPendingSequence = frame->sequence_number;
+    turnaroundPendingChannel = phy_rx->channel;
+}
+
+/**************************************************************************//**
+\brief Account pending request as acknowledged or missing
+    /param[in]     elapsed      end of request to end of acknowledgment in us
+******************************************************************************/
+static void turnaround_resolve( uint32_t elapsed, bool acked )
+{
+    Turnaround_Entry_t * entry = turnaroundPending;
+    uint16_t turn;
+
+    turnaroundPending = NULL;
+    if( !acked )
+    {
+        entry->missing++;
+        turnaroundStats.missing++;
+        return;
+    }
+
+    //timestamps of both frames are taken the same way, their jitter may
+    //exceed a very short turnaround
+    turn = ( elapsed > TURNAROUND_ACK_AIR_TIME_US ) ? elapsed - TURNAROUND_ACK_AIR_TIME_US : 0;
+    entry->acked++;
+    entry->turn_total += turn;
+    if( turn < entry->turn_min )
+    {
+        entry->turn_min = turn;
+    }
+    if( turn > entry->turn_max )
+    {
+        entry->turn_max = turn;
+    }
+    turnaroundStats.acked++;
+}
+
+/**************************************************************************//**
+\brief End interval, counting continues in the other table
+A request still waiting is dropped unless its acknowledgment is overdue
+******************************************************************************/
+static void turnaround_swap( uint32_t now )
+{
+    Turnaround_Table_t * table = turnaroundFlushed;
+
+    if( turnaroundPending != NULL )
+    {
+        if( now - turnaroundPendingTime > TURNAROUND_WINDOW_US )
+        {
+            turnaround_resolve( 0, false );
+        }
+        turnaroundPending = NULL;
+    }
+
+    turnaroundFlushed = turnaroundActive;
+    turnaroundActive = table;
+    memset( turnaroundActive, 0, sizeof(Turnaround_Table_t) );
+
+    turnaroundFlushing = true;
+    turnaroundHeaderPending = true;
+    turnaroundFlushIndex = 0;
+}
+
+/**************************************************************************//**
+\brief Send interval header on stats channel
+{"turn":"int","s":10,"n":5,"full":0,"bad":0}
+******************************************************************************/
+static bool turnaround_send_header( void )
+{
+    char record[TURNAROUND_RECORD_SIZE];
+    int length;
+
+    length = snprintf( record, TURNAROUND_RECORD_SIZE, "{\"turn\":\"int\",\"s\":%u,\"n\":%u,\"full\":%u,\"bad\":%u}\n\r",
+                       (unsigned int)turnaroundStats.period, (unsigned int)turnaroundFlushed->sources,
+                       (unsigned int)turnaroundFlushed->overflow, (unsigned int)turnaroundFlushed->unparsed );
+    if( length <= 0 || length >= TURNAROUND_RECORD_SIZE )
+    {
+        return false;
+    }
+    return ( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS );
+}
+
+/**************************************************************************//**
+\brief Send a source record on stats channel
+{"turn":"src","pan":"0x1A62","a":"0x1234","req":120,"ack":117,"miss":3,"ta":[190,196,230],"rt":3,"ri":[2080,2650,3900]}
+ta and ri are min/mean/max in us, 0 when nothing was measured
+******************************************************************************/
+static bool turnaround_send_entry( Turnaround_Entry_t const * entry )
+{
+    char record[TURNAROUND_RECORD_SIZE];
+    char address[20];
+    uint32_t turn[3] = { 0, 0, 0 };
+    uint32_t retry[3] = { 0, 0, 0 };
+    int length;
+
+    if( entry->mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        snprintf( address, sizeof(address), "0x%08X%08X", (unsigned int)(entry->address >> 32), (unsigned int)entry->address );
+    }
+    else if( entry->mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        snprintf( address, sizeof(address), "0x%04X", (unsigned int)entry->address );
+    }
+    else
+    {
+        address[0] = '\0';
+    }
+
+    if( entry->acked )
+    {
+        turn[0] = entry->turn_min;
+        turn[1] = entry->turn_total / entry->acked;
+        turn[2] = entry->turn_max;
+    }
+    if( entry->retries )
+    {
+        retry[0] = entry->retry_min;
+        retry[1] = entry->retry_total / entry->retries;
+        retry[2] = entry->retry_max;
+    }
+
+    length = snprintf( record, TURNAROUND_RECORD_SIZE,
+                       "{\"turn\":\"src\",\"pan\":\"0x%04X\",\"a\":\"%s\",\"req\":%u,\"ack\":%u,\"miss\":%u,\"ta\":[%u,%u,%u],\"rt\":%u,\"ri\":[%u,%u,%u]}\n\r",
+                       entry->pan_id, address, (unsigned int)entry->requests, (unsigned int)entry->acked, (unsigned int)entry->missing,
+                       (unsigned int)turn[0], (unsigned int)turn[1], (unsigned int)turn[2], (unsigned int)entry->retries,
+                       (unsigned int)retry[0], (unsigned int)retry[1], (unsigned int)retry[2] );
+    if( length <= 0 || length >= TURNAROUND_RECORD_SIZE )
+    {
+        return false;
+    }
+    return ( Mux_Write( MUX_CHANNEL_STATS, (uint8_t *)record, length ) == MUX_WRITE_SUCCESS );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init turnaround metrics, disabled
+******************************************************************************/
+void Turnaround_Init( void )
+{
+    memset( turnaroundTables, 0, sizeof(turnaroundTables) );
+    memset( &turnaroundStats, 0, sizeof(turnaroundStats) );
+    turnaroundPeriodUs = TURNAROUND_DISABLED;
+    turnaroundFlushing = false;
+    turnaroundPending = NULL;
+}
+
+/**************************************************************************//**
+\brief Enable or disable turnaround metrics
+A new period starts a new interval, counters of current one are discarded
+******************************************************************************/
+void Turnaround_SetPeriod( uint32_t period_s )
+{
+    if( period_s > TURNAROUND_PERIOD_MAX_S )
+    {
+        period_s = TURNAROUND_PERIOD_MAX_S;
+    }
+    Scheduler_Cancel( SCHEDULER_TASK_TURNAROUND );
+    memset( turnaroundTables, 0, sizeof(turnaroundTables) );
+    turnaroundFlushing = false;
+    turnaroundPending = NULL;
+    turnaroundStats.period = period_s;
+    turnaroundPeriodUs = period_s * TURNAROUND_US_PER_S;
+
+    if( period_s != TURNAROUND_DISABLED )
+    {
+        turnaroundDeadline = HAL_Radio_GetTime() + turnaroundPeriodUs;
+        Scheduler_PostDelayed( SCHEDULER_TASK_TURNAROUND, turnaroundPeriodUs );
+    }
+}
+
+/**************************************************************************//**
+\brief Offer a received frame to turnaround metrics
+Only the frame control and sequence number are read, the unpacked frame
+gives requests source address. Any frame other than the expected acknowledgment
+means the pending request was not acknowledged, the channel is shared.
+******************************************************************************/
+void Turnaround_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    uint16_t frame_control;
+    uint8_t type;
+    uint32_t elapsed;
+
+    if( turnaroundPeriodUs == TURNAROUND_DISABLED || phy_rx->len < TURNAROUND_ACK_SIZE )
+    {
+        return;
+    }
+
+    frame_control = (uint16_t)phy_rx->payload[0] | ((uint16_t)phy_rx->payload[1] << 8);
+    type = frame_control & MHR_FRAMECONTROL_FRAME_TYPE_MSK;
+
+    if( turnaroundPending != NULL )
+    {
+        elapsed = phy_rx->timestamp - turnaroundPendingTime;
+        if( type == MHR_FRAMECONTROL_FRAME_TYPE_ACK &&
+            phy_rx->len == TURNAROUND_ACK_SIZE &&
+            phy_rx->payload[MHR_FRAME_CONTROL_SIZE] == turnaroundPendingSequence &&
+            phy_rx->channel == turnaroundPendingChannel &&
+            elapsed <= TURNAROUND_WINDOW_US )
+        {
+            turnaround_resolve( elapsed, true );
+            return;
+        }
+        turnaround_resolve( elapsed, false );
+    }
+
+    if( ( type == MHR_FRAMECONTROL_FRAME_TYPE_DATA || type == MHR_FRAMECONTROL_FRAME_TYPE_MAC_COMMAND ) &&
+        ( frame_control & MHR_FRAMECONTROL_AR ) &&
+        !( frame_control & MHR_FRAMECONTROL_SEQUENCE_NUMBER_SUPPRESSION ) )
+    {
+        turnaround_request( phy_rx, frame );
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive turnaround metrics state and counters
+******************************************************************************/
+void Turnaround_GetStats( Turnaround_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = turnaroundStats;
+        stats->sources = turnaroundActive->sources;
+    }
+}
+
+/**************************************************************************//**
+\brief Turnaround task
+Interval ends on time even when previous one is still being sent, it is
+then extended until the host link caught up
+******************************************************************************/
+void Turnaround_Task( void )
+{
+    uint32_t now;
+    uint32_t wait;
+    uint8_t sent = 0;
+
+    if( turnaroundPeriodUs == TURNAROUND_DISABLED )
+    {
+        return;
+    }
+
+    now = HAL_Radio_GetTime();
+    if( !turnaroundFlushing && (int32_t)(now - turnaroundDeadline) >= 0 )
+    {
+        turnaround_swap( now );
+        turnaroundDeadline += turnaroundPeriodUs;
+        if( (int32_t)(now - turnaroundDeadline) >= 0 )
+        {
+            //late by more than a period, restart from now
+            turnaroundDeadline = now + turnaroundPeriodUs;
+        }
+    }
+
+    while( turnaroundFlushing )
+    {
+        if( sent >= TURNAROUND_RECORDS_PER_RUN )
+        {
+            Scheduler_Post( SCHEDULER_TASK_TURNAROUND );
+            return;
+        }
+
+        if( Mux_GetFreeSpace( MUX_CHANNEL_STATS ) < TURNAROUND_RECORD_SIZE )
+        {
+            wait = turnaroundDeadline - now;
+            Scheduler_PostDelayed( SCHEDULER_TASK_TURNAROUND,
+                                   ( (int32_t)wait > 0 && wait < TURNAROUND_FLUSH_POLL_US ) ? wait : TURNAROUND_FLUSH_POLL_US );
+            return;
+        }
+
+        if( turnaroundHeaderPending )
+        {
+            turnaround_send_header();
+            turnaroundHeaderPending = false;
+            sent++;
+            continue;
+        }
+
+        while( turnaroundFlushIndex < TURNAROUND_TABLE_SIZE && turnaroundFlushed->entries[turnaroundFlushIndex].requests == 0 )
+        {
+            turnaroundFlushIndex++;
+        }
+        if( turnaroundFlushIndex >= TURNAROUND_TABLE_SIZE )
+        {
+            turnaroundFlushing = false;
+            turnaroundStats.intervals++;
+            break;
+        }
+        turnaround_send_entry( &turnaroundFlushed->entries[turnaroundFlushIndex++] );
+        turnaroundStats.records++;
+        sent++;
+    }
+
+    wait = turnaroundDeadline - now;
+    Scheduler_PostDelayed( SCHEDULER_TASK_TURNAROUND, ( (int32_t)wait > 0 ) ? wait : 0 );
+}
@@ -0,0 +1,100 @@
+/****************************************************************************//**
+  \file capture_turnaround.h
+
+  \brief Acknowledgment turnaround and retry timing metrics
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_TURNAROUND_H
+#define _CAPTURE_TURNAROUND_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Sources tracked per interval, must be a power of 2
+//two tables are used, one counting while the other one is sent to host
+#define TURNAROUND_TABLE_SIZE       32
+
+//Period value disabling turnaround metrics
+#define TURNAROUND_DISABLED         0
+
+//Longest period in seconds, the next swap must stay within half the 32 bits
+//radio time range in us
+#define TURNAROUND_PERIOD_MAX_S     (INT32_MAX / 1000000)
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint32_t period;                    //interval in seconds, TURNAROUND_DISABLED when off
+    uint32_t sources;                   //sources counted in current interval
+    uint32_t intervals;                 //intervals sent to host
+    uint32_t records;                   //source records sent to host
+    uint32_t acked;                     //requests matched to their acknowledgment
+    uint32_t missing;                   //requests without acknowledgment
+    uint32_t overflow;                  //requests not counted, table full
+    uint32_t unparsed;                  //requests not counted, MAC header not unpacked
+}Turnaround_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init turnaround metrics, disabled
+******************************************************************************/
+void Turnaround_Init( void );
+
+/**************************************************************************//**
+\brief Enable turnaround metrics, sent every period_s seconds,
+TURNAROUND_DISABLED stops them, up to TURNAROUND_PERIOD_MAX_S
+******************************************************************************/
+void Turnaround_SetPeriod( uint32_t period_s );
+
+/**************************************************************************//**
+\brief Offer a received frame to turnaround metrics
+Frame is never consumed, it continues to capture,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+void Turnaround_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive turnaround metrics state and counters
+******************************************************************************/
+void Turnaround_GetStats( Turnaround_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Turnaround task
+Ends intervals and sends their records
+******************************************************************************/
+void Turnaround_Task( void );
+
+#endif // _CAPTURE_TURNAROUND_H
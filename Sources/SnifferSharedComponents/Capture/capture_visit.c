@@ -0,0 +1,564 @@
+/***************************************************************************//**
+ @file capture_visit.c
+  @brief   Predictive visits of periodic emitters on secondary channels
+           Short probe visits of secondary channels learn period and phase of
+           beacons and data polls, radio then leaves the primary channel only for
+           the predicted windows
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "capture_visit.h"
+#include "capture.h"
+#include "capture_sync.h"
+#include "mac.h"
+#include "mac_unpack.h"
+#include "scheduler.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define VISIT_US_PER_MS                 1000
+#define VISIT_PER_MILLE                 1000
+
+//Frame air time, preamble, SFD and PHR then PSDU at 32 us per byte
+#define VISIT_US_PER_BYTE               32
+#define VISIT_PHY_HEADER_SIZE           6
+
+//Window margin around a predicted frame, grows with each period elapsed
+//since last sighting for drift and jitter
+#define VISIT_GUARD_US                  2000
+#define VISIT_GUARD_PERIOD_SHIFT        8
+
+//Channel change and task latency, radio leaves this early
+#define VISIT_SWITCH_US                 500
+
+//Learned periods, shorter ones are not worth a visit, longer ones are forgotten
+#define VISIT_PERIOD_MIN_US             (10UL * VISIT_US_PER_MS)
+#define VISIT_PERIOD_MAX_US             (60000UL * VISIT_US_PER_MS)
+
+//Sightings matching the period before windows are scheduled
+#define VISIT_LOCK_MATCHES              2
+
+//Match tolerance while learning, period estimate from a remainder is coarse
+#define VISIT_LEARN_TOLERANCE_SHIFT     3
+
+//Consecutive missed windows before an emitter goes back to learning
+#define VISIT_MISS_MAX                  3
+
+//Probe interval dither, Numerical Recipes LCG
+#define VISIT_LCG_MULTIPLIER            1664525
+#define VISIT_LCG_INCREMENT             1013904223
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static Visit_Emitter_t * visit_lookup( uint8_t channel, uint16_t pan_id, uint8_t mode, uint64_t address, Visit_Kind_t kind );
+static uint32_t visit_guard( uint32_t period, uint32_t cycles );
+static void visit_unlock( Visit_Emitter_t * emitter );
+static void visit_learn( Visit_Emitter_t * emitter, uint32_t time );
+static void visit_leave( uint8_t channel, uint32_t now, uint32_t end );
+static void visit_return( uint32_t now );
+static void visit_plan( uint32_t now );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Visit_Emitter_t visitEmitters[VISIT_TABLE_SIZE];
+static uint8_t visitChannels[VISIT_MAX_CHANNELS];
+static uint8_t visitCount;              //secondary channels
+static uint8_t visitProbeIndex;         //next channel to probe
+static uint32_t visitProbeUs;
+static uint32_t visitEveryUs;
+static uint32_t visitNextProbe;         //radio time of next probe visit
+static uint32_t visitLeft;              //radio time primary channel was left
+static uint32_t visitEnd;               //radio time current visit ends
+static Visit_Emitter_t * visitTarget;   //emitter of current window
+static bool visitDone;                  //window frame received, return early
+static uint64_t visitStart;             //extended time visits started
+static uint64_t visitAwayUs;
+static uint32_t visitRandom;            //probe interval dither state
+static Visit_Stats_t visitStats;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Return emitter, allocated on first frame
+returns NULL when table is full
+******************************************************************************/
+static Visit_Emitter_t * visit_lookup( uint8_t channel, uint16_t pan_id, uint8_t mode, uint64_t address, Visit_Kind_t kind )
+{
+    Visit_Emitter_t * free_slot = NULL;
+
+    for( uint8_t i = 0; i < VISIT_TABLE_SIZE; i++ )
+    {
+        Visit_Emitter_t * emitter = &visitEmitters[i];
+
+        if( emitter->channel == 0 )
+        {
+            if( free_slot == NULL )
+            {
+                free_slot = emitter;
+            }
+            continue;
+        }
+        if( emitter->channel == channel && emitter->pan_id == pan_id && emitter->mode == mode &&
+            emitter->address == address && emitter->kind == kind )
+        {
+            return emitter;
+        }
+    }
+
+    if( free_slot != NULL )
+    {
+        memset( free_slot, 0, sizeof(Visit_Emitter_t) );
+        free_slot->channel = channel;
+        free_slot->pan_id = pan_id;
+        free_slot->mode = mode;
+        free_slot->address = address;
+        free_slot->kind = kind;
+        visitStats.emitters++;
+    }
+    return free_slot;
+}
+
+/**************************************************************************//**
+\brief Window margin on each side of a frame predicted cycles periods ahead
+******************************************************************************/
+static uint32_t visit_guard( uint32_t period, uint32_t cycles )
+{
+    return VISIT_GUARD_US + cycles * (period >> VISIT_GUARD_PERIOD_SHIFT);
+}
+
+/**************************************************************************//**
+\brief Forget learned period, windows stop until it is learned again
+******************************************************************************/
+static void visit_unlock( Visit_Emitter_t * emitter )
+{
+    if( emitter->locked )
+    {
+        emitter->locked = false;
+        visitStats.locked--;
+    }
+    emitter->matches = 0;
+}
+
+/**************************************************************************//**
+\brief Learn period and phase from a sighting
+Interval between sightings is a multiple of the period, probes miss most
+frames. An interval that is not a multiple replaces the period by the
+remainder, as in Euclid's algorithm, so a multiple converges to the period.
+A period taken from a remainder carries the error of every cycle it was
+taken from, matches are loose and correct it fully until it is locked.
+******************************************************************************/
+static void visit_learn( Visit_Emitter_t * emitter, uint32_t time )
+{
+    uint32_t delta = time - emitter->last;
+    uint32_t period = emitter->period;
+    uint32_t cycles;
+    uint32_t guard;
+    int32_t error;
+
+    emitter->last = time;
+    emitter->seen++;
+    if( emitter->seen == 1 )
+    {
+        return;
+    }
+
+    if( delta > VISIT_PERIOD_MAX_US )
+    {
+        emitter->period = 0;
+        visit_unlock( emitter );
+        return;
+    }
+
+    if( period == 0 || delta + visit_guard( period, 1 ) < period )
+    {
+        //first interval, or a shorter one
+        emitter->period = ( delta >= VISIT_PERIOD_MIN_US ) ? delta : 0;
+        visit_unlock( emitter );
+        return;
+    }
+
+    cycles = (delta + period / 2) / period;
+    guard = visit_guard( period, cycles );
+    if( !emitter->locked && guard < (period >> VISIT_LEARN_TOLERANCE_SHIFT) )
+    {
+        guard = period >> VISIT_LEARN_TOLERANCE_SHIFT;
+    }
+    error = (int32_t)(delta - cycles * period);
+    if( error > (int32_t)guard || error < -(int32_t)guard )
+    {
+        //remainder is a shorter period candidate, unless it is in the noise
+        error = ( error < 0 ) ? -error : error;
+        if( (uint32_t)error >= VISIT_PERIOD_MIN_US )
+        {
+            emitter->period = error;
+        }
+        visit_unlock( emitter );
+        return;
+    }
+
+    //follow drift once locked, a quarter of the error of each period
+    emitter->period += error / (int32_t)cycles / ( emitter->locked ? 4 : 1 );
+    if( emitter->matches < UINT8_MAX )
+    {
+        emitter->matches++;
+    }
+    if( !emitter->locked && emitter->matches >= VISIT_LOCK_MATCHES )
+    {
+        emitter->locked = true;
+        emitter->strikes = 0;
+        visitStats.locked++;
+    }
+}
+
+/**************************************************************************//**
+\brief Leave primary channel until end
+******************************************************************************/
+static void visit_leave( uint8_t channel, uint32_t now, uint32_t end )
+{
+    HAL_SetRadioChannel( channel );
+    visitLeft = now;
+    visitEnd = end;
+    visitDone = false;
+    Scheduler_PostDelayed( SCHEDULER_TASK_VISIT, end - now );
+}
+
+/**************************************************************************//**
+\brief Back to primary channel
+******************************************************************************/
+static void visit_return( uint32_t now )
+{
+    HAL_SetRadioChannel( visitStats.primary );
+    visitAwayUs += now - visitLeft;
+    visitStats.state = VISIT_STATE_HOME;
+    visitTarget = NULL;
+}
+
+/**************************************************************************//**
+\brief Go to next due visit or wait for it
+Predicted windows come first, a probe is cut short by the next window
+Window instances already passed are skipped, they are not misses
+******************************************************************************/
+static void visit_plan( uint32_t now )
+{
+    Visit_Emitter_t * target = NULL;
+    uint32_t target_start = 0;
+    uint32_t target_end = 0;
+    uint32_t next;
+
+    for( uint8_t i = 0; i < VISIT_TABLE_SIZE; i++ )
+    {
+        Visit_Emitter_t * emitter = &visitEmitters[i];
+        uint32_t guard;
+        uint32_t predicted;
+        uint32_t start;
+        uint32_t cycles = 1;
+
+        if( emitter->channel == 0 || !emitter->locked )
+        {
+            continue;
+        }
+
+        predicted = emitter->last + emitter->period;
+        guard = visit_guard( emitter->period, cycles );
+        while( (int32_t)(predicted + guard - now) <= 0 )
+        {
+            predicted += emitter->period;
+            guard = visit_guard( emitter->period, ++cycles );
+        }
+        start = predicted - guard - VISIT_SWITCH_US -
+                ((uint32_t)(emitter->length + VISIT_PHY_HEADER_SIZE) * VISIT_US_PER_BYTE);
+        if( (int32_t)(start - now) < 0 )
+        {
+            start = now;
+        }
+        if( target == NULL || (int32_t)(start - target_start) < 0 )
+        {
+            target = emitter;
+            target_start = start;
+            target_end = predicted + guard;
+        }
+    }
+
+    if( target != NULL && target_start == now )
+    {
+        visitStats.state = VISIT_STATE_WINDOW;
+        visitStats.windows++;
+        visitTarget = target;
+        visit_leave( target->channel, now, target_end );
+        return;
+    }
+
+    if( (int32_t)(visitNextProbe - now) <= 0 )
+    {
+        next = now + visitProbeUs;
+        if( target != NULL && (int32_t)(target_start - next) < 0 )
+        {
+            next = target_start;
+        }
+        //interval is dithered between half and one and a half every, a fixed
+        //interval could stay out of phase with an emitter forever
+        visitRandom = visitRandom * VISIT_LCG_MULTIPLIER + VISIT_LCG_INCREMENT;
+        visitNextProbe = now + visitEveryUs / 2 + (visitRandom >> 8) % visitEveryUs;
+        visitStats.state = VISIT_STATE_PROBE;
+        visitStats.probes++;
+        visit_leave( visitChannels[visitProbeIndex], now, next );
+        visitProbeIndex = ( visitProbeIndex + 1 ) % visitCount;
+        return;
+    }
+
+    next = visitNextProbe;
+    if( target != NULL && (int32_t)(target_start - next) < 0 )
+    {
+        next = target_start;
+    }
+    Scheduler_PostDelayed( SCHEDULER_TASK_VISIT, next - now );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init visits, stopped
+******************************************************************************/
+void Visit_Init( void )
+{
+    memset( visitEmitters, 0, sizeof(visitEmitters) );
+    memset( &visitStats, 0, sizeof(visitStats) );
+    visitCount = 0;
+    visitTarget = NULL;
+}
+
+/**************************************************************************//**
+\brief Start visits, current channel becomes primary and hopping stops
+Emitters learned before are forgotten
+******************************************************************************/
+bool Visit_Start( uint8_t const * channels, uint8_t count, uint16_t probe_ms, uint16_t every_ms )
+{
+    uint8_t primary = ( visitStats.state != VISIT_STATE_IDLE ) ? visitStats.primary : Capture_GetChannel();
+
+    if( count == 0 || count > VISIT_MAX_CHANNELS || probe_ms == 0 || every_ms < probe_ms )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        if( channels[i] < PHY_CHANNEL_11 || channels[i] > PHY_CHANNEL_26 || channels[i] == primary )
+        {
+            return false;
+        }
+    }
+
+    //stops hopping and any previous visit
+    Capture_SetChannel( primary );
+
+    memset( visitEmitters, 0, sizeof(visitEmitters) );
+    memset( &visitStats, 0, sizeof(visitStats) );
+    memcpy( visitChannels, channels, count );
+    visitCount = count;
+    visitProbeIndex = 0;
+    visitProbeUs = (uint32_t)probe_ms * VISIT_US_PER_MS;
+    visitEveryUs = (uint32_t)every_ms * VISIT_US_PER_MS;
+    visitNextProbe = HAL_Radio_GetTime();
+    visitRandom = visitNextProbe;
+    visitStart = Sync_Now();
+    visitAwayUs = 0;
+    visitStats.primary = primary;
+    visitStats.state = VISIT_STATE_HOME;
+    Scheduler_Post( SCHEDULER_TASK_VISIT );
+    return true;
+}
+
+/**************************************************************************//**
+\brief Stop visits and return to primary channel
+******************************************************************************/
+void Visit_Stop( void )
+{
+    if( visitStats.state == VISIT_STATE_IDLE )
+    {
+        return;
+    }
+
+    Scheduler_Cancel( SCHEDULER_TASK_VISIT );
+    if( visitStats.state != VISIT_STATE_HOME )
+    {
+        visit_return( HAL_Radio_GetTime() );
+    }
+    visitStats.state = VISIT_STATE_IDLE;
+}
+
+/**************************************************************************//**
+\brief Offer a received frame to visits
+Only beacons and data requests received away from primary channel are
+looked at, other frames cost a state check
+******************************************************************************/
+void Visit_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame )
+{
+    Visit_Emitter_t * emitter;
+    Visit_Kind_t kind;
+    uint64_t address = 0;
+    uint16_t pan_id;
+
+    if( ( visitStats.state != VISIT_STATE_PROBE && visitStats.state != VISIT_STATE_WINDOW ) ||
+        phy_rx->channel == visitStats.primary || frame == NULL )
+    {
+        return;
+    }
+
+    if( frame->frame_control.frame_Type == MAC_FRAME_TYPE_BEACON )
+    {
+        kind = VISIT_KIND_BEACON;
+    }
+    else if( frame->frame_control.frame_Type == MAC_FRAME_TYPE_COMMAND &&
+             frame->payload_size > frame->ie_size && frame->payload[frame->ie_size] == MAC_CMD_DATA_REQUEST )
+    {
+        kind = VISIT_KIND_POLL;
+    }
+    else
+    {
+        return;
+    }
+
+    if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_SHORT_ADDRESS )
+    {
+        address = frame->source_addr.short_addr;
+    }
+    else if( frame->frame_control.source_addressing_mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+    {
+        address = frame->source_addr.long_addr;
+    }
+
+    //MAC_Unpack fills an elided source PAN ID
+    pan_id = frame->source_pan_id;
+
+    emitter = visit_lookup( phy_rx->channel, pan_id, frame->frame_control.source_addressing_mode, address, kind );
+    if( emitter == NULL )
+    {
+        visitStats.overflow++;
+        return;
+    }
+
+    emitter->length = phy_rx->len;
+    visit_learn( emitter, phy_rx->timestamp );
+
+    if( emitter == visitTarget && !visitDone )
+    {
+        emitter->hits++;
+        emitter->strikes = 0;
+        visitStats.hits++;
+        visitDone = true;
+        Scheduler_Post( SCHEDULER_TASK_VISIT );
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive visit state and counters
+******************************************************************************/
+void Visit_GetStats( Visit_Stats_t * stats )
+{
+    uint64_t elapsed;
+
+    *stats = visitStats;
+    stats->away = 0;
+    if( visitStats.state != VISIT_STATE_IDLE )
+    {
+        elapsed = Sync_Now() - visitStart;
+        if( elapsed )
+        {
+            stats->away = (uint32_t)( (visitAwayUs * VISIT_PER_MILLE) / elapsed );
+        }
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive an emitter, returns false past last one
+******************************************************************************/
+bool Visit_GetEmitter( uint8_t index, Visit_Emitter_t * emitter )
+{
+    for( uint8_t i = 0; i < VISIT_TABLE_SIZE; i++ )
+    {
+        if( visitEmitters[i].channel == 0 )
+        {
+            continue;
+        }
+        if( index-- == 0 )
+        {
+            *emitter = visitEmitters[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/**************************************************************************//**
+\brief Visit task
+Frames received on the visited channel are processed first, reception runs
+at higher priority, so they keep the channel they were received on
+******************************************************************************/
+void Visit_Task( void )
+{
+    uint32_t now = HAL_Radio_GetTime();
+    Visit_Emitter_t * target = visitTarget;
+
+    if( visitStats.state == VISIT_STATE_IDLE )
+    {
+        return;
+    }
+
+    if( visitStats.state != VISIT_STATE_HOME )
+    {
+        if( !visitDone && (int32_t)(visitEnd - now) > 0 )
+        {
+            Scheduler_PostDelayed( SCHEDULER_TASK_VISIT, visitEnd - now );
+            return;
+        }
+        if( HAL_Radio_RxPending() )
+        {
+            Scheduler_Post( SCHEDULER_TASK_VISIT );
+            return;
+        }
+
+        if( visitStats.state == VISIT_STATE_WINDOW && !visitDone )
+        {
+            target->misses++;
+            visitStats.misses++;
+            if( ++target->strikes >= VISIT_MISS_MAX )
+            {
+                visit_unlock( target );
+            }
+        }
+        visit_return( now );
+    }
+
+    visit_plan( now );
+}
@@ -0,0 +1,144 @@
+/****************************************************************************//**
+  \file capture_visit.h
+
+  \brief Predictive visits of periodic emitters on secondary channels
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CAPTURE_VISIT_H
+#define _CAPTURE_VISIT_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+#include "mac_unpack.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Secondary channels visited
+#define VISIT_MAX_CHANNELS          3
+
+//Periodic emitters tracked on secondary channels
+#define VISIT_TABLE_SIZE            8
+
+//Default probe visit length and interval between probe visits
+#define VISIT_PROBE_DEFAULT_MS      20
+#define VISIT_EVERY_DEFAULT_MS      500
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    VISIT_STATE_IDLE,
+    VISIT_STATE_HOME,                   //on primary channel
+    VISIT_STATE_PROBE,                  //learning visit of a secondary channel
+    VISIT_STATE_WINDOW,                 //predicted visit of an emitter
+}Visit_State_t;
+
+typedef enum {
+    VISIT_KIND_BEACON,
+    VISIT_KIND_POLL,                    //data request command
+}Visit_Kind_t;
+
+//Emitter of periodic frames, times are in us
+typedef struct {
+    uint64_t address;                   //short or extended source address
+    uint32_t period;                    //learned period, 0 until two sightings
+    uint32_t last;                      //radio time of last sighting, end of frame
+    uint32_t seen;                      //frames received
+    uint32_t hits;                      //frames received in predicted windows
+    uint32_t misses;                    //predicted windows without the frame
+    uint16_t pan_id;
+    uint8_t  channel;                   //0 when slot is free
+    uint8_t  mode;                      //source addressing mode, MAC_Addressing_Mode_t
+    Visit_Kind_t kind;
+    uint8_t  length;                    //last frame length, sizes the window
+    uint8_t  matches;                   //sightings confirming period
+    uint8_t  strikes;                   //consecutive misses
+    bool     locked;                    //period confirmed, windows are scheduled
+}Visit_Emitter_t;
+
+typedef struct {
+    Visit_State_t state;
+    uint8_t  primary;                   //channel captured between visits
+    uint8_t  emitters;                  //emitters in table
+    uint8_t  locked;                    //emitters visited in predicted windows
+    uint32_t probes;                    //probe visits
+    uint32_t windows;                   //predicted visits
+    uint32_t hits;                      //predicted visits catching their frame
+    uint32_t misses;                    //predicted visits ended without it
+    uint32_t overflow;                  //emitters not tracked, table full
+    uint32_t away;                      //time off primary channel in per mille
+}Visit_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init visits, stopped
+******************************************************************************/
+void Visit_Init( void );
+
+/**************************************************************************//**
+\brief Start visits, current channel becomes primary and hopping stops
+    /param[in]     channels     secondary channels
+    /param[in]     probe_ms     length of a probe visit
+    /param[in]     every_ms     interval between probe visits, channels
+                                are probed in turn
+******************************************************************************/
+bool Visit_Start( uint8_t const * channels, uint8_t count, uint16_t probe_ms, uint16_t every_ms );
+
+/**************************************************************************//**
+\brief Stop visits and return to primary channel, learned emitters are kept
+******************************************************************************/
+void Visit_Stop( void );
+
+/**************************************************************************//**
+\brief Offer a received frame to visits
+Frame is never consumed, it continues to capture,
+frame is the unpacked phy_rx, NULL when it can't be unpacked
+******************************************************************************/
+void Visit_Record( PhyRx_t const * phy_rx, MAC_Frame_Unpacked_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive visit state and counters
+******************************************************************************/
+void Visit_GetStats( Visit_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Retreive an emitter, returns false past last one
+******************************************************************************/
+bool Visit_GetEmitter( uint8_t index, Visit_Emitter_t * emitter );
+
+/**************************************************************************//**
+\brief Visit task
+Leaves primary channel for probes and predicted windows, returns when done
+******************************************************************************/
+void Visit_Task( void );
+
+#endif // _CAPTURE_VISIT_H
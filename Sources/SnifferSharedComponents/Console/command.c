@@ -0,0 +1,2272 @@
+/***************************************************************************//**
+ @file command.c
+  @brief   Host command parser and dispatcher
+           Commands are flat JSON objects parsed one byte at a time without
+           allocation, a command carrying an "id" is acknowledged
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "command.h"
+#include "console.h"
+#include "console_mux.h"
+#include "capture.h"
+#include "capture_burst.h"
+#include "capture_trigger.h"
+#include "capture_flashlog.h"
+#include "capture_summary.h"
+#include "capture_dedup.h"
+#include "capture_ack.h"
+#include "capture_sample.h"
+#include "capture_inject.h"
+#include "capture_discover.h"
+#include "capture_replay.h"
+#include "capture_sync.h"
+#include "capture_turnaround.h"
+#include "capture_noise.h"
+#include "capture_visit.h"
+#include "capture_tsch.h"
+#include "console.h"
+#include "log.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "pool.h"
+#include "printf.h"
+#include "string.h"
+#include "stdlib.h"     //for strtol, strtoll
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define COMMAND_LITERAL_MAX_LENGTH      5       //"false"
+#define COMMAND_NUMBER_MAX_DIGITS       10
+
+//Kept free by response fields for the status and the closing bracket
+//,"st":-2147483648}\n\r
+#define COMMAND_RESPONSE_TRAILER_SIZE   24
+
+#define COMMAND_BAUDRATE_MIN            9600
+#define COMMAND_BAUDRATE_MAX            2000000
+
+//Polling period while waiting for a response to leave the device
+#define COMMAND_PENDING_POLL_US         1000
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+typedef enum {
+    COMMAND_STEP_OPENING_BRACKET,
+    COMMAND_STEP_KEY_START,
+    COMMAND_STEP_KEY,
+    COMMAND_STEP_COLON,
+    COMMAND_STEP_VALUE_START,
+    COMMAND_STEP_STRING,
+    COMMAND_STEP_STRING_ESCAPE,
+    COMMAND_STEP_NUMBER,
+    COMMAND_STEP_LITERAL,
+    COMMAND_STEP_ARRAY_VALUE,
+    COMMAND_STEP_ARRAY_NUMBER,
+    COMMAND_STEP_ARRAY_NEXT,
+    COMMAND_STEP_NEXT,
+}Command_Step_t;
+
+typedef Command_Status_t (*Command_Handler_t)( Command_Request_t const * request, Command_Response_t * response );
+
+typedef struct {
+    char const *        name;
+    Command_Handler_t   handler;
+}Command_Entry_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static bool command_is_whitespace( uint8_t byte );
+static bool command_is_digit( uint8_t byte );
+static void command_parse_error( void );
+static bool command_number_start( uint8_t byte );
+static bool command_number_add( uint8_t byte );
+static uint16_t command_response_free( Command_Response_t const * response );
+static int8_t command_hex_digit( char digit );
+static void command_dispatch( void );
+
+static Command_Status_t command_chan( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_hop( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_filt( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_snap( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_enc( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_baud( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_stats( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_reset( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_mux( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_log( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_task( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_burst( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_trig( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_flog( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_sum( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_dedup( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_ack( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_samp( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_tx( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_disc( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_replay( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_sync( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_turn( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_noise( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_visit( Command_Request_t const * request, Command_Response_t * response );
+static Command_Status_t command_tsch( Command_Request_t const * request, Command_Response_t * response );
+#ifdef PROFILER_ENABLE
+static Command_Status_t command_prof( Command_Request_t const * request, Command_Response_t * response );
+#endif
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static const Command_Entry_t CommandTable[] = {
+    { "chan",   command_chan  },        //{"cmd":"chan","ch":15}
+    { "hop",    command_hop   },        //{"cmd":"hop","ch":[11,15,20,25],"dwell":250}
+    { "filt",   command_filt  },        //{"cmd":"filt","pan":"0x1A62","src":"0x0000","dst":"0xFFFF","type":3}
+    { "snap",   command_snap  },        //{"cmd":"snap","len":24}
+    { "enc",    command_enc   },        //{"cmd":"enc","mode":"bin"}
+    { "baud",   command_baud  },        //{"cmd":"baud","rate":921600}
+    { "stats",  command_stats },        //{"cmd":"stats","clr":true}
+    { "reset",  command_reset },        //{"cmd":"reset"}
+    { "mux",    command_mux   },        //{"cmd":"mux","en":false}
+    { "log",    command_log   },        //{"cmd":"log","lvl":0}
+    { "task",   command_task  },        //{"cmd":"task","n":0}
+    { "burst",  command_burst },        //{"cmd":"burst","op":"start","frames":1000,"ms":500}
+    { "trig",   command_trig  },        //{"cmd":"trig","n":0,"type":8,"b":[0,1,255]}
+    { "flog",   command_flog  },        //{"cmd":"flog","op":"dump","from":0}
+    { "sum",    command_sum   },        //{"cmd":"sum","s":10}
+    { "dedup",  command_dedup },        //{"cmd":"dedup","ms":30}
+    { "ack",    command_ack   },        //{"cmd":"ack","ms":100}
+    { "samp",   command_samp  },        //{"cmd":"samp","flow":100,"n":50}
+    { "tx",     command_tx    },        //{"cmd":"tx","f":"030801ffffffff07","h":1}
+    { "disc",   command_disc  },        //{"cmd":"disc","op":"start","ch":[11,15,20,25],"ms":40}
+    { "replay", command_replay },       //{"cmd":"replay","op":"start","lead":20}
+    { "sync",   command_sync  },        //{"cmd":"sync","t1":"1700000000123456"}
+    { "turn",   command_turn  },        //{"cmd":"turn","s":10}
+    { "noise",  command_noise },        //{"cmd":"noise","ms":1000,"us":1000,"th":-75}
+    { "visit",  command_visit },        //{"cmd":"visit","op":"start","ch":[15,20],"probe":20,"every":500}
+    { "tsch",   command_tsch  },        //{"cmd":"tsch","op":"start","pan":"0x1A62","off":0,"to":30}
+#ifdef PROFILER_ENABLE
+    { "prof",   command_prof  },        //{"cmd":"prof","n":0}
+#endif
+};
+
+#define NB_OF_COMMANDS      (sizeof(CommandTable)/sizeof(CommandTable[0]))
+
+//Encoding names, in Capture_Encoding_t order
+static char const * const CommandEncodingNames[CAPTURE_ENCODING_COUNT] = {
+    "json",
+    "jsont",
+    "bin",
+};
+
+//Discovery states, in Discover_State_t order
+static char const * const CommandDiscoverStateNames[] = {
+    "idle",
+    "sweep",
+    "report",
+};
+
+//Visit states and emitter kinds, in Visit_State_t and Visit_Kind_t order
+static char const * const CommandVisitStateNames[] = {
+    "idle",
+    "home",
+    "probe",
+    "window",
+};
+
+static char const * const CommandVisitKindNames[] = {
+    "bcn",
+    "poll",
+};
+
+//TSCH follow states, in Tsch_State_t order
+static char const * const CommandTschStateNames[] = {
+    "idle",
+    "search",
+    "follow",
+};
+
+//Replay states, in Replay_State_t order
+static char const * const CommandReplayStateNames[] = {
+    "idle",
+    "play",
+};
+
+//Burst states and stop reasons, in Burst_State_t and Burst_Stop_Reason_t order
+static char const * const CommandBurstStateNames[] = {
+    "idle",
+    "rec",
+    "drain",
+    "armed",
+};
+
+static char const * const CommandBurstReasonNames[] = {
+    "none",
+    "full",
+    "frames",
+    "time",
+    "trig",
+};
+
+//Flash log states, in FlashLog_State_t order
+static char const * const CommandFlashLogStateNames[] = {
+    "idle",
+    "rec",
+    "dump",
+    "erase",
+};
+
+static Command_Step_t commandStep = COMMAND_STEP_OPENING_BRACKET;
+static Command_Request_t commandRequest;
+static Command_Response_t commandResponse;
+static Command_Stats_t commandStats;
+
+//Number and literal being parsed
+static int32_t commandNumber;
+static bool commandNumberNegative;
+static bool commandNumberOverflow;
+static uint8_t commandNumberDigits;
+static char commandLiteral[COMMAND_LITERAL_MAX_LENGTH + 1];
+static uint8_t commandLiteralLength;
+
+//Actions done once response is sent to host
+static uint32_t commandPendingBaudrate = 0;
+static bool commandPendingReset = false;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+static bool command_is_whitespace( uint8_t byte )
+{
+    return ( byte == ' ' || byte == '\t' || byte == '\r' || byte == '\n' );
+}
+
+static bool command_is_digit( uint8_t byte )
+{
+    return ( byte >= '0' && byte <= '9' );
+}
+
+static int8_t command_hex_digit( char digit )
+{
+    if( digit >= '0' && digit <= '9' ) return digit - '0';
+    if( digit >= 'a' && digit <= 'f' ) return digit - 'a' + 10;
+    if( digit >= 'A' && digit <= 'F' ) return digit - 'A' + 10;
+    return -1;
+}
+
+/**************************************************************************//**
+\brief Return room left for response fields, trailer excluded
+******************************************************************************/
+static uint16_t command_response_free( Command_Response_t const * response )
+{
+    if( response->length + COMMAND_RESPONSE_TRAILER_SIZE >= COMMAND_RESPONSE_SIZE )
+    {
+        return 0;
+    }
+    return COMMAND_RESPONSE_SIZE - COMMAND_RESPONSE_TRAILER_SIZE - response->length;
+}
+
+/**************************************************************************//**
+\brief Drop command being parsed
+******************************************************************************/
+static void command_parse_error( void )
+{
+    commandStats.parse_errors++;
+    commandStep = COMMAND_STEP_OPENING_BRACKET;
+}
+
+/**************************************************************************//**
+\brief Start a number, returns false if byte can't start a number
+******************************************************************************/
+static bool command_number_start( uint8_t byte )
+{
+    commandNumber = 0;
+    commandNumberDigits = 0;
+    commandNumberOverflow = false;
+    commandNumberNegative = ( byte == '-' );
+    if( commandNumberNegative )
+    {
+        return true;
+    }
+    return command_number_add( byte );
+}
+
+/**************************************************************************//**
+\brief Add a digit to number, returns false if byte is not a digit
+A number above INT32_MAX ends the number and flags it as overflow
+******************************************************************************/
+static bool command_number_add( uint8_t byte )
+{
+    if( !command_is_digit( byte ) || commandNumberDigits >= COMMAND_NUMBER_MAX_DIGITS )
+    {
+        return false;
+    }
+    if( commandNumber > (INT32_MAX - (byte - '0')) / 10 )
+    {
+        commandNumberOverflow = true;
+        return false;
+    }
+    commandNumber = (commandNumber * 10) + (byte - '0');
+    commandNumberDigits++;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Execute parsed command, send response if command has an id
+Response: {"id":<id>,"ack":"<cmd>",<fields>,"st":<Command_Status_t>}
+******************************************************************************/
+static void command_dispatch( void )
+{
+    int32_t id = 0;
+    bool has_id;
+    char const * name;
+    uint8_t name_length;
+    char const * ack = "";
+    uint16_t header_length;
+    int written;
+    Command_Status_t status = COMMAND_STATUS_UNKNOWN_COMMAND;
+    Command_Handler_t handler = NULL;
+
+    commandStats.received++;
+
+    has_id = Command_GetNumber( &commandRequest, "id", &id );
+
+    if( Command_GetString( &commandRequest, "cmd", &name, &name_length ) )
+    {
+        for( uint8_t i = 0; i < NB_OF_COMMANDS; i++ )
+        {
+            if( (strlen( CommandTable[i].name ) == name_length) &&
+                (memcmp( CommandTable[i].name, name, name_length ) == 0) )
+            {
+                handler = CommandTable[i].handler;
+                ack = CommandTable[i].name;
+                break;
+            }
+        }
+    }
+    //Legacy channel selection, example: {"C":11}
+    else if( Command_GetParam( &commandRequest, "C" ) != NULL )
+    {
+        handler = command_chan;
+        ack = "C";
+    }
+
+    //Unknown commands are acknowledged with an empty name
+    commandResponse.length = snprintf( commandResponse.buffer, COMMAND_RESPONSE_SIZE, "{\"id\":%d,\"ack\":\"%s\"", (int)id, ack );
+    header_length = commandResponse.length;
+
+    if( handler != NULL )
+    {
+        status = handler( &commandRequest, &commandResponse );
+    }
+
+    if( status != COMMAND_STATUS_SUCCESS )
+    {
+        commandStats.rejected++;
+        commandResponse.length = header_length;
+    }
+
+    if( !has_id )
+    {
+        return;
+    }
+
+    //fields leave room for the trailer, clamped anyway to what was written
+    written = snprintf( &commandResponse.buffer[commandResponse.length], COMMAND_RESPONSE_SIZE - commandResponse.length, ",\"st\":%d}\n\r", (int)status );
+    if( written > 0 )
+    {
+        commandResponse.length += written;
+    }
+    if( commandResponse.length >= COMMAND_RESPONSE_SIZE )
+    {
+        commandResponse.length = COMMAND_RESPONSE_SIZE - 1;
+    }
+    Mux_Write( MUX_CHANNEL_CONTROL, (uint8_t const *)commandResponse.buffer, commandResponse.length );
+}
+
+/**************************************************************************//**
+\brief Select a fixed channel, stops hopping
+params: ch (or C for legacy command)
+******************************************************************************/
+static Command_Status_t command_chan( Command_Request_t const * request, Command_Response_t * response )
+{
+    int32_t channel;
+
+    if( !Command_GetNumber( request, "ch", &channel ) &&
+        !Command_GetNumber( request, "C", &channel ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( Capture_SetChannel( channel ) != CAPTURE_SUCCESS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Command_ResponseAddNumber( response, "ch", Capture_GetChannel() );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set hop plan
+params: ch array of channels, dwell in ms, an empty array stops hopping
+******************************************************************************/
+static Command_Status_t command_hop( Command_Request_t const * request, Command_Response_t * response )
+{
+    int32_t const * array;
+    uint8_t count;
+    int32_t dwell = 0;
+    uint8_t channels[CAPTURE_HOP_MAX_CHANNELS];
+
+    if( !Command_GetArray( request, "ch", &array, &count ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( count && !Command_GetNumber( request, "dwell", &dwell ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( count > CAPTURE_HOP_MAX_CHANNELS || dwell < 0 || dwell > UINT16_MAX )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        if( array[i] < PHY_CHANNEL_11 || array[i] > PHY_CHANNEL_26 )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        channels[i] = array[i];
+    }
+
+    if( Capture_SetHopPlan( channels, count, dwell ) != CAPTURE_SUCCESS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Command_ResponseAddNumber( response, "n", count );
+    Command_ResponseAddNumber( response, "dwell", dwell );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set capture filter
+params: pan, src, dst short address and type mask, all optional
+an absent field disables the matching filter
+******************************************************************************/
+static Command_Status_t command_filt( Command_Request_t const * request, Command_Response_t * response )
+{
+    Capture_Filter_t filter;
+    int32_t value;
+
+    (void) response;
+
+    filter.pan_id = CAPTURE_FILTER_ANY;
+    filter.src_addr = CAPTURE_FILTER_ANY;
+    filter.dst_addr = CAPTURE_FILTER_ANY;
+    filter.type_mask = CAPTURE_FILTER_TYPE_ALL;
+
+    if( Command_GetNumber( request, "pan", &value ) )
+    {
+        if( value < 0 || value > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        filter.pan_id = value;
+    }
+
+    if( Command_GetNumber( request, "src", &value ) )
+    {
+        if( value < 0 || value > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        filter.src_addr = value;
+    }
+
+    if( Command_GetNumber( request, "dst", &value ) )
+    {
+        if( value < 0 || value > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        filter.dst_addr = value;
+    }
+
+    if( Command_GetNumber( request, "type", &value ) )
+    {
+        if( value < 0 || value > UINT8_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        filter.type_mask = value;
+    }
+
+    Capture_SetFilter( &filter );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set snaplen
+params: len, 0 for whole frames
+******************************************************************************/
+static Command_Status_t command_snap( Command_Request_t const * request, Command_Response_t * response )
+{
+    int32_t snaplen;
+
+    if( !Command_GetNumber( request, "len", &snaplen ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( snaplen < 0 || snaplen > PHY_PAYLOAD_MAX )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Capture_SetSnaplen( snaplen );
+    Command_ResponseAddNumber( response, "len", snaplen );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set capture encoding
+params: mode, "json", "jsont" or "bin" (or Capture_Encoding_t value)
+******************************************************************************/
+static Command_Status_t command_enc( Command_Request_t const * request, Command_Response_t * response )
+{
+    char const * mode;
+    uint8_t length;
+    int32_t encoding = CAPTURE_ENCODING_COUNT;
+
+    if( Command_GetString( request, "mode", &mode, &length ) )
+    {
+        for( uint8_t i = 0; i < CAPTURE_ENCODING_COUNT; i++ )
+        {
+            if( (strlen( CommandEncodingNames[i] ) == length) &&
+                (memcmp( CommandEncodingNames[i], mode, length ) == 0) )
+            {
+                encoding = i;
+                break;
+            }
+        }
+    }
+    else if( !Command_GetNumber( request, "mode", &encoding ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( encoding < 0 || Capture_SetEncoding( encoding ) != CAPTURE_SUCCESS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Command_ResponseAddString( response, "mode", CommandEncodingNames[encoding] );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Change console baudrate
+params: rate, response is sent at actual baudrate then baudrate is changed
+******************************************************************************/
+static Command_Status_t command_baud( Command_Request_t const * request, Command_Response_t * response )
+{
+    int32_t baudrate;
+
+    if( !Command_GetNumber( request, "rate", &baudrate ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( baudrate < COMMAND_BAUDRATE_MIN || baudrate > COMMAND_BAUDRATE_MAX )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    if( commandPendingBaudrate || commandPendingReset )
+    {
+        return COMMAND_STATUS_BUSY;
+    }
+
+    commandPendingBaudrate = baudrate;
+    Scheduler_Post( SCHEDULER_TASK_COMMAND );
+    Command_ResponseAddNumber( response, "rate", baudrate );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Report statistics
+params: clr (optional) clears capture statistics once reported
+******************************************************************************/
+static Command_Status_t command_stats( Command_Request_t const * request, Command_Response_t * response )
+{
+    Capture_Stats_t capture;
+    Pool_Stats_t pool;
+    int32_t clear = 0;
+
+    Capture_GetStats( &capture );
+    Pool_GetStats( &pool );
+    Command_ResponseAddNumber( response, "rx", capture.received );
+    Command_ResponseAddNumber( response, "filt", capture.filtered );
+    Command_ResponseAddNumber( response, "samp", capture.sampled );
+    Command_ResponseAddNumber( response, "tx", capture.sent );
+    Command_ResponseAddNumber( response, "drop", capture.dropped );
+    Command_ResponseAddNumber( response, "hop", capture.hops );
+    Command_ResponseAddNumber( response, "cmd", commandStats.received );
+    Command_ResponseAddNumber( response, "cerr", commandStats.parse_errors );
+    Command_ResponseAddNumber( response, "rxovf", Console_GetRxOverflows() );
+    Command_ResponseAddNumber( response, "ldrop", Log_GetDrops() );
+    Command_ResponseAddNumber( response, "pool", pool.in_use );
+    Command_ResponseAddNumber( response, "pmax", pool.high_watermark );
+    Command_ResponseAddNumber( response, "pexh", pool.exhausted );
+    Command_ResponseAddNumber( response, "phld", pool.hold_refused );
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        Capture_ClearStats();
+        Pool_ClearStats();
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Reset device once response is sent
+******************************************************************************/
+static Command_Status_t command_reset( Command_Request_t const * request, Command_Response_t * response )
+{
+    (void) request;
+    (void) response;
+
+    if( commandPendingBaudrate )
+    {
+        return COMMAND_STATUS_BUSY;
+    }
+    commandPendingReset = true;
+    Scheduler_Post( SCHEDULER_TASK_COMMAND );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Enable or disable mux framing
+params: en
+******************************************************************************/
+static Command_Status_t command_mux( Command_Request_t const * request, Command_Response_t * response )
+{
+    int32_t enable;
+
+    if( !Command_GetNumber( request, "en", &enable ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    Mux_Enable( enable != 0 );
+    Command_ResponseAddNumber( response, "en", Mux_IsEnabled() );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set log level
+params: lvl (optional) Log_Level_t, lowest level sent to host
+******************************************************************************/
+static Command_Status_t command_log( Command_Request_t const * request, Command_Response_t * response )
+{
+    int32_t level;
+
+    if( Command_GetNumber( request, "lvl", &level ) )
+    {
+        if( level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_NONE )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        Log_SetLevel( level );
+    }
+
+    Command_ResponseAddNumber( response, "lvl", Log_GetLevel() );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Report scheduler statistics of a task, times in us
+params: n task number (Scheduler_Task_t), clr (optional) clears all statistics
+******************************************************************************/
+static Command_Status_t command_task( Command_Request_t const * request, Command_Response_t * response )
+{
+    Scheduler_Task_Stats_t stats;
+    int32_t task;
+    int32_t clear = 0;
+
+    if( !Command_GetNumber( request, "n", &task ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( task < 0 || task >= SCHEDULER_TASK_COUNT )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Scheduler_GetTaskStats( task, &stats );
+    Command_ResponseAddNumber( response, "n", task );
+    Command_ResponseAddNumber( response, "runs", stats.runs );
+    Command_ResponseAddNumber( response, "rmax", stats.run_time_max );
+    Command_ResponseAddNumber( response, "ravg", stats.runs ? stats.run_time_total / stats.runs : 0 );
+    Command_ResponseAddNumber( response, "lmax", stats.latency_max );
+    Command_ResponseAddNumber( response, "lavg", stats.runs ? stats.latency_total / stats.runs : 0 );
+    Command_ResponseAddNumber( response, "sleep", Scheduler_GetSleepTime() );
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        Scheduler_ClearStats();
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Burst capture control and status
+op: optional, "start", "arm", "stop" (drain now, or trigger now when armed)
+or "abort", status only when absent
+frames, ms: optional with start and arm, frame count and duration limits,
+after trigger when armed
+pre: optional with arm, lead-up duration in ms
+rearm: optional with arm, arm again after each window is drained
+******************************************************************************/
+static Command_Status_t command_burst( Command_Request_t const * request, Command_Response_t * response )
+{
+    Burst_Stats_t stats;
+    char const * op;
+    uint8_t length;
+    int32_t frames = BURST_NO_LIMIT;
+    int32_t duration = BURST_NO_LIMIT;
+    int32_t pre = BURST_NO_LIMIT;
+    int32_t rearm = 0;
+    Burst_Result_t result = BURST_SUCCESS;
+
+    if( Command_GetString( request, "op", &op, &length ) )
+    {
+        if( length == 5 && memcmp( op, "start", 5 ) == 0 )
+        {
+            Command_GetNumber( request, "frames", &frames );
+            Command_GetNumber( request, "ms", &duration );
+            if( frames < 0 || duration < 0 || (uint32_t)duration > BURST_MS_MAX )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+            result = Burst_Start( frames, duration );
+        }
+        else if( length == 3 && memcmp( op, "arm", 3 ) == 0 )
+        {
+            Command_GetNumber( request, "frames", &frames );
+            Command_GetNumber( request, "ms", &duration );
+            Command_GetNumber( request, "pre", &pre );
+            Command_GetNumber( request, "rearm", &rearm );
+            if( frames < 0 || duration < 0 || pre < 0 ||
+                (uint32_t)duration > BURST_MS_MAX || (uint32_t)pre > BURST_MS_MAX )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+            result = Burst_Arm( pre, frames, duration, rearm != 0 );
+        }
+        else if( length == 4 && memcmp( op, "stop", 4 ) == 0 )
+        {
+            result = Burst_Trigger();
+        }
+        else if( length == 5 && memcmp( op, "abort", 5 ) == 0 )
+        {
+            Burst_Abort();
+        }
+        else
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if( result == BURST_BUSY )
+    {
+        return COMMAND_STATUS_BUSY;
+    }
+    if( result != BURST_SUCCESS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Burst_GetStats( &stats );
+    Command_ResponseAddString( response, "state", CommandBurstStateNames[stats.state] );
+    Command_ResponseAddString( response, "why", CommandBurstReasonNames[stats.reason] );
+    Command_ResponseAddNumber( response, "rec", stats.recorded );
+    Command_ResponseAddNumber( response, "pre", stats.pre_trigger );
+    Command_ResponseAddNumber( response, "win", stats.windows );
+    Command_ResponseAddNumber( response, "bytes", stats.bytes );
+    Command_ResponseAddNumber( response, "drn", stats.drained );
+    Command_ResponseAddNumber( response, "miss", stats.missed );
+    Command_ResponseAddNumber( response, "dur", stats.duration );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Set or report a burst trigger expression
+n: expression number
+type, pan, src, dst, b: optional, setting any of them replaces the expression,
+an absent field matches any frame, type 0 disables the expression
+b: up to TRIGGER_MAX_BYTE_MATCHES triplets of MAC payload offset, value and mask
+******************************************************************************/
+static Command_Status_t command_trig( Command_Request_t const * request, Command_Response_t * response )
+{
+    Trigger_Expression_t expression;
+    Trigger_Stats_t stats;
+    int32_t index;
+    int32_t value;
+    int32_t const * bytes;
+    uint8_t count;
+    bool set = false;
+
+    if( !Command_GetNumber( request, "n", &index ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+    if( index < 0 || index >= TRIGGER_MAX_EXPRESSIONS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    memset( &expression, 0, sizeof(expression) );
+    expression.type_mask = TRIGGER_TYPE_ALL;
+    expression.pan_id = TRIGGER_ANY;
+    expression.src_addr = TRIGGER_ANY;
+    expression.dst_addr = TRIGGER_ANY;
+
+    if( Command_GetNumber( request, "type", &value ) )
+    {
+        if( value < 0 || value > UINT8_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        expression.type_mask = value;
+        set = true;
+    }
+
+    if( Command_GetNumber( request, "pan", &value ) )
+    {
+        if( value < 0 || value > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        expression.pan_id = value;
+        set = true;
+    }
+
+    if( Command_GetNumber( request, "src", &value ) )
+    {
+        if( value < 0 || value > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        expression.src_addr = value;
+        set = true;
+    }
+
+    if( Command_GetNumber( request, "dst", &value ) )
+    {
+        if( value < 0 || value > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        expression.dst_addr = value;
+        set = true;
+    }
+
+    if( Command_GetArray( request, "b", &bytes, &count ) )
+    {
+        if( (count % 3) != 0 || count > 3 * TRIGGER_MAX_BYTE_MATCHES )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        for( uint8_t i = 0; i < count; i++ )
+        {
+            if( bytes[i] < 0 || bytes[i] > UINT8_MAX )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+        }
+        for( uint8_t i = 0; i < count / 3; i++ )
+        {
+            expression.bytes[i].offset = bytes[3 * i];
+            expression.bytes[i].value = bytes[3 * i + 1];
+            expression.bytes[i].mask = bytes[3 * i + 2];
+        }
+        set = true;
+    }
+
+    if( set )
+    {
+        expression.enabled = ( expression.type_mask != 0 );
+        Trigger_Set( index, &expression );
+    }
+
+    Trigger_Get( index, &expression );
+    Trigger_GetStats( &stats );
+    Command_ResponseAddNumber( response, "n", index );
+    Command_ResponseAddNumber( response, "type", expression.enabled ? expression.type_mask : 0 );
+    if( expression.pan_id != TRIGGER_ANY )
+    {
+        Command_ResponseAddNumber( response, "pan", expression.pan_id );
+    }
+    if( expression.src_addr != TRIGGER_ANY )
+    {
+        Command_ResponseAddNumber( response, "src", expression.src_addr );
+    }
+    if( expression.dst_addr != TRIGGER_ANY )
+    {
+        Command_ResponseAddNumber( response, "dst", expression.dst_addr );
+    }
+    Command_ResponseAddNumber( response, "hits", stats.hits[index] );
+    Command_ResponseAddNumber( response, "eval", stats.evaluated );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Flash log control and status
+op: optional, "start", "stop", "dump" or "erase", status only when absent
+from: optional with dump, dump offset to resume from
+******************************************************************************/
+static Command_Status_t command_flog( Command_Request_t const * request, Command_Response_t * response )
+{
+    FlashLog_Stats_t stats;
+    char const * op;
+    uint8_t length;
+    int32_t from = 0;
+    FlashLog_Result_t result = FLASHLOG_SUCCESS;
+
+    if( Command_GetString( request, "op", &op, &length ) )
+    {
+        if( length == 5 && memcmp( op, "start", 5 ) == 0 )
+        {
+            result = FlashLog_Start();
+        }
+        else if( length == 4 && memcmp( op, "stop", 4 ) == 0 )
+        {
+            FlashLog_Stop();
+        }
+        else if( length == 4 && memcmp( op, "dump", 4 ) == 0 )
+        {
+            Command_GetNumber( request, "from", &from );
+            result = ( from < 0 ) ? FLASHLOG_INVALID_PARAMETER : FlashLog_Dump( from );
+        }
+        else if( length == 5 && memcmp( op, "erase", 5 ) == 0 )
+        {
+            result = FlashLog_Erase();
+        }
+        else
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if( result == FLASHLOG_BUSY )
+    {
+        return COMMAND_STATUS_BUSY;
+    }
+    if( result != FLASHLOG_SUCCESS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    FlashLog_GetStats( &stats );
+    Command_ResponseAddString( response, "state", CommandFlashLogStateNames[stats.state] );
+    Command_ResponseAddNumber( response, "pages", stats.pages );
+    Command_ResponseAddNumber( response, "used", stats.used_pages );
+    Command_ResponseAddNumber( response, "seq", stats.sequence );
+    Command_ResponseAddNumber( response, "wear", stats.max_erases );
+    Command_ResponseAddNumber( response, "end", stats.end );
+    Command_ResponseAddNumber( response, "rec", stats.recorded );
+    Command_ResponseAddNumber( response, "drop", stats.dropped );
+    Command_ResponseAddNumber( response, "err", stats.errors );
+    Command_ResponseAddNumber( response, "off", stats.dump_offset );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Summary mode control and status
+s: optional, summary period in seconds, 0 goes back to live capture
+******************************************************************************/
+static Command_Status_t command_sum( Command_Request_t const * request, Command_Response_t * response )
+{
+    Summary_Stats_t stats;
+    int32_t period;
+
+    if( Command_GetNumber( request, "s", &period ) )
+    {
+        if( period < 0 || period > SUMMARY_PERIOD_MAX_S )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        Summary_SetPeriod( period );
+    }
+
+    Summary_GetStats( &stats );
+    Command_ResponseAddNumber( response, "s", stats.period );
+    Command_ResponseAddNumber( response, "src", stats.sources );
+    Command_ResponseAddNumber( response, "int", stats.intervals );
+    Command_ResponseAddNumber( response, "recs", stats.records );
+    Command_ResponseAddNumber( response, "full", stats.overflow );
+    Command_ResponseAddNumber( response, "bad", stats.unparsed );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Retransmission deduplication control and status
+ms: optional, window in ms, 0 disables
+clr: optional, clears counters once reported
+******************************************************************************/
+static Command_Status_t command_dedup( Command_Request_t const * request, Command_Response_t * response )
+{
+    Dedup_Stats_t stats;
+    int32_t window;
+    int32_t clear = 0;
+
+    if( Command_GetNumber( request, "ms", &window ) )
+    {
+        if( window < 0 || window > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        Dedup_SetWindow( window );
+    }
+
+    Dedup_GetStats( &stats );
+    Command_ResponseAddNumber( response, "ms", stats.window );
+    Command_ResponseAddNumber( response, "held", stats.held );
+    Command_ResponseAddNumber( response, "sup", stats.suppressed );
+    Command_ResponseAddNumber( response, "early", stats.early );
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        Dedup_ClearStats();
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Acknowledgment coalescing control and status
+ms: optional, longest record interval in ms, 0 sends acknowledgments as frames
+******************************************************************************/
+static Command_Status_t command_ack( Command_Request_t const * request, Command_Response_t * response )
+{
+    Ack_Stats_t stats;
+    int32_t interval;
+
+    if( Command_GetNumber( request, "ms", &interval ) )
+    {
+        if( interval < 0 || interval > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        Ack_SetInterval( interval );
+    }
+
+    Ack_GetStats( &stats );
+    Command_ResponseAddNumber( response, "ms", stats.interval );
+    Command_ResponseAddNumber( response, "acks", stats.folded );
+    Command_ResponseAddNumber( response, "recs", stats.records );
+    Command_ResponseAddNumber( response, "drop", stats.dropped );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Flow sampling control and status
+flow: optional, flows fully kept in per mille, 1000 disables sampling
+n: optional with flow, 1 in n frames of other flows kept, 0 for none
+clr: optional, clears counters once reported
+******************************************************************************/
+static Command_Status_t command_samp( Command_Request_t const * request, Command_Response_t * response )
+{
+    Sample_Stats_t stats;
+    int32_t flow;
+    int32_t one_in = SAMPLE_ONE_IN_NONE;
+    int32_t clear = 0;
+
+    if( Command_GetNumber( request, "flow", &flow ) )
+    {
+        Command_GetNumber( request, "n", &one_in );
+        if( flow < 0 || flow > SAMPLE_FLOW_ALL || one_in < 0 || one_in > UINT16_MAX ||
+            !Sample_Set( flow, one_in ) )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    Sample_GetStats( &stats );
+    Command_ResponseAddNumber( response, "flow", stats.flow_fraction );
+    Command_ResponseAddNumber( response, "n", stats.one_in );
+    Command_ResponseAddNumber( response, "kept", stats.flow_kept );
+    Command_ResponseAddNumber( response, "smp", stats.sampled );
+    Command_ResponseAddNumber( response, "drop", stats.dropped );
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        Sample_ClearStats();
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Transmit queue status, queue a single frame
+f: optional, frame without FCS in hexadecimal, larger frames are uploaded on mux channel 4
+m: optional with f, 0 = CSMA-CA (default), 1 = immediate
+h: optional with f, handle reported back when the frame is done
+clr: optional, clears counters once reported
+******************************************************************************/
+static Command_Status_t command_tx( Command_Request_t const * request, Command_Response_t * response )
+{
+    uint8_t frame[COMMAND_MAX_STRING_DATA / 2];
+    PhyTxStats_t stats;
+    Inject_Stats_t inject;
+    PhyTxQueue_Result_t result;
+    char const * hex;
+    uint8_t length;
+    int32_t mode = PHY_TX_MODE_CSMA;
+    int32_t handle = 0;
+    int32_t clear = 0;
+
+    if( Command_GetString( request, "f", &hex, &length ) )
+    {
+        Command_GetNumber( request, "m", &mode );
+        Command_GetNumber( request, "h", &handle );
+        if( (length == 0) || (length & 1) || mode < 0 || mode >= PHY_TX_MODE_SCHEDULED ||
+            handle < 0 || handle > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+
+        length /= 2;
+        for( uint8_t i = 0; i < length; i++ )
+        {
+            int8_t high = command_hex_digit( hex[2 * i] );
+            int8_t low = command_hex_digit( hex[2 * i + 1] );
+            if( high < 0 || low < 0 )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+            frame[i] = (high << 4) | low;
+        }
+
+        result = PHY_QueueFrame( frame, length, mode, handle );
+        if( result == PHY_TX_QUEUE_FULL )
+        {
+            return COMMAND_STATUS_BUSY;
+        }
+        if( result != PHY_TX_QUEUE_SUCCESS )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    PHY_GetTxStats( &stats );
+    Inject_GetStats( &inject );
+    Command_ResponseAddNumber( response, "pend", stats.pending );
+    Command_ResponseAddNumber( response, "queued", stats.queued );
+    Command_ResponseAddNumber( response, "sent", stats.sent );
+    Command_ResponseAddNumber( response, "cca", stats.cca_fail );
+    Command_ResponseAddNumber( response, "err", stats.errors );
+    Command_ResponseAddNumber( response, "rej", stats.rejected );
+    Command_ResponseAddNumber( response, "up", inject.uploads );
+    Command_ResponseAddNumber( response, "bad", inject.malformed );
+    Command_ResponseAddNumber( response, "drop", inject.dropped );
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        PHY_ClearTxStats();
+        Inject_ClearStats();
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Active discovery sweep control and status
+op: optional, "start" sends a beacon request on each channel, PAN table is
+    reported on stats channel once done
+ch: optional with op, channels to visit, all 16 when absent
+ms: optional with op, listening window on each channel
+******************************************************************************/
+static Command_Status_t command_disc( Command_Request_t const * request, Command_Response_t * response )
+{
+    Discover_Stats_t stats;
+    char const * op;
+    uint8_t length;
+    int32_t const * array;
+    uint8_t count;
+    uint32_t mask = DISCOVER_CHANNELS_ALL;
+    int32_t window = DISCOVER_WINDOW_DEFAULT_MS;
+
+    if( Command_GetString( request, "op", &op, &length ) )
+    {
+        if( length != 5 || memcmp( op, "start", 5 ) != 0 )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+
+        if( Command_GetArray( request, "ch", &array, &count ) )
+        {
+            mask = 0;
+            for( uint8_t i = 0; i < count; i++ )
+            {
+                if( array[i] < PHY_CHANNEL_11 || array[i] > PHY_CHANNEL_26 )
+                {
+                    return COMMAND_STATUS_INVALID_PARAMETER;
+                }
+                mask |= 1UL << array[i];
+            }
+        }
+        Command_GetNumber( request, "ms", &window );
+        if( mask == 0 || window <= 0 || window > UINT16_MAX )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+
+        Discover_GetStats( &stats );
+        if( stats.state != DISCOVER_STATE_IDLE )
+        {
+            return COMMAND_STATUS_BUSY;
+        }
+        Discover_Start( mask, window );
+    }
+
+    Discover_GetStats( &stats );
+    Command_ResponseAddString( response, "state", CommandDiscoverStateNames[stats.state] );
+    Command_ResponseAddNumber( response, "sweeps", stats.sweeps );
+    Command_ResponseAddNumber( response, "bcn", stats.beacons );
+    Command_ResponseAddNumber( response, "pans", stats.pans );
+    Command_ResponseAddNumber( response, "full", stats.full );
+    Command_ResponseAddNumber( response, "fail", stats.failed );
+    Command_ResponseAddNumber( response, "us", stats.duration );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Timed replay control and status
+Frames are loaded on mux channel 4 as scheduled records
+op: optional, "start" (optional lead = ms before offset 0), "stop" or "clear"
+******************************************************************************/
+static Command_Status_t command_replay( Command_Request_t const * request, Command_Response_t * response )
+{
+    Replay_Stats_t stats;
+    char const * op;
+    uint8_t length;
+    int32_t lead = REPLAY_LEAD_DEFAULT_MS;
+    Replay_Result_t result = REPLAY_SUCCESS;
+
+    if( Command_GetString( request, "op", &op, &length ) )
+    {
+        if( length == 5 && memcmp( op, "start", 5 ) == 0 )
+        {
+            Command_GetNumber( request, "lead", &lead );
+            if( lead < 0 || lead > UINT16_MAX )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+            result = Replay_Start( lead );
+        }
+        else if( length == 4 && memcmp( op, "stop", 4 ) == 0 )
+        {
+            Replay_Stop();
+        }
+        else if( length == 5 && memcmp( op, "clear", 5 ) == 0 )
+        {
+            Replay_Clear();
+        }
+        else
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if( result == REPLAY_BUSY )
+    {
+        return COMMAND_STATUS_BUSY;
+    }
+    if( result != REPLAY_SUCCESS )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    Replay_GetStats( &stats );
+    Command_ResponseAddString( response, "state", CommandReplayStateNames[stats.state] );
+    Command_ResponseAddNumber( response, "frames", stats.frames );
+    Command_ResponseAddNumber( response, "bytes", stats.bytes );
+    Command_ResponseAddNumber( response, "played", stats.played );
+    Command_ResponseAddNumber( response, "late", stats.late );
+    Command_ResponseAddNumber( response, "runs", stats.runs );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Clock synchronization exchange and wall clock correction
+t1: optional, host time of request echoed back
+ref: optional, extended device time in us, given as a string
+wall: optional, host wall clock in us at ref, given as a string
+ppb: optional, device clock rate error in parts per billion, default 0
+ref, wall and ppb set the correction applied to anchor records
+clr: optional, remove correction
+s: optional, anchor record period in seconds, 0 disables anchor records
+t2 is the time the command end was received, t3 the time the response was
+built, both in extended device time, host computes offset and drift from
+t1, t2, t3 and its own reception time of the response
+******************************************************************************/
+static Command_Status_t command_sync( Command_Request_t const * request, Command_Response_t * response )
+{
+    uint64_t received = Sync_Extend( Console_GetRxTime() );
+    Sync_Stats_t stats;
+    char const * t1;
+    uint8_t length;
+    int64_t reference;
+    int64_t wall;
+    int32_t ppb = 0;
+    int32_t period;
+    int32_t clear;
+    bool has_ref = Command_GetNumber64( request, "ref", &reference );
+    bool has_wall = Command_GetNumber64( request, "wall", &wall );
+
+    if( has_ref != has_wall )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+    Command_GetNumber( request, "ppb", &ppb );
+    if( ppb > SYNC_PPB_MAX || ppb < -SYNC_PPB_MAX || (has_ref && reference < 0) )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+    if( Command_GetNumber( request, "s", &period ) &&
+        (period < 0 || !Sync_SetAnchorPeriod( period )) )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        Sync_ClearCorrection();
+    }
+    if( has_ref )
+    {
+        Sync_SetCorrection( reference, wall, ppb );
+    }
+
+    Sync_GetStats( &stats );
+    Command_ResponseAddNumber( response, "s", stats.period );
+    if( stats.corrected )
+    {
+        Command_ResponseAddNumber( response, "ppb", stats.ppb );
+    }
+    Command_ResponseAddNumber( response, "anch", stats.anchors );
+    Command_ResponseAddNumber( response, "drop", stats.dropped );
+
+    if( Command_GetString( request, "t1", &t1, &length ) )
+    {
+        Sync_CountExchange();
+        //strings are null terminated in shared data
+        Command_ResponseAddString( response, "t1", t1 );
+        Command_ResponseAddNumber64( response, "t2", received );
+        //last field, taken as late as possible
+        Command_ResponseAddNumber64( response, "t3", Sync_Now() );
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Acknowledgment turnaround metrics control and status
+s: optional, record period in seconds, 0 disables
+******************************************************************************/
+static Command_Status_t command_turn( Command_Request_t const * request, Command_Response_t * response )
+{
+    Turnaround_Stats_t stats;
+    int32_t period;
+
+    if( Command_GetNumber( request, "s", &period ) )
+    {
+        if( period < 0 || period > TURNAROUND_PERIOD_MAX_S )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        Turnaround_SetPeriod( period );
+    }
+
+    Turnaround_GetStats( &stats );
+    Command_ResponseAddNumber( response, "s", stats.period );
+    Command_ResponseAddNumber( response, "src", stats.sources );
+    Command_ResponseAddNumber( response, "int", stats.intervals );
+    Command_ResponseAddNumber( response, "recs", stats.records );
+    Command_ResponseAddNumber( response, "ack", stats.acked );
+    Command_ResponseAddNumber( response, "miss", stats.missing );
+    Command_ResponseAddNumber( response, "full", stats.overflow );
+    Command_ResponseAddNumber( response, "bad", stats.unparsed );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Noise floor and channel busy ratio control and status
+ms: optional, record period in ms, 0 disables
+us: optional, RSSI sample period in us, default 1000
+th: optional, busy threshold in dBm, default -75
+******************************************************************************/
+static Command_Status_t command_noise( Command_Request_t const * request, Command_Response_t * response )
+{
+    Noise_Stats_t stats;
+    int32_t period;
+    int32_t sample = NOISE_SAMPLE_DEFAULT_US;
+    int32_t threshold = NOISE_BUSY_DEFAULT_DBM;
+
+    if( Command_GetNumber( request, "ms", &period ) )
+    {
+        Command_GetNumber( request, "us", &sample );
+        Command_GetNumber( request, "th", &threshold );
+        if( period < 0 || period > UINT16_MAX || sample < 0 ||
+            threshold < INT8_MIN || threshold > INT8_MAX ||
+            !Noise_Start( period, sample, threshold ) )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    Noise_GetStats( &stats );
+    Command_ResponseAddNumber( response, "ms", stats.period );
+    Command_ResponseAddNumber( response, "us", stats.sample_us );
+    Command_ResponseAddNumber( response, "th", stats.threshold );
+    Command_ResponseAddNumber( response, "n", stats.samples );
+    Command_ResponseAddNumber( response, "bad", stats.invalid );
+    Command_ResponseAddNumber( response, "recs", stats.records );
+    Command_ResponseAddNumber( response, "drop", stats.dropped );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Secondary channel visits control and status
+op: optional, "start" or "stop"
+ch: secondary channels when starting, current channel is primary
+probe: optional, probe visit length in ms, default 20
+every: optional, interval between probe visits in ms, default 500
+n: optional, report emitter n instead of status
+******************************************************************************/
+static Command_Status_t command_visit( Command_Request_t const * request, Command_Response_t * response )
+{
+    Visit_Stats_t stats;
+    Visit_Emitter_t emitter;
+    char const * op;
+    uint8_t length;
+    int32_t const * array;
+    uint8_t count;
+    uint8_t channels[VISIT_MAX_CHANNELS];
+    int32_t probe = VISIT_PROBE_DEFAULT_MS;
+    int32_t every = VISIT_EVERY_DEFAULT_MS;
+    int32_t index;
+    char address[20];
+
+    if( Command_GetString( request, "op", &op, &length ) )
+    {
+        if( length == 5 && memcmp( op, "start", 5 ) == 0 )
+        {
+            if( !Command_GetArray( request, "ch", &array, &count ) )
+            {
+                return COMMAND_STATUS_MISSING_PARAMETER;
+            }
+            Command_GetNumber( request, "probe", &probe );
+            Command_GetNumber( request, "every", &every );
+            if( count > VISIT_MAX_CHANNELS || probe <= 0 || probe > UINT16_MAX || every <= 0 || every > UINT16_MAX )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+            for( uint8_t i = 0; i < count; i++ )
+            {
+                if( array[i] < PHY_CHANNEL_11 || array[i] > PHY_CHANNEL_26 )
+                {
+                    return COMMAND_STATUS_INVALID_PARAMETER;
+                }
+                channels[i] = array[i];
+            }
+            if( !Visit_Start( channels, count, probe, every ) )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if( length == 4 && memcmp( op, "stop", 4 ) == 0 )
+        {
+            Visit_Stop();
+        }
+        else
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    if( Command_GetNumber( request, "n", &index ) )
+    {
+        if( index < 0 || index > UINT8_MAX || !Visit_GetEmitter( index, &emitter ) )
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+        if( emitter.mode == MAC_ADDRESSING_MODE_EXTENDED_ADDRESS )
+        {
+            snprintf( address, sizeof(address), "0x%08X%08X", (unsigned int)(emitter.address >> 32), (unsigned int)emitter.address );
+        }
+        else
+        {
+            snprintf( address, sizeof(address), "0x%04X", (unsigned int)emitter.address );
+        }
+        Command_ResponseAddNumber( response, "n", index );
+        Command_ResponseAddNumber( response, "ch", emitter.channel );
+        Command_ResponseAddString( response, "k", CommandVisitKindNames[emitter.kind] );
+        Command_ResponseAddString( response, "a", address );
+        snprintf( address, sizeof(address), "0x%04X", emitter.pan_id );
+        Command_ResponseAddString( response, "pan", address );
+        Command_ResponseAddNumber( response, "per", emitter.period );
+        Command_ResponseAddNumber( response, "lock", emitter.locked );
+        Command_ResponseAddNumber( response, "seen", emitter.seen );
+        Command_ResponseAddNumber( response, "hit", emitter.hits );
+        Command_ResponseAddNumber( response, "miss", emitter.misses );
+        return COMMAND_STATUS_SUCCESS;
+    }
+
+    Visit_GetStats( &stats );
+    Command_ResponseAddString( response, "state", CommandVisitStateNames[stats.state] );
+    Command_ResponseAddNumber( response, "pri", stats.primary );
+    Command_ResponseAddNumber( response, "em", stats.emitters );
+    Command_ResponseAddNumber( response, "lock", stats.locked );
+    Command_ResponseAddNumber( response, "probes", stats.probes );
+    Command_ResponseAddNumber( response, "win", stats.windows );
+    Command_ResponseAddNumber( response, "hit", stats.hits );
+    Command_ResponseAddNumber( response, "miss", stats.misses );
+    Command_ResponseAddNumber( response, "full", stats.overflow );
+    Command_ResponseAddNumber( response, "away", stats.away );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief TSCH follow control and status
+op: optional, "start" or "stop"
+pan: optional when starting, PAN to follow, first heard when absent
+off: optional when starting, channel offset followed, default 0
+to: optional when starting, sync loss timeout in s, default 30
+******************************************************************************/
+static Command_Status_t command_tsch( Command_Request_t const * request, Command_Response_t * response )
+{
+    Tsch_Stats_t stats;
+    char const * op;
+    uint8_t length;
+    int32_t pan = TSCH_PAN_ANY;
+    int32_t offset = 0;
+    int32_t timeout = TSCH_TIMEOUT_DEFAULT_S;
+    char text[8];
+
+    if( Command_GetString( request, "op", &op, &length ) )
+    {
+        if( length == 5 && memcmp( op, "start", 5 ) == 0 )
+        {
+            Command_GetNumber( request, "pan", &pan );
+            Command_GetNumber( request, "off", &offset );
+            Command_GetNumber( request, "to", &timeout );
+            if( pan < 0 || pan > UINT16_MAX || offset < 0 || offset > UINT8_MAX ||
+                timeout < 0 || timeout > UINT16_MAX || !Tsch_Start( pan, offset, timeout ) )
+            {
+                return COMMAND_STATUS_INVALID_PARAMETER;
+            }
+        }
+        else if( length == 4 && memcmp( op, "stop", 4 ) == 0 )
+        {
+            Tsch_Stop();
+        }
+        else
+        {
+            return COMMAND_STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    Tsch_GetStats( &stats );
+    Command_ResponseAddString( response, "state", CommandTschStateNames[stats.state] );
+    snprintf( text, sizeof(text), "0x%04X", stats.pan_id );
+    Command_ResponseAddString( response, "pan", text );
+    Command_ResponseAddNumber( response, "off", stats.channel_offset );
+    Command_ResponseAddNumber64( response, "asn", stats.asn );
+    Command_ResponseAddNumber( response, "ch", HAL_GetRadioChannel() );
+    Command_ResponseAddNumber( response, "seq", stats.sequence_length );
+    Command_ResponseAddNumber( response, "ts", stats.timeslot_us );
+    Command_ResponseAddNumber( response, "tx", stats.tx_offset_us );
+    Command_ResponseAddNumber( response, "eb", stats.beacons );
+    Command_ResponseAddNumber( response, "sync", stats.syncs );
+    Command_ResponseAddNumber( response, "lost", stats.losses );
+    Command_ResponseAddNumber( response, "resync", stats.resync_ms );
+    Command_ResponseAddNumber( response, "slots", stats.slots );
+    Command_ResponseAddNumber( response, "late", stats.late );
+    Command_ResponseAddNumber( response, "ins", stats.in_slot );
+    Command_ResponseAddNumber( response, "drop", stats.dropped );
+    return COMMAND_STATUS_SUCCESS;
+}
+
+#ifdef PROFILER_ENABLE
+/**************************************************************************//**
+\brief Report hot path probe durations in core clock cycles
+n: probe number, see Profiler_Probe_t
+clr: optional, clear all probes after report
+Histogram h starts at bucket h0 and ends at last non empty bucket,
+bucket b counts durations of 2^b to 2^(b+1)-1 cycles
+******************************************************************************/
+static Command_Status_t command_prof( Command_Request_t const * request, Command_Response_t * response )
+{
+    Profiler_Stats_t stats;
+    int32_t probe;
+    int32_t clear = 0;
+    uint8_t first = PROFILER_HISTOGRAM_BUCKETS;
+    uint8_t last = 0;
+
+    if( !Command_GetNumber( request, "n", &probe ) )
+    {
+        return COMMAND_STATUS_MISSING_PARAMETER;
+    }
+
+    if( !Profiler_GetStats( probe, &stats ) )
+    {
+        return COMMAND_STATUS_INVALID_PARAMETER;
+    }
+
+    for( uint8_t i = 0; i < PROFILER_HISTOGRAM_BUCKETS; i++ )
+    {
+        if( stats.histogram[i] )
+        {
+            if( first == PROFILER_HISTOGRAM_BUCKETS )
+            {
+                first = i;
+            }
+            last = i;
+        }
+    }
+    if( first == PROFILER_HISTOGRAM_BUCKETS )
+    {
+        //no sample, empty histogram
+        first = 0;
+        last = 0;
+    }
+
+    Command_ResponseAddNumber( response, "n", probe );
+    Command_ResponseAddString( response, "name", Profiler_GetName( probe ) );
+    Command_ResponseAddNumber( response, "cnt", stats.count );
+    Command_ResponseAddNumber( response, "min", stats.count ? stats.min : 0 );
+    Command_ResponseAddNumber( response, "max", stats.max );
+    Command_ResponseAddNumber( response, "avg", stats.count ? (uint32_t)(stats.total / stats.count) : 0 );
+    Command_ResponseAddNumber( response, "h0", first );
+    Command_ResponseAddArray( response, "h", &stats.histogram[first], stats.count ? last - first + 1 : 0 );
+
+    if( Command_GetNumber( request, "clr", &clear ) && clear )
+    {
+        Profiler_Clear();
+    }
+    return COMMAND_STATUS_SUCCESS;
+}
+#endif
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init command parser
+******************************************************************************/
+void Command_Init( void )
+{
+    commandStep = COMMAND_STEP_OPENING_BRACKET;
+    commandPendingBaudrate = 0;
+    commandPendingReset = false;
+    memset( &commandStats, 0, sizeof(commandStats) );
+}
+
+/**************************************************************************//**
+\brief Abort a partially received command
+******************************************************************************/
+void Command_Abort( void )
+{
+    if( commandStep != COMMAND_STEP_OPENING_BRACKET )
+    {
+        command_parse_error();
+    }
+}
+
+/**************************************************************************//**
+\brief Feed one received byte to the streaming parser
+Accept a flat JSON object whose values are numbers, strings, true/false/null
+or arrays of numbers
+******************************************************************************/
+void Command_RxByte( uint8_t byte )
+{
+    Command_Param_t * param;
+    Command_Step_t previous;
+    bool again;
+
+    do {
+        again = false;
+        previous = commandStep;
+        param = &commandRequest.params[commandRequest.count];
+
+        switch( commandStep )
+        {
+        //ignore character until start with opening brackets
+        case COMMAND_STEP_OPENING_BRACKET:
+            if( byte == '{' )
+            {
+                commandRequest.count = 0;
+                commandRequest.strings_length = 0;
+                commandRequest.arrays_length = 0;
+                commandStep = COMMAND_STEP_KEY_START;
+            }
+            break;
+
+        case COMMAND_STEP_KEY_START:
+            if( command_is_whitespace( byte ) )
+            {
+                break;
+            }
+            if( byte == '}' && commandRequest.count == 0 )
+            {
+                commandStep = COMMAND_STEP_OPENING_BRACKET;
+                command_dispatch();
+            }
+            else if( byte == '"' && commandRequest.count < COMMAND_MAX_PARAMS )
+            {
+                param->key[0] = '\0';
+                param->length = 0;
+                commandStep = COMMAND_STEP_KEY;
+            }
+            else
+            {
+                command_parse_error();
+            }
+            break;
+
+        case COMMAND_STEP_KEY:
+            if( byte == '"' )
+            {
+                param->key[param->length] = '\0';
+                commandStep = COMMAND_STEP_COLON;
+            }
+            else if( param->length < COMMAND_MAX_KEY_LENGTH )
+            {
+                param->key[param->length++] = byte;
+            }
+            else
+            {
+                command_parse_error();
+            }
+            break;
+
+        case COMMAND_STEP_COLON:
+            if( byte == ':' )
+            {
+                commandStep = COMMAND_STEP_VALUE_START;
+            }
+            else if( !command_is_whitespace( byte ) )
+            {
+                command_parse_error();
+            }
+            break;
+
+        case COMMAND_STEP_VALUE_START:
+            if( command_is_whitespace( byte ) )
+            {
+                break;
+            }
+            param->number = 0;
+            param->length = 0;
+            if( byte == '"' )
+            {
+                param->type = COMMAND_VALUE_STRING;
+                param->offset = commandRequest.strings_length;
+                commandStep = COMMAND_STEP_STRING;
+            }
+            else if( byte == '[' )
+            {
+                param->type = COMMAND_VALUE_ARRAY;
+                param->offset = commandRequest.arrays_length;
+                commandStep = COMMAND_STEP_ARRAY_VALUE;
+            }
+            else if( command_number_start( byte ) )
+            {
+                param->type = COMMAND_VALUE_NUMBER;
+                commandStep = COMMAND_STEP_NUMBER;
+            }
+            else if( byte >= 'a' && byte <= 'z' )
+            {
+                param->type = COMMAND_VALUE_LITERAL;
+                commandLiteral[0] = byte;
+                commandLiteralLength = 1;
+                commandStep = COMMAND_STEP_LITERAL;
+            }
+            else
+            {
+                command_parse_error();
+            }
+            break;
+
+        case COMMAND_STEP_STRING:
+            if( byte == '"' )
+            {
+                commandRequest.strings[commandRequest.strings_length++] = '\0';
+                commandStep = COMMAND_STEP_NEXT;
+            }
+            //keep room for null terminator
+            else if( commandRequest.strings_length >= COMMAND_MAX_STRING_DATA )
+            {
+                command_parse_error();
+            }
+            else if( byte == '\\' )
+            {
+                commandStep = COMMAND_STEP_STRING_ESCAPE;
+            }
+            else
+            {
+                commandRequest.strings[commandRequest.strings_length++] = byte;
+                param->length++;
+            }
+            break;
+
+        //escaped character is taken as is
+        case COMMAND_STEP_STRING_ESCAPE:
+            commandRequest.strings[commandRequest.strings_length++] = byte;
+            param->length++;
+            commandStep = COMMAND_STEP_STRING;
+            break;
+
+        case COMMAND_STEP_NUMBER:
+            if( command_number_add( byte ) )
+            {
+                break;
+            }
+            if( commandNumberDigits == 0 || commandNumberOverflow )
+            {
+                command_parse_error();
+                break;
+            }
+            param->number = commandNumberNegative ? -commandNumber : commandNumber;
+            commandStep = COMMAND_STEP_NEXT;
+            again = true;
+            break;
+
+        case COMMAND_STEP_LITERAL:
+            if( byte >= 'a' && byte <= 'z' )
+            {
+                if( commandLiteralLength >= COMMAND_LITERAL_MAX_LENGTH )
+                {
+                    command_parse_error();
+                    break;
+                }
+                commandLiteral[commandLiteralLength++] = byte;
+                break;
+            }
+            commandLiteral[commandLiteralLength] = '\0';
+            if( strcmp( commandLiteral, "true" ) == 0 )
+            {
+                param->number = 1;
+            }
+            else if( strcmp( commandLiteral, "false" ) && strcmp( commandLiteral, "null" ) )
+            {
+                command_parse_error();
+                break;
+            }
+            commandStep = COMMAND_STEP_NEXT;
+            again = true;
+            break;
+
+        case COMMAND_STEP_ARRAY_VALUE:
+            if( command_is_whitespace( byte ) )
+            {
+                break;
+            }
+            if( byte == ']' && param->length == 0 )
+            {
+                commandStep = COMMAND_STEP_NEXT;
+            }
+            else if( commandRequest.arrays_length < COMMAND_MAX_ARRAY_DATA &&
+                     command_number_start( byte ) )
+            {
+                commandStep = COMMAND_STEP_ARRAY_NUMBER;
+            }
+            else
+            {
+                command_parse_error();
+            }
+            break;
+
+        case COMMAND_STEP_ARRAY_NUMBER:
+            if( command_number_add( byte ) )
+            {
+                break;
+            }
+            if( commandNumberDigits == 0 || commandNumberOverflow )
+            {
+                command_parse_error();
+                break;
+            }
+            commandRequest.arrays[commandRequest.arrays_length++] = commandNumberNegative ? -commandNumber : commandNumber;
+            param->length++;
+            commandStep = COMMAND_STEP_ARRAY_NEXT;
+            again = true;
+            break;
+
+        case COMMAND_STEP_ARRAY_NEXT:
+            if( byte == ',' )
+            {
+                commandStep = COMMAND_STEP_ARRAY_VALUE;
+            }
+            else if( byte == ']' )
+            {
+                commandStep = COMMAND_STEP_NEXT;
+            }
+            else if( !command_is_whitespace( byte ) )
+            {
+                command_parse_error();
+            }
+            break;
+
+        //value done, wait for next key or end of object
+        case COMMAND_STEP_NEXT:
+            if( command_is_whitespace( byte ) )
+            {
+                break;
+            }
+            if( byte == ',' )
+            {
+                commandRequest.count++;
+                commandStep = COMMAND_STEP_KEY_START;
+            }
+            else if( byte == '}' )
+            {
+                commandRequest.count++;
+                commandStep = COMMAND_STEP_OPENING_BRACKET;
+                command_dispatch();
+            }
+            else
+            {
+                command_parse_error();
+            }
+            break;
+
+        default:
+            commandStep = COMMAND_STEP_OPENING_BRACKET;
+            break;
+        }
+
+        //Resynchronize on an opening bracket that caused an error
+        if( previous != COMMAND_STEP_OPENING_BRACKET &&
+            commandStep == COMMAND_STEP_OPENING_BRACKET &&
+            byte == '{' )
+        {
+            again = true;
+        }
+    } while( again );
+
+}
+
+/**************************************************************************//**
+\brief Command task
+Wait until response left the device before changing baudrate or resetting
+******************************************************************************/
+void Command_Task( void )
+{
+    Mux_Channel_Stats_t control;
+
+    if( !commandPendingBaudrate && !commandPendingReset )
+    {
+        return;
+    }
+
+    Mux_GetChannelStats( MUX_CHANNEL_CONTROL, &control );
+    if( control.queued )
+    {
+        Scheduler_PostDelayed( SCHEDULER_TASK_COMMAND, COMMAND_PENDING_POLL_US );
+        return;
+    }
+    HAL_Console_Flush();
+
+    if( commandPendingReset )
+    {
+        HAL_System_Reset();
+    }
+
+    HAL_Console_SetBaudrate( commandPendingBaudrate );
+    commandPendingBaudrate = 0;
+}
+
+/**************************************************************************//**
+\brief Retreive command statistics
+******************************************************************************/
+void Command_GetStats( Command_Stats_t * stats )
+{
+    if( stats != NULL )
+    {
+        *stats = commandStats;
+    }
+}
+
+/**************************************************************************//**
+\brief Find a parameter by key, returns NULL if absent
+******************************************************************************/
+Command_Param_t const * Command_GetParam( Command_Request_t const * request, char const * key )
+{
+    for( uint8_t i = 0; i < request->count; i++ )
+    {
+        if( strcmp( request->params[i].key, key ) == 0 )
+        {
+            return &request->params[i];
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************//**
+\brief Retreive a number parameter
+******************************************************************************/
+bool Command_GetNumber( Command_Request_t const * request, char const * key, int32_t * value )
+{
+    Command_Param_t const * param = Command_GetParam( request, key );
+    char * end;
+
+    if( param == NULL )
+    {
+        return false;
+    }
+
+    switch( param->type )
+    {
+    case COMMAND_VALUE_NUMBER:
+    case COMMAND_VALUE_LITERAL:
+        *value = param->number;
+        return true;
+    case COMMAND_VALUE_STRING:
+        //strings are null terminated in shared data
+        *value = strtol( &request->strings[param->offset], &end, 0 );
+        return ( param->length != 0 && *end == '\0' );
+    default:
+        return false;
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive a 64 bits number parameter
+******************************************************************************/
+bool Command_GetNumber64( Command_Request_t const * request, char const * key, int64_t * value )
+{
+    Command_Param_t const * param = Command_GetParam( request, key );
+    char * end;
+
+    if( param == NULL )
+    {
+        return false;
+    }
+
+    switch( param->type )
+    {
+    case COMMAND_VALUE_NUMBER:
+        *value = param->number;
+        return true;
+    case COMMAND_VALUE_STRING:
+        //strings are null terminated in shared data
+        *value = strtoll( &request->strings[param->offset], &end, 0 );
+        return ( param->length != 0 && *end == '\0' );
+    default:
+        return false;
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive a string parameter, string is not null terminated
+******************************************************************************/
+bool Command_GetString( Command_Request_t const * request, char const * key, char const ** string, uint8_t * length )
+{
+    Command_Param_t const * param = Command_GetParam( request, key );
+
+    if( param == NULL || param->type != COMMAND_VALUE_STRING )
+    {
+        return false;
+    }
+    *string = &request->strings[param->offset];
+    *length = param->length;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Retreive an array parameter
+******************************************************************************/
+bool Command_GetArray( Command_Request_t const * request, char const * key, int32_t const ** array, uint8_t * count )
+{
+    Command_Param_t const * param = Command_GetParam( request, key );
+
+    if( param == NULL || param->type != COMMAND_VALUE_ARRAY )
+    {
+        return false;
+    }
+    *array = &request->arrays[param->offset];
+    *count = param->length;
+    return true;
+}
+
+/**************************************************************************//**
+\brief Append a number field to a response
+Field is dropped if response is full
+******************************************************************************/
+void Command_ResponseAddNumber( Command_Response_t * response, char const * key, int32_t value )
+{
+    uint16_t free_space = command_response_free( response );
+    int written;
+
+    written = snprintf( &response->buffer[response->length], free_space, ",\"%s\":%d", key, (int)value );
+    if( written > 0 && written < free_space )
+    {
+        response->length += written;
+    }
+}
+
+/**************************************************************************//**
+\brief Append a 64 bits number field to a response
+Field is dropped if response is full
+******************************************************************************/
+void Command_ResponseAddNumber64( Command_Response_t * response, char const * key, int64_t value )
+{
+    uint16_t free_space = command_response_free( response );
+    int written;
+
+    written = snprintf( &response->buffer[response->length], free_space, ",\"%s\":%lld", key, (long long)value );
+    if( written > 0 && written < free_space )
+    {
+        response->length += written;
+    }
+}
+
+/**************************************************************************//**
+\brief Append a string field to a response
+Field is dropped if response is full
+******************************************************************************/
+void Command_ResponseAddString( Command_Response_t * response, char const * key, char const * value )
+{
+    uint16_t free_space = command_response_free( response );
+    int written;
+
+    written = snprintf( &response->buffer[response->length], free_space, ",\"%s\":\"%s\"", key, value );
+    if( written > 0 && written < free_space )
+    {
+        response->length += written;
+    }
+}
+
+/**************************************************************************//**
+\brief Append an array of numbers field to a response
+Field is dropped if response is full
+******************************************************************************/
+void Command_ResponseAddArray( Command_Response_t * response, char const * key, uint32_t const * values, uint8_t count )
+{
+    uint16_t length = response->length;
+    uint16_t limit = response->length + command_response_free( response );
+    int written;
+
+    written = snprintf( &response->buffer[length], limit - length, ",\"%s\":[", key );
+    for( uint8_t i = 0; i < count && written > 0 && written < limit - length; i++ )
+    {
+        length += written;
+        written = snprintf( &response->buffer[length], limit - length, i ? ",%u" : "%u", (unsigned int)values[i] );
+    }
+    if( written > 0 && written < limit - length )
+    {
+        length += written;
+        written = snprintf( &response->buffer[length], limit - length, "]" );
+        if( written > 0 && written < limit - length )
+        {
+            //whole array fits, keep it
+            response->length = length + written;
+        }
+    }
+}
+
+#ifdef UNIT_TEST_COMMAND
+///////////////////////////////////////////////////////////////////////////////
+// Unit test for number parsing, returns parse errors raised by a command
+///////////////////////////////////////////////////////////////////////////////
+static uint32_t command_unit_test_errors( char const * command )
+{
+    Command_Stats_t stats;
+    uint32_t errors;
+
+    Command_GetStats( &stats );
+    errors = stats.parse_errors;
+    while( *command != '\0' )
+    {
+        Command_RxByte( (uint8_t)*command++ );
+    }
+    Command_GetStats( &stats );
+    return stats.parse_errors - errors;
+}
+
+uint8_t Command_UnitTest1( void )
+{
+    //Numbers above INT32_MAX are rejected instead of wrapping
+    if( command_unit_test_errors( "{\"n\":4294967295}" ) != 1 ||
+        command_unit_test_errors( "{\"n\":[1,4294967295]}" ) != 1 ||
+        command_unit_test_errors( "{\"n\":2147483648}" ) != 1 ||
+        command_unit_test_errors( "{\"n\":-2147483648}" ) != 1 )
+    {
+        return false;
+    }
+
+    //Largest values still accepted
+    if( command_unit_test_errors( "{\"n\":2147483647}" ) != 0 ||
+        command_unit_test_errors( "{\"n\":[-2147483647,2147483647]}" ) != 0 )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+uint8_t Command_UnitTest2( void )
+{
+    static Command_Response_t response;
+    static const uint32_t values[] = { 4294967295u, 4294967295u, 4294967295u, 4294967295u };
+
+    //Fields stop short of the trailer, whatever their kind
+    response.length = 0;
+    for( uint16_t i = 0; i < COMMAND_RESPONSE_SIZE; i++ )
+    {
+        Command_ResponseAddNumber( &response, "n", INT32_MIN );
+        Command_ResponseAddString( &response, "s", "abc" );
+        Command_ResponseAddArray( &response, "a", values, 4 );
+    }
+    if( response.length > COMMAND_RESPONSE_SIZE - COMMAND_RESPONSE_TRAILER_SIZE )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+#endif //UNIT_TEST_COMMAND
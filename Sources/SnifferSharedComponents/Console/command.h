@@ -0,0 +1,187 @@
+/****************************************************************************//**
+  \file command.h
+
+  \brief Host command parser and dispatcher
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _COMMAND_H
+#define _COMMAND_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Parser limits, a command exceeding any of them is rejected
+#define COMMAND_MAX_PARAMS              8       //key/value pairs per command
+#define COMMAND_MAX_KEY_LENGTH          8       //characters per key
+#define COMMAND_MAX_STRING_DATA         48      //characters of all string values
+#define COMMAND_MAX_ARRAY_DATA          16      //numbers of all array values
+
+//Largest response sent to host
+#define COMMAND_RESPONSE_SIZE           320
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    COMMAND_STATUS_SUCCESS,
+    COMMAND_STATUS_UNKNOWN_COMMAND,
+    COMMAND_STATUS_MISSING_PARAMETER,
+    COMMAND_STATUS_INVALID_PARAMETER,
+    COMMAND_STATUS_BUSY,
+}Command_Status_t;
+
+typedef enum {
+    COMMAND_VALUE_NUMBER,
+    COMMAND_VALUE_STRING,
+    COMMAND_VALUE_ARRAY,
+    COMMAND_VALUE_LITERAL,              //true, false, null
+}Command_Value_Type_t;
+
+typedef struct {
+    char     key[COMMAND_MAX_KEY_LENGTH + 1];
+    Command_Value_Type_t type;
+    int32_t  number;                    //number, or literal 1 for true and 0 for false/null
+    uint8_t  offset;                    //first character or number in shared data
+    uint8_t  length;                    //string characters or array numbers
+}Command_Param_t;
+
+//A parsed command, strings and arrays point inside shared data
+typedef struct {
+    Command_Param_t params[COMMAND_MAX_PARAMS];
+    uint8_t  count;
+    char     strings[COMMAND_MAX_STRING_DATA + 1];
+    uint8_t  strings_length;
+    int32_t  arrays[COMMAND_MAX_ARRAY_DATA];
+    uint8_t  arrays_length;
+}Command_Request_t;
+
+//Response under construction, see Command_ResponseAddNumber
+typedef struct {
+    char     buffer[COMMAND_RESPONSE_SIZE];
+    uint16_t length;
+}Command_Response_t;
+
+typedef struct {
+    uint32_t received;                  //commands parsed
+    uint32_t rejected;                  //commands answered with an error status
+    uint32_t parse_errors;              //malformed or oversized commands
+}Command_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init command parser
+******************************************************************************/
+void Command_Init( void );
+
+/**************************************************************************//**
+\brief Feed one received byte to the streaming parser
+Command is dispatched as soon as its closing bracket is received
+******************************************************************************/
+void Command_RxByte( uint8_t byte );
+
+/**************************************************************************//**
+\brief Abort a partially received command
+******************************************************************************/
+void Command_Abort( void );
+
+/**************************************************************************//**
+\brief Command task
+Perform actions that must wait for the response to be sent (baud, reset)
+******************************************************************************/
+void Command_Task( void );
+
+/**************************************************************************//**
+\brief Retreive command statistics
+******************************************************************************/
+void Command_GetStats( Command_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Find a parameter by key, returns NULL if absent
+******************************************************************************/
+Command_Param_t const * Command_GetParam( Command_Request_t const * request, char const * key );
+
+/**************************************************************************//**
+\brief Retreive a number parameter
+A string value is converted, so "0x1A2B" is accepted as well as 6699
+returns false if absent or not a number
+******************************************************************************/
+bool Command_GetNumber( Command_Request_t const * request, char const * key, int32_t * value );
+
+/**************************************************************************//**
+\brief Retreive a 64 bits number parameter
+Values beyond 32 bits must be given as a string, "1700000000123456"
+returns false if absent or not a number
+******************************************************************************/
+bool Command_GetNumber64( Command_Request_t const * request, char const * key, int64_t * value );
+
+/**************************************************************************//**
+\brief Retreive a string parameter, string is not null terminated
+returns false if absent or not a string
+******************************************************************************/
+bool Command_GetString( Command_Request_t const * request, char const * key, char const ** string, uint8_t * length );
+
+/**************************************************************************//**
+\brief Retreive an array parameter
+returns false if absent or not an array
+******************************************************************************/
+bool Command_GetArray( Command_Request_t const * request, char const * key, int32_t const ** array, uint8_t * count );
+
+/**************************************************************************//**
+\brief Append a number field to a response
+******************************************************************************/
+void Command_ResponseAddNumber( Command_Response_t * response, char const * key, int32_t value );
+
+/**************************************************************************//**
+\brief Append a 64 bits number field to a response
+******************************************************************************/
+void Command_ResponseAddNumber64( Command_Response_t * response, char const * key, int64_t value );
+
+/**************************************************************************//**
+\brief Append a string field to a response
+******************************************************************************/
+void Command_ResponseAddString( Command_Response_t * response, char const * key, char const * value );
+
+/**************************************************************************//**
+\brief Append an array of numbers field to a response
+******************************************************************************/
+void Command_ResponseAddArray( Command_Response_t * response, char const * key, uint32_t const * values, uint8_t count );
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+//  Unit tests
+///////////////////////////////////////////////////////////////////////////////
+uint8_t Command_UnitTest1( void );
+uint8_t Command_UnitTest2( void );
+
+#endif // _COMMAND_H
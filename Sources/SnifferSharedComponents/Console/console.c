@@ -28,19 +28,26 @@ SOFTWARE.
 ******************************************************************************/
 
 #include "console.h"
+#include "console_mux.h"
+#include "command.h"
+#include "capture_inject.h"
+#include "log.h"
+#include "scheduler.h"
+#include "profiler.h"
 #include "Hal_Console.h"
-#include "jsmn.h"
 #include "string.h"
-#include "stdlib.h"     //for strtol
+#include "stdarg.h"
+#include "inttypes.h"
 #include "Hal.h"
 
 /***************************************************************************//**
  * Private defines
  ******************************************************************************/
-#define CONSOLE_RX_BUFFER_SIZE      16
+//Must be a power of 2
+#define CONSOLE_RX_BUFFER_SIZE      512
+#define CONSOLE_RX_BUFFER_MSK       (CONSOLE_RX_BUFFER_SIZE - 1)
 
-#define MAX_JSON_RX_LENGTH          CONSOLE_RX_BUFFER_SIZE
-#define MAX_JSON_RX_TOKEN           8
+#define CONSOLE_PRINT_BUFFER_SIZE   128
 
 
 #define ATTRIBUT_DELIMITER				':'
@@ -53,32 +60,25 @@ SOFTWARE.
 /***************************************************************************//**
  * Private types
  ******************************************************************************/
-//wait for valid JSON
-typedef enum {
-    JSON_STEP_OPENING_BRACKET,
-    JSON_STEP_CARRIAGE_RETURN,
-}JSON_Steps_t;
-
 /***************************************************************************//**
  * Local function protoypes
  ******************************************************************************/
-static void console_serialize_json( uint8_t byte );
-static void console_process_rx_json( uint8_t * json, uint8_t len );
-
 /***************************************************************************//**
  * Local variables
  ******************************************************************************/
 static uint8_t rxFifo[CONSOLE_RX_BUFFER_SIZE];      //Buffer of received byte for console
-static uint8_t rxFifoIn = 0;                        //Head index of circular buffer
-static uint8_t rxFifoOut = 0;                       //Tail index of circular buffer
-
-static JSON_Steps_t jsonRxStep = JSON_STEP_OPENING_BRACKET;
-static uint8_t jsonRxBuffer[MAX_JSON_RX_LENGTH];
-static uint8_t jsonRxLength = 0;                    //Count number of bytes received
+static volatile uint16_t rxFifoIn = 0;              //Head index of circular buffer, written by interrupt
+static volatile uint16_t rxFifoOut = 0;             //Tail index of circular buffer
+static volatile uint32_t rxFifoOverflows = 0;       //Count bytes lost because buffer was full
+static volatile uint32_t rxCommandTime = 0;         //Radio time of last command end byte, see Console_GetRxTime
 
 #define JSON_TX_BUFFER_SIZE  512
 static uint8_t jsonTxBuffer[JSON_TX_BUFFER_SIZE];
 
+//Binary record: 9 bytes header, frame and up to 5 bytes of trailer
+#define BINARY_TX_BUFFER_SIZE  (9 + PHY_PAYLOAD_MAX + 5)
+static uint8_t binaryTxBuffer[BINARY_TX_BUFFER_SIZE];
+
 static const uint8_t HexToAscii[] = {
     '0',
     '1',
@@ -102,66 +102,12 @@ static const uint8_t HexToAscii[] = {
 /***************************************************************************//**
  * Local functions
  ******************************************************************************/
-static void console_process_rx_json( uint8_t * json, uint8_t len );
 static void write_json_parameter(uint8_t * buffer, uint16_t *Index, char Attribut, uint8_t* Data, uint8_t Length, const char* Format, uint8_t isInt);
 
-/**************************************************************************//**
-\brief Process received JSON
-******************************************************************************/
-static void console_process_rx_json( uint8_t * json, uint8_t len )
-{
-    jsmn_parser JsmnParser = { 0 };
-    jsmntok_t JsmnTokens[MAX_JSON_RX_TOKEN];
-    uint8_t i = 0;
-
-    memset(&JsmnTokens, 0, sizeof(JsmnTokens));
-    //Parse JSON payload
-    jsmn_init(&JsmnParser);
-    jsmn_parse(&JsmnParser, (char *) json, len, JsmnTokens, MAX_JSON_RX_TOKEN);
-
-    //Process JSON
-    i = 0;
-    while (JsmnTokens[i].type != JSMN_UNDEFINED && i < MAX_JSON_RX_TOKEN)
-    {
-        if (JsmnTokens[i].type == JSMN_OBJECT)
-        {
-            i++;
-        }
-        //JSMN_STRING
-        else if (JsmnTokens[i].type == JSMN_STRING)
-        {
-            switch (json[JsmnTokens[i].start])
-            {
-            // Channel
-            //example: {"C":11}
-            case 'C':
-                {
-                    uint8_t channel;
-                    i++;
-                    //channel = atoi((char *) &json[JsmnTokens[i].start]);
-                    channel = strtol((char *) &json[JsmnTokens[i].start], NULL, 10);
-                    if( channel >= 11 && channel <= 26 )
-                    {
-                        // PHY_SetChannel(channel);
-                        HAL_SetRadioChannel(channel);
-                    }
-                }
-                break;
-            default:
-                break;
-            }
-            i++;
-        }
-        else {
-            i++;
-        }
-    }
-}
-
 /**************************************************************************//**
 \brief Write JSON parameter to buffer
 ******************************************************************************/
-static void write_json_parameter(uint8_t * buffer, uint16_t *Index, char Attribut, uint8_t* Data, uint8_t Length, const char* Format, uint8_t isInt)
+HAL_RAMFUNC static void write_json_parameter(uint8_t * buffer, uint16_t *Index, char Attribut, uint8_t* Data, uint8_t Length, const char* Format, uint8_t isInt)
 {
 	buffer[(*Index)++] = '"';
 	buffer[(*Index)++] = Attribut;
@@ -191,11 +137,45 @@ void Console_Init( void )
 {
     rxFifoIn = 0;
     rxFifoOut = 0;
-    jsonRxLength = 0;
-    jsonRxStep = JSON_STEP_OPENING_BRACKET;
+    rxFifoOverflows = 0;
     HAL_Console_Init();
 }
 
+/**************************************************************************//**
+\brief Print a single byte to console
+Byte is sent as a text record on the log channel
+******************************************************************************/
+void Console_PutByte( uint8_t byte )
+{
+    Log_WriteText( LOG_LEVEL_INFO, &byte, 1 );
+}
+
+/**************************************************************************//**
+\brief Send a formatted string to console
+String is formatted by target and sent as a text record on the log channel,
+use LOG() on hot paths
+******************************************************************************/
+void Console_Print( const char * count, ...)
+{
+    char text[CONSOLE_PRINT_BUFFER_SIZE];
+    va_list va;
+    int size;
+
+    va_start( va, count );
+    size = vsnprintf( text, sizeof(text), count, va );
+    va_end( va );
+
+    if( size <= 0 )
+    {
+        return;
+    }
+    if( size >= (int)sizeof(text) )
+    {
+        size = sizeof(text) - 1;
+    }
+    Log_WriteText( LOG_LEVEL_INFO, (uint8_t const *)text, size );
+}
+
 /**************************************************************************//**
 \brief Send a buffer content to console
 ******************************************************************************/
@@ -208,18 +188,70 @@ void Console_Write( uint8_t const * buffer, uint16_t size )
     }
 }
 
+/**************************************************************************//**
+\brief Start sending a buffer content to console, returns immediately
+******************************************************************************/
+bool Console_WriteAsync( uint8_t const * buffer, uint16_t size )
+{
+    return HAL_Console_Tx_Dma( buffer, size );
+}
+
+/**************************************************************************//**
+\brief Return true while a buffer given to Console_WriteAsync is being sent
+******************************************************************************/
+bool Console_IsTxBusy( void )
+{
+    return HAL_Console_Tx_Busy();
+}
+
+/**************************************************************************//**
+\brief Console transmission done handler, called from interrupt context
+Multiplexer can send its next frame
+******************************************************************************/
+void Console_TxDone( void )
+{
+    Scheduler_Post( SCHEDULER_TASK_MUX );
+}
+
 /**************************************************************************//**
 \brief Console reception handler
     Can be called from interrupt context, so keep simple
 ******************************************************************************/
 void Console_RxByte( uint8_t byte )
 {
+    uint16_t next = (rxFifoIn + 1) & CONSOLE_RX_BUFFER_MSK;
+
+    //Keep oldest bytes, a command is useless once truncated anyway
+    if( next == rxFifoOut )
+    {
+        rxFifoOverflows++;
+        return;
+    }
     rxFifo[rxFifoIn] = byte;
-    rxFifoIn++;
-    if( rxFifoIn >= CONSOLE_RX_BUFFER_SIZE )
+    rxFifoIn = next;
+
+    //Raw JSON command or mux frame end, a mux frame start is overwritten by its end
+    if( byte == '}' || byte == MUX_FLAG )
     {
-        rxFifoIn = 0;
+        rxCommandTime = HAL_Radio_GetTime();
     }
+    Scheduler_Post( SCHEDULER_TASK_CONSOLE_RX );
+}
+
+/**************************************************************************//**
+\brief Return number of received bytes lost because RX buffer was full
+******************************************************************************/
+uint32_t Console_GetRxOverflows( void )
+{
+    return rxFifoOverflows;
+}
+
+/**************************************************************************//**
+\brief Return radio time of reception of last command end byte
+******************************************************************************/
+uint32_t Console_GetRxTime( void )
+{
+    return rxCommandTime;
 }
 
 
@@ -231,53 +263,42 @@ void Console_Process_Rx( void )
     //Process all byte received
     while( rxFifoIn != rxFifoOut )
     {
-        console_serialize_json( rxFifo[rxFifoOut] );
-        rxFifoOut++;
-        if( rxFifoOut >= CONSOLE_RX_BUFFER_SIZE )
+        //Bytes inside a mux frame are handled by the multiplexer
+        if( !Mux_RxByte( rxFifo[rxFifoOut] ) )
         {
-            rxFifoOut = 0;
+            Command_RxByte( rxFifo[rxFifoOut] );
         }
+        rxFifoOut = (rxFifoOut + 1) & CONSOLE_RX_BUFFER_MSK;
     }
 }
 
 /**************************************************************************//**
-\brief Build received JSON buffer
+\brief Mux frame received from host
+Control channel carries the same JSON commands as the raw console,
+a mux frame holds a single command
+Transmit channel carries a batch of frames to transmit
 ******************************************************************************/
-static void console_serialize_json( uint8_t byte )
+void Mux_RxMsgCallback( Mux_Channel_t channel, uint8_t const * payload, uint16_t size )
 {
-    switch( jsonRxStep )
+    if( channel == MUX_CHANNEL_TX )
     {
-    //ignore character until start with opening brackets
-    case JSON_STEP_OPENING_BRACKET:
-        if( byte == '{')
-        {
-            jsonRxLength = 0;
-            jsonRxBuffer[jsonRxLength++] = byte;
-            jsonRxStep = JSON_STEP_CARRIAGE_RETURN;
-        }
-        break;
-    //Once opening bracket is received, wait for carriage return
-    case JSON_STEP_CARRIAGE_RETURN:
-        jsonRxBuffer[jsonRxLength++] = byte;
-        if( byte == '\r')
-        {
-            console_process_rx_json( jsonRxBuffer, jsonRxLength );
-            jsonRxLength = 0;
-            jsonRxStep = JSON_STEP_OPENING_BRACKET;
-        }
-        else if( jsonRxLength >= MAX_JSON_RX_LENGTH )
-        {
-            //Received JSON is too large - drop it!
-            jsonRxLength = 0;
-            jsonRxStep = JSON_STEP_OPENING_BRACKET;
-        }
-        break;
-    default:
-        //do nothing
-        break;
+        Inject_Upload( payload, size );
+        return;
     }
-}
 
+    if( channel != MUX_CHANNEL_CONTROL )
+    {
+        return;
+    }
+
+    //Drop any partial command received outside of a mux frame
+    Command_Abort();
+    while( size-- )
+    {
+        Command_RxByte( *payload++ );
+    }
+    Command_Abort();
+}
 
 /**************************************************************************//**
 \brief JSON buffer V2
@@ -293,8 +314,29 @@ Example:
 {"L":50,"Q":255,"R":-94,"S":"4188a31e48ffff00000912fcff000001cc0885dafeffd76b0828f6ea32000885dafeffd76b0800295e19cad6ebd84ca2aee2"}
 ******************************************************************************/
 void Console_PhyToJSONV2( PhyRx_t * phy_rx)
+{
+    Console_PhyToJSON( phy_rx, 0, false );
+}
+
+/**************************************************************************//**
+\brief JSON buffer with snaplen and timestamp
+Same as JSON V2, L keeps the length of the frame received over the air
+when S is truncated to snaplen bytes
+T = radio timestamp of end of frame in us, only when timestamp is true
+Example:
+{"L":50,"Q":255,"R":-94,"C":11,"T":12345678,"S":"4188a31e48ffff00"}
+******************************************************************************/
+HAL_RAMFUNC Mux_Write_Result_t Console_PhyToJSON( PhyRx_t * phy_rx, uint8_t snaplen, bool timestamp )
 {
     uint16_t i = 0;
+    uint8_t len = phy_rx->len;
+    Mux_Write_Result_t result;
+    PROF_START( PROFILER_PROBE_PHY_TO_JSON );
+
+    if( snaplen && snaplen < len )
+    {
+        len = snaplen;
+    }
 
     memset(jsonTxBuffer, 0, JSON_TX_BUFFER_SIZE );
 
@@ -304,12 +346,24 @@ void Console_PhyToJSONV2( PhyRx_t * phy_rx)
     write_json_parameter(jsonTxBuffer, &i, 'Q', (uint8_t *)(uint32_t)phy_rx->lqi, 3+1, "%d", true);
     write_json_parameter(jsonTxBuffer, &i, 'R', (uint8_t *)(uint32_t)phy_rx->rssi, 3+1, "%d", true);
     write_json_parameter(jsonTxBuffer, &i, 'C', (uint8_t *)(uint32_t)phy_rx->channel, 3+1, "%d", true);
+    if( timestamp )
+    {
+        i += snprintf( (char *)&jsonTxBuffer[i], 4+10+1+1, "\"T\":%" PRIu32 ",", phy_rx->timestamp );
+    }
+    if( phy_rx->repeats )
+    {
+        write_json_parameter(jsonTxBuffer, &i, 'N', (uint8_t *)(uint32_t)phy_rx->repeats, 3+1, "%d", true);
+    }
+    if( phy_rx->weight > 1 )
+    {
+        write_json_parameter(jsonTxBuffer, &i, 'W', (uint8_t *)(uint32_t)phy_rx->weight, 5+1, "%d", true);
+    }
     jsonTxBuffer[i++] = '"';
     jsonTxBuffer[i++] = 'S';
     jsonTxBuffer[i++] = '"';
     jsonTxBuffer[i++] = ATTRIBUT_DELIMITER;
     jsonTxBuffer[i++] = STRING_START_DELIMITER;
-    for( uint8_t j = 0; j < phy_rx->len && i < (JSON_TX_BUFFER_SIZE-(4+4+1)); j++ )
+    for( uint8_t j = 0; j < len && i < (JSON_TX_BUFFER_SIZE-(4+4+1)); j++ )
     {
         uint8_t rx_byte = phy_rx->payload[j];
         jsonTxBuffer[i++] = HexToAscii[((rx_byte >> 4) & 0x0F)];
@@ -320,7 +374,54 @@ void Console_PhyToJSONV2( PhyRx_t * phy_rx)
     jsonTxBuffer[i++] = '\n';
     jsonTxBuffer[i++] = '\r';
 
-    Console_Write(jsonTxBuffer, i);
+    result = Mux_Write(MUX_CHANNEL_CAPTURE, jsonTxBuffer, i);
+    PROF_STOP( PROFILER_PROBE_PHY_TO_JSON );
+    return result;
 }
 
+/**************************************************************************//**
+\brief Binary capture record
+Only meaningful inside a mux frame, record is:
+length (1) | captured length (1) | LQI (1) | RSSI (1) | channel (1) |
+timestamp in us (4, LSB first) | captured bytes | optional trailer
+trailer is tag and value pairs, 'N' (1) repeats, 'W' (2, LSB first) weight
+******************************************************************************/
+HAL_RAMFUNC Mux_Write_Result_t Console_PhyToBinary( PhyRx_t * phy_rx, uint8_t snaplen )
+{
+    uint16_t i = 0;
+    uint8_t len = phy_rx->len;
+
+    if( snaplen && snaplen < len )
+    {
+        len = snaplen;
+    }
+    if( len > PHY_PAYLOAD_MAX )
+    {
+        len = PHY_PAYLOAD_MAX;
+    }
 
+    binaryTxBuffer[i++] = phy_rx->len;
+    binaryTxBuffer[i++] = len;
+    binaryTxBuffer[i++] = phy_rx->lqi;
+    binaryTxBuffer[i++] = (uint8_t)phy_rx->rssi;
+    binaryTxBuffer[i++] = phy_rx->channel;
+    binaryTxBuffer[i++] = (uint8_t)(phy_rx->timestamp);
+    binaryTxBuffer[i++] = (uint8_t)(phy_rx->timestamp >> 8);
+    binaryTxBuffer[i++] = (uint8_t)(phy_rx->timestamp >> 16);
+    binaryTxBuffer[i++] = (uint8_t)(phy_rx->timestamp >> 24);
+    memcpy( &binaryTxBuffer[i], phy_rx->payload, len );
+    i += len;
+    if( phy_rx->repeats )
+    {
+        binaryTxBuffer[i++] = 'N';
+        binaryTxBuffer[i++] = phy_rx->repeats;
+    }
+    if( phy_rx->weight > 1 )
+    {
+        binaryTxBuffer[i++] = 'W';
+        binaryTxBuffer[i++] = (uint8_t)(phy_rx->weight);
+        binaryTxBuffer[i++] = (uint8_t)(phy_rx->weight >> 8);
+    }
+
+    return Mux_Write(MUX_CHANNEL_CAPTURE, binaryTxBuffer, i);
+}
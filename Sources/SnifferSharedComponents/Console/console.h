@@ -34,6 +34,7 @@ SOFTWARE.
 ******************************************************************************/
 #include "printf.h"
 #include "mac.h"
+#include "console_mux.h"
 
 /******************************************************************************
                    Define(s) section
@@ -59,6 +60,23 @@ void Console_PutByte( uint8_t byte );
 ******************************************************************************/
 void Console_Write( uint8_t const * buffer, uint16_t size );
 
+/**************************************************************************//**
+\brief Start sending a buffer content to console, returns immediately
+Buffer must remain unchanged until Console_IsTxBusy() returns false
+returns false if a previous buffer is still being sent
+******************************************************************************/
+bool Console_WriteAsync( uint8_t const * buffer, uint16_t size );
+
+/**************************************************************************//**
+\brief Return true while a buffer given to Console_WriteAsync is being sent
+******************************************************************************/
+bool Console_IsTxBusy( void );
+
+/**************************************************************************//**
+\brief Console transmission done handler, called from interrupt context
+******************************************************************************/
+void Console_TxDone( void );
+
 /**************************************************************************//**
 \brief Send a formatted string to console
 ******************************************************************************/
@@ -69,6 +87,17 @@ void Console_Print( const char * count, ...);
 ******************************************************************************/
 void Console_RxByte( uint8_t byte );
 
+/**************************************************************************//**
+\brief Return number of received bytes lost because RX buffer was full
+******************************************************************************/
+uint32_t Console_GetRxOverflows( void );
+
+/**************************************************************************//**
+\brief Return radio time of reception of last command end byte
+Time is taken in reception interrupt, before command parsing delays
+******************************************************************************/
+uint32_t Console_GetRxTime( void );
+
 /**************************************************************************//**
 \brief Process uart reception
 ******************************************************************************/
@@ -89,6 +118,26 @@ Example:
 ******************************************************************************/
 void Console_PhyToJSONV2( PhyRx_t * phy_rx);
 
+/**************************************************************************//**
+\brief JSON buffer with snaplen and timestamp
+Same as JSON V2, L keeps the length of the frame received over the air
+when S is truncated to snaplen bytes (0 for whole frame)
+T = radio timestamp of end of frame in us, only when timestamp is true
+N = identical copies (MAC retries) received after this one, only when not 0
+W = sampling weight, frames this one stands for, only when more than 1
+Example:
+{"L":50,"Q":255,"R":-94,"C":11,"T":12345678,"S":"4188a31e48ffff00"}
+******************************************************************************/
+Mux_Write_Result_t Console_PhyToJSON( PhyRx_t * phy_rx, uint8_t snaplen, bool timestamp );
+
+/**************************************************************************//**
+\brief Binary capture record, only meaningful inside a mux frame
+length (1) | captured length (1) | LQI (1) | RSSI (1) | channel (1) |
+timestamp in us (4, LSB first) | captured bytes | optional trailer
+trailer is tag and value pairs, 'N' (1) repeats, 'W' (2, LSB first) weight
+******************************************************************************/
+Mux_Write_Result_t Console_PhyToBinary( PhyRx_t * phy_rx, uint8_t snaplen );
+
 
 
 #endif // _CONSOLE_H
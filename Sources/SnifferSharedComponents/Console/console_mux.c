@@ -0,0 +1,512 @@
+/***************************************************************************//**
+ @file console_mux.c
+  @brief   Virtual channel multiplexer for the console serial link
+           Each channel has its own queue, priority and credits so a slow
+           consumer of one stream never stalls another one
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+#include "console_mux.h"
+#include "console.h"
+#include "crc.h"
+#include "scheduler.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+//Size of channel and sequence fields
+#define MUX_HEADER_SIZE             2
+#define MUX_CRC_SIZE                2
+
+//Each queued message is prefixed by its length (uint16_t)
+#define MUX_QUEUE_RECORD_HEADER     2
+
+#define MUX_RAW_FRAME_SIZE          (MUX_HEADER_SIZE + MUX_MAX_PAYLOAD + MUX_CRC_SIZE)
+//worst case every byte is escaped, plus two flags
+#define MUX_WIRE_FRAME_SIZE         ((MUX_RAW_FRAME_SIZE * 2) + 2)
+
+#define MUX_CONTROL_QUEUE_SIZE      512
+#define MUX_CAPTURE_QUEUE_SIZE      4096
+#define MUX_STATS_QUEUE_SIZE        512
+#define MUX_LOG_QUEUE_SIZE          1024
+#define MUX_TX_QUEUE_SIZE           1024
+
+/***************************************************************************//**
+ * Private types
+ ******************************************************************************/
+typedef struct {
+    uint8_t *   buffer;
+    uint16_t    size;
+    uint8_t     default_priority;
+    bool        legacy;             //written raw to console when mux disabled
+}Mux_Channel_Config_t;
+
+typedef struct {
+    uint16_t    in;                 //Head index of circular buffer
+    uint16_t    out;                //Tail index of circular buffer
+    uint16_t    used;               //number of bytes in circular buffer
+    uint16_t    credits;
+    uint8_t     priority;
+    uint32_t    frames;
+    uint32_t    bytes;
+    uint32_t    drops;
+}Mux_Queue_t;
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void mux_queue_push( Mux_Channel_t channel, uint8_t const * data, uint16_t size );
+static void mux_queue_pop( Mux_Channel_t channel, uint8_t * data, uint16_t size );
+static uint16_t mux_stuff_byte( uint8_t * wire, uint16_t index, uint8_t byte );
+static void mux_process_rx_frame( void );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static uint8_t muxControlQueue[MUX_CONTROL_QUEUE_SIZE];
+static uint8_t muxCaptureQueue[MUX_CAPTURE_QUEUE_SIZE];
+static uint8_t muxStatsQueue[MUX_STATS_QUEUE_SIZE];
+static uint8_t muxLogQueue[MUX_LOG_QUEUE_SIZE];
+static uint8_t muxTxQueue[MUX_TX_QUEUE_SIZE];
+
+static const Mux_Channel_Config_t MuxChannelConfig[MUX_CHANNEL_COUNT] =
+{
+    //buffer            //size                      //default_priority  //legacy
+{   muxControlQueue,    MUX_CONTROL_QUEUE_SIZE,     3,                  true    },
+{   muxCaptureQueue,    MUX_CAPTURE_QUEUE_SIZE,     2,                  true    },
+{   muxStatsQueue,      MUX_STATS_QUEUE_SIZE,       1,                  true    },
+{   muxLogQueue,        MUX_LOG_QUEUE_SIZE,         0,                  false   },
+{   muxTxQueue,         MUX_TX_QUEUE_SIZE,          1,                  true    },
+};
+
+static Mux_Queue_t muxQueue[MUX_CHANNEL_COUNT];
+static bool muxEnabled = false;
+static uint8_t muxTxSequence = 0;
+
+static uint8_t muxRawFrame[MUX_RAW_FRAME_SIZE];     //frame being sent before byte stuffing
+static uint8_t muxWireFrame[MUX_WIRE_FRAME_SIZE];   //frame being sent after byte stuffing
+
+static uint8_t muxRxFrame[MUX_RAW_FRAME_SIZE];
+static uint16_t muxRxLength = 0;
+static bool muxRxInFrame = false;
+static bool muxRxEscape = false;
+static uint32_t muxRxErrors = 0;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Copy data to channel circular buffer, caller verified space is available
+******************************************************************************/
+static void mux_queue_push( Mux_Channel_t channel, uint8_t const * data, uint16_t size )
+{
+    Mux_Queue_t * queue = &muxQueue[channel];
+    Mux_Channel_Config_t const * config = &MuxChannelConfig[channel];
+
+    while( size-- )
+    {
+        config->buffer[queue->in++] = *data++;
+        if( queue->in >= config->size )
+        {
+            queue->in = 0;
+        }
+        queue->used++;
+    }
+}
+
+/**************************************************************************//**
+\brief Copy data from channel circular buffer, caller verified data is available
+******************************************************************************/
+static void mux_queue_pop( Mux_Channel_t channel, uint8_t * data, uint16_t size )
+{
+    Mux_Queue_t * queue = &muxQueue[channel];
+    Mux_Channel_Config_t const * config = &MuxChannelConfig[channel];
+
+    while( size-- )
+    {
+        *data++ = config->buffer[queue->out++];
+        if( queue->out >= config->size )
+        {
+            queue->out = 0;
+        }
+        queue->used--;
+    }
+}
+
+/**************************************************************************//**
+\brief Write a byte to wire buffer escaping flag and escape characters
+******************************************************************************/
+static uint16_t mux_stuff_byte( uint8_t * wire, uint16_t index, uint8_t byte )
+{
+    if( (byte == MUX_FLAG) || (byte == MUX_ESCAPE) )
+    {
+        wire[index++] = MUX_ESCAPE;
+        byte ^= MUX_ESCAPE_XOR;
+    }
+    wire[index++] = byte;
+    return index;
+}
+
+/**************************************************************************//**
+\brief Validate and dispatch a frame received from host
+******************************************************************************/
+static void mux_process_rx_frame( void )
+{
+    uint16_t crc_calc;
+    uint16_t crc_rcv;
+    uint8_t channel;
+
+    if( muxRxLength < (MUX_HEADER_SIZE + MUX_CRC_SIZE) )
+    {
+        muxRxErrors++;
+        return;
+    }
+
+    crc_calc = crcFast( muxRxFrame, muxRxLength - MUX_CRC_SIZE );
+    crc_rcv = muxRxFrame[muxRxLength - 2];
+    crc_rcv |= (((uint16_t) muxRxFrame[muxRxLength - 1]) << 8);
+    if( crc_calc != crc_rcv )
+    {
+        muxRxErrors++;
+        return;
+    }
+
+    //A valid frame from host means it understands mux framing
+    muxEnabled = true;
+
+    channel = muxRxFrame[0];
+    if( channel & MUX_CREDIT_GRANT_FLAG )
+    {
+        channel &= ~MUX_CREDIT_GRANT_FLAG;
+        if( (channel < MUX_CHANNEL_COUNT) && (muxRxLength >= (MUX_HEADER_SIZE + 2 + MUX_CRC_SIZE)) )
+        {
+            Mux_GrantCredits( channel, muxRxFrame[2] | (((uint16_t) muxRxFrame[3]) << 8) );
+        }
+        return;
+    }
+
+    if( channel < MUX_CHANNEL_COUNT )
+    {
+        Mux_RxMsgCallback( channel, &muxRxFrame[MUX_HEADER_SIZE], muxRxLength - (MUX_HEADER_SIZE + MUX_CRC_SIZE) );
+    }
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init multiplexer, mux framing is disabled until host opt-in
+******************************************************************************/
+void Mux_Init( void )
+{
+    memset( muxQueue, 0, sizeof(muxQueue) );
+    for( uint8_t i = 0; i < MUX_CHANNEL_COUNT; i++ )
+    {
+        muxQueue[i].priority = MuxChannelConfig[i].default_priority;
+        //flow control is off until host grants credits, so a host unaware
+        //of credits is never stalled
+        muxQueue[i].credits = MUX_CREDITS_UNLIMITED;
+    }
+    muxEnabled = false;
+    muxTxSequence = 0;
+    muxRxLength = 0;
+    muxRxInFrame = false;
+    muxRxEscape = false;
+    muxRxErrors = 0;
+}
+
+/**************************************************************************//**
+\brief Enable or disable mux framing
+******************************************************************************/
+void Mux_Enable( bool enable )
+{
+    muxEnabled = enable;
+    Scheduler_Post( SCHEDULER_TASK_MUX );
+}
+
+/**************************************************************************//**
+\brief Return true when mux framing is enabled
+******************************************************************************/
+bool Mux_IsEnabled( void )
+{
+    return muxEnabled;
+}
+
+/**************************************************************************//**
+\brief Queue a message on a virtual channel
+Can be called from interrupt context
+******************************************************************************/
+Mux_Write_Result_t Mux_Write( Mux_Channel_t channel, uint8_t const * buffer, uint16_t size )
+{
+    Mux_Queue_t * queue;
+    uint32_t irq_state;
+    uint8_t header[MUX_QUEUE_RECORD_HEADER];
+
+    if( (channel >= MUX_CHANNEL_COUNT) || (buffer == NULL) || (size == 0) || (size > MUX_MAX_PAYLOAD) )
+    {
+        return MUX_WRITE_INVALID_PARAMETER;
+    }
+    queue = &muxQueue[channel];
+
+    //Without mux, behave as a plain console
+    if( !muxEnabled )
+    {
+        if( !MuxChannelConfig[channel].legacy )
+        {
+            queue->drops++;
+            return MUX_WRITE_CHANNEL_DISABLED;
+        }
+        Console_Write( buffer, size );
+        queue->frames++;
+        queue->bytes += size;
+        return MUX_WRITE_SUCCESS;
+    }
+
+    header[0] = (uint8_t) (size & 0xFF);
+    header[1] = (uint8_t) ((size & 0xFF00) >> 8);
+
+    irq_state = HAL_System_EnterCritical();
+    if( (MuxChannelConfig[channel].size - queue->used) < (size + MUX_QUEUE_RECORD_HEADER) )
+    {
+        queue->drops++;
+        HAL_System_ExitCritical( irq_state );
+        return MUX_WRITE_QUEUE_FULL;
+    }
+    mux_queue_push( channel, header, MUX_QUEUE_RECORD_HEADER );
+    mux_queue_push( channel, buffer, size );
+    HAL_System_ExitCritical( irq_state );
+
+    Scheduler_Post( SCHEDULER_TASK_MUX );
+    return MUX_WRITE_SUCCESS;
+}
+
+/**************************************************************************//**
+\brief Return number of free bytes in a channel queue
+******************************************************************************/
+uint16_t Mux_GetFreeSpace( Mux_Channel_t channel )
+{
+    uint16_t free_space;
+
+    if( channel >= MUX_CHANNEL_COUNT )
+    {
+        return 0;
+    }
+
+    free_space = MuxChannelConfig[channel].size - muxQueue[channel].used;
+    if( free_space < MUX_QUEUE_RECORD_HEADER )
+    {
+        return 0;
+    }
+    return free_space - MUX_QUEUE_RECORD_HEADER;
+}
+
+/**************************************************************************//**
+\brief Set channel priority, higher value is sent first
+******************************************************************************/
+void Mux_SetPriority( Mux_Channel_t channel, uint8_t priority )
+{
+    if( channel < MUX_CHANNEL_COUNT )
+    {
+        muxQueue[channel].priority = priority;
+    }
+}
+
+/**************************************************************************//**
+\brief Grant channel credits, MUX_CREDITS_UNLIMITED disables flow control
+Grants add to remaining credits, a grant sent while frames of the previous
+one are still in flight is not lost. The sum saturates below
+MUX_CREDITS_UNLIMITED. Without flow control, a grant enables it with that
+many credits.
+******************************************************************************/
+void Mux_GrantCredits( Mux_Channel_t channel, uint16_t credits )
+{
+    Mux_Queue_t * queue;
+
+    if( channel >= MUX_CHANNEL_COUNT )
+    {
+        return;
+    }
+
+    queue = &muxQueue[channel];
+    if( (credits == MUX_CREDITS_UNLIMITED) || (queue->credits == MUX_CREDITS_UNLIMITED) )
+    {
+        queue->credits = credits;
+    }else if( credits >= MUX_CREDITS_UNLIMITED - 1 - queue->credits ){
+        queue->credits = MUX_CREDITS_UNLIMITED - 1;
+    }else{
+        queue->credits += credits;
+    }
+    Scheduler_Post( SCHEDULER_TASK_MUX );
+}
+
+/**************************************************************************//**
+\brief Retreive channel statistics
+******************************************************************************/
+void Mux_GetChannelStats( Mux_Channel_t channel, Mux_Channel_Stats_t * stats )
+{
+    if( (channel >= MUX_CHANNEL_COUNT) || (stats == NULL) )
+    {
+        return;
+    }
+    stats->frames   = muxQueue[channel].frames;
+    stats->bytes    = muxQueue[channel].bytes;
+    stats->drops    = muxQueue[channel].drops;
+    stats->credits  = muxQueue[channel].credits;
+    stats->queued   = muxQueue[channel].used;
+    stats->priority = muxQueue[channel].priority;
+}
+
+/**************************************************************************//**
+\brief Mux task
+Send the next queued frame of the highest priority channel having credits
+Frame is sent by DMA, task is posted again once transfer is done
+******************************************************************************/
+void Mux_Task( void )
+{
+    Mux_Channel_t channel = MUX_CHANNEL_COUNT;
+    Mux_Queue_t * queue;
+    uint32_t irq_state;
+    uint8_t header[MUX_QUEUE_RECORD_HEADER];
+    uint16_t size;
+    uint16_t crc_calc;
+    uint16_t index = 0;
+
+    //Wire frame buffer is in use until transfer is done
+    if( !muxEnabled || Console_IsTxBusy() )
+    {
+        return;
+    }
+
+    //Select highest priority channel with pending data and credits
+    for( uint8_t i = 0; i < MUX_CHANNEL_COUNT; i++ )
+    {
+        if( (muxQueue[i].used != 0) && (muxQueue[i].credits != 0) )
+        {
+            if( (channel == MUX_CHANNEL_COUNT) || (muxQueue[i].priority > muxQueue[channel].priority) )
+            {
+                channel = i;
+            }
+        }
+    }
+    if( channel == MUX_CHANNEL_COUNT )
+    {
+        return;
+    }
+    queue = &muxQueue[channel];
+
+    irq_state = HAL_System_EnterCritical();
+    mux_queue_pop( channel, header, MUX_QUEUE_RECORD_HEADER );
+    size = header[0] | (((uint16_t) header[1]) << 8);
+    mux_queue_pop( channel, &muxRawFrame[MUX_HEADER_SIZE], size );
+    HAL_System_ExitCritical( irq_state );
+
+    muxRawFrame[0] = channel;
+    muxRawFrame[1] = muxTxSequence++;
+    crc_calc = crcFast( muxRawFrame, size + MUX_HEADER_SIZE );
+    muxRawFrame[size + MUX_HEADER_SIZE]     = (crc_calc & 0xFF);
+    muxRawFrame[size + MUX_HEADER_SIZE + 1] = ((crc_calc & 0xFF00) >> 8);
+
+    muxWireFrame[index++] = MUX_FLAG;
+    for( uint16_t i = 0; i < (size + MUX_HEADER_SIZE + MUX_CRC_SIZE); i++ )
+    {
+        index = mux_stuff_byte( muxWireFrame, index, muxRawFrame[i] );
+    }
+    muxWireFrame[index++] = MUX_FLAG;
+
+    Console_WriteAsync( muxWireFrame, index );
+
+    if( queue->credits != MUX_CREDITS_UNLIMITED )
+    {
+        queue->credits--;
+    }
+    queue->frames++;
+    queue->bytes += size;
+}
+
+/**************************************************************************//**
+\brief Mux reception of a byte from console
+Every frame from host must have its own opening and closing flag
+returns true if byte was consumed by the mux deframer
+******************************************************************************/
+bool Mux_RxByte( uint8_t byte )
+{
+    if( byte == MUX_FLAG )
+    {
+        //closing flag
+        if( muxRxInFrame && (muxRxLength != 0) )
+        {
+            mux_process_rx_frame();
+            muxRxInFrame = false;
+        }
+        //opening flag
+        else
+        {
+            muxRxInFrame = true;
+        }
+        muxRxLength = 0;
+        muxRxEscape = false;
+        return true;
+    }
+
+    if( !muxRxInFrame )
+    {
+        return false;
+    }
+
+    if( byte == MUX_ESCAPE )
+    {
+        muxRxEscape = true;
+        return true;
+    }
+
+    if( muxRxEscape )
+    {
+        byte ^= MUX_ESCAPE_XOR;
+        muxRxEscape = false;
+    }
+
+    if( muxRxLength >= MUX_RAW_FRAME_SIZE )
+    {
+        //Frame too large - drop it!
+        muxRxErrors++;
+        muxRxInFrame = false;
+        muxRxLength = 0;
+        return true;
+    }
+    muxRxFrame[muxRxLength++] = byte;
+    return true;
+}
+
+/**************************************************************************//**
+\brief callback raised upon reception of a valid mux frame from host
+******************************************************************************/
+void __attribute__((weak)) Mux_RxMsgCallback( Mux_Channel_t channel, uint8_t const * payload, uint16_t size )
+{
+    (void) channel;
+    (void) payload;
+    (void) size;
+}
@@ -0,0 +1,156 @@
+/****************************************************************************//**
+  \file console_mux.h
+
+  \brief Virtual channel multiplexer for the console serial link
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _CONSOLE_MUX_H
+#define _CONSOLE_MUX_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Frame delimiter and escape, HDLC like byte stuffing
+//A mux frame on the wire is:
+//FLAG | CHANNEL | SEQUENCE | PAYLOAD ... | CRC16 (LSB first) | FLAG
+//Every byte between the two flags equal to FLAG or ESCAPE is sent as
+//ESCAPE followed by (byte ^ MUX_ESCAPE_XOR)
+#define MUX_FLAG                    0x7E
+#define MUX_ESCAPE                  0x7D
+#define MUX_ESCAPE_XOR              0x20
+
+//Largest payload carried by a single mux frame
+#define MUX_MAX_PAYLOAD             512
+
+//Host to device frame, channel with this bit set is a credit grant
+//for channel (channel & ~MUX_CREDIT_GRANT_FLAG)
+//payload is a uint16_t (LSB first) number of frames
+#define MUX_CREDIT_GRANT_FLAG       0x80
+
+//Credit value disabling flow control on a channel
+#define MUX_CREDITS_UNLIMITED       0xFFFF
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    MUX_CHANNEL_CONTROL,            //command responses
+    MUX_CHANNEL_CAPTURE,            //captured frames
+    MUX_CHANNEL_STATS,              //statistics and periodic records
+    MUX_CHANNEL_LOG,                //debug logs
+    MUX_CHANNEL_TX,                 //frames to transmit from host, transmit reports to host
+    MUX_CHANNEL_COUNT
+}Mux_Channel_t;
+
+typedef enum {
+    MUX_WRITE_SUCCESS,
+    MUX_WRITE_INVALID_PARAMETER,
+    MUX_WRITE_QUEUE_FULL,
+    MUX_WRITE_CHANNEL_DISABLED,
+}Mux_Write_Result_t;
+
+typedef struct {
+    uint32_t frames;                //frames sent to host
+    uint32_t bytes;                 //payload bytes sent to host
+    uint32_t drops;                 //frames dropped (queue full or channel disabled)
+    uint16_t credits;               //remaining credits
+    uint16_t queued;                //bytes waiting in queue
+    uint8_t  priority;              //higher value is sent first
+}Mux_Channel_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init multiplexer, mux framing is disabled until host opt-in
+******************************************************************************/
+void Mux_Init( void );
+
+/**************************************************************************//**
+\brief Enable or disable mux framing
+When disabled, channels flagged as legacy are written raw to the console
+as they were before the multiplexer existed, other channels are dropped
+******************************************************************************/
+void Mux_Enable( bool enable );
+
+/**************************************************************************//**
+\brief Return true when mux framing is enabled
+******************************************************************************/
+bool Mux_IsEnabled( void );
+
+/**************************************************************************//**
+\brief Queue a message on a virtual channel
+Can be called from interrupt context
+******************************************************************************/
+Mux_Write_Result_t Mux_Write( Mux_Channel_t channel, uint8_t const * buffer, uint16_t size );
+
+/**************************************************************************//**
+\brief Return number of free bytes in a channel queue
+******************************************************************************/
+uint16_t Mux_GetFreeSpace( Mux_Channel_t channel );
+
+/**************************************************************************//**
+\brief Set channel priority, higher value is sent first
+******************************************************************************/
+void Mux_SetPriority( Mux_Channel_t channel, uint8_t priority );
+
+/**************************************************************************//**
+\brief Grant channel credits, MUX_CREDITS_UNLIMITED disables flow control
+Grants add up, saturating below MUX_CREDITS_UNLIMITED. Flow control is off
+by default, the first grant enables it with that many credits
+******************************************************************************/
+void Mux_GrantCredits( Mux_Channel_t channel, uint16_t credits );
+
+/**************************************************************************//**
+\brief Retreive channel statistics
+******************************************************************************/
+void Mux_GetChannelStats( Mux_Channel_t channel, Mux_Channel_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Mux task
+Send the next queued frame of the highest priority channel having credits
+******************************************************************************/
+void Mux_Task( void );
+
+/**************************************************************************//**
+\brief Mux reception of a byte from console
+returns true if byte was consumed by the mux deframer
+returns false if byte is outside of a mux frame
+******************************************************************************/
+bool Mux_RxByte( uint8_t byte );
+
+/**************************************************************************//**
+\brief callback raised upon reception of a valid mux frame from host
+Credit grants are handled by the mux and are not reported
+******************************************************************************/
+void Mux_RxMsgCallback( Mux_Channel_t channel, uint8_t const * payload, uint16_t size );
+
+#endif // _CONSOLE_MUX_H
@@ -0,0 +1,155 @@
+/***************************************************************************//**
+ @file log.c
+  @brief   Tokenized logging
+           Only a format string ID and raw arguments are sent, formatting
+           is deferred to the host using the dictionary extracted from the ELF
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "log.h"
+#include "console_mux.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define LOG_TOKEN_HEADER_SIZE       (1 + 1 + 2 + 4)
+#define LOG_TEXT_MAX_SIZE           128
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static volatile Log_Level_t logLevel = LOG_LEVEL_INFO;
+static volatile uint32_t logDrops = 0;
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Set lowest level sent to host
+******************************************************************************/
+void Log_SetLevel( Log_Level_t level )
+{
+    if( level <= LOG_LEVEL_NONE )
+    {
+        logLevel = level;
+    }
+}
+
+/**************************************************************************//**
+\brief Return lowest level sent to host
+******************************************************************************/
+Log_Level_t Log_GetLevel( void )
+{
+    return logLevel;
+}
+
+/**************************************************************************//**
+\brief Return true if logs of this level are sent to host
+******************************************************************************/
+bool Log_IsEnabled( Log_Level_t level )
+{
+    return ( level >= logLevel && level < LOG_LEVEL_NONE );
+}
+
+/**************************************************************************//**
+\brief Queue a tokenized log record on the log channel
+Can be called from interrupt context
+******************************************************************************/
+void Log_Write( Log_Level_t level, uint16_t id, uint32_t const * args, uint8_t count )
+{
+    uint8_t record[LOG_TOKEN_HEADER_SIZE + (LOG_MAX_ARGS * sizeof(uint32_t))];
+    uint8_t i = 0;
+    uint32_t timestamp = HAL_Radio_GetTime();
+
+    if( count > LOG_MAX_ARGS )
+    {
+        count = LOG_MAX_ARGS;
+    }
+
+    record[i++] = LOG_RECORD_TOKEN;
+    record[i++] = level;
+    record[i++] = (uint8_t)(id);
+    record[i++] = (uint8_t)(id >> 8);
+    record[i++] = (uint8_t)(timestamp);
+    record[i++] = (uint8_t)(timestamp >> 8);
+    record[i++] = (uint8_t)(timestamp >> 16);
+    record[i++] = (uint8_t)(timestamp >> 24);
+    for( uint8_t j = 0; j < count; j++ )
+    {
+        record[i++] = (uint8_t)(args[j]);
+        record[i++] = (uint8_t)(args[j] >> 8);
+        record[i++] = (uint8_t)(args[j] >> 16);
+        record[i++] = (uint8_t)(args[j] >> 24);
+    }
+
+    //Logs are silently discarded until host enables mux framing
+    if( Mux_Write( MUX_CHANNEL_LOG, record, i ) == MUX_WRITE_QUEUE_FULL )
+    {
+        logDrops++;
+    }
+}
+
+/**************************************************************************//**
+\brief Queue a text log record on the log channel
+******************************************************************************/
+void Log_WriteText( Log_Level_t level, uint8_t const * text, uint16_t size )
+{
+    uint8_t record[2 + LOG_TEXT_MAX_SIZE];
+    uint16_t i = 0;
+
+    if( !Log_IsEnabled( level ) )
+    {
+        return;
+    }
+
+    if( size > LOG_TEXT_MAX_SIZE )
+    {
+        size = LOG_TEXT_MAX_SIZE;
+    }
+
+    record[i++] = LOG_RECORD_TEXT;
+    record[i++] = level;
+    while( size-- )
+    {
+        record[i++] = *text++;
+    }
+
+    //Logs are silently discarded until host enables mux framing
+    if( Mux_Write( MUX_CHANNEL_LOG, record, i ) == MUX_WRITE_QUEUE_FULL )
+    {
+        logDrops++;
+    }
+}
+
+/**************************************************************************//**
+\brief Return number of logs lost because log channel was full
+******************************************************************************/
+uint32_t Log_GetDrops( void )
+{
+    return logDrops;
+}
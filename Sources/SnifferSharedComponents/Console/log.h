@@ -0,0 +1,125 @@
+/****************************************************************************//**
+  \file log.h
+
+  \brief Tokenized logging, format strings are decoded by the host
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _LOG_H
+#define _LOG_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Format strings are placed in section .log_strings which is never loaded to
+//target, the linker script puts it at address 0 so a string address is its
+//offset in the dictionary extracted from the ELF at build time (.logdict)
+//and is sent to host as a 16-bit ID along with raw 32-bit arguments.
+//Only integer arguments are supported, %s can't be decoded by the host.
+#define LOG_SECTION                 __attribute__((section(".log_strings"), used))
+
+//Maximum number of arguments of a single log
+#define LOG_MAX_ARGS                6
+
+//Log record types, first byte of each message on the log channel
+#define LOG_RECORD_TOKEN            0x00    //TYPE | LEVEL | ID (2) | TIMESTAMP (4) | ARGS (4 each), all LSB first
+#define LOG_RECORD_TEXT             0x01    //TYPE | LEVEL | text formatted by target
+
+//Logs below this level are removed at compile time
+#ifndef LOG_LEVEL_MIN
+#define LOG_LEVEL_MIN               LOG_LEVEL_DEBUG
+#endif
+
+//Log with level, format string and up to LOG_MAX_ARGS integer arguments
+//example: LOG( LOG_LEVEL_INFO, "rx len %d lqi %d", phy_rx->len, phy_rx->lqi );
+//A trailing 0 is appended so a log without argument is valid C99
+#define LOG( level, ... )           LOG_( level, __VA_ARGS__, 0 )
+#define LOG_( level, format, ... )                                                      \
+    do {                                                                                \
+        if( (level) >= LOG_LEVEL_MIN && Log_IsEnabled( level ) )                        \
+        {                                                                               \
+            static const char log_format[] LOG_SECTION = format;                        \
+            const uint32_t log_args[] = { __VA_ARGS__ };                                \
+            Log_Write( (level), (uint16_t)(uintptr_t)log_format, log_args,              \
+                       (sizeof(log_args) / sizeof(log_args[0])) - 1 );                  \
+        }                                                                               \
+    } while( 0 )
+
+#define LOG_DEBUG( ... )            LOG( LOG_LEVEL_DEBUG, __VA_ARGS__ )
+#define LOG_INFO( ... )             LOG( LOG_LEVEL_INFO, __VA_ARGS__ )
+#define LOG_WARNING( ... )          LOG( LOG_LEVEL_WARNING, __VA_ARGS__ )
+#define LOG_ERROR( ... )            LOG( LOG_LEVEL_ERROR, __VA_ARGS__ )
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_NONE,                 //disable all logs
+}Log_Level_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Set lowest level sent to host, default is LOG_LEVEL_INFO
+******************************************************************************/
+void Log_SetLevel( Log_Level_t level );
+
+/**************************************************************************//**
+\brief Return lowest level sent to host
+******************************************************************************/
+Log_Level_t Log_GetLevel( void );
+
+/**************************************************************************//**
+\brief Return true if logs of this level are sent to host
+******************************************************************************/
+bool Log_IsEnabled( Log_Level_t level );
+
+/**************************************************************************//**
+\brief Queue a tokenized log record on the log channel, use LOG() instead
+Can be called from interrupt context
+******************************************************************************/
+void Log_Write( Log_Level_t level, uint16_t id, uint32_t const * args, uint8_t count );
+
+/**************************************************************************//**
+\brief Queue a text log record on the log channel
+******************************************************************************/
+void Log_WriteText( Log_Level_t level, uint8_t const * text, uint16_t size );
+
+/**************************************************************************//**
+\brief Return number of logs lost because log channel was full
+******************************************************************************/
+uint32_t Log_GetDrops( void );
+
+#endif // _LOG_H
@@ -0,0 +1,295 @@
+/***************************************************************************//**
+ @file pool.c
+  @brief   Fixed block pool of frame buffers
+           Buffers are handed from stage to stage by reference counting,
+           allocation and release are O(1) through a free list
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "pool.h"
+#include "string.h"
+#include "Hal.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//End of free list
+#define POOL_INDEX_NONE             0xFF
+
+#if POOL_BUFFER_COUNT >= POOL_INDEX_NONE
+#error "POOL_BUFFER_COUNT must fit free list index"
+#endif
+
+#if POOL_RX_RESERVE >= POOL_BUFFER_COUNT
+#error "POOL_RX_RESERVE must leave buffers to hold"
+#endif
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+//frame must remain first, a PhyRx_t pointer is also a block pointer
+typedef struct {
+    PhyRx_t frame;
+    uint8_t references;
+    uint8_t next;                   //next free block, valid while free
+}Pool_Block_t;
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+static Pool_Block_t poolBlocks[POOL_BUFFER_COUNT];
+static uint8_t poolFreeHead = POOL_INDEX_NONE;
+static Pool_Stats_t poolStats;
+
+/******************************************************************************
+                   Local function section
+******************************************************************************/
+/**************************************************************************//**
+\brief Return block holding a frame, NULL if frame is not from pool
+******************************************************************************/
+static Pool_Block_t * pool_block( PhyRx_t const * frame )
+{
+    uintptr_t offset = (uintptr_t)frame - (uintptr_t)poolBlocks;
+
+    if( (frame == NULL) ||
+        ((uintptr_t)frame < (uintptr_t)poolBlocks) ||
+        (offset >= sizeof(poolBlocks)) ||
+        (offset % sizeof(Pool_Block_t)) )
+    {
+        return NULL;
+    }
+    return &poolBlocks[offset / sizeof(Pool_Block_t)];
+}
+
+/**************************************************************************//**
+\brief Take a free block, reference count is 1, NULL if none, in critical section
+******************************************************************************/
+static Pool_Block_t * pool_take( void )
+{
+    Pool_Block_t * block;
+
+    if( poolFreeHead == POOL_INDEX_NONE )
+    {
+        return NULL;
+    }
+    block = &poolBlocks[poolFreeHead];
+    poolFreeHead = block->next;
+    block->references = 1;
+    poolStats.allocations++;
+    poolStats.in_use++;
+    if( poolStats.in_use > poolStats.high_watermark )
+    {
+        poolStats.high_watermark = poolStats.in_use;
+    }
+    return block;
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init pool, all buffers are free
+******************************************************************************/
+void Pool_Init( void )
+{
+    uint32_t irq_state;
+
+    irq_state = HAL_System_EnterCritical();
+    for( uint8_t i = 0; i < POOL_BUFFER_COUNT; i++ )
+    {
+        poolBlocks[i].references = 0;
+        poolBlocks[i].next = ( i + 1 < POOL_BUFFER_COUNT ) ? i + 1 : POOL_INDEX_NONE;
+    }
+    poolFreeHead = 0;
+    memset( &poolStats, 0, sizeof(poolStats) );
+    poolStats.capacity = POOL_BUFFER_COUNT;
+    HAL_System_ExitCritical( irq_state );
+}
+
+/**************************************************************************//**
+\brief Allocate a frame buffer, reference count is 1
+******************************************************************************/
+PhyRx_t * Pool_Alloc( void )
+{
+    Pool_Block_t * block;
+    uint32_t irq_state;
+
+    irq_state = HAL_System_EnterCritical();
+    block = pool_take();
+    if( block == NULL )
+    {
+        poolStats.exhausted++;
+    }
+    HAL_System_ExitCritical( irq_state );
+
+    if( block == NULL )
+    {
+        return NULL;
+    }
+    return &block->frame;
+}
+
+/**************************************************************************//**
+\brief Allocate a frame buffer a stage keeps, reference count is 1
+******************************************************************************/
+PhyRx_t * Pool_AllocHold( void )
+{
+    Pool_Block_t * block = NULL;
+    uint32_t irq_state;
+
+    irq_state = HAL_System_EnterCritical();
+    if( POOL_BUFFER_COUNT - poolStats.in_use > POOL_RX_RESERVE )
+    {
+        block = pool_take();
+    }else{
+        poolStats.hold_refused++;
+    }
+    HAL_System_ExitCritical( irq_state );
+
+    if( block == NULL )
+    {
+        return NULL;
+    }
+    return &block->frame;
+}
+
+/**************************************************************************//**
+\brief Take an additional reference to keep a received frame
+The frame is already counted in use, keeping it leaves free buffers as they
+are, it is refused once they went down to the reserve.
+******************************************************************************/
+bool Pool_Hold( PhyRx_t * frame )
+{
+    Pool_Block_t * block = pool_block( frame );
+    bool held = false;
+    uint32_t irq_state;
+
+    if( block == NULL )
+    {
+        return false;
+    }
+
+    irq_state = HAL_System_EnterCritical();
+    if( block->references && block->references < UINT8_MAX &&
+        ((block->references > 1) || (POOL_BUFFER_COUNT - poolStats.in_use >= POOL_RX_RESERVE)) )
+    {
+        block->references++;
+        held = true;
+    }else{
+        poolStats.hold_refused++;
+    }
+    HAL_System_ExitCritical( irq_state );
+    return held;
+}
+
+/**************************************************************************//**
+\brief Take an additional reference on a buffer
+******************************************************************************/
+void Pool_Retain( PhyRx_t * frame )
+{
+    Pool_Block_t * block = pool_block( frame );
+    uint32_t irq_state;
+
+    if( block == NULL )
+    {
+        return;
+    }
+
+    irq_state = HAL_System_EnterCritical();
+    if( block->references && block->references < UINT8_MAX )
+    {
+        block->references++;
+    }
+    HAL_System_ExitCritical( irq_state );
+}
+
+/**************************************************************************//**
+\brief Drop a reference, buffer returns to pool when last reference is dropped
+******************************************************************************/
+void Pool_Release( PhyRx_t * frame )
+{
+    Pool_Block_t * block = pool_block( frame );
+    uint32_t irq_state;
+
+    irq_state = HAL_System_EnterCritical();
+    if( block == NULL || block->references == 0 )
+    {
+        poolStats.invalid_releases++;
+    }else if( --block->references == 0 ){
+        block->next = poolFreeHead;
+        poolFreeHead = block - poolBlocks;
+        poolStats.in_use--;
+    }
+    HAL_System_ExitCritical( irq_state );
+}
+
+/**************************************************************************//**
+\brief Return number of references on a buffer
+******************************************************************************/
+uint8_t Pool_GetReferences( PhyRx_t const * frame )
+{
+    Pool_Block_t * block = pool_block( frame );
+
+    if( block == NULL )
+    {
+        return 0;
+    }
+    return block->references;
+}
+
+/**************************************************************************//**
+\brief Retreive pool statistics
+******************************************************************************/
+void Pool_GetStats( Pool_Stats_t * stats )
+{
+    uint32_t irq_state;
+
+    if( stats == NULL )
+    {
+        return;
+    }
+    irq_state = HAL_System_EnterCritical();
+    *stats = poolStats;
+    HAL_System_ExitCritical( irq_state );
+}
+
+/**************************************************************************//**
+\brief Clear pool counters, high watermark restarts at current usage
+******************************************************************************/
+void Pool_ClearStats( void )
+{
+    uint32_t irq_state;
+
+    irq_state = HAL_System_EnterCritical();
+    poolStats.allocations = 0;
+    poolStats.exhausted = 0;
+    poolStats.hold_refused = 0;
+    poolStats.invalid_releases = 0;
+    poolStats.high_watermark = poolStats.in_use;
+    HAL_System_ExitCritical( irq_state );
+}
@@ -0,0 +1,122 @@
+/****************************************************************************//**
+  \file pool.h
+
+  \brief Fixed block pool of frame buffers
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _POOL_H
+#define _POOL_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "phy.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Number of frame buffers shared by every pipeline stage
+//each buffer holds a whole frame (up to 127 bytes) and its metadata,
+//burst capture windows are kept in them too
+#define POOL_BUFFER_COUNT           64
+
+//Buffers left to reception, stages keeping frames (hold queues, transmit
+//queue) cannot take them so a full downstream stage never stops capture
+#define POOL_RX_RESERVE             8
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef struct {
+    uint16_t capacity;              //number of buffers in pool
+    uint16_t in_use;                //buffers currently allocated
+    uint16_t high_watermark;        //highest in_use since last clear
+    uint32_t allocations;           //successful Pool_Alloc
+    uint32_t exhausted;             //Pool_Alloc failed, no free buffer
+    uint32_t hold_refused;          //Pool_Hold or Pool_AllocHold refused, only reserve left
+    uint32_t invalid_releases;      //release of a free or foreign buffer
+}Pool_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init pool, all buffers are free
+******************************************************************************/
+void Pool_Init( void );
+
+/**************************************************************************//**
+\brief Allocate a frame buffer, reference count is 1
+returns NULL when pool is exhausted
+Can be called from interrupt context
+******************************************************************************/
+PhyRx_t * Pool_Alloc( void );
+
+/**************************************************************************//**
+\brief Take an additional reference on a buffer
+A stage keeping a buffer passed to it beyond the call must retain it
+Can be called from interrupt context
+******************************************************************************/
+void Pool_Retain( PhyRx_t * frame );
+
+/**************************************************************************//**
+\brief Allocate a frame buffer a stage keeps, reference count is 1
+returns NULL when only POOL_RX_RESERVE buffers are left
+Can be called from interrupt context
+******************************************************************************/
+PhyRx_t * Pool_AllocHold( void );
+
+/**************************************************************************//**
+\brief Take an additional reference to keep a received frame
+returns false, frame not retained, when this would eat into POOL_RX_RESERVE
+A frame already kept by another stage can always be held again
+Can be called from interrupt context
+******************************************************************************/
+bool Pool_Hold( PhyRx_t * frame );
+
+/**************************************************************************//**
+\brief Drop a reference, buffer returns to pool when last reference is dropped
+Can be called from interrupt context
+******************************************************************************/
+void Pool_Release( PhyRx_t * frame );
+
+/**************************************************************************//**
+\brief Return number of references on a buffer, 0 if free or not from pool
+******************************************************************************/
+uint8_t Pool_GetReferences( PhyRx_t const * frame );
+
+/**************************************************************************//**
+\brief Retreive pool statistics
+******************************************************************************/
+void Pool_GetStats( Pool_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Clear pool counters, high watermark restarts at current usage
+******************************************************************************/
+void Pool_ClearStats( void );
+
+#endif // _POOL_H
@@ -0,0 +1,146 @@
+/***************************************************************************//**
+ @file profiler.c
+  @brief   Cycle accurate profiling of firmware hot path
+           Probe points measure durations with the DWT cycle counter and keep
+           min, max, mean and a log2 histogram per probe
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+******************************************************************************/
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "profiler.h"
+#include "string.h"
+
+//Whole module is removed from builds without profiling
+#ifdef PROFILER_ENABLE
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+//Probe names, in Profiler_Probe_t order
+static char const * const ProfilerProbeNames[PROFILER_PROBE_COUNT] = {
+    "radio_evt",
+    "rx_get",
+    "to_json",
+    "unpack",
+};
+
+static Profiler_Stats_t profilerStats[PROFILER_PROBE_COUNT];
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init profiler and start cycle counter
+******************************************************************************/
+void Profiler_Init( void )
+{
+    HAL_System_CycleCounterInit();
+    Profiler_Clear();
+}
+
+/**************************************************************************//**
+\brief Record a duration
+******************************************************************************/
+void Profiler_Record( Profiler_Probe_t probe, uint32_t cycles )
+{
+    Profiler_Stats_t * stats;
+    uint8_t bucket;
+
+    if( probe >= PROFILER_PROBE_COUNT )
+    {
+        return;
+    }
+    stats = &profilerStats[probe];
+
+    if( cycles < stats->min )
+    {
+        stats->min = cycles;
+    }
+    if( cycles > stats->max )
+    {
+        stats->max = cycles;
+    }
+    stats->total += cycles;
+    stats->count++;
+
+    //log2, duration of 0 or 1 cycle in first bucket
+    bucket = cycles ? (31 - __builtin_clz( cycles )) : 0;
+    if( bucket >= PROFILER_HISTOGRAM_BUCKETS )
+    {
+        bucket = PROFILER_HISTOGRAM_BUCKETS - 1;
+    }
+    stats->histogram[bucket]++;
+}
+
+/**************************************************************************//**
+\brief Retreive probe statistics
+******************************************************************************/
+bool Profiler_GetStats( Profiler_Probe_t probe, Profiler_Stats_t * stats )
+{
+    uint32_t irq_state;
+
+    if( probe >= PROFILER_PROBE_COUNT || stats == NULL )
+    {
+        return false;
+    }
+
+    //probe may be recorded from interrupt context
+    irq_state = HAL_System_EnterCritical();
+    *stats = profilerStats[probe];
+    HAL_System_ExitCritical( irq_state );
+    return true;
+}
+
+/**************************************************************************//**
+\brief Return probe name
+******************************************************************************/
+char const * Profiler_GetName( Profiler_Probe_t probe )
+{
+    if( probe >= PROFILER_PROBE_COUNT )
+    {
+        return "";
+    }
+    return ProfilerProbeNames[probe];
+}
+
+/**************************************************************************//**
+\brief Clear all probes statistics
+******************************************************************************/
+void Profiler_Clear( void )
+{
+    uint32_t irq_state;
+
+    irq_state = HAL_System_EnterCritical();
+    memset( profilerStats, 0, sizeof(profilerStats) );
+    for( uint8_t i = 0; i < PROFILER_PROBE_COUNT; i++ )
+    {
+        profilerStats[i].min = UINT32_MAX;
+    }
+    HAL_System_ExitCritical( irq_state );
+}
+
+#endif // PROFILER_ENABLE
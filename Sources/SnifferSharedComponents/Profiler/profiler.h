@@ -0,0 +1,105 @@
+/****************************************************************************//**
+  \file profiler.h
+
+  \brief Cycle accurate profiling of firmware hot path
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+#include "Hal.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+//Histogram bucket n counts durations of 2^n to 2^(n+1)-1 cycles,
+//last bucket counts anything longer
+#define PROFILER_HISTOGRAM_BUCKETS      20
+
+//Probe points, compiled out unless PROFILER_ENABLE is defined
+//PROF_START and PROF_STOP must be in the same scope
+#ifdef PROFILER_ENABLE
+#define PROF_START( probe )             uint32_t prof_start_##probe = HAL_CYCLE_COUNT()
+#define PROF_STOP( probe )              Profiler_Record( (probe), HAL_CYCLE_COUNT() - prof_start_##probe )
+#else
+#define PROF_START( probe )
+#define PROF_STOP( probe )
+#endif
+
+/******************************************************************************
+                   Types section
+******************************************************************************/
+typedef enum {
+    PROFILER_PROBE_RADIO_EVENT,         //radioEventHandler, interrupt context
+    PROFILER_PROBE_RADIO_GET_RX,        //HAL_Radio_GetRxPacket
+    PROFILER_PROBE_PHY_TO_JSON,         //Console_PhyToJSON
+    PROFILER_PROBE_MAC_UNPACK,          //MAC_Unpack
+    PROFILER_PROBE_COUNT
+}Profiler_Probe_t;
+
+//Durations are in core clock cycles
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;                     //divide by count for mean
+    uint32_t histogram[PROFILER_HISTOGRAM_BUCKETS];
+}Profiler_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init profiler and start cycle counter
+******************************************************************************/
+void Profiler_Init( void );
+
+/**************************************************************************//**
+\brief Record a duration, use PROF_START/PROF_STOP instead
+Each probe must always be recorded from the same context
+******************************************************************************/
+void Profiler_Record( Profiler_Probe_t probe, uint32_t cycles );
+
+/**************************************************************************//**
+\brief Retreive probe statistics, returns false if probe is invalid
+******************************************************************************/
+bool Profiler_GetStats( Profiler_Probe_t probe, Profiler_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Return probe name
+******************************************************************************/
+char const * Profiler_GetName( Profiler_Probe_t probe );
+
+/**************************************************************************//**
+\brief Clear all probes statistics
+******************************************************************************/
+void Profiler_Clear( void );
+
+#endif // _PROFILER_H
@@ -0,0 +1,228 @@
+/***************************************************************************//**
+ @file scheduler.c
+  @brief   Event driven run to completion task scheduler
+           Tasks are posted from interrupts, timers or other tasks and run
+           in priority order, the core sleeps when no task is ready
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+/******************************************************************************
+                   Includes section
+******************************************************************************/
+#include "scheduler.h"
+#include "string.h"
+#include "Hal.h"
+
+/***************************************************************************//**
+ * Private defines
+ ******************************************************************************/
+#define SCHEDULER_TASK_BIT( task )      (1UL << (task))
+
+/***************************************************************************//**
+ * Local function protoypes
+ ******************************************************************************/
+static void scheduler_timer_expired( uint8_t timer );
+
+/***************************************************************************//**
+ * Local variables
+ ******************************************************************************/
+//Scheduler owns one HAL timer per task, timer number is task number
+_Static_assert( SCHEDULER_TASK_COUNT <= HAL_TIMER_COUNT, "not enough HAL timers" );
+
+static Scheduler_Task_Function_t schedulerTasks[SCHEDULER_TASK_COUNT];
+static volatile uint32_t schedulerReady = 0;                    //bit n set when task n is ready
+static volatile uint32_t schedulerPostTime[SCHEDULER_TASK_COUNT];   //time of first post since last run
+static Scheduler_Task_Stats_t schedulerStats[SCHEDULER_TASK_COUNT];
+static uint32_t schedulerSleepTime = 0;
+
+/***************************************************************************//**
+ * Local functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief HAL timer expired, interrupt context
+******************************************************************************/
+static void scheduler_timer_expired( uint8_t timer )
+{
+    Scheduler_Post( timer );
+}
+
+/***************************************************************************//**
+ * Global functions
+ ******************************************************************************/
+/**************************************************************************//**
+\brief Init scheduler
+******************************************************************************/
+void Scheduler_Init( void )
+{
+    schedulerReady = 0;
+    memset( schedulerTasks, 0, sizeof(schedulerTasks) );
+    Scheduler_ClearStats();
+}
+
+/**************************************************************************//**
+\brief Register the function run when a task is ready
+******************************************************************************/
+void Scheduler_Register( Scheduler_Task_t task, Scheduler_Task_Function_t function )
+{
+    if( task < SCHEDULER_TASK_COUNT )
+    {
+        schedulerTasks[task] = function;
+    }
+}
+
+/**************************************************************************//**
+\brief Mark a task ready
+Can be called from interrupt context
+******************************************************************************/
+void Scheduler_Post( Scheduler_Task_t task )
+{
+    uint32_t irq_state;
+
+    if( task >= SCHEDULER_TASK_COUNT )
+    {
+        return;
+    }
+
+    irq_state = HAL_System_EnterCritical();
+    if( (schedulerReady & SCHEDULER_TASK_BIT( task )) == 0 )
+    {
+        schedulerPostTime[task] = HAL_Radio_GetTime();
+        schedulerReady |= SCHEDULER_TASK_BIT( task );
+    }
+    HAL_System_ExitCritical( irq_state );
+}
+
+/**************************************************************************//**
+\brief Post a task once delay_us elapsed
+******************************************************************************/
+void Scheduler_PostDelayed( Scheduler_Task_t task, uint32_t delay_us )
+{
+    if( task < SCHEDULER_TASK_COUNT )
+    {
+        HAL_Timer_Start( task, delay_us, false, scheduler_timer_expired );
+    }
+}
+
+/**************************************************************************//**
+\brief Post a task every period_us
+******************************************************************************/
+void Scheduler_PostPeriodic( Scheduler_Task_t task, uint32_t period_us )
+{
+    if( task < SCHEDULER_TASK_COUNT )
+    {
+        HAL_Timer_Start( task, period_us, true, scheduler_timer_expired );
+    }
+}
+
+/**************************************************************************//**
+\brief Cancel a delayed or periodic post
+******************************************************************************/
+void Scheduler_Cancel( Scheduler_Task_t task )
+{
+    if( task < SCHEDULER_TASK_COUNT )
+    {
+        HAL_Timer_Stop( task );
+    }
+}
+
+/**************************************************************************//**
+\brief Run ready tasks, sleep when none is ready
+A task runs to completion, a task having more work posts itself again
+so higher priority tasks get a chance to run in between
+******************************************************************************/
+void Scheduler_Run( void )
+{
+    uint32_t irq_state;
+    uint32_t start;
+    uint32_t elapsed;
+    uint8_t task;
+
+    while( 1 )
+    {
+        irq_state = HAL_System_EnterCritical();
+        if( schedulerReady == 0 )
+        {
+            //interrupts are masked, a pending one still wakes the core
+            start = HAL_Radio_GetTime();
+            HAL_System_Sleep();
+            schedulerSleepTime += HAL_Radio_GetTime() - start;
+            HAL_System_ExitCritical( irq_state );
+            continue;
+        }
+
+        //highest priority is lowest bit set
+        task = __builtin_ctz( schedulerReady );
+        schedulerReady &= ~SCHEDULER_TASK_BIT( task );
+        start = HAL_Radio_GetTime();
+        elapsed = start - schedulerPostTime[task];
+        HAL_System_ExitCritical( irq_state );
+
+        if( elapsed > schedulerStats[task].latency_max )
+        {
+            schedulerStats[task].latency_max = elapsed;
+        }
+        schedulerStats[task].latency_total += elapsed;
+
+        if( schedulerTasks[task] != NULL )
+        {
+            schedulerTasks[task]();
+        }
+
+        elapsed = HAL_Radio_GetTime() - start;
+        if( elapsed > schedulerStats[task].run_time_max )
+        {
+            schedulerStats[task].run_time_max = elapsed;
+        }
+        schedulerStats[task].run_time_total += elapsed;
+        schedulerStats[task].runs++;
+    }
+}
+
+/**************************************************************************//**
+\brief Retreive task statistics
+******************************************************************************/
+void Scheduler_GetTaskStats( Scheduler_Task_t task, Scheduler_Task_Stats_t * stats )
+{
+    if( task < SCHEDULER_TASK_COUNT && stats != NULL )
+    {
+        *stats = schedulerStats[task];
+    }
+}
+
+/**************************************************************************//**
+\brief Return time spent sleeping in microseconds
+******************************************************************************/
+uint32_t Scheduler_GetSleepTime( void )
+{
+    return schedulerSleepTime;
+}
+
+/**************************************************************************//**
+\brief Clear task statistics and sleep time
+******************************************************************************/
+void Scheduler_ClearStats( void )
+{
+    memset( schedulerStats, 0, sizeof(schedulerStats) );
+    schedulerSleepTime = 0;
+}
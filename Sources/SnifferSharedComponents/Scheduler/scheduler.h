@@ -0,0 +1,132 @@
+/****************************************************************************//**
+  \file scheduler.h
+
+  \brief Event driven run to completion task scheduler
+
+SPDX-License-Identifier: MIT
+
+Copyright (c) 2023 Eric St-Onge
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+*******************************************************************************/
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+/******************************************************************************
+                    Includes section
+******************************************************************************/
+#include "stdint.h"
+#include "stdbool.h"
+
+/******************************************************************************
+                   Define(s) section
+******************************************************************************/
+/******************************************************************************
+                   Types section
+******************************************************************************/
+//Tasks in priority order, lowest value runs first when several are ready
+typedef enum {
+    SCHEDULER_TASK_PHY,                 //received radio packets
+    SCHEDULER_TASK_CONSOLE_RX,          //bytes received from host
+    SCHEDULER_TASK_COMMAND,             //deferred command actions
+    SCHEDULER_TASK_CAPTURE,             //hop plan
+    SCHEDULER_TASK_MUX,                 //frames sent to host
+    SCHEDULER_TASK_BURST,               //burst capture drain
+    SCHEDULER_TASK_FLASHLOG,            //flash log writes, erase and dump
+    SCHEDULER_TASK_SUMMARY,             //summary records
+    SCHEDULER_TASK_DEDUP,               //deduplicated frames sent at window end
+    SCHEDULER_TASK_ACK,                 //acknowledgment records
+    SCHEDULER_TASK_TX,                  //transmit queue
+    SCHEDULER_TASK_DISCOVER,            //discovery sweep and PAN table
+    SCHEDULER_TASK_REPLAY,              //timed frame replay
+    SCHEDULER_TASK_SYNC,                //clock extension and anchor records
+    SCHEDULER_TASK_TURNAROUND,          //acknowledgment timing records
+    SCHEDULER_TASK_NOISE,               //RSSI sampling and noise records
+    SCHEDULER_TASK_VISIT,               //secondary channel visits
+    SCHEDULER_TASK_TSCH,                //TSCH timeslot retune
+    SCHEDULER_TASK_COUNT
+}Scheduler_Task_t;
+
+typedef void (*Scheduler_Task_Function_t)( void );
+
+//Times are in microseconds
+typedef struct {
+    uint32_t runs;                      //number of times task ran
+    uint32_t run_time_max;              //longest run
+    uint32_t run_time_total;            //sum of run times, divide by runs for mean
+    uint32_t latency_max;               //longest delay between post and run
+    uint32_t latency_total;             //sum of latencies, divide by runs for mean
+}Scheduler_Task_Stats_t;
+
+/******************************************************************************
+                   Prototypes section
+******************************************************************************/
+/**************************************************************************//**
+\brief Init scheduler, no task registered and none ready
+******************************************************************************/
+void Scheduler_Init( void );
+
+/**************************************************************************//**
+\brief Register the function run when a task is ready
+******************************************************************************/
+void Scheduler_Register( Scheduler_Task_t task, Scheduler_Task_Function_t function );
+
+/**************************************************************************//**
+\brief Mark a task ready, it runs once however many times it was posted
+Can be called from interrupt context
+******************************************************************************/
+void Scheduler_Post( Scheduler_Task_t task );
+
+/**************************************************************************//**
+\brief Post a task once delay_us elapsed, replaces a pending timed post
+******************************************************************************/
+void Scheduler_PostDelayed( Scheduler_Task_t task, uint32_t delay_us );
+
+/**************************************************************************//**
+\brief Post a task every period_us, replaces a pending timed post
+******************************************************************************/
+void Scheduler_PostPeriodic( Scheduler_Task_t task, uint32_t period_us );
+
+/**************************************************************************//**
+\brief Cancel a delayed or periodic post
+******************************************************************************/
+void Scheduler_Cancel( Scheduler_Task_t task );
+
+/**************************************************************************//**
+\brief Run ready tasks, sleep when none is ready, never returns
+******************************************************************************/
+void Scheduler_Run( void );
+
+/**************************************************************************//**
+\brief Retreive task statistics
+******************************************************************************/
+void Scheduler_GetTaskStats( Scheduler_Task_t task, Scheduler_Task_Stats_t * stats );
+
+/**************************************************************************//**
+\brief Return time spent sleeping in microseconds
+******************************************************************************/
+uint32_t Scheduler_GetSleepTime( void );
+
+/**************************************************************************//**
+\brief Clear task statistics and sleep time
+******************************************************************************/
+void Scheduler_ClearStats( void );
+
+#endif // _SCHEDULER_H
@@ -81,6 +81,9 @@ void BSP_Init( void )
     //Init Radio - does not enable
     HAL_Radio_Init();
 
+    //Init Timers - uses radio timebase
+    HAL_Timer_Init();
+
     BSP_InitLed();
 
 }
@@ -51,6 +51,8 @@ SOFTWARE.
 #define HAL_CONSOLE_USART_ID            0
 #define HAL_CONSOLE_RX_IRQ              USART0_RX_IRQn
 #define HAL_CONSOLE_USART_CLOCK         cmuClock_USART0
+#define HAL_CONSOLE_TX_DMA_CHANNEL      0
+#define HAL_CONSOLE_TX_DMA_SIGNAL       ldmaPeripheralSignal_USART0_TXBL
 
 // USART0 TX on PB01
 #define HAL_CONSOLE_USART_TX_PORT       gpioPortB
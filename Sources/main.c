@@ -33,6 +33,27 @@ SOFTWARE.
 #include "crc.h"
 #include "mac.h"
 #include "console.h"
+#include "console_mux.h"
+#include "command.h"
+#include "capture.h"
+#include "capture_burst.h"
+#include "capture_trigger.h"
+#include "capture_flashlog.h"
+#include "capture_summary.h"
+#include "capture_dedup.h"
+#include "capture_ack.h"
+#include "capture_sample.h"
+#include "capture_inject.h"
+#include "capture_discover.h"
+#include "capture_replay.h"
+#include "capture_sync.h"
+#include "capture_turnaround.h"
+#include "capture_noise.h"
+#include "capture_visit.h"
+#include "capture_tsch.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "pool.h"
 
 
 /***************************************************************************//**
@@ -52,25 +73,73 @@ SOFTWARE.
  ******************************************************************************/
 int main(void)
 {
+    //Tasks may be posted as soon as interrupts are enabled
+    Scheduler_Init();
+
     //Init Hardware
     BSP_Init();
 
+#ifdef PROFILER_ENABLE
+    //Hot path cycle counting
+    Profiler_Init();
+#endif
+
     //Init Components
     //Build CRC table
     crcInit();
 
+    //Frame buffers shared by reception, transmission and capture stores
+    Pool_Init();
+
+    //Serial link virtual channels
+    Mux_Init();
+
+    //Host commands and capture configuration
+    Command_Init();
+    Capture_Init();
+    Burst_Init();
+    Trigger_Init();
+    FlashLog_Init();
+    Summary_Init();
+    Dedup_Init();
+    Ack_Init();
+    Sample_Init();
+    Inject_Init();
+    Discover_Init();
+    Replay_Init();
+    Sync_Init();
+    Turnaround_Init();
+    Noise_Init();
+    Visit_Init();
+    Tsch_Init();
+
     //Should be mac enable promiscuous mode
     //MAC_EnablePromiscuousMode();
     HAL_Radio_InitPromiscuousMode();
 
     // printf("Hello World!");
 
-    //loop forever
-    while(1){
-        // HAL_Console_Tx_Byte('E');
-        PHY_Task();
-        Console_Process_Rx();
-    }
+    Scheduler_Register( SCHEDULER_TASK_PHY, PHY_Task );
+    Scheduler_Register( SCHEDULER_TASK_CONSOLE_RX, Console_Process_Rx );
+    Scheduler_Register( SCHEDULER_TASK_COMMAND, Command_Task );
+    Scheduler_Register( SCHEDULER_TASK_CAPTURE, Capture_Task );
+    Scheduler_Register( SCHEDULER_TASK_MUX, Mux_Task );
+    Scheduler_Register( SCHEDULER_TASK_BURST, Burst_Task );
+    Scheduler_Register( SCHEDULER_TASK_FLASHLOG, FlashLog_Task );
+    Scheduler_Register( SCHEDULER_TASK_SUMMARY, Summary_Task );
+    Scheduler_Register( SCHEDULER_TASK_DEDUP, Dedup_Task );
+    Scheduler_Register( SCHEDULER_TASK_ACK, Ack_Task );
+    Scheduler_Register( SCHEDULER_TASK_TX, PHY_TxTask );
+    Scheduler_Register( SCHEDULER_TASK_DISCOVER, Discover_Task );
+    Scheduler_Register( SCHEDULER_TASK_REPLAY, Replay_Task );
+    Scheduler_Register( SCHEDULER_TASK_SYNC, Sync_Task );
+    Scheduler_Register( SCHEDULER_TASK_TURNAROUND, Turnaround_Task );
+    Scheduler_Register( SCHEDULER_TASK_NOISE, Noise_Task );
+    Scheduler_Register( SCHEDULER_TASK_VISIT, Visit_Task );
+    Scheduler_Register( SCHEDULER_TASK_TSCH, Tsch_Task );
+
+    //run tasks as they are posted, never returns
+    Scheduler_Run();
 }
 
 
@@ -81,7 +150,7 @@ returning false normal processing is performed
 ******************************************************************************/
 bool Mac_RxMsgCallbackPreprocessPhyRx( PhyRx_t * phy_rx )
 {
-    Console_PhyToJSONV2( phy_rx );
+    Capture_ProcessFrame( phy_rx );
     return true;
 }
 
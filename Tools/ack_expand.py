@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# Copyright (c) 2023 Eric St-Onge
+#
+# Expand acknowledgment records of the sniffer ({"cmd":"ack","ms":..}) back
+# into one capture record per acknowledgment, for tools expecting frames.
+#
+# JSON stream:  ack_expand.py < capture.txt > expanded.txt
+# JSON records {"K":"<tuples>","C":11,"T":12345678} become
+# {"L":5,"Q":0,"R":-60,"C":11,"T":12345690,"S":"02001e7a3c"}, other lines are
+# copied unchanged. LQI of folded acknowledgments is not kept, Q is 0.
+#
+# Binary stream:  ack_expand.py --binary < records.hex > expanded.hex
+# One binary record (payload of a channel 1 frame of multiplexed mode) per
+# line, in hex. Acknowledgment records, starting with 0x00, become one binary
+# frame record line each, other lines are copied unchanged.
+
+import argparse
+import json
+import struct
+import sys
+
+ACK_TUPLE_SIZE = 4
+ACK_TIME_UNIT_US = 4
+ACK_TIME_PENDING = 0x8000
+ACK_FRAME_CONTROL = 0x0002
+FRAME_PENDING = 0x0010
+
+
+def fcs(data):
+    """802.15.4 FCS, CRC-16/KERMIT"""
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc
+
+
+def expand_tuples(tuples, timestamp):
+    """Yield (frame, rssi, timestamp) of each folded acknowledgment"""
+    for i in range(0, len(tuples) - ACK_TUPLE_SIZE + 1, ACK_TUPLE_SIZE):
+        sequence, rssi, time = struct.unpack_from("<BbH", tuples, i)
+        frame_control = ACK_FRAME_CONTROL
+        if time & ACK_TIME_PENDING:
+            frame_control |= FRAME_PENDING
+        frame = struct.pack("<HB", frame_control, sequence)
+        frame += struct.pack("<H", fcs(frame))
+        yield frame, rssi, (timestamp + (time & ~ACK_TIME_PENDING) * ACK_TIME_UNIT_US) & 0xFFFFFFFF
+
+
+def expand_json(record):
+    """Return capture JSON lines of a {"K":..} record"""
+    lines = []
+    for frame, rssi, timestamp in expand_tuples(bytes.fromhex(record["K"]), record["T"]):
+        lines.append('{"L":%d,"Q":0,"R":%d,"C":%d,"T":%d,"S":"%s"}'
+                     % (len(frame), rssi, record["C"], timestamp, frame.hex()))
+    return lines
+
+
+def expand_binary(record):
+    """Return binary frame records of a binary acknowledgment record
+    marker | channel | count | timestamp (4) | tuples"""
+    _, channel, count, timestamp = struct.unpack_from("<BBBI", record, 0)
+    tuples = record[7:7 + count * ACK_TUPLE_SIZE]
+    return [struct.pack("<BBBbBI", len(frame), len(frame), 0, rssi, channel, time) + frame
+            for frame, rssi, time in expand_tuples(tuples, timestamp)]
+
+
+def expand_line(text):
+    """Return expanded lines of a JSON line, None if it is not an ack record"""
+    if text.startswith('{"K"'):
+        try:
+            return expand_json(json.loads(text))
+        except (ValueError, KeyError):
+            pass
+    return None
+
+
+def expand_hex_line(text):
+    """Return expanded hex lines of a binary record line, None if it is not an ack record"""
+    if text.startswith("00"):
+        try:
+            return [record.hex() for record in expand_binary(bytes.fromhex(text))]
+        except (ValueError, struct.error):
+            pass
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Expand sniffer acknowledgment records")
+    parser.add_argument("--binary", action="store_true",
+                        help="input and output are binary records, one per line in hex")
+    args = parser.parse_args()
+
+    expand = expand_hex_line if args.binary else expand_line
+    for line in sys.stdin:
+        expanded = expand(line.strip())
+        if expanded is None:
+            sys.stdout.write(line)
+            continue
+        for record in expanded:
+            sys.stdout.write(record + "\n")
+
+
+if __name__ == "__main__":
+    main()